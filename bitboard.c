@@ -0,0 +1,763 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * bitboard.c -- Bitset view of the black squares and grid topology
+ */
+
+#include <puz.h>
+
+/*
+  The bitboard keeps every row, and every column, of the board as a
+  PUZ_BB_WORDS-word bitset: bit c of row r (and bit r of column c) is
+  set if square (r,c) is black.  255 squares fit in four 64-bit words,
+  so every line of every legal board has the same fixed-size layout.
+
+  All the structural questions are then answered a word at a time.
+  For a line of white squares W, where bit i+1 is the square after
+  bit i:
+
+    starts = W & ~(W << 1) & (W >> 1)   (white, previous isn't, next is)
+    ends   = W & ~(W >> 1) & (W << 1)
+
+  which is exactly the .puz numbering rule for words of length >= 2.
+ */
+
+static void line_shl(uint64_t *dst, const uint64_t *src, int k);
+static void line_shr(uint64_t *dst, const uint64_t *src, int k);
+static void line_white(const uint64_t *black, int len, uint64_t *dst);
+static void line_fill(uint64_t *seed, const uint64_t *mask);
+static uint64_t reverse64(uint64_t x);
+static void line_reverse(const uint64_t *src, int len, uint64_t *dst);
+static void prefix_count(struct puz_bitboard_t *bb, int row0, int row, int col,
+                         int *slots, int *numbered);
+static void prefix_count_1(struct puz_bitboard_t *bb, int row0, int row,
+                           int col, int *slots, int *numbered);
+
+/**
+ * line_shl - shift a line towards higher square indices
+ *
+ * @dst: result (may not alias src)
+ * @src: line to shift
+ * @k: distance, 0 < k < 64
+ *
+ * This is an internal function.
+ */
+static void line_shl(uint64_t *dst, const uint64_t *src, int k) {
+  int i;
+
+  dst[0] = src[0] << k;
+  for(i = 1; i < PUZ_BB_WORDS; i++)
+    dst[i] = (src[i] << k) | (src[i-1] >> (64 - k));
+}
+
+/**
+ * line_shr - shift a line towards lower square indices
+ *
+ * @dst: result (may not alias src)
+ * @src: line to shift
+ * @k: distance, 0 < k < 64
+ *
+ * This is an internal function.
+ */
+static void line_shr(uint64_t *dst, const uint64_t *src, int k) {
+  int i;
+
+  for(i = 0; i < PUZ_BB_WORDS - 1; i++)
+    dst[i] = (src[i] >> k) | (src[i+1] << (64 - k));
+  dst[PUZ_BB_WORDS - 1] = src[PUZ_BB_WORDS - 1] >> k;
+}
+
+/**
+ * line_white - turn a line of black squares into a line of white ones
+ *
+ * @black: the black-square line
+ * @len: number of squares in the line
+ * @dst: result
+ *
+ * This is an internal function.  Bits at or past len are cleared.
+ */
+static void line_white(const uint64_t *black, int len, uint64_t *dst) {
+  int i;
+
+  for(i = 0; i < PUZ_BB_WORDS; i++) {
+    if(len >= 64 * (i + 1))
+      dst[i] = ~black[i];
+    else if(len <= 64 * i)
+      dst[i] = 0;
+    else
+      dst[i] = ~black[i] & ((1ULL << (len - 64 * i)) - 1);
+  }
+}
+
+/**
+ * line_fill - flood a seed along runs of a mask, in both directions
+ *
+ * @seed: set of squares to start from; replaced with the result
+ * @mask: squares the fill may pass through
+ *
+ * This is an internal function.  It's a Kogge-Stone fill, so it takes
+ * log2(255) steps per direction rather than one step per square.
+ */
+static void line_fill(uint64_t *seed, const uint64_t *mask) {
+  uint64_t g[PUZ_BB_WORDS], p[PUZ_BB_WORDS], t[PUZ_BB_WORDS];
+  int i, k;
+
+  /* towards higher indices */
+  memcpy(g, seed, sizeof(g));
+  memcpy(p, mask, sizeof(p));
+  for(k = 1; k < 256; k <<= 1) {
+    if(k < 64) {
+      line_shl(t, g, k);
+      for(i = 0; i < PUZ_BB_WORDS; i++)
+        g[i] |= p[i] & t[i];
+      line_shl(t, p, k);
+      for(i = 0; i < PUZ_BB_WORDS; i++)
+        p[i] &= t[i];
+    } else {
+      int w = k / 64;
+      for(i = PUZ_BB_WORDS - 1; i >= 0; i--) {
+        uint64_t gs = i >= w ? g[i-w] : 0;
+        uint64_t ps = i >= w ? p[i-w] : 0;
+        g[i] |= p[i] & gs;
+        p[i] &= ps;
+      }
+    }
+  }
+
+  /* and towards lower ones */
+  memcpy(p, mask, sizeof(p));
+  for(k = 1; k < 256; k <<= 1) {
+    if(k < 64) {
+      line_shr(t, g, k);
+      for(i = 0; i < PUZ_BB_WORDS; i++)
+        g[i] |= p[i] & t[i];
+      line_shr(t, p, k);
+      for(i = 0; i < PUZ_BB_WORDS; i++)
+        p[i] &= t[i];
+    } else {
+      int w = k / 64;
+      for(i = 0; i < PUZ_BB_WORDS; i++) {
+        uint64_t gs = i + w < PUZ_BB_WORDS ? g[i+w] : 0;
+        uint64_t ps = i + w < PUZ_BB_WORDS ? p[i+w] : 0;
+        g[i] |= p[i] & gs;
+        p[i] &= ps;
+      }
+    }
+  }
+
+  memcpy(seed, g, sizeof(g));
+}
+
+/**
+ * reverse64 - reverse the bits of a word
+ *
+ * This is an internal function.
+ */
+static uint64_t reverse64(uint64_t x) {
+  x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+  x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+  x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+  return __builtin_bswap64(x);
+}
+
+/**
+ * line_reverse - mirror a line end-for-end
+ *
+ * @src: line to mirror
+ * @len: number of squares in the line
+ * @dst: result (may not alias src)
+ *
+ * This is an internal function.  Square i of src becomes square
+ * len-1-i of dst.
+ */
+static void line_reverse(const uint64_t *src, int len, uint64_t *dst) {
+  uint64_t r[PUZ_BB_WORDS];
+  int i, pad = PUZ_BB_WORDS * 64 - len;
+
+  /* reverse all 256 bits, then shift the padding back out */
+  for(i = 0; i < PUZ_BB_WORDS; i++)
+    r[i] = reverse64(src[PUZ_BB_WORDS - 1 - i]);
+
+  memset(dst, 0, PUZ_BB_WORDS * sizeof(uint64_t));
+  for(i = 0; i < PUZ_BB_WORDS; i++) {
+    int w = pad / 64 + i, b = pad % 64;
+    if(w >= PUZ_BB_WORDS)
+      break;
+    dst[i] = r[w] >> b;
+    if(b && w + 1 < PUZ_BB_WORDS)
+      dst[i] |= r[w+1] << (64 - b);
+  }
+}
+
+/**
+ * puz_bitboard_calc - derive a puzzle's bitboard from its solution
+ *
+ * @puz: the puzzle (required)
+ *
+ * This is called on load and from puz_solution_set(), so the
+ * bitboard is normally already there; use puz_bitboard_get() to
+ * fetch it.  Any previous bitboard is freed.
+ *
+ * Return Value: NULL on error or if the puzzle has no solution, else
+ * the puzzle's new bitboard.
+ */
+struct puz_bitboard_t *puz_bitboard_calc(struct puzzle_t *puz) {
+  struct puz_bitboard_t *bb;
+  int w, h, r, c;
+
+  if(NULL == puz)
+    return NULL;
+
+  free(puz->bitboard);
+  puz->bitboard = NULL;
+
+  if(NULL == puz->solution)
+    return NULL;
+
+  w = puz_width_get(puz);
+  h = puz_height_get(puz);
+
+  bb = (struct puz_bitboard_t *)calloc(1, sizeof(struct puz_bitboard_t) +
+                                       (w + h) * sizeof(*bb->lines));
+  if(NULL == bb) {
+    perror("calloc");
+    return NULL;
+  }
+
+  bb->width = w;
+  bb->height = h;
+  bb->rows = bb->lines;
+  bb->cols = bb->lines + h;
+
+  for(r = 0; r < h; r++) {
+    for(c = 0; c < w; c++) {
+      if(puz->solution[r*w + c] == '.') {
+        bb->rows[r][c/64] |= 1ULL << (c%64);
+        bb->cols[c][r/64] |= 1ULL << (r%64);
+      }
+    }
+  }
+
+  puz->bitboard = bb;
+  return bb;
+}
+
+/**
+ * puz_bitboard_get - get a puzzle's bitboard
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ *
+ * Returns NULL on error or if field is unset.
+ */
+struct puz_bitboard_t *puz_bitboard_get(struct puzzle_t *puz) {
+  if(NULL == puz)
+    return NULL;
+
+  return puz->bitboard;
+}
+
+/**
+ * puz_bitboard_black_get - check whether a square is black
+ *
+ * @bb: the bitboard (required)
+ * @row: row of the square
+ * @col: column of the square
+ *
+ * Returns 1 if black, 0 if white, -1 on error.
+ */
+int puz_bitboard_black_get(struct puz_bitboard_t *bb, int row, int col) {
+  if(NULL == bb || row < 0 || col < 0 || row >= bb->height || col >= bb->width)
+    return -1;
+
+  return (bb->rows[row][col/64] >> (col%64)) & 1;
+}
+
+/**
+ * puz_bitboard_black_set - make a square black or white
+ *
+ * @bb: the bitboard (required)
+ * @row: row of the square
+ * @col: column of the square
+ * @black: nonzero for black, zero for white
+ *
+ * This only changes the bitboard, which is what constructor tools
+ * want when trying out patterns.  It doesn't touch the solution.
+ *
+ * Returns -1 on error, else the old value.
+ */
+int puz_bitboard_black_set(struct puz_bitboard_t *bb, int row, int col,
+                           int black) {
+  int old = puz_bitboard_black_get(bb, row, col);
+
+  if(old < 0)
+    return -1;
+
+  if(black) {
+    bb->rows[row][col/64] |= 1ULL << (col%64);
+    bb->cols[col][row/64] |= 1ULL << (row%64);
+  } else {
+    bb->rows[row][col/64] &= ~(1ULL << (col%64));
+    bb->cols[col][row/64] &= ~(1ULL << (row%64));
+  }
+
+  return old;
+}
+
+/**
+ * puz_bitboard_across_starts - find where the across words in a row begin
+ *
+ * @bb: the bitboard (required)
+ * @row: the row
+ * @starts: PUZ_BB_WORDS words to receive the set of first squares
+ * @ends: PUZ_BB_WORDS words to receive the set of last squares, or NULL
+ *
+ * Only words of at least two squares are counted.
+ *
+ * Returns -1 on error, else the number of words in the row.
+ */
+int puz_bitboard_across_starts(struct puz_bitboard_t *bb, int row,
+                               uint64_t *starts, uint64_t *ends) {
+  uint64_t wh[PUZ_BB_WORDS], prev[PUZ_BB_WORDS], next[PUZ_BB_WORDS];
+  int i, n = 0;
+
+  if(NULL == bb || NULL == starts || row < 0 || row >= bb->height)
+    return -1;
+
+  line_white(bb->rows[row], bb->width, wh);
+  line_shl(prev, wh, 1);
+  line_shr(next, wh, 1);
+
+  for(i = 0; i < PUZ_BB_WORDS; i++) {
+    starts[i] = wh[i] & ~prev[i] & next[i];
+    if(ends)
+      ends[i] = wh[i] & ~next[i] & prev[i];
+    n += __builtin_popcountll(starts[i]);
+  }
+
+  return n;
+}
+
+/**
+ * puz_bitboard_down_starts - find where the down words in a column begin
+ *
+ * @bb: the bitboard (required)
+ * @col: the column
+ * @starts: PUZ_BB_WORDS words to receive the set of first squares (bit = row)
+ * @ends: PUZ_BB_WORDS words to receive the set of last squares, or NULL
+ *
+ * Only words of at least two squares are counted.
+ *
+ * Returns -1 on error, else the number of words in the column.
+ */
+int puz_bitboard_down_starts(struct puz_bitboard_t *bb, int col,
+                             uint64_t *starts, uint64_t *ends) {
+  uint64_t wh[PUZ_BB_WORDS], prev[PUZ_BB_WORDS], next[PUZ_BB_WORDS];
+  int i, n = 0;
+
+  if(NULL == bb || NULL == starts || col < 0 || col >= bb->width)
+    return -1;
+
+  line_white(bb->cols[col], bb->height, wh);
+  line_shl(prev, wh, 1);
+  line_shr(next, wh, 1);
+
+  for(i = 0; i < PUZ_BB_WORDS; i++) {
+    starts[i] = wh[i] & ~prev[i] & next[i];
+    if(ends)
+      ends[i] = wh[i] & ~next[i] & prev[i];
+    n += __builtin_popcountll(starts[i]);
+  }
+
+  return n;
+}
+
+/**
+ * puz_bitboard_word_count - count the words on the board
+ *
+ * @bb: the bitboard (required)
+ * @across: if not NULL, receives the number of across words
+ * @down: if not NULL, receives the number of down words
+ *
+ * For a well-formed puzzle the total equals the clue count.
+ *
+ * Returns -1 on error, else the total number of words.
+ */
+int puz_bitboard_word_count(struct puz_bitboard_t *bb, int *across, int *down) {
+  uint64_t s[PUZ_BB_WORDS];
+  int i, a = 0, d = 0;
+
+  if(NULL == bb)
+    return -1;
+
+  for(i = 0; i < bb->height; i++)
+    a += puz_bitboard_across_starts(bb, i, s, NULL);
+  for(i = 0; i < bb->width; i++)
+    d += puz_bitboard_down_starts(bb, i, s, NULL);
+
+  if(across)
+    *across = a;
+  if(down)
+    *down = d;
+
+  return a + d;
+}
+
+/**
+ * puz_bitboard_is_symmetric - check for 180-degree rotational symmetry
+ *
+ * @bb: the bitboard (required)
+ *
+ * Returns 1 if the black squares are symmetric, 0 if not or on error.
+ */
+int puz_bitboard_is_symmetric(struct puz_bitboard_t *bb) {
+  uint64_t rev[PUZ_BB_WORDS];
+  int r, i;
+
+  if(NULL == bb)
+    return 0;
+
+  for(r = 0; r <= (bb->height - 1) / 2; r++) {
+    line_reverse(bb->rows[bb->height - 1 - r], bb->width, rev);
+    for(i = 0; i < PUZ_BB_WORDS; i++) {
+      if(rev[i] != bb->rows[r][i])
+        return 0;
+    }
+  }
+
+  return 1;
+}
+
+/**
+ * puz_bitboard_is_connected - check that all white squares form one region
+ *
+ * @bb: the bitboard (required)
+ *
+ * This floods outwards from the first white square, a whole row at a
+ * time, until nothing changes.  A board with no white squares counts
+ * as connected.
+ *
+ * Returns 1 if connected, 0 if not or on error.
+ */
+int puz_bitboard_is_connected(struct puz_bitboard_t *bb) {
+  uint64_t (*wh)[PUZ_BB_WORDS], (*reach)[PUZ_BB_WORDS];
+  uint64_t x[PUZ_BB_WORDS];
+  int r, i, changed, seeded = 0, connected = 1;
+
+  if(NULL == bb)
+    return 0;
+
+  wh = calloc(2 * (bb->height + 1), sizeof(*wh));
+  if(NULL == wh) {
+    perror("calloc");
+    return 0;
+  }
+  reach = wh + bb->height + 1;
+
+  for(r = 0; r < bb->height; r++) {
+    line_white(bb->rows[r], bb->width, wh[r]);
+    for(i = 0; i < PUZ_BB_WORDS && !seeded; i++) {
+      if(wh[r][i]) {
+        reach[r][i] = wh[r][i] & -wh[r][i]; /* lowest white square */
+        seeded = 1;
+      }
+    }
+  }
+
+  do {
+    changed = 0;
+    /* sweep down then up, so a snake-shaped region still settles fast */
+    for(r = 0; r < 2 * bb->height; r++) {
+      int row = r < bb->height ? r : 2 * bb->height - 1 - r;
+
+      for(i = 0; i < PUZ_BB_WORDS; i++) {
+        x[i] = reach[row][i];
+        if(row > 0)
+          x[i] |= reach[row-1][i] & wh[row][i];
+        if(row + 1 < bb->height)
+          x[i] |= reach[row+1][i] & wh[row][i];
+      }
+      line_fill(x, wh[row]);
+
+      if(memcmp(x, reach[row], sizeof(x))) {
+        memcpy(reach[row], x, sizeof(x));
+        changed = 1;
+      }
+    }
+  } while(changed);
+
+  for(r = 0; r < bb->height && connected; r++) {
+    if(memcmp(reach[r], wh[r], sizeof(x)))
+      connected = 0;
+  }
+
+  free(wh);
+
+  return connected;
+}
+
+/**
+ * puz_bitboard_unchecked_count - count the white squares not in two words
+ *
+ * @bb: the bitboard (required)
+ *
+ * A white square is unchecked if it has no white neighbour across, or
+ * none down, so it belongs to at most one word.
+ *
+ * Returns -1 on error; else a non-negative value
+ */
+int puz_bitboard_unchecked_count(struct puz_bitboard_t *bb) {
+  uint64_t (*single)[PUZ_BB_WORDS];
+  uint64_t wh[PUZ_BB_WORDS], prev[PUZ_BB_WORDS], next[PUZ_BB_WORDS], s;
+  int r, c, i, n = 0;
+
+  if(NULL == bb)
+    return -1;
+
+  single = calloc(bb->height + 1, sizeof(*single));
+  if(NULL == single) {
+    perror("calloc");
+    return -1;
+  }
+
+  for(r = 0; r < bb->height; r++) {
+    line_white(bb->rows[r], bb->width, wh);
+    line_shl(prev, wh, 1);
+    line_shr(next, wh, 1);
+    for(i = 0; i < PUZ_BB_WORDS; i++) {
+      single[r][i] = wh[i] & ~prev[i] & ~next[i];
+      n += __builtin_popcountll(single[r][i]);
+    }
+  }
+
+  /* add the squares alone down, unless already counted across */
+  for(c = 0; c < bb->width; c++) {
+    line_white(bb->cols[c], bb->height, wh);
+    line_shl(prev, wh, 1);
+    line_shr(next, wh, 1);
+    for(i = 0; i < PUZ_BB_WORDS; i++) {
+      for(s = wh[i] & ~prev[i] & ~next[i]; s; s &= s - 1) {
+        r = i * 64 + __builtin_ctzll(s);
+        n += !((single[r][c/64] >> (c%64)) & 1);
+      }
+    }
+  }
+
+  free(single);
+
+  return n;
+}
+
+/**
+ * prefix_count - count the words and numbered squares before a square
+ *
+ * @bb: the bitboard
+ * @row0: the first row to count
+ * @row: row of the square; bb->height counts the whole board
+ * @col: column of the square
+ * @slots: receives the number of words starting from row0 up to
+ *   (row,col)
+ * @numbered: likewise, the number of numbered squares
+ *
+ * This is an internal function.  "Before" is in row-major order, so
+ * this is how .puz files number squares and order their clues.  The
+ * down starts of a row are its white squares with black (or nothing)
+ * above and white below, so both directions are counted a row at a
+ * time.  Boards up to 64 wide, which is nearly all of them, go to
+ * prefix_count_1().
+ */
+static void prefix_count(struct puz_bitboard_t *bb, int row0, int row, int col,
+                         int *slots, int *numbered) {
+  uint64_t above[PUZ_BB_WORDS], wh[PUZ_BB_WORDS], below[PUZ_BB_WORDS];
+  uint64_t prev[PUZ_BB_WORDS], next[PUZ_BB_WORDS];
+  uint64_t across, down, mask;
+  int r, i, s = 0, n = 0, nw = (bb->width + 63) / 64;
+
+  if(1 == nw) {
+    prefix_count_1(bb, row0, row, col, slots, numbered);
+    return;
+  }
+
+  memset(above, 0, sizeof(above));
+  memset(below, 0, sizeof(below));
+  if(row0 > 0)
+    line_white(bb->rows[row0-1], bb->width, above);
+  if(row0 < bb->height)
+    line_white(bb->rows[row0], bb->width, wh);
+
+  for(r = row0; r <= row && r < bb->height; r++) {
+    if(r + 1 < bb->height)
+      line_white(bb->rows[r+1], bb->width, below);
+    else
+      memset(below, 0, sizeof(below));
+
+    line_shl(prev, wh, 1);
+    line_shr(next, wh, 1);
+
+    /* the words past the board's width are all empty */
+    for(i = 0; i < nw; i++) {
+      across = wh[i] & ~prev[i] & next[i];
+      down = wh[i] & ~above[i] & below[i];
+
+      if(r == row) {
+        if(col <= i * 64)
+          break;
+        if(col < (i + 1) * 64) {
+          mask = (1ULL << (col % 64)) - 1;
+          across &= mask;
+          down &= mask;
+        }
+      }
+      s += __builtin_popcountll(across) + __builtin_popcountll(down);
+      n += __builtin_popcountll(across | down);
+    }
+
+    memcpy(above, wh, sizeof(wh));
+    memcpy(wh, below, sizeof(wh));
+  }
+
+  *slots = s;
+  *numbered = n;
+}
+
+/**
+ * prefix_count_1 - prefix_count() for a board at most 64 squares wide
+ *
+ * This is an internal function.  Each row is one word, so the shifts
+ * and masks are single instructions rather than loops over
+ * PUZ_BB_WORDS words.
+ */
+static void prefix_count_1(struct puz_bitboard_t *bb, int row0, int row,
+                           int col, int *slots, int *numbered) {
+  uint64_t full, above = 0, wh = 0, below, across, down, mask;
+  int r, s = 0, n = 0;
+
+  full = bb->width == 64 ? ~0ULL : (1ULL << bb->width) - 1;
+
+  if(row0 > 0)
+    above = ~bb->rows[row0-1][0] & full;
+  if(row0 < bb->height)
+    wh = ~bb->rows[row0][0] & full;
+
+  for(r = row0; r <= row && r < bb->height; r++) {
+    below = r + 1 < bb->height ? ~bb->rows[r+1][0] & full : 0;
+
+    across = wh & ~(wh << 1) & (wh >> 1);
+    down = wh & ~above & below;
+
+    if(r == row) {
+      mask = (1ULL << col) - 1;
+      across &= mask;
+      down &= mask;
+    }
+    s += __builtin_popcountll(across) + __builtin_popcountll(down);
+    n += __builtin_popcountll(across | down);
+
+    above = wh;
+    wh = below;
+  }
+
+  *slots = s;
+  *numbered = n;
+}
+
+/**
+ * puz_bitboard_is_start - check whether a word starts on a square
+ *
+ * @bb: the bitboard (required)
+ * @row: row of the square
+ * @col: column of the square
+ * @dir: 0 for across, 1 for down
+ *
+ * Returns 1 if a word of at least two squares starts there, 0 if not
+ * or on error.
+ */
+int puz_bitboard_is_start(struct puz_bitboard_t *bb, int row, int col, int dir) {
+  if(puz_bitboard_black_get(bb, row, col) != 0)
+    return 0;
+
+  if(0 == dir)
+    return (col == 0 || puz_bitboard_black_get(bb, row, col - 1)) &&
+      0 == puz_bitboard_black_get(bb, row, col + 1);
+
+  return (row == 0 || puz_bitboard_black_get(bb, row - 1, col)) &&
+    0 == puz_bitboard_black_get(bb, row + 1, col);
+}
+
+/**
+ * puz_bitboard_slot_range - count the words starting in a range of squares
+ *
+ * @bb: the bitboard (required)
+ * @row0: the first row of the range
+ * @row: row of the first square after the range; the board's height
+ *   runs the range to the end of the board
+ * @col: column of that square
+ * @dir: 1 to count the across word starting on that square, if any
+ *
+ * Squares run in row-major order, and a square's across word comes
+ * before its down word, which is the order of the clues.  Only the
+ * rows in the range are looked at.
+ *
+ * Returns -1 on error; else a non-negative value
+ */
+int puz_bitboard_slot_range(struct puz_bitboard_t *bb, int row0, int row,
+                            int col, int dir) {
+  int slots, numbered;
+
+  if(NULL == bb || row0 < 0 || row < row0 || row > bb->height ||
+     col < 0 || col >= bb->width)
+    return -1;
+
+  prefix_count(bb, row0, row, col, &slots, &numbered);
+  if(dir && row < bb->height && puz_bitboard_is_start(bb, row, col, 0))
+    slots++;
+
+  return slots;
+}
+
+/**
+ * puz_bitboard_slot_index - find a word's position in clue order
+ *
+ * @bb: the bitboard (required)
+ * @row: row of the word's first square
+ * @col: column of the word's first square
+ * @dir: 0 for across, 1 for down
+ *
+ * The word need not exist: this is the index it has, or would have.
+ * Passing the board's height as @row gives the total number of words.
+ *
+ * Returns -1 on error; else a non-negative value
+ */
+int puz_bitboard_slot_index(struct puz_bitboard_t *bb, int row, int col, int dir) {
+  return puz_bitboard_slot_range(bb, 0, row, col, dir);
+}
+
+/**
+ * puz_bitboard_square_number - get the clue number printed in a square
+ *
+ * @bb: the bitboard (required)
+ * @row: row of the square
+ * @col: column of the square
+ *
+ * Returns -1 on error, 0 if the square isn't numbered, else its number.
+ */
+int puz_bitboard_square_number(struct puz_bitboard_t *bb, int row, int col) {
+  int slots, numbered;
+
+  if(NULL == bb || row < 0 || row >= bb->height || col < 0 || col >= bb->width)
+    return -1;
+
+  if(!puz_bitboard_is_start(bb, row, col, 0) &&
+     !puz_bitboard_is_start(bb, row, col, 1))
+    return 0;
+
+  prefix_count(bb, 0, row, col, &slots, &numbered);
+
+  return numbered + 1;
+}
@@ -0,0 +1,207 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * check.c -- Check many user grids against one solution
+ */
+
+#include <puz.h>
+
+/*
+  The solution is copied once into a buffer padded out to a multiple
+  of 64 bytes with '.', so padding never counts as correct or
+  incorrect.  Users are then processed in tiles of CHECK_USER_TILE,
+  and within a tile the board is walked in blocks of CHECK_CELL_BLOCK
+  cells: every user in the tile is checked against one block of the
+  solution before moving on, so the solution block stays in L1 no
+  matter how big the board is.  For the usual 15x15 and 21x21 boards
+  the whole solution is a single block.
+
+  The block itself is checked by puz_kernels.check, which has a
+  version per instruction set; see cpu.c.
+
+  Tiles are handed out one at a time to tasks on the library's pool
+  (see pool.c), so a slow tile doesn't hold up a whole range.
+ */
+#define CHECK_CELL_BLOCK 4096
+#define CHECK_USER_TILE  32
+
+struct check_job_t {
+  unsigned char *solution; /* padded copy */
+  int bd_sz;
+  int padded_sz;
+
+  unsigned char **grids;
+  struct puz_check_result_t *results;
+  unsigned char **mismatch;
+  int n;
+
+  int next; /* the next tile to take */
+};
+
+static void check_tiles(void *arg);
+
+/**
+ * check_tiles - check tiles of users until there are none left
+ *
+ * @arg: the struct check_job_t, shared by every task
+ *
+ * This is an internal function, and is the pool task for
+ * puz_check_grids().
+ */
+static void check_tiles(void *arg) {
+  struct check_job_t *job = (struct check_job_t *)arg;
+  int u0, u, end, off, len;
+
+  for(;;) {
+    u0 = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED) * CHECK_USER_TILE;
+    if(u0 >= job->n)
+      break;
+    end = u0 + CHECK_USER_TILE;
+    if(end > job->n)
+      end = job->n;
+
+    for(u = u0; u < end; u++)
+      memset(&job->results[u], 0, sizeof(struct puz_check_result_t));
+
+    for(off = 0; off < job->padded_sz; off += CHECK_CELL_BLOCK) {
+      len = job->padded_sz - off;
+      if(len > CHECK_CELL_BLOCK)
+        len = CHECK_CELL_BLOCK;
+
+      for(u = u0; u < end; u++) {
+        if(NULL == job->grids[u]) {
+          job->results[u].correct = job->results[u].incorrect = -1;
+          continue;
+        }
+        puz_kernels.check(job->solution, job->grids[u], off, len,
+                          job->bd_sz, &job->results[u],
+                          job->mismatch ? job->mismatch[u] : NULL);
+      }
+    }
+  }
+}
+
+/**
+ * puz_check_grids - check many user grids against one solution
+ *
+ * @ref: the puzzle holding the solution (required)
+ * @grids: array of n user grids, each width*height bytes in grid format (required)
+ * @n: number of grids
+ * @results: array of n results to fill in (required)
+ * @mismatch: optional array of n bitmaps of (width*height+7)/8 bytes
+ *   each.  Bit i is set if square i holds a wrong letter.  May be NULL.
+ * @nthreads: how many tasks to spread the users over, on the library's
+ *   thread pool (see pool.c); 0 means one per pool thread, plus this
+ *   one.
+ *
+ * A square counts as correct if it holds the solution letter, and as
+ * incorrect if it holds anything else but '-'.  Black squares count
+ * as neither.  Rebus squares are checked by their single grid letter
+ * only; use the per-puzzle progress counts for full rebus checking.
+ * A NULL grid gets -1 for both counts.
+ *
+ * Return Value: -1 on error, 0 on success.
+ */
+int puz_check_grids(struct puzzle_t *ref, unsigned char **grids, int n,
+                    struct puz_check_result_t *results,
+                    unsigned char **mismatch, int nthreads) {
+  struct check_job_t job;
+  struct puz_group_t g;
+  unsigned char *sol;
+  int i, bd_sz, padded_sz, tiles;
+
+  if(NULL == ref || NULL == ref->solution || NULL == grids ||
+     NULL == results || n < 0)
+    return -1;
+
+  if(n == 0)
+    return 0;
+
+  bd_sz = puz_width_get(ref) * puz_height_get(ref);
+  padded_sz = (bd_sz + 63) & ~63;
+
+  sol = (unsigned char *)malloc(padded_sz);
+  if(NULL == sol) {
+    perror("malloc");
+    return -1;
+  }
+  memset(sol, '.', padded_sz);
+  memcpy(sol, ref->solution, bd_sz);
+
+  tiles = (n + CHECK_USER_TILE - 1) / CHECK_USER_TILE;
+  if(nthreads <= 0)
+    nthreads = puz_pool_threads_get() + 1;
+  if(nthreads > tiles)
+    nthreads = tiles;
+
+  job.solution = sol;
+  job.bd_sz = bd_sz;
+  job.padded_sz = padded_sz;
+  job.grids = grids;
+  job.results = results;
+  job.mismatch = mismatch;
+  job.n = n;
+  job.next = 0;
+
+  /* the calling thread works too */
+  puz_group_init(&g);
+  for(i = 1; i < nthreads; i++)
+    puz_group_spawn(&g, check_tiles, &job);
+  check_tiles(&job);
+  puz_group_wait(&g);
+
+  free(sol);
+
+  return 0;
+}
+
+/**
+ * puz_check_puzzles - check many users' puzzles against one solution
+ *
+ * @ref: the puzzle holding the solution (required)
+ * @puzzles: array of n user puzzles, the same size as ref (required)
+ * @n: number of puzzles
+ * @results: array of n results to fill in (required)
+ * @mismatch: optional array of n bitmaps, as for puz_check_grids()
+ * @nthreads: as for puz_check_grids()
+ *
+ * This is puz_check_grids() over the grids of the given puzzles.
+ * Puzzles of a different size than ref get -1 for both counts.
+ *
+ * Return Value: -1 on error, 0 on success.
+ */
+int puz_check_puzzles(struct puzzle_t *ref, struct puzzle_t **puzzles, int n,
+                      struct puz_check_result_t *results,
+                      unsigned char **mismatch, int nthreads) {
+  unsigned char **grids;
+  int i, rv;
+
+  if(NULL == ref || NULL == puzzles || n < 0)
+    return -1;
+
+  grids = (unsigned char **)malloc((n ? n : 1) * sizeof(unsigned char *));
+  if(NULL == grids) {
+    perror("malloc");
+    return -1;
+  }
+
+  for(i = 0; i < n; i++) {
+    grids[i] = NULL;
+    if(puzzles[i] && puz_width_get(puzzles[i]) == puz_width_get(ref) &&
+       puz_height_get(puzzles[i]) == puz_height_get(ref))
+      grids[i] = puz_grid_get(puzzles[i]);
+  }
+
+  rv = puz_check_grids(ref, grids, n, results, mismatch, nthreads);
+
+  free(grids);
+
+  return rv;
+}
@@ -21,6 +21,8 @@ static void magic_gen_10(unsigned char *dest, unsigned short *sums);
 static void magic_gen_14(unsigned char *dest, unsigned short *sums);
 static unsigned short rtbl_gen(struct puzzle_t *puz);
 static unsigned short rusr_gen(struct puzzle_t *puz);
+static unsigned short cksum_board(unsigned char *base, int bd_sz,
+                                  unsigned short cksum);
 
 /**
  * puz_cksum_region - Checksum a region using PUZ's rotate-and-sum
@@ -29,30 +31,66 @@ static unsigned short rusr_gen(struct puzzle_t *puz);
  * @len: length to run the checksum over
  * @cksum: the initial value of the checksum
  *
- * This is used to run the PUZ checksum over chunks of memory.
+ * This is used to run the PUZ checksum over chunks of memory.  The
+ * loop itself is puz_kernels.cksum; see cpu.c.
  *
  * Return Value: it returns the new checksum value.
  */
 unsigned short puz_cksum_region(unsigned char *base, int len,
                                 unsigned short cksum) {
+  cksum = puz_kernels.cksum(base, len, cksum);
+
+#if PRINT_CKSUM_RESULTS
+  printf("\t%d %d\n", len, cksum);
+#endif
+
+  return cksum;
+}
+
+/**
+ * cksum_fixed - puz_cksum_region() for a length known at compile time
+ *
+ * This is an internal function.  It is always inlined, so a call with
+ * a constant @len gets its own copy of the loop with a fixed trip
+ * count, which the compiler unrolls.
+ */
+static inline __attribute__((always_inline))
+unsigned short cksum_fixed(unsigned char *base, int len,
+                           unsigned short cksum) {
   int i;
 
+#pragma GCC unroll 8
   for(i = 0; i < len; i++) {
-    if(cksum & 0x0001)
-      cksum = (cksum >> 1) + 0x8000;
-    else
-      cksum = cksum >> 1;
-
-    cksum += *(base+i);
+    cksum = (cksum >> 1) | (cksum << 15);
+    cksum += base[i];
   }
 
-#if PRINT_CKSUM_RESULTS
-  printf("\t%d %d\n", i, cksum);
-#endif
-
   return cksum;
 }
 
+/**
+ * cksum_board - checksum one board's worth of squares
+ *
+ * @base: the board: solution, grid, GRBS or GEXT
+ * @bd_sz: width * height
+ * @cksum: the initial value of the checksum
+ *
+ * This is an internal function.  Nearly every puzzle is 15x15 or
+ * 21x21, so those sizes get fixed-size copies of the loop; anything
+ * else goes through puz_cksum_region().
+ */
+static unsigned short cksum_board(unsigned char *base, int bd_sz,
+                                  unsigned short cksum) {
+  switch(bd_sz) {
+  case 15*15:
+    return cksum_fixed(base, 15*15, cksum);
+  case 21*21:
+    return cksum_fixed(base, 21*21, cksum);
+  default:
+    return puz_cksum_region(base, bd_sz, cksum);
+  }
+}
+
 /**
  * puz_cksum_cib - Calculate the CIB Checksum for a puzzle
  *
@@ -65,7 +103,7 @@ unsigned short puz_cksum_region(unsigned char *base, int len,
 static unsigned short puz_cksum_cib(struct puzzle_t *puz) {
   unsigned short cksum;
   // First checksum header info
-  cksum = puz_cksum_region(puz->cib, 8, 0);
+  cksum = puz_cksum_region(puz->cold.cib, 8, 0);
   
   return cksum;
 }
@@ -105,9 +143,9 @@ unsigned short puz_cksum(struct puzzle_t *puz, unsigned short cksum) {
 
 #if CKSUM_PIECEWISE
   // checksum  solutions
-  cksum = puz_cksum_region(puz->solution, puz_a, cksum);
+  cksum = cksum_board(puz->solution, puz_a, cksum);
   // Next checksum grid
-  cksum = puz_cksum_region(puz->grid, puz_a, cksum);
+  cksum = cksum_board(puz->grid, puz_a, cksum);
   
   // title string w/NUL
   if(Sstrlen(puz->title) > 0) {
@@ -146,7 +184,7 @@ unsigned short puz_cksum(struct puzzle_t *puz, unsigned short cksum) {
   for(i = 0; i < puz->header.clue_count; i++)
     cksum = puz_cksum_region(puz->clues[i], Sstrlen(puz->clues[i]), cksum);
   // notes string w/NUL
-  if (Sstrlen(puz->notes) > 0) {
+  if (puz->notes && Sstrlen(puz->notes) > 0) {
     cksum = puz_cksum_region(puz->notes, Sstrlen(puz->notes)+1, cksum);
   }
 
@@ -219,7 +257,7 @@ unsigned short puz_cksum2(struct puzzle_t *puz, unsigned short cksum) {
   for(i = 0; i < puz->header.clue_count; i++)
     cksum = puz_cksum_region(puz->clues[i], Sstrlen(puz->clues[i]), cksum);
   // notes string w/NUL
-  if (Sstrlen(puz->notes) > 0) {
+  if (puz->notes && Sstrlen(puz->notes) > 0) {
     cksum = puz_cksum_region(puz->notes, Sstrlen(puz->notes)+1, cksum);
   }
 
@@ -344,11 +382,11 @@ static unsigned short rusr_gen(struct puzzle_t *puz) {
 int puz_cksums_calc(struct puzzle_t *puz) {
   unsigned short soln, puz0, cib, puzcib, grid;
 
-  w_le_8(puz->cib+0, puz->header.width);
-  w_le_8(puz->cib+1, puz->header.height);
-  w_le_16(puz->cib+2, puz->header.clue_count);
-  w_le_16(puz->cib+4, puz->header.x_unk_30);
-  w_le_16(puz->cib+6, puz->header.scrambled_tag);
+  w_le_8(puz->cold.cib+0, puz->header.width);
+  w_le_8(puz->cold.cib+1, puz->header.height);
+  w_le_16(puz->cold.cib+2, puz->header.clue_count);
+  w_le_16(puz->cold.cib+4, puz->header.x_unk_30);
+  w_le_16(puz->cold.cib+6, puz->header.scrambled_tag);
 
   puz0 = puz_cksum2(puz, 0x0000);
   cib = puz_cksum_cib(puz);
@@ -356,39 +394,37 @@ int puz_cksums_calc(struct puzzle_t *puz) {
 
   int bd_size = puz->header.width*puz->header.height;
 
-  grid = puz_cksum_region(puz->grid, bd_size, 0x0000);
-  soln = puz_cksum_region(puz->solution, bd_size, 0x0000);
+  grid = cksum_board(puz->grid, bd_size, 0x0000);
+  soln = cksum_board(puz->solution, bd_size, 0x0000);
 
   // printf("Cksums: %04x %04x %04x %04x\n", soln, cib, puz0, grid);
 
-  puz->calc_cksum_puzcib = puzcib;
+  puz->cold.calc_cksum_puzcib = puzcib;
   
-  puz->calc_cksums[0] = cib;
-  puz->calc_cksums[1] = soln;
-  puz->calc_cksums[2] = grid;
-  puz->calc_cksums[3] = puz0;
+  puz->cold.calc_cksums[0] = cib;
+  puz->cold.calc_cksums[1] = soln;
+  puz->cold.calc_cksums[2] = grid;
+  puz->cold.calc_cksums[3] = puz0;
 
-  magic_gen_10(puz->calc_magic10, puz->calc_cksums);
-  magic_gen_14(puz->calc_magic14, puz->calc_cksums);
+  magic_gen_10(puz->cold.calc_magic10, puz->cold.calc_cksums);
+  magic_gen_14(puz->cold.calc_magic14, puz->cold.calc_cksums);
 
   if (puz_has_rebus(puz)) {
-    puz->calc_grbs_cksum = 
-      puz_cksum_region(puz->grbs, bd_size, 0x0000);
-    puz->calc_rtbl_cksum = rtbl_gen(puz);
+    puz->cold.calc_grbs_cksum = cksum_board(puz->grbs, bd_size, 0x0000);
+    puz->cold.calc_rtbl_cksum = rtbl_gen(puz);
   }
 
   if (puz_has_timer(puz)) {
-    puz->calc_ltim_cksum = puz_cksum_region(puz->ltim, Sstrlen(puz->ltim),
+    puz->cold.calc_ltim_cksum = puz_cksum_region(puz->ltim, Sstrlen(puz->ltim),
                                             0x0000);
   }
 
   if (puz_has_extras(puz)) {
-    puz->calc_gext_cksum = 
-      puz_cksum_region(puz->gext, bd_size, 0x0000);
+    puz->cold.calc_gext_cksum = cksum_board(puz->gext, bd_size, 0x0000);
   }
 
   if (puz_has_rusr(puz)) {
-    puz->calc_rusr_cksum = rusr_gen(puz);
+    puz->cold.calc_rusr_cksum = rusr_gen(puz);
   }
 
   return 0;
@@ -416,66 +452,66 @@ int puz_cksums_check(struct puzzle_t *puz) {
 
   puz_cksums_calc(puz);
 
-  if(puz->header.cksum_cib != puz->calc_cksums[0]) {
+  if(puz->cold.cksum_cib != puz->cold.calc_cksums[0]) {
     printf("CIBs differ: got %04x, calc %04x\n", 
-	   puz->header.cksum_cib, puz->calc_cksums[0]);
+	   puz->cold.cksum_cib, puz->cold.calc_cksums[0]);
     retval++;
   }
-  if(puz->header.cksum_puz != puz->calc_cksum_puzcib) {
+  if(puz->cold.cksum_puz != puz->cold.calc_cksum_puzcib) {
     printf("PUZ cksums differ: got %04x, calc %04x\n", 
-	   puz->header.cksum_puz, puz->calc_cksum_puzcib);
+	   puz->cold.cksum_puz, puz->cold.calc_cksum_puzcib);
     retval++;
   }
 
   for(i = 0; i < 4; i++) {
-    if(puz->header.magic_10[i] != puz->calc_magic10[i]) {
+    if(puz->cold.magic_10[i] != puz->cold.calc_magic10[i]) {
       printf("magic 10 %d differs: got %02x, calc %02x\n", 
-	     i, puz->header.magic_10[i], puz->calc_magic10[i]);
+	     i, puz->cold.magic_10[i], puz->cold.calc_magic10[i]);
       retval++;
     }
   }
 
   for(i = 0; i < 4; i++) {
-    if(puz->header.magic_14[i] != puz->calc_magic14[i]) {
+    if(puz->cold.magic_14[i] != puz->cold.calc_magic14[i]) {
       printf("magic 14 %d differs: got %02x, calc %02x\n", 
-	     i, puz->header.magic_14[i], puz->calc_magic14[i]);
+	     i, puz->cold.magic_14[i], puz->cold.calc_magic14[i]);
       retval++;
     }
   }
 
   if (puz_has_rebus(puz)) {
-    if(puz->grbs_cksum != puz->calc_grbs_cksum) {
+    if(puz->cold.grbs_cksum != puz->cold.calc_grbs_cksum) {
       printf("GRBS checksum differs: got %02x, calc %02x\n", 
-             puz->grbs_cksum, puz->calc_grbs_cksum);
+             puz->cold.grbs_cksum, puz->cold.calc_grbs_cksum);
       retval++;
     }
-    if(puz->rtbl_cksum != puz->calc_rtbl_cksum) {
+    if(puz->cold.rtbl_cksum != puz->cold.calc_rtbl_cksum) {
       printf("RTBL checksum differs: got %02x, calc %02x\n", 
-             puz->rtbl_cksum, puz->calc_rtbl_cksum);
+             puz->cold.rtbl_cksum, puz->cold.calc_rtbl_cksum);
       retval++;
     }
   }
 
   if (puz_has_timer(puz)) {
-    if(puz->ltim_cksum != puz->calc_ltim_cksum) {
+    if(puz->cold.ltim_cksum != puz->cold.calc_ltim_cksum) {
       printf("LTIM checksum differs: got %02x, calc %02x\n",
-             puz->ltim_cksum, puz->calc_ltim_cksum);
+             puz->cold.ltim_cksum, puz->cold.calc_ltim_cksum);
       retval++;
     }
   }
 
   if (puz_has_extras(puz)) {
-    if(puz->gext_cksum != puz->calc_gext_cksum) {
+    if(puz->cold.gext_cksum != puz->cold.calc_gext_cksum) {
       printf("GEXT checksum differs: got %02x, calc %02x\n", 
-             puz->gext_cksum, puz->calc_gext_cksum);
+             puz->cold.gext_cksum, puz->cold.calc_gext_cksum);
       retval++;
     }
   }
 
   if (puz_has_rusr(puz)) {
-    if(puz->rusr_cksum != puz->calc_rusr_cksum) {
+    if(puz->cold.rusr_cksum != puz->cold.calc_rusr_cksum) {
       printf("RUSR checksum differs: got %02x, calc %02x\n", 
-             puz->rusr_cksum, puz->calc_rusr_cksum);
+             puz->cold.rusr_cksum, puz->cold.calc_rusr_cksum);
       retval++;
     }
   }
@@ -497,27 +533,27 @@ int puz_cksums_check(struct puzzle_t *puz) {
 int puz_cksums_commit(struct puzzle_t *puz) {
   puz_cksums_calc(puz);
 
-  puz->header.cksum_puz = puz->calc_cksum_puzcib;
-  puz->header.cksum_cib = puz->calc_cksums[0];
+  puz->cold.cksum_puz = puz->cold.calc_cksum_puzcib;
+  puz->cold.cksum_cib = puz->cold.calc_cksums[0];
 
-  memcpy(puz->header.magic_10, puz->calc_magic10, 4);
-  memcpy(puz->header.magic_14, puz->calc_magic14, 4);
+  memcpy(puz->cold.magic_10, puz->cold.calc_magic10, 4);
+  memcpy(puz->cold.magic_14, puz->cold.calc_magic14, 4);
 
   if (puz_has_rebus(puz)) {
-    puz->grbs_cksum = puz->calc_grbs_cksum;
-    puz->rtbl_cksum = puz->calc_rtbl_cksum;
+    puz->cold.grbs_cksum = puz->cold.calc_grbs_cksum;
+    puz->cold.rtbl_cksum = puz->cold.calc_rtbl_cksum;
   }
 
   if (puz_has_timer(puz)) {
-    puz->ltim_cksum = puz->calc_ltim_cksum;
+    puz->cold.ltim_cksum = puz->cold.calc_ltim_cksum;
   }
 
   if (puz_has_extras(puz)) {
-    puz->gext_cksum = puz->calc_gext_cksum;
+    puz->cold.gext_cksum = puz->cold.calc_gext_cksum;
   }
 
   if (puz_has_rusr(puz)) {
-    puz->rusr_cksum = puz->calc_rusr_cksum;
+    puz->cold.rusr_cksum = puz->cold.calc_rusr_cksum;
   }
 
   return 0;
@@ -0,0 +1,760 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * clue.c -- Clue text compressed against a trained dictionary
+ */
+
+#include <puz.h>
+
+/*
+  Clues are short, so a general-purpose compressor has nothing to work
+  with inside one clue, and compressing many together loses random
+  access.  What they do have is a shared vocabulary: " of", " the",
+  "Part of", " in a way".  So a dictionary of up to PUZ_CLUE_TOKENS
+  such strings is trained once over a corpus, and each clue is coded
+  on its own against it:
+
+    0x00-0x7f         that byte
+    0x80-0xef         dictionary entry 0-111, the most used
+    0xf0-0xfe, b      entry 112 + (first - 0xf0) * 256 + b
+    0xff, b           the byte b, for b >= 0x80
+
+  Training counts every run of one to three words (each with the
+  space in front of it) up to PUZ_CLUE_TOKEN_MAX bytes, and keeps the
+  ones that save the most: the one-byte codes go to what is used
+  most, the two-byte codes to what saves most beyond that.
+  Compressing takes the longest entry that matches at each point.
+
+  What each code stands for is a 16-byte slot in one table, with its
+  length in the last byte: the bytes 0-127, then the entries, then the
+  bytes 0-255 again.  The entries come in code order, and 0xff sits
+  just past the last two-byte code, so one sum finds the slot for any
+  code, escapes included.  Decompressing is then the same few steps
+  for every code, with no branch on what kind it is: find the slot,
+  copy 16 bytes, move on by the length.  The over-copy is why the
+  output wants PUZ_CLUE_PAD bytes to spare; without them it goes
+  exactly.
+
+  A struct puz_clue_store_t keeps many compressed clues end to end,
+  each got back by number.
+ */
+
+#define CLUE_ONE_BYTE  112           /* entries with one-byte codes */
+#define CLUE_TWO_BYTE  0xf0          /* first byte of the others */
+#define CLUE_LITERAL   0xff
+#define CLUE_WORDS     3             /* longest run of words trained */
+#define CLUE_ENTRIES   128           /* slot of entry 0 */
+#define CLUE_MAGIC0    'P'
+#define CLUE_MAGIC1    'C'
+#define CLUE_VERSION   1
+
+#define CLUE_ENTRY(d, id) ((d)->code[CLUE_ENTRIES + (id)])
+
+/* One string counted while training */
+struct clue_cand_t {
+  uint32_t count;
+  uint32_t gain;
+  unsigned char len;
+  unsigned char s[PUZ_CLUE_TOKEN_MAX];
+};
+
+struct clue_cands_t {
+  struct clue_cand_t *tab;
+  size_t mask;
+  size_t used;
+};
+
+static uint32_t clue_hash(const unsigned char *s, int len);
+static int clue_cand_add(struct clue_cands_t *c, const unsigned char *s,
+                         int len);
+static int clue_cand_cmp(const void *a, const void *b);
+static int clue_index(struct puz_clue_dict_t *d);
+static int clue_lookup(struct puz_clue_dict_t *d, const unsigned char *s,
+                       int len);
+static int clue_store_grow(struct puz_clue_store_t *store, size_t need);
+
+/**
+ * clue_hash - FNV-1a over a short string
+ *
+ * This is an internal function.
+ */
+static uint32_t clue_hash(const unsigned char *s, int len) {
+  uint32_t h = 2166136261u;
+  int i;
+
+  for(i = 0; i < len; i++)
+    h = (h ^ s[i]) * 16777619u;
+
+  return h;
+}
+
+/**
+ * clue_cand_add - count one more use of a string
+ *
+ * @c: the counts
+ * @s: the string
+ * @len: its length, 2 to PUZ_CLUE_TOKEN_MAX
+ *
+ * This is an internal function.
+ *
+ * Return Value: 0 on success, -1 if out of memory.
+ */
+static int clue_cand_add(struct clue_cands_t *c, const unsigned char *s,
+                         int len) {
+  struct clue_cand_t *tab, *e;
+  size_t i, j;
+
+  /* keep it under half full */
+  if(2 * (c->used + 1) > c->mask + 1) {
+    tab = (struct clue_cand_t *)calloc(2 * (c->mask + 1), sizeof(*tab));
+    if(NULL == tab) {
+      perror("calloc");
+      return -1;
+    }
+    for(i = 0; i <= c->mask; i++) {
+      if(!c->tab[i].len)
+        continue;
+      j = clue_hash(c->tab[i].s, c->tab[i].len) & (2 * c->mask + 1);
+      while(tab[j].len)
+        j = (j + 1) & (2 * c->mask + 1);
+      tab[j] = c->tab[i];
+    }
+    free(c->tab);
+    c->tab = tab;
+    c->mask = 2 * c->mask + 1;
+  }
+
+  for(i = clue_hash(s, len) & c->mask; ; i = (i + 1) & c->mask) {
+    e = c->tab + i;
+    if(!e->len) {
+      e->len = len;
+      memcpy(e->s, s, len);
+      e->count = 1;
+      c->used++;
+      return 0;
+    }
+    if(e->len == len && !memcmp(e->s, s, len)) {
+      e->count++;
+      return 0;
+    }
+  }
+}
+
+/**
+ * clue_cand_cmp - qsort() order: most gain first, then by the bytes
+ *
+ * This is an internal function.  The tie-break keeps training
+ * repeatable.
+ */
+static int clue_cand_cmp(const void *a, const void *b) {
+  const struct clue_cand_t *x = a, *y = b;
+
+  if(x->gain != y->gain)
+    return x->gain < y->gain ? 1 : -1;
+  if(x->len != y->len)
+    return x->len - y->len;
+  return memcmp(x->s, y->s, x->len);
+}
+
+/**
+ * clue_index - fill in the byte slots and the table for compressing
+ *
+ * @d: the dictionary, with its entries filled in
+ *
+ * This is an internal function.
+ *
+ * Return Value: 0 on success, -1 if out of memory.
+ */
+static int clue_index(struct puz_clue_dict_t *d) {
+  int id, size, len;
+  uint32_t i;
+
+  for(size = 16; size < 2 * d->n; size *= 2)
+    ;
+
+  free(d->hash);
+  d->hash = (uint16_t *)calloc(size, sizeof(uint16_t));
+  if(NULL == d->hash) {
+    perror("calloc");
+    return -1;
+  }
+  d->hash_mask = size - 1;
+  d->lens = 0;
+
+  for(i = 0; i < 256; i++) {
+    d->code[CLUE_ENTRIES + PUZ_CLUE_TOKENS + i][0] = i;
+    d->code[CLUE_ENTRIES + PUZ_CLUE_TOKENS + i][PUZ_CLUE_TOKEN_MAX] = 1;
+    if(i < CLUE_ENTRIES) {
+      d->code[i][0] = i;
+      d->code[i][PUZ_CLUE_TOKEN_MAX] = 1;
+    }
+  }
+
+  for(id = 0; id < d->n; id++) {
+    len = CLUE_ENTRY(d, id)[PUZ_CLUE_TOKEN_MAX];
+    if(!len)
+      continue;
+    d->lens |= 1u << len;
+    for(i = clue_hash(CLUE_ENTRY(d, id), len) & d->hash_mask; d->hash[i];
+        i = (i + 1) & d->hash_mask)
+      ;
+    d->hash[i] = id + 1;
+  }
+
+  return 0;
+}
+
+/**
+ * clue_lookup - find a dictionary entry
+ *
+ * This is an internal function.
+ *
+ * Return Value: the entry's number, or -1 if there's none.
+ */
+static int clue_lookup(struct puz_clue_dict_t *d, const unsigned char *s,
+                       int len) {
+  uint32_t i;
+  int id;
+
+  for(i = clue_hash(s, len) & d->hash_mask; d->hash[i];
+      i = (i + 1) & d->hash_mask) {
+    id = d->hash[i] - 1;
+    if(CLUE_ENTRY(d, id)[PUZ_CLUE_TOKEN_MAX] == len &&
+       !memcmp(CLUE_ENTRY(d, id), s, len))
+      return id;
+  }
+
+  return -1;
+}
+
+/**
+ * puz_clue_dict_init - start an empty clue dictionary
+ *
+ * @d: pointer to the struct puz_clue_dict_t to init.  If NULL, one
+ *   will be malloc'd for you.
+ *
+ * An empty dictionary works; it just doesn't compress anything.
+ *
+ * Return Value: NULL on error, else a pointer to the initialized
+ * struct puz_clue_dict_t.  If d was NULL, this is a pointer to the
+ * newly-allocated structure.
+ */
+struct puz_clue_dict_t *puz_clue_dict_init(struct puz_clue_dict_t *d) {
+  if(NULL == d) {
+    d = (struct puz_clue_dict_t *)malloc(sizeof(struct puz_clue_dict_t));
+    if(NULL == d) {
+      perror("malloc");
+      return NULL;
+    }
+  }
+
+  memset(d, 0, sizeof(struct puz_clue_dict_t));
+  if(clue_index(d) < 0)
+    return NULL;
+
+  return d;
+}
+
+/**
+ * puz_clue_dict_free - free a dictionary's lookup table
+ *
+ * @d: the dictionary
+ *
+ * This does not free @d itself.
+ */
+void puz_clue_dict_free(struct puz_clue_dict_t *d) {
+  if(NULL == d)
+    return;
+
+  free(d->hash);
+  memset(d, 0, sizeof(struct puz_clue_dict_t));
+}
+
+/**
+ * puz_clue_dict_train - build a dictionary from a corpus of clues
+ *
+ * @d: the dictionary, from puz_clue_dict_init(); its entries are
+ *   replaced
+ * @clues: the clues
+ * @n: how many
+ *
+ * Clues compressed against a dictionary can only be read back with
+ * the same one, so train once, save it with puz_clue_dict_write(), and
+ * keep it alongside whatever holds the clues.
+ *
+ * Return Value: the number of entries, or -1 on error.
+ */
+int puz_clue_dict_train(struct puz_clue_dict_t *d, unsigned char **clues,
+                        int n) {
+  struct clue_cands_t c;
+  struct clue_cand_t *all, *picked;
+  unsigned char *s;
+  size_t i, m;
+  int k, p, start, end, len, words, ones, twos;
+
+  if(NULL == d || (NULL == clues && n > 0))
+    return -1;
+
+  c.mask = 4095;
+  c.used = 0;
+  c.tab = (struct clue_cand_t *)calloc(c.mask + 1, sizeof(*c.tab));
+  if(NULL == c.tab) {
+    perror("calloc");
+    return -1;
+  }
+
+  /* runs of words starting at each word, the space before it and all */
+  for(k = 0; k < n; k++) {
+    s = clues[k];
+    if(NULL == s)
+      continue;
+    len = Sstrlen(s);
+    for(p = 0; p < len; p++) {
+      if(s[p] == ' ' || (p > 0 && s[p - 1] != ' '))
+        continue;
+      start = p > 0 ? p - 1 : 0;
+      end = p;
+      for(words = 0; words < CLUE_WORDS; words++) {
+        while(end < len && s[end] != ' ')
+          end++;
+        if(end - start > PUZ_CLUE_TOKEN_MAX)
+          break;
+        if(end - start >= 2 && clue_cand_add(&c, s + start, end - start) < 0) {
+          free(c.tab);
+          return -1;
+        }
+        if(end >= len)
+          break;
+        end++;
+      }
+    }
+  }
+
+  all = (struct clue_cand_t *)malloc((c.used + 1) * sizeof(*all));
+  if(NULL == all) {
+    perror("malloc");
+    free(c.tab);
+    return -1;
+  }
+  for(i = m = 0; i <= c.mask; i++)
+    if(c.tab[i].len && c.tab[i].count > 1)
+      all[m++] = c.tab[i];
+  free(c.tab);
+
+  /* a one-byte code saves len - 1 bytes a use */
+  for(i = 0; i < m; i++)
+    all[i].gain = all[i].count * (all[i].len - 1);
+  qsort(all, m, sizeof(*all), clue_cand_cmp);
+  ones = m < CLUE_ONE_BYTE ? m : CLUE_ONE_BYTE;
+
+  /* and a two-byte one len - 2 */
+  picked = all + ones;
+  for(i = 0; i < m - ones; i++)
+    picked[i].gain = picked[i].count * (picked[i].len - 2);
+  qsort(picked, m - ones, sizeof(*all), clue_cand_cmp);
+  for(twos = 0; twos < (int)(m - ones) &&
+        twos < PUZ_CLUE_TOKENS - CLUE_ONE_BYTE && picked[twos].gain; twos++)
+    ;
+
+  /* with too few for every one-byte code, the rest go unused */
+  memset(CLUE_ENTRY(d, 0), 0, sizeof(d->code[0]) * PUZ_CLUE_TOKENS);
+  for(k = 0; k < ones; k++) {
+    memcpy(CLUE_ENTRY(d, k), all[k].s, all[k].len);
+    CLUE_ENTRY(d, k)[PUZ_CLUE_TOKEN_MAX] = all[k].len;
+  }
+  for(k = 0; k < twos; k++) {
+    memcpy(CLUE_ENTRY(d, CLUE_ONE_BYTE + k), picked[k].s, picked[k].len);
+    CLUE_ENTRY(d, CLUE_ONE_BYTE + k)[PUZ_CLUE_TOKEN_MAX] = picked[k].len;
+  }
+  d->n = twos ? CLUE_ONE_BYTE + twos : ones;
+  free(all);
+
+  /* unused one-byte slots have length 0, and clue_index skips them */
+  if(clue_index(d) < 0)
+    return -1;
+
+  return d->n;
+}
+
+/**
+ * puz_clue_dict_size - how big a dictionary is when written out
+ *
+ * @d: the dictionary (required)
+ *
+ * Return Value: the number of bytes puz_clue_dict_write() needs, or
+ * -1 on error.
+ */
+int puz_clue_dict_size(struct puz_clue_dict_t *d) {
+  int id, sz = 5;
+
+  if(NULL == d)
+    return -1;
+
+  for(id = 0; id < d->n; id++)
+    sz += 1 + CLUE_ENTRY(d, id)[PUZ_CLUE_TOKEN_MAX];
+
+  return sz;
+}
+
+/**
+ * puz_clue_dict_write - write a dictionary out
+ *
+ * @d: the dictionary
+ * @base: where to
+ * @sz: how big base is
+ *
+ * Return Value: the number of bytes written, or -1 if base is too
+ * small.
+ */
+int puz_clue_dict_write(struct puz_clue_dict_t *d, unsigned char *base,
+                        int sz) {
+  unsigned char *p = base;
+  int id, len;
+
+  if(NULL == d || NULL == base || sz < puz_clue_dict_size(d))
+    return -1;
+
+  *p++ = CLUE_MAGIC0;
+  *p++ = CLUE_MAGIC1;
+  *p++ = CLUE_VERSION;
+  w_le_16(p, d->n);
+  p += 2;
+  for(id = 0; id < d->n; id++) {
+    len = CLUE_ENTRY(d, id)[PUZ_CLUE_TOKEN_MAX];
+    *p++ = len;
+    memcpy(p, CLUE_ENTRY(d, id), len);
+    p += len;
+  }
+
+  return p - base;
+}
+
+/**
+ * puz_clue_dict_read - read a dictionary written by puz_clue_dict_write()
+ *
+ * @d: the dictionary, from puz_clue_dict_init(); its entries are
+ *   replaced
+ * @base: what was written
+ * @sz: its size
+ *
+ * Return Value: the number of entries, or -1 if base doesn't hold a
+ * dictionary.
+ */
+int puz_clue_dict_read(struct puz_clue_dict_t *d, unsigned char *base,
+                       int sz) {
+  unsigned char *p = base, *end = base + sz;
+  int id, n, len;
+
+  if(NULL == d || NULL == base || sz < 5 || base[0] != CLUE_MAGIC0 ||
+     base[1] != CLUE_MAGIC1 || base[2] != CLUE_VERSION)
+    return -1;
+
+  n = le_16(base + 3);
+  if(n > PUZ_CLUE_TOKENS)
+    return -1;
+  p += 5;
+
+  memset(CLUE_ENTRY(d, 0), 0, sizeof(d->code[0]) * PUZ_CLUE_TOKENS);
+  for(id = 0; id < n; id++) {
+    if(p >= end)
+      return -1;
+    len = *p++;
+    if(len > PUZ_CLUE_TOKEN_MAX || len > end - p)
+      return -1;
+    memcpy(CLUE_ENTRY(d, id), p, len);
+    CLUE_ENTRY(d, id)[PUZ_CLUE_TOKEN_MAX] = len;
+    p += len;
+  }
+  d->n = n;
+
+  if(clue_index(d) < 0)
+    return -1;
+
+  return n;
+}
+
+/**
+ * puz_clue_compress - compress one clue
+ *
+ * @d: the dictionary
+ * @clue: the clue
+ * @out: where to write it
+ * @sz: how big out is; twice the clue's length is always enough
+ *
+ * Return Value: the compressed length, or -1 if out is too small.
+ */
+int puz_clue_compress(struct puz_clue_dict_t *d, const unsigned char *clue,
+                      unsigned char *out, int sz) {
+  int i, l, id, len, o = 0;
+
+  if(NULL == d || NULL == clue || NULL == out)
+    return -1;
+
+  len = Sstrlen(clue);
+  for(i = 0; i < len; i += l) {
+    id = -1;
+    for(l = len - i < PUZ_CLUE_TOKEN_MAX ? len - i : PUZ_CLUE_TOKEN_MAX;
+        l >= 2; l--) {
+      if(d->lens & (1u << l) && (id = clue_lookup(d, clue + i, l)) >= 0)
+        break;
+    }
+
+    if(id < 0)
+      l = 1;
+
+    /* checked once the code's size is known, so an exact fit works */
+    if(o + 1 + (id >= CLUE_ONE_BYTE || (id < 0 && clue[i] >= 0x80)) > sz)
+      return -1;
+
+    if(id >= CLUE_ONE_BYTE) {
+      out[o++] = CLUE_TWO_BYTE + ((id - CLUE_ONE_BYTE) >> 8);
+      out[o++] = (id - CLUE_ONE_BYTE) & 0xFF;
+    } else if(id >= 0) {
+      out[o++] = 0x80 + id;
+    } else {
+      if(clue[i] >= 0x80)
+        out[o++] = CLUE_LITERAL;
+      out[o++] = clue[i];
+    }
+  }
+
+  return o;
+}
+
+/**
+ * puz_clue_decompress - decompress one clue
+ *
+ * @d: the dictionary it was compressed with
+ * @in: the compressed clue
+ * @len: its length
+ * @out: where to write the clue, NUL-terminated
+ * @sz: how big out is.  It's fastest with PUZ_CLUE_PAD bytes to spare.
+ *
+ * Return Value: the clue's length, or -1 if out is too small or @in
+ * isn't a clue compressed with @d.
+ */
+int puz_clue_decompress(struct puz_clue_dict_t *d, const unsigned char *in,
+                        int len, unsigned char *out, int sz) {
+  const unsigned char *end = in + len, *t;
+  unsigned char *o = out, *last;
+  int c, two, slot, l;
+
+  if(NULL == d || NULL == in || NULL == out || sz < 1)
+    return -1;
+  last = out + sz - 1;  /* for the NUL */
+
+  while(in < end) {
+    /* worked out both ways and picked with a mask, not a branch, as
+       one- and two-byte codes come in no pattern; in[1] only if it's
+       there, and a two-byte code cut short is caught below */
+    c = in[0];
+    two = c >= CLUE_TWO_BYTE;
+    slot = CLUE_ENTRIES + CLUE_ONE_BYTE + (c - CLUE_TWO_BYTE) * 256 +
+      in[end - in > 1];
+    slot = c ^ (-two & (slot ^ c));
+    if(end - in < 1 + two)
+      return -1;
+
+    /* an unused slot is an entry this dictionary doesn't have */
+    t = d->code[slot];
+    l = t[PUZ_CLUE_TOKEN_MAX];
+    if(!l)
+      return -1;
+
+    if(last - o >= PUZ_CLUE_PAD) {
+      memcpy(o, t, PUZ_CLUE_TOKEN_MAX + 1);
+    } else {
+      if(l > last - o)
+        return -1;
+      memcpy(o, t, l);
+    }
+    o += l;
+    in += 1 + two;
+  }
+
+  *o = 0;
+  return o - out;
+}
+
+/**
+ * puz_clue_store_init - start an empty clue store
+ *
+ * @store: pointer to the struct puz_clue_store_t to init.  If NULL,
+ *   one will be malloc'd for you.
+ * @d: the dictionary to compress against; it must outlive the store
+ *
+ * Return Value: NULL on error, else a pointer to the initialized
+ * struct puz_clue_store_t.  If store was NULL, this is a pointer to
+ * the newly-allocated structure.
+ */
+struct puz_clue_store_t *puz_clue_store_init(struct puz_clue_store_t *store,
+                                             struct puz_clue_dict_t *d) {
+  if(NULL == store) {
+    store = (struct puz_clue_store_t *)malloc(sizeof(struct puz_clue_store_t));
+    if(NULL == store) {
+      perror("malloc");
+      return NULL;
+    }
+  }
+
+  memset(store, 0, sizeof(struct puz_clue_store_t));
+  store->dict = d;
+
+  return store;
+}
+
+/**
+ * puz_clue_store_free - free a store's clues
+ *
+ * @store: the store
+ *
+ * This does not free @store itself, or its dictionary.
+ */
+void puz_clue_store_free(struct puz_clue_store_t *store) {
+  if(NULL == store)
+    return;
+
+  free(store->off);
+  free(store->data);
+  memset(store, 0, sizeof(struct puz_clue_store_t));
+}
+
+/**
+ * clue_store_grow - make room for one more clue of up to need bytes
+ *
+ * This is an internal function.
+ *
+ * Return Value: 0 on success, -1 if out of memory or past 4GB.
+ */
+static int clue_store_grow(struct puz_clue_store_t *store, size_t need) {
+  void *p;
+  size_t cap;
+
+  if(store->n + 1 >= store->cap) {
+    cap = store->cap ? store->cap * 2 : 1024;
+    p = realloc(store->off, cap * sizeof(*store->off));
+    if(NULL == p) {
+      perror("realloc");
+      return -1;
+    }
+    store->off = p;
+    store->off[0] = 0;
+    store->cap = cap;
+  }
+
+  if(store->data_sz + need > store->data_cap) {
+    cap = store->data_cap ? store->data_cap : 4096;
+    while(cap < store->data_sz + need)
+      cap *= 2;
+    if(cap > 0xFFFFFFFFUL) {
+      if(store->data_sz + need > 0xFFFFFFFFUL)
+        return -1;
+      cap = 0xFFFFFFFFUL;
+    }
+    p = realloc(store->data, cap);
+    if(NULL == p) {
+      perror("realloc");
+      return -1;
+    }
+    store->data = p;
+    store->data_cap = cap;
+  }
+
+  return 0;
+}
+
+/**
+ * puz_clue_store_add - compress a clue into a store
+ *
+ * @store: the store
+ * @clue: the clue; NULL is stored as ""
+ *
+ * Return Value: the clue's number in the store, or -1 on error.
+ */
+int puz_clue_store_add(struct puz_clue_store_t *store, unsigned char *clue) {
+  int len;
+
+  if(NULL == store)
+    return -1;
+  if(NULL == clue)
+    clue = (unsigned char *)"";
+
+  if(clue_store_grow(store, 2 * Sstrlen(clue) + 1) < 0)
+    return -1;
+
+  len = puz_clue_compress(store->dict, clue, store->data + store->data_sz,
+                          store->data_cap - store->data_sz);
+  if(len < 0)
+    return -1;
+
+  store->data_sz += len;
+  store->off[++store->n] = store->data_sz;
+
+  return store->n - 1;
+}
+
+/**
+ * puz_clue_store_add_puzzle - compress all of a puzzle's clues into a store
+ *
+ * @store: the store
+ * @puz: the puzzle
+ *
+ * Return Value: the number of the puzzle's first clue in the store;
+ * the rest follow in order.  -1 on error, in which case some of the
+ * clues may have been added.
+ */
+int puz_clue_store_add_puzzle(struct puz_clue_store_t *store,
+                              struct puzzle_t *puz) {
+  int i, first;
+
+  if(NULL == store || NULL == puz)
+    return -1;
+
+  first = store->n;
+  for(i = 0; i < puz->header.clue_count; i++)
+    if(puz_clue_store_add(store, puz->clues[i]) < 0)
+      return -1;
+
+  return first;
+}
+
+/**
+ * puz_clue_store_count - how many clues are in a store
+ *
+ * @store: the store (required)
+ *
+ * Returns -1 on error; else a non-negative value
+ */
+int puz_clue_store_count(struct puz_clue_store_t *store) {
+  if(NULL == store)
+    return -1;
+
+  return store->n;
+}
+
+/**
+ * puz_clue_store_get - decompress one clue from a store
+ *
+ * @store: the store
+ * @n: the clue's number
+ * @out: where to write it, NUL-terminated
+ * @sz: how big out is; fastest with PUZ_CLUE_PAD bytes to spare
+ *
+ * Return Value: the clue's length, or -1 if there's no such clue or
+ * out is too small.
+ */
+int puz_clue_store_get(struct puz_clue_store_t *store, int n,
+                       unsigned char *out, int sz) {
+  if(NULL == store || n < 0 || n >= store->n)
+    return -1;
+
+  return puz_clue_decompress(store->dict, store->data + store->off[n],
+                             store->off[n + 1] - store->off[n], out, sz);
+}
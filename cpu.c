@@ -0,0 +1,1203 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * cpu.c -- Pick the best version of each hot loop for this CPU
+ */
+
+#include <puz.h>
+
+#include <ctype.h>
+#include <strings.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_X86 1
+#include <immintrin.h>
+#define CPU_SSE2   __attribute__((target("sse2")))
+#define CPU_AVX2   __attribute__((target("avx2,popcnt")))
+#define CPU_AVX512 __attribute__((target("avx512f,avx512bw,popcnt")))
+#endif
+
+/*
+  One binary has to run on everything from SSE2-only machines to
+  AVX-512 servers, so the loops that are worth vectorizing are built
+  once per instruction set here, each with its own target attribute,
+  and reached through puz_kernels.  The table starts out pointing at
+  the plain C versions; at startup cpu_init() asks the CPU what it has
+  and switches to the best ones it can run.  PUZ_CPU_LEVEL in the
+  environment (scalar, sse2, avx2 or avx512) caps the level, for
+  benchmarking one against another; puz_cpu_level_set() does the same
+  from code.
+
+  The kernels:
+
+   cksum    the rotate-and-sum behind puz_cksum_region().  Every step
+            depends on the last, and the rotate doesn't distribute
+            over the add, so there is nothing to vectorize: every
+            level uses the C loop.  It's in the table so that callers
+            don't need to know that.
+   check    one block of one user's grid against the solution, for
+            puz_check_grids().  64 squares a step at every level.
+   eol      the next '\r' or '\n', for the text loader.
+   ascii    whether a string is pure ASCII, and its length, for the
+            UTF-8 views.
+   letters  a histogram of letters 0..25, for puz_fill()'s weights.
+   range8, range16, match16
+            the predicates behind puz_meta_select(): which rows of a
+            column are in a range, or have given bits set and clear.
+            64 rows a step, each giving one word of the selection.
+   pack5, unpack5
+            boards to and from 5 bits a square, for pack.c.  There is
+            no SSE2 version (it needs pshufb), and AVX-512 uses AVX2's.
+
+  puz_cpu_selftest() runs each level this CPU supports over random
+  input against the C versions.
+ */
+
+static unsigned short cksum_scalar(unsigned char *base, int len,
+                                   unsigned short cksum);
+static void check_scalar(unsigned char *sol, unsigned char *grid, int off,
+                         int len, int bd_sz, struct puz_check_result_t *res,
+                         unsigned char *mismatch);
+static unsigned char *eol_scalar(unsigned char *b, unsigned char *stop);
+static int ascii_scalar(unsigned char *s, size_t *len);
+static void letters_scalar(const unsigned char *p, int n, uint32_t *counts);
+static void range8_scalar(const uint8_t *col, int n, unsigned lo, unsigned hi,
+                          uint64_t *sel);
+static void range16_scalar(const uint16_t *col, int n, unsigned lo,
+                           unsigned hi, uint64_t *sel);
+static void match16_scalar(const uint16_t *col, int n, unsigned mask,
+                           unsigned val, uint64_t *sel);
+static int pack5_scalar(const unsigned char *board, int n,
+                        unsigned char *bits);
+static void unpack5_scalar(const unsigned char *bits, int n,
+                           unsigned char *board);
+
+static void cpu_table(int level, struct puz_kernels_t *k);
+static void cpu_init(void) __attribute__((constructor));
+
+/* usable before cpu_init() has run, if only at the slowest level */
+struct puz_kernels_t puz_kernels = {
+  cksum_scalar, check_scalar, eol_scalar, ascii_scalar, letters_scalar,
+  range8_scalar, range16_scalar, match16_scalar, pack5_scalar, unpack5_scalar
+};
+
+static int cpu_level = PUZ_CPU_SCALAR;
+
+/**
+ * cksum_scalar - the rotate-and-sum checksum
+ *
+ * This is an internal function; see puz_cksum_region().
+ */
+static unsigned short cksum_scalar(unsigned char *base, int len,
+                                   unsigned short cksum) {
+  int i;
+
+  for(i = 0; i < len; i++) {
+    /* rotate right one bit, then add */
+    cksum = (cksum >> 1) | (cksum << 15);
+    cksum += base[i];
+  }
+
+  return cksum;
+}
+
+/*
+  check: each level has a check64_*() comparing 64 squares and giving
+  back bitmasks of the right and wrong ones.  CHECK_KERNEL() wraps one
+  in the block loop and the 15x15 / 21x21 copies that check.c used to
+  make for itself, so every level gets them.  The solution is padded
+  with '.' to a multiple of 64, off and len are multiples of 64, and
+  the grid is read no further than bd_sz.
+ */
+
+/**
+ * check64_scalar - check 64 squares
+ *
+ * @s: the solution's squares
+ * @g: the user's squares
+ * @good: receives bit j set if square j is right
+ * @bad: receives bit j set if square j is wrong (not blank)
+ *
+ * This is an internal function.
+ */
+static inline __attribute__((always_inline))
+void check64_scalar(const unsigned char *s, const unsigned char *g,
+                    uint64_t *good, uint64_t *bad) {
+  uint64_t gd = 0, bd = 0;
+  int j;
+
+  for(j = 0; j < 64; j++) {
+    if(s[j] == '.')
+      continue;
+    if(s[j] == g[j])
+      gd |= 1ULL << j;
+    else if(g[j] != '-')
+      bd |= 1ULL << j;
+  }
+
+  *good = gd;
+  *bad = bd;
+}
+
+#define CHECK_KERNEL(isa, attr)                                         \
+static inline __attribute__((always_inline)) attr                       \
+void check_block_##isa(unsigned char *sol, unsigned char *grid, int off, \
+                       int len, int bd_sz,                              \
+                       struct puz_check_result_t *res,                  \
+                       unsigned char *mismatch) {                       \
+  unsigned char tail[64], *g;                                           \
+  uint64_t good, bad;                                                   \
+  int i, k, end, nb = (bd_sz + 7) / 8;                                  \
+                                                                        \
+  end = off + len < bd_sz ? off + len : bd_sz;                          \
+  for(i = off; i < end; i += 64) {                                      \
+    g = grid + i;                                                       \
+    if(i + 64 > bd_sz) {                                                \
+      /* don't read past the end of the user's grid */                  \
+      memset(tail, '.', 64);                                            \
+      memcpy(tail, grid + i, bd_sz - i);                                \
+      g = tail;                                                         \
+    }                                                                   \
+    check64_##isa(sol + i, g, &good, &bad);                             \
+    res->correct += __builtin_popcountll(good);                         \
+    res->incorrect += __builtin_popcountll(bad);                        \
+    if(mismatch) {                                                      \
+      for(k = 0; k < 8 && i / 8 + k < nb; k++)                          \
+        mismatch[i / 8 + k] = (bad >> (8 * k)) & 0xFF;                  \
+    }                                                                   \
+  }                                                                     \
+}                                                                       \
+                                                                        \
+static attr                                                             \
+void check_##isa(unsigned char *sol, unsigned char *grid, int off,      \
+                 int len, int bd_sz, struct puz_check_result_t *res,    \
+                 unsigned char *mismatch) {                             \
+  switch(bd_sz) {                                                       \
+  case 15*15:                                                           \
+    check_block_##isa(sol, grid, 0, 256, 15*15, res, mismatch);         \
+    break;                                                              \
+  case 21*21:                                                           \
+    check_block_##isa(sol, grid, 0, 448, 21*21, res, mismatch);         \
+    break;                                                              \
+  default:                                                              \
+    check_block_##isa(sol, grid, off, len, bd_sz, res, mismatch);       \
+    break;                                                              \
+  }                                                                     \
+}
+
+CHECK_KERNEL(scalar, )
+
+/**
+ * eol_scalar - find the end of a line
+ *
+ * @b: where to start
+ * @stop: the end of the buffer
+ *
+ * This is an internal function.
+ *
+ * Return Value: the first '\r' or '\n' at or after b, or stop.
+ */
+static unsigned char *eol_scalar(unsigned char *b, unsigned char *stop) {
+  while(b < stop && *b != '\r' && *b != '\n')
+    b++;
+
+  return b;
+}
+
+/**
+ * ascii_scalar - check a string for bytes with the high bit set
+ *
+ * @s: the string (required)
+ * @len: receives its length
+ *
+ * This is an internal function.
+ *
+ * Return Value: 1 if the string is pure ASCII, 0 if not.
+ */
+static int ascii_scalar(unsigned char *s, size_t *len) {
+  unsigned char *p;
+  int ascii = 1;
+
+  for(p = s; *p; p++)
+    ascii &= *p < 0x80;
+  *len = p - s;
+
+  return ascii;
+}
+
+/**
+ * letters_scalar - count letters
+ *
+ * @p: the letters, each 0..25; anything else isn't counted
+ * @n: how many
+ * @counts: 26 counts to add to
+ *
+ * This is an internal function.  Four tables, so that runs of the same
+ * letter don't wait on each other's increments.
+ */
+static void letters_scalar(const unsigned char *p, int n, uint32_t *counts) {
+  uint32_t c[4][256];
+  int i;
+
+  memset(c, 0, sizeof(c));
+  for(i = 0; i + 4 <= n; i += 4) {
+    c[0][p[i]]++;
+    c[1][p[i+1]]++;
+    c[2][p[i+2]]++;
+    c[3][p[i+3]]++;
+  }
+  for(; i < n; i++)
+    c[0][p[i]]++;
+
+  for(i = 0; i < 26; i++)
+    counts[i] += c[0][i] + c[1][i] + c[2][i] + c[3][i];
+}
+
+/*
+  range8, range16 and match16: each level has a *64_*() giving the
+  selection word for 64 rows, and SELECT_KERNEL() runs it down the
+  column, finishing a partial last word with the C loop.  Bits past
+  the last row come out clear.  A range is tested as one unsigned
+  compare, (x - lo) <= (hi - lo), and lo <= hi always.
+ */
+
+/**
+ * range8_rows - which of up to 64 rows are in a range
+ *
+ * @c: the column, from the first row
+ * @n: how many rows, 1 to 64
+ * @lo: the least value selected
+ * @span: hi - lo
+ *
+ * This is an internal function.
+ *
+ * Return Value: bit j set if row j is in the range.
+ */
+static inline __attribute__((always_inline))
+uint64_t range8_rows(const uint8_t *c, int n, unsigned lo, unsigned span) {
+  uint64_t m = 0;
+  int j;
+
+  for(j = 0; j < n; j++)
+    m |= (uint64_t)((uint8_t)(c[j] - lo) <= span) << j;
+
+  return m;
+}
+
+static inline __attribute__((always_inline))
+uint64_t range16_rows(const uint16_t *c, int n, unsigned lo, unsigned span) {
+  uint64_t m = 0;
+  int j;
+
+  for(j = 0; j < n; j++)
+    m |= (uint64_t)((uint16_t)(c[j] - lo) <= span) << j;
+
+  return m;
+}
+
+static inline __attribute__((always_inline))
+uint64_t match16_rows(const uint16_t *c, int n, unsigned mask, unsigned val) {
+  uint64_t m = 0;
+  int j;
+
+  for(j = 0; j < n; j++)
+    m |= (uint64_t)((c[j] & mask) == val) << j;
+
+  return m;
+}
+
+#define range64_8_scalar(c, lo, span) range8_rows(c, 64, lo, span)
+#define range64_16_scalar(c, lo, span) range16_rows(c, 64, lo, span)
+#define match64_16_scalar(c, mask, val) match16_rows(c, 64, mask, val)
+
+#define SELECT_KERNEL(isa, attr)                                        \
+static attr                                                             \
+void range8_##isa(const uint8_t *col, int n, unsigned lo, unsigned hi,  \
+                  uint64_t *sel) {                                      \
+  int i;                                                                \
+                                                                        \
+  for(i = 0; i + 64 <= n; i += 64)                                      \
+    sel[i / 64] &= range64_8_##isa(col + i, lo, hi - lo);               \
+  if(i < n)                                                             \
+    sel[i / 64] &= range8_rows(col + i, n - i, lo, hi - lo);            \
+}                                                                       \
+                                                                        \
+static attr                                                             \
+void range16_##isa(const uint16_t *col, int n, unsigned lo, unsigned hi, \
+                   uint64_t *sel) {                                     \
+  int i;                                                                \
+                                                                        \
+  for(i = 0; i + 64 <= n; i += 64)                                      \
+    sel[i / 64] &= range64_16_##isa(col + i, lo, hi - lo);              \
+  if(i < n)                                                             \
+    sel[i / 64] &= range16_rows(col + i, n - i, lo, hi - lo);           \
+}                                                                       \
+                                                                        \
+static attr                                                             \
+void match16_##isa(const uint16_t *col, int n, unsigned mask,           \
+                   unsigned val, uint64_t *sel) {                       \
+  int i;                                                                \
+                                                                        \
+  for(i = 0; i + 64 <= n; i += 64)                                      \
+    sel[i / 64] &= match64_16_##isa(col + i, mask, val);                \
+  if(i < n)                                                             \
+    sel[i / 64] &= match16_rows(col + i, n - i, mask, val);             \
+}
+
+SELECT_KERNEL(scalar, )
+
+/*
+  pack5: square i is bits 5i..5i+4 of the packed board, least
+  significant first, so every 8 squares are 5 bytes.  Letters are 0-25,
+  '.' PUZ_PACK_BLACK and '-' PUZ_PACK_BLANK; anything else is
+  PUZ_PACK_ESCAPE, and pack.c keeps the byte itself elsewhere.
+ */
+
+/**
+ * pack5_code - the 5-bit code for one square
+ *
+ * This is an internal function.
+ */
+static inline __attribute__((always_inline))
+unsigned int pack5_code(unsigned char c) {
+  if((unsigned char)(c - 'A') < 26)
+    return c - 'A';
+  if(c == '.')
+    return PUZ_PACK_BLACK;
+  if(c == '-')
+    return PUZ_PACK_BLANK;
+  return PUZ_PACK_ESCAPE;
+}
+
+/**
+ * pack5_scalar - pack a board 5 bits a square
+ *
+ * @board: the squares
+ * @n: how many
+ * @bits: receives (5n + 7) / 8 bytes
+ *
+ * This is an internal function.
+ *
+ * Return Value: the number of squares coded PUZ_PACK_ESCAPE.
+ */
+static int pack5_scalar(const unsigned char *board, int n,
+                        unsigned char *bits) {
+  uint64_t acc = 0;
+  unsigned int code;
+  int i, have = 0, esc = 0;
+
+  for(i = 0; i < n; i++) {
+    code = pack5_code(board[i]);
+    esc += code == PUZ_PACK_ESCAPE;
+    acc |= (uint64_t)code << have;
+    have += 5;
+    while(have >= 8) {
+      *bits++ = acc & 0xFF;
+      acc >>= 8;
+      have -= 8;
+    }
+  }
+  if(have)
+    *bits = acc & 0xFF;
+
+  return esc;
+}
+
+/**
+ * unpack5_scalar - unpack a board packed 5 bits a square
+ *
+ * @bits: the packed squares
+ * @n: how many
+ * @board: receives n squares; escaped ones come out as '?'
+ *
+ * This is an internal function.
+ */
+static void unpack5_scalar(const unsigned char *bits, int n,
+                           unsigned char *board) {
+  static const unsigned char chars[33] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ.-????";
+  uint64_t acc = 0;
+  int i, have = 0;
+
+  for(i = 0; i < n; i++) {
+    if(have < 5) {
+      acc |= (uint64_t)*bits++ << have;
+      have += 8;
+    }
+    board[i] = chars[acc & 31];
+    acc >>= 5;
+    have -= 5;
+  }
+}
+
+#ifdef CPU_X86
+
+/*
+  SSE2.  The ascii kernel only does aligned loads, which may read past
+  the terminator but never into another page, the same as the C
+  library's own strlen; the address sanitizer doesn't know that, so
+  it's told to look away.  The same goes for AVX2 below.
+ */
+
+static inline __attribute__((always_inline)) CPU_SSE2
+void check64_sse2(const unsigned char *s, const unsigned char *g,
+                  uint64_t *good, uint64_t *bad) {
+  __m128i dot = _mm_set1_epi8('.'), dash = _mm_set1_epi8('-'), sv, gv;
+  uint64_t gd = 0, bd = 0, eq, black, blank;
+  int k;
+
+  for(k = 0; k < 64; k += 16) {
+    sv = _mm_loadu_si128((const __m128i *)(s + k));
+    gv = _mm_loadu_si128((const __m128i *)(g + k));
+    eq = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(sv, gv));
+    black = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(sv, dot));
+    blank = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(gv, dash));
+    gd |= (eq & ~black) << k;
+    bd |= (~eq & ~black & ~blank & 0xFFFF) << k;
+  }
+
+  *good = gd;
+  *bad = bd;
+}
+
+CHECK_KERNEL(sse2, CPU_SSE2)
+
+static CPU_SSE2
+unsigned char *eol_sse2(unsigned char *b, unsigned char *stop) {
+  __m128i cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n'), v;
+  unsigned int m;
+
+  for(; stop - b >= 16; b += 16) {
+    v = _mm_loadu_si128((__m128i *)b);
+    m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, cr),
+                                       _mm_cmpeq_epi8(v, lf)));
+    if(m)
+      return b + __builtin_ctz(m);
+  }
+
+  return eol_scalar(b, stop);
+}
+
+static CPU_SSE2 __attribute__((no_sanitize_address))
+int ascii_sse2(unsigned char *s, size_t *len) {
+  unsigned char *p = (unsigned char *)((uintptr_t)s & ~(uintptr_t)15);
+  unsigned int skip = s - p, zero, high;
+  __m128i v;
+
+  v = _mm_load_si128((__m128i *)p);
+  zero = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) >> skip << skip;
+  high = _mm_movemask_epi8(v) >> skip << skip;
+
+  while(!zero) {
+    if(high) {
+      *len = Sstrlen(s);
+      return 0;
+    }
+    p += 16;
+    v = _mm_load_si128((__m128i *)p);
+    zero = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    high = _mm_movemask_epi8(v);
+  }
+
+  /* only the bytes before the terminator count */
+  zero &= -zero;
+  *len = p + __builtin_ctz(zero) - s;
+
+  return 0 == (high & (zero - 1));
+}
+
+/* SSE2 has no unsigned 16-bit compare, so flip the sign bits and
+   use the signed one */
+
+static inline __attribute__((always_inline)) CPU_SSE2
+uint64_t range64_8_sse2(const uint8_t *c, unsigned lo, unsigned span) {
+  __m128i l = _mm_set1_epi8(lo), s = _mm_set1_epi8(span), d;
+  uint64_t m = 0;
+  int k;
+
+  for(k = 0; k < 64; k += 16) {
+    d = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)(c + k)), l);
+    m |= (uint64_t)(unsigned int)
+      _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, s), d)) << k;
+  }
+
+  return m;
+}
+
+static inline __attribute__((always_inline)) CPU_SSE2
+uint64_t range64_16_sse2(const uint16_t *c, unsigned lo, unsigned span) {
+  __m128i l = _mm_set1_epi16(lo), flip = _mm_set1_epi16(-0x8000);
+  __m128i s = _mm_xor_si128(_mm_set1_epi16(span), flip), a, b;
+  uint64_t m = 0;
+  int k;
+
+  for(k = 0; k < 64; k += 16) {
+    a = _mm_xor_si128(_mm_sub_epi16(
+          _mm_loadu_si128((const __m128i *)(c + k)), l), flip);
+    b = _mm_xor_si128(_mm_sub_epi16(
+          _mm_loadu_si128((const __m128i *)(c + k + 8)), l), flip);
+    a = _mm_packs_epi16(_mm_cmpgt_epi16(a, s), _mm_cmpgt_epi16(b, s));
+    m |= (uint64_t)(~_mm_movemask_epi8(a) & 0xFFFF) << k;
+  }
+
+  return m;
+}
+
+static inline __attribute__((always_inline)) CPU_SSE2
+uint64_t match64_16_sse2(const uint16_t *c, unsigned mask, unsigned val) {
+  __m128i mk = _mm_set1_epi16(mask), v = _mm_set1_epi16(val), a, b;
+  uint64_t m = 0;
+  int k;
+
+  for(k = 0; k < 64; k += 16) {
+    a = _mm_and_si128(_mm_loadu_si128((const __m128i *)(c + k)), mk);
+    b = _mm_and_si128(_mm_loadu_si128((const __m128i *)(c + k + 8)), mk);
+    a = _mm_packs_epi16(_mm_cmpeq_epi16(a, v), _mm_cmpeq_epi16(b, v));
+    m |= (uint64_t)(unsigned int)_mm_movemask_epi8(a) << k;
+  }
+
+  return m;
+}
+
+SELECT_KERNEL(sse2, CPU_SSE2)
+
+/* AVX2: as SSE2, 32 bytes at a time */
+
+static inline __attribute__((always_inline)) CPU_AVX2
+void check64_avx2(const unsigned char *s, const unsigned char *g,
+                  uint64_t *good, uint64_t *bad) {
+  __m256i dot = _mm256_set1_epi8('.'), dash = _mm256_set1_epi8('-'), sv, gv;
+  uint64_t gd = 0, bd = 0, eq, black, blank;
+  int k;
+
+  for(k = 0; k < 64; k += 32) {
+    sv = _mm256_loadu_si256((const __m256i *)(s + k));
+    gv = _mm256_loadu_si256((const __m256i *)(g + k));
+    eq = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(sv, gv));
+    black = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(sv, dot));
+    blank = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(gv, dash));
+    gd |= (eq & ~black) << k;
+    bd |= (~eq & ~black & ~blank & 0xFFFFFFFFULL) << k;
+  }
+
+  *good = gd;
+  *bad = bd;
+}
+
+CHECK_KERNEL(avx2, CPU_AVX2)
+
+static CPU_AVX2
+unsigned char *eol_avx2(unsigned char *b, unsigned char *stop) {
+  __m256i cr = _mm256_set1_epi8('\r'), lf = _mm256_set1_epi8('\n'), v;
+  unsigned int m;
+
+  for(; stop - b >= 32; b += 32) {
+    v = _mm256_loadu_si256((__m256i *)b);
+    m = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, cr),
+                                             _mm256_cmpeq_epi8(v, lf)));
+    if(m)
+      return b + __builtin_ctz(m);
+  }
+
+  return eol_sse2(b, stop);
+}
+
+static CPU_AVX2 __attribute__((no_sanitize_address))
+int ascii_avx2(unsigned char *s, size_t *len) {
+  unsigned char *p = (unsigned char *)((uintptr_t)s & ~(uintptr_t)31);
+  unsigned int skip = s - p, zero, high;
+  __m256i v;
+
+  v = _mm256_load_si256((__m256i *)p);
+  zero = (unsigned int)_mm256_movemask_epi8(
+    _mm256_cmpeq_epi8(v, _mm256_setzero_si256())) >> skip << skip;
+  high = (unsigned int)_mm256_movemask_epi8(v) >> skip << skip;
+
+  while(!zero) {
+    if(high) {
+      *len = Sstrlen(s);
+      return 0;
+    }
+    p += 32;
+    v = _mm256_load_si256((__m256i *)p);
+    zero = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+    high = _mm256_movemask_epi8(v);
+  }
+
+  zero &= -zero;
+  *len = p + __builtin_ctz(zero) - s;
+
+  return 0 == (high & (zero - 1));
+}
+
+/* packs works within each 128-bit half, so put the quarters back in
+   order before taking the mask */
+
+static inline __attribute__((always_inline)) CPU_AVX2
+uint64_t range64_8_avx2(const uint8_t *c, unsigned lo, unsigned span) {
+  __m256i l = _mm256_set1_epi8(lo), s = _mm256_set1_epi8(span), d;
+  uint64_t m = 0;
+  int k;
+
+  for(k = 0; k < 64; k += 32) {
+    d = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i *)(c + k)), l);
+    m |= (uint64_t)(uint32_t)
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(d, s), d)) << k;
+  }
+
+  return m;
+}
+
+static inline __attribute__((always_inline)) CPU_AVX2
+uint64_t range64_16_avx2(const uint16_t *c, unsigned lo, unsigned span) {
+  __m256i l = _mm256_set1_epi16(lo), s = _mm256_set1_epi16(span), a, b;
+  uint64_t m = 0;
+  int k;
+
+  for(k = 0; k < 64; k += 32) {
+    a = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i *)(c + k)), l);
+    b = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i *)(c + k + 16)), l);
+    a = _mm256_packs_epi16(_mm256_cmpeq_epi16(_mm256_min_epu16(a, s), a),
+                           _mm256_cmpeq_epi16(_mm256_min_epu16(b, s), b));
+    a = _mm256_permute4x64_epi64(a, 0xD8);
+    m |= (uint64_t)(uint32_t)_mm256_movemask_epi8(a) << k;
+  }
+
+  return m;
+}
+
+static inline __attribute__((always_inline)) CPU_AVX2
+uint64_t match64_16_avx2(const uint16_t *c, unsigned mask, unsigned val) {
+  __m256i mk = _mm256_set1_epi16(mask), v = _mm256_set1_epi16(val), a, b;
+  uint64_t m = 0;
+  int k;
+
+  for(k = 0; k < 64; k += 32) {
+    a = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(c + k)), mk);
+    b = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(c + k + 16)), mk);
+    a = _mm256_packs_epi16(_mm256_cmpeq_epi16(a, v), _mm256_cmpeq_epi16(b, v));
+    a = _mm256_permute4x64_epi64(a, 0xD8);
+    m |= (uint64_t)(uint32_t)_mm256_movemask_epi8(a) << k;
+  }
+
+  return m;
+}
+
+SELECT_KERNEL(avx2, CPU_AVX2)
+
+/*
+  pack5 and unpack5, 32 squares (20 bytes) a step.  Packing maps the
+  bytes to codes with compares, then merges neighbours: pairs of 5 bits
+  into 10 with pmaddubsw, pairs of those into 20 with pmaddwd, and
+  pairs of those into 40 with a shift, leaving 5 bytes at the bottom of
+  each 64-bit lane to be gathered with pshufb.  Unpacking runs the same
+  steps backwards and maps codes to bytes with two 16-entry pshufb
+  tables.  Each step writes (or reads) 6 bytes past its 20, so the
+  loops stop 10 squares short and leave the rest to the C versions.
+ */
+
+static CPU_AVX2
+int pack5_avx2(const unsigned char *board, int n, unsigned char *bits) {
+  const __m256i a = _mm256_set1_epi8('A'), span = _mm256_set1_epi8(25);
+  const __m256i gather = _mm256_setr_epi8(
+    0, 1, 2, 3, 4, 8, 9, 10, 11, 12, -1, -1, -1, -1, -1, -1,
+    0, 1, 2, 3, 4, 8, 9, 10, 11, 12, -1, -1, -1, -1, -1, -1);
+  __m256i v, d, letter, black, blank, code, lo;
+  int i, esc = 0;
+
+  for(i = 0; i + 42 <= n; i += 32) {
+    v = _mm256_loadu_si256((const __m256i *)(board + i));
+    d = _mm256_sub_epi8(v, a);
+    letter = _mm256_cmpeq_epi8(_mm256_min_epu8(d, span), d);
+    black = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.'));
+    blank = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-'));
+
+    code = _mm256_blendv_epi8(_mm256_set1_epi8(PUZ_PACK_ESCAPE), d, letter);
+    code = _mm256_blendv_epi8(code, _mm256_set1_epi8(PUZ_PACK_BLACK), black);
+    code = _mm256_blendv_epi8(code, _mm256_set1_epi8(PUZ_PACK_BLANK), blank);
+    esc += 32 - __builtin_popcount(_mm256_movemask_epi8(
+      _mm256_or_si256(letter, _mm256_or_si256(black, blank))));
+
+    code = _mm256_maddubs_epi16(code, _mm256_set1_epi16(0x2001));
+    code = _mm256_madd_epi16(code, _mm256_set1_epi32(0x04000001));
+    lo = _mm256_and_si256(code, _mm256_set1_epi64x(0xFFFFFFFF));
+    code = _mm256_srli_epi64(_mm256_xor_si256(code, lo), 12);
+    code = _mm256_shuffle_epi8(_mm256_or_si256(code, lo), gather);
+
+    _mm_storeu_si128((__m128i *)(bits + i / 8 * 5),
+                     _mm256_castsi256_si128(code));
+    _mm_storeu_si128((__m128i *)(bits + i / 8 * 5 + 10),
+                     _mm256_extracti128_si256(code, 1));
+  }
+
+  return esc + pack5_scalar(board + i, n - i, bits + i / 8 * 5);
+}
+
+static CPU_AVX2
+void unpack5_avx2(const unsigned char *bits, int n, unsigned char *board) {
+  const __m256i spread = _mm256_setr_epi8(
+    0, 1, 2, 3, 4, -1, -1, -1, 5, 6, 7, 8, 9, -1, -1, -1,
+    0, 1, 2, 3, 4, -1, -1, -1, 5, 6, 7, 8, 9, -1, -1, -1);
+  const __m256i lo_chars = _mm256_setr_epi8(
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
+    'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
+    'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P');
+  const __m256i hi_chars = _mm256_setr_epi8(
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
+    'Y', 'Z', '.', '-', '?', '?', '?', '?',
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
+    'Y', 'Z', '.', '-', '?', '?', '?', '?');
+  __m256i v, t;
+  int i;
+
+  for(i = 0; i + 42 <= n; i += 32) {
+    v = _mm256_inserti128_si256(_mm256_castsi128_si256(
+          _mm_loadu_si128((const __m128i *)(bits + i / 8 * 5))),
+        _mm_loadu_si128((const __m128i *)(bits + i / 8 * 5 + 10)), 1);
+    v = _mm256_shuffle_epi8(v, spread);
+
+    /* 40 bits to 2 x 20, 20 to 2 x 10, 10 to 2 x 5 */
+    t = _mm256_and_si256(v, _mm256_set1_epi64x(0xFFFFF));
+    v = _mm256_or_si256(t, _mm256_slli_epi64(_mm256_xor_si256(v, t), 12));
+    t = _mm256_and_si256(v, _mm256_set1_epi32(0x3FF));
+    v = _mm256_or_si256(t, _mm256_slli_epi32(_mm256_xor_si256(v, t), 6));
+    t = _mm256_and_si256(v, _mm256_set1_epi16(0x1F));
+    v = _mm256_or_si256(t, _mm256_slli_epi16(_mm256_xor_si256(v, t), 3));
+
+    v = _mm256_blendv_epi8(_mm256_shuffle_epi8(lo_chars, v),
+                           _mm256_shuffle_epi8(hi_chars, v),
+                           _mm256_slli_epi16(v, 3));
+    _mm256_storeu_si256((__m256i *)(board + i), v);
+  }
+
+  unpack5_scalar(bits + i / 8 * 5, n - i, board + i);
+}
+
+/*
+  letters: a byte counter per letter per lane, bumped by subtracting
+  the compare mask (all ones is -1), and summed with vpsadbw before
+  255 vectors can overflow it.  13 letters at a time, so the counters
+  stay in registers.  With SSE2's 16 bytes this loses to the C loop,
+  so there is no SSE2 version.
+ */
+static CPU_AVX2
+void letters_avx2(const unsigned char *p, int n, uint32_t *counts) {
+  __m256i acc[13], v, s;
+  __m128i t;
+  int i, j, k, g, blk, full = n & ~31;
+
+  for(g = 0; g < 26; g += 13) {
+    for(i = 0; i < full; ) {
+      blk = (full - i) / 32;
+      if(blk > 255)
+        blk = 255;
+      for(k = 0; k < 13; k++)
+        acc[k] = _mm256_setzero_si256();
+      for(j = 0; j < blk; j++, i += 32) {
+        v = _mm256_loadu_si256((const __m256i *)(p + i));
+#pragma GCC unroll 13
+        for(k = 0; k < 13; k++)
+          acc[k] = _mm256_sub_epi8(acc[k],
+                                   _mm256_cmpeq_epi8(v, _mm256_set1_epi8(g + k)));
+      }
+      for(k = 0; k < 13; k++) {
+        s = _mm256_sad_epu8(acc[k], _mm256_setzero_si256());
+        t = _mm_add_epi64(_mm256_castsi256_si128(s),
+                          _mm256_extracti128_si256(s, 1));
+        counts[g + k] += _mm_cvtsi128_si32(t) + _mm_extract_epi16(t, 4);
+      }
+    }
+  }
+
+  letters_scalar(p + full, n - full, counts);
+}
+
+/* AVX-512: compares give a 64-bit mask straight out */
+
+static inline __attribute__((always_inline)) CPU_AVX512
+void check64_avx512(const unsigned char *s, const unsigned char *g,
+                    uint64_t *good, uint64_t *bad) {
+  __m512i sv = _mm512_loadu_si512(s), gv = _mm512_loadu_si512(g);
+  uint64_t eq, black, blank;
+
+  eq = _mm512_cmpeq_epi8_mask(sv, gv);
+  black = _mm512_cmpeq_epi8_mask(sv, _mm512_set1_epi8('.'));
+  blank = _mm512_cmpeq_epi8_mask(gv, _mm512_set1_epi8('-'));
+
+  *good = eq & ~black;
+  *bad = ~eq & ~black & ~blank;
+}
+
+CHECK_KERNEL(avx512, CPU_AVX512)
+
+static CPU_AVX512
+void letters_avx512(const unsigned char *p, int n, uint32_t *counts) {
+  uint64_t c[26];
+  __m512i v;
+  int i, k, full = n & ~63;
+
+  memset(c, 0, sizeof(c));
+  for(i = 0; i < full; i += 64) {
+    v = _mm512_loadu_si512(p + i);
+#pragma GCC unroll 26
+    for(k = 0; k < 26; k++)
+      c[k] += __builtin_popcountll(_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(k)));
+  }
+  for(k = 0; k < 26; k++)
+    counts[k] += c[k];
+
+  letters_avx2(p + full, n - full, counts);
+}
+
+static inline __attribute__((always_inline)) CPU_AVX512
+uint64_t range64_8_avx512(const uint8_t *c, unsigned lo, unsigned span) {
+  __m512i d = _mm512_sub_epi8(_mm512_loadu_si512(c), _mm512_set1_epi8(lo));
+
+  return _mm512_cmple_epu8_mask(d, _mm512_set1_epi8(span));
+}
+
+static inline __attribute__((always_inline)) CPU_AVX512
+uint64_t range64_16_avx512(const uint16_t *c, unsigned lo, unsigned span) {
+  __m512i l = _mm512_set1_epi16(lo), s = _mm512_set1_epi16(span);
+  __m512i a = _mm512_sub_epi16(_mm512_loadu_si512(c), l);
+  __m512i b = _mm512_sub_epi16(_mm512_loadu_si512(c + 32), l);
+
+  return (uint64_t)_mm512_cmple_epu16_mask(a, s) |
+    (uint64_t)_mm512_cmple_epu16_mask(b, s) << 32;
+}
+
+static inline __attribute__((always_inline)) CPU_AVX512
+uint64_t match64_16_avx512(const uint16_t *c, unsigned mask, unsigned val) {
+  __m512i mk = _mm512_set1_epi16(mask), v = _mm512_set1_epi16(val);
+  __m512i a = _mm512_and_si512(_mm512_loadu_si512(c), mk);
+  __m512i b = _mm512_and_si512(_mm512_loadu_si512(c + 32), mk);
+
+  return (uint64_t)_mm512_cmpeq_epi16_mask(a, v) |
+    (uint64_t)_mm512_cmpeq_epi16_mask(b, v) << 32;
+}
+
+SELECT_KERNEL(avx512, CPU_AVX512)
+
+#endif /* CPU_X86 */
+
+/**
+ * cpu_table - fill in the kernels for a level
+ *
+ * @level: a PUZ_CPU_* level this CPU supports
+ * @k: the table to fill in
+ *
+ * This is an internal function.
+ */
+static void cpu_table(int level, struct puz_kernels_t *k) {
+  k->cksum = cksum_scalar;
+  k->check = check_scalar;
+  k->eol = eol_scalar;
+  k->ascii = ascii_scalar;
+  k->letters = letters_scalar;
+  k->range8 = range8_scalar;
+  k->range16 = range16_scalar;
+  k->match16 = match16_scalar;
+  k->pack5 = pack5_scalar;
+  k->unpack5 = unpack5_scalar;
+
+#ifdef CPU_X86
+  if(level >= PUZ_CPU_SSE2) {
+    k->check = check_sse2;
+    k->eol = eol_sse2;
+    k->ascii = ascii_sse2;
+    k->range8 = range8_sse2;
+    k->range16 = range16_sse2;
+    k->match16 = match16_sse2;
+  }
+  if(level >= PUZ_CPU_AVX2) {
+    k->check = check_avx2;
+    k->eol = eol_avx2;
+    k->ascii = ascii_avx2;
+    k->letters = letters_avx2;
+    k->range8 = range8_avx2;
+    k->range16 = range16_avx2;
+    k->match16 = match16_avx2;
+    k->pack5 = pack5_avx2;
+    k->unpack5 = unpack5_avx2;
+  }
+  if(level >= PUZ_CPU_AVX512) {
+    /* 32-byte eol and ascii are already more than a line or a clue */
+    k->check = check_avx512;
+    k->letters = letters_avx512;
+    k->range8 = range8_avx512;
+    k->range16 = range16_avx512;
+    k->match16 = match16_avx512;
+  }
+#else
+  (void)level;
+#endif
+}
+
+/**
+ * puz_cpu_level_detect - find the best level this CPU can run
+ *
+ * Return Value: a PUZ_CPU_* level.
+ */
+int puz_cpu_level_detect(void) {
+#ifdef CPU_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512bw"))
+    return PUZ_CPU_AVX512;
+  if(__builtin_cpu_supports("avx2"))
+    return PUZ_CPU_AVX2;
+  if(__builtin_cpu_supports("sse2"))
+    return PUZ_CPU_SSE2;
+#endif
+  return PUZ_CPU_SCALAR;
+}
+
+/**
+ * puz_cpu_level_get - the level the kernels are running at
+ *
+ * Return Value: a PUZ_CPU_* level.
+ */
+int puz_cpu_level_get(void) {
+  return cpu_level;
+}
+
+/**
+ * puz_cpu_level_set - switch the kernels to another level
+ *
+ * @level: a PUZ_CPU_* level; higher than the CPU supports means the
+ *   best it does
+ *
+ * This isn't safe while other threads are using the library; call it
+ * first thing.
+ *
+ * Return Value: the level now in effect, or -1 if @level is negative.
+ */
+int puz_cpu_level_set(int level) {
+  int best = puz_cpu_level_detect();
+
+  if(level < 0)
+    return -1;
+  if(level > best)
+    level = best;
+
+  cpu_table(level, &puz_kernels);
+  cpu_level = level;
+
+  return level;
+}
+
+/**
+ * puz_cpu_level_name - name a level
+ *
+ * @level: a PUZ_CPU_* level
+ *
+ * Return Value: "scalar", "sse2", "avx2" or "avx512", the same names
+ * PUZ_CPU_LEVEL takes; NULL for anything else.
+ */
+const char *puz_cpu_level_name(int level) {
+  static const char *names[] = { "scalar", "sse2", "avx2", "avx512" };
+
+  if(level < PUZ_CPU_SCALAR || level > PUZ_CPU_AVX512)
+    return NULL;
+  return names[level];
+}
+
+/**
+ * cpu_init - choose the kernels at startup
+ *
+ * This is an internal function, run before main().
+ */
+static void cpu_init(void) {
+  char *env = getenv("PUZ_CPU_LEVEL");
+  int level = puz_cpu_level_detect(), want, i;
+
+  if(env && *env) {
+    want = -1;
+    for(i = PUZ_CPU_SCALAR; i <= PUZ_CPU_AVX512; i++) {
+      if(!strcasecmp(env, puz_cpu_level_name(i)))
+        want = i;
+    }
+    if(want < 0 && isdigit((unsigned char)*env))
+      want = atoi(env);
+
+    if(want < 0 || want > PUZ_CPU_AVX512)
+      fprintf(stderr, "PUZ_CPU_LEVEL=%s isn't a level; using %s\n",
+              env, puz_cpu_level_name(level));
+    else if(want > level)
+      fprintf(stderr, "PUZ_CPU_LEVEL=%s, but this CPU only has %s\n",
+              env, puz_cpu_level_name(level));
+    else
+      level = want;
+  }
+
+  puz_cpu_level_set(level);
+}
+
+/* the self-test's random numbers; any fixed sequence will do */
+static uint32_t cpu_rand(uint32_t *s) {
+  *s ^= *s << 13;
+  *s ^= *s >> 17;
+  *s ^= *s << 5;
+  return *s;
+}
+
+/**
+ * puz_cpu_selftest - check every supported level against the C code
+ *
+ * Each kernel, at each level up to what this CPU can run, is given the
+ * same random input as the plain C version: odd lengths, odd
+ * alignments, board sizes on and off the fixed-size paths, and boards
+ * big enough to take more than one block.
+ *
+ * Return Value: the number of disagreements (0 if all is well), or -1
+ * on allocation failure.
+ */
+int puz_cpu_selftest(void) {
+  struct puz_kernels_t ref, k;
+  struct puz_check_result_t r0, r1;
+  unsigned char *buf, *sol, *grid, *m0, *m1, *a, *b;
+  uint16_t *w;
+  uint64_t s0[3][64], s1[3][64];
+  static const int sizes[] = { 1, 15*15, 21*21, 5*7, 64, 65, 13*17,
+                               100*100, 255*255 };
+  const int max = 255*255, padded = (max + 63) & ~63;
+  uint32_t seed = 0x2545F491, c0[26], c1[26];
+  int level, best = puz_cpu_level_detect(), bad = 0, before;
+  int t, i, n, off, len, bd_sz;
+  unsigned lo, hi;
+  size_t l0, l1;
+
+  buf = (unsigned char *)malloc(max + 128);
+  sol = (unsigned char *)malloc(padded);
+  grid = (unsigned char *)malloc(max);
+  m0 = (unsigned char *)malloc(max / 8 + 1);
+  m1 = (unsigned char *)malloc(max / 8 + 1);
+  if(NULL == buf || NULL == sol || NULL == grid || NULL == m0 || NULL == m1) {
+    perror("malloc");
+    bad = -1;
+    goto out;
+  }
+
+  cpu_table(PUZ_CPU_SCALAR, &ref);
+
+  for(level = PUZ_CPU_SCALAR + 1; level <= best; level++) {
+    cpu_table(level, &k);
+    before = bad;
+
+    for(t = 0; t < 200; t++) {
+      n = cpu_rand(&seed) % 4096;
+      off = cpu_rand(&seed) % 64;
+      a = buf + off;
+
+      for(i = 0; i < n; i++)
+        a[i] = cpu_rand(&seed);
+      if(k.cksum(a, n, t) != ref.cksum(a, n, t))
+        bad++;
+
+      /* sparse line ends, and a stop anywhere */
+      for(i = 0; i < n; i++)
+        a[i] = (cpu_rand(&seed) % 97) ? 'a' + i % 26 :
+          (cpu_rand(&seed) & 1) ? '\r' : '\n';
+      b = a + (n ? cpu_rand(&seed) % n : 0);
+      if(k.eol(a, b) != ref.eol(a, b) || k.eol(b, a + n) != ref.eol(b, a + n))
+        bad++;
+
+      /* ASCII, with now and then one high byte */
+      for(i = 0; i < n; i++)
+        a[i] = 1 + cpu_rand(&seed) % 127;
+      a[n] = 0;
+      if(t & 1 && n > 0)
+        a[cpu_rand(&seed) % n] |= 0x80;
+      if(k.ascii(a, &l1) != ref.ascii(a, &l0) || l0 != l1)
+        bad++;
+
+      for(i = 0; i < n; i++)
+        a[i] = cpu_rand(&seed) % (t & 2 ? 26 : 30);
+      memset(c0, 0, sizeof(c0));
+      memset(c1, 0, sizeof(c1));
+      ref.letters(a, n, c0);
+      k.letters(a, n, c1);
+      if(memcmp(c0, c1, sizeof(c0)))
+        bad++;
+
+      /* columns of few distinct values, so ranges hit their ends */
+      w = (uint16_t *)(grid + (off & ~1));
+      for(i = 0; i < n; i++)
+        w[i] = cpu_rand(&seed) % 8 * (t & 4 ? 0x2001 : 37);
+      lo = cpu_rand(&seed) % 300;
+      hi = lo + cpu_rand(&seed) % (t & 8 ? 300 : 0x10000 - lo);
+
+      memset(s0, 0xFF, sizeof(s0));
+      memset(s1, 0xFF, sizeof(s1));
+      ref.range8(a, n, lo % 32, lo % 32 + hi % (256 - lo % 32), s0[0]);
+      k.range8(a, n, lo % 32, lo % 32 + hi % (256 - lo % 32), s1[0]);
+      ref.range16(w, n, lo, hi, s0[1]);
+      k.range16(w, n, lo, hi, s1[1]);
+      ref.match16(w, n, hi, lo & hi, s0[2]);
+      k.match16(w, n, hi, lo & hi, s1[2]);
+      if(memcmp(s0, s1, sizeof(s0)))
+        bad++;
+
+      /* boards, with now and then a byte that needs escaping */
+      for(i = 0; i < n; i++) {
+        len = cpu_rand(&seed) % 64;
+        a[i] = len == 0 ? '.' : len == 1 ? '-' :
+          len == 2 && t & 1 ? (unsigned char)cpu_rand(&seed) :
+          (unsigned char)('A' + len % 26);
+      }
+      len = (5 * n + 7) / 8;
+      if(ref.pack5(a, n, m0) != k.pack5(a, n, m1) || memcmp(m0, m1, len))
+        bad++;
+      ref.unpack5(m0, n, grid);
+      k.unpack5(m0, n, grid + 4096);
+      if(memcmp(grid, grid + 4096, n))
+        bad++;
+    }
+
+    for(t = 0; t < (int)(sizeof(sizes) / sizeof(sizes[0])); t++) {
+      bd_sz = sizes[t];
+      memset(sol, '.', padded);
+      for(i = 0; i < bd_sz; i++) {
+        n = cpu_rand(&seed) % 8;
+        sol[i] = n == 0 ? '.' : 'A' + cpu_rand(&seed) % 4;
+        n = cpu_rand(&seed) % 4;
+        grid[i] = n == 0 ? '-' : n == 1 ? sol[i] : 'A' + cpu_rand(&seed) % 4;
+      }
+
+      memset(&r0, 0, sizeof(r0));
+      memset(&r1, 0, sizeof(r1));
+      memset(m0, 0xAA, max / 8 + 1);
+      memset(m1, 0xAA, max / 8 + 1);
+      for(off = 0; off < bd_sz; off += 4096) {
+        len = ((bd_sz + 63) & ~63) - off;
+        if(len > 4096)
+          len = 4096;
+        ref.check(sol, grid, off, len, bd_sz, &r0, m0);
+        k.check(sol, grid, off, len, bd_sz, &r1, m1);
+      }
+      if(r0.correct != r1.correct || r0.incorrect != r1.incorrect ||
+         memcmp(m0, m1, max / 8 + 1))
+        bad++;
+    }
+
+    if(bad > before)
+      fprintf(stderr, "puz_cpu_selftest: %s disagrees with scalar\n",
+              puz_cpu_level_name(level));
+  }
+
+ out:
+  free(buf);
+  free(sol);
+  free(grid);
+  free(m0);
+  free(m1);
+
+  return bad;
+}
@@ -0,0 +1,765 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * dict.c -- Compiled word-list dictionaries
+ */
+
+#include <puz.h>
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+  A word list is compiled into a minimal DAWG (a trie with identical
+  suffix subtrees merged), written out as flat arrays so a dictionary
+  file can be mmap'd and used as-is:
+
+    struct puz_dict_head_t
+    struct puz_dict_node_t nodes[n_nodes]
+    uint32_t edges[n_edges]      target node << 8 | letter
+    uint8_t  scores[n_words]
+
+  Each node's edges are contiguous and sorted by letter.  Each node
+  also records how many words pass through it; walking a word from
+  the root and adding up the counts of the edges skipped on the way
+  gives the word's rank in sorted order, which indexes the score
+  table.  So scores take one byte per word, not one per node.
+
+  Words are upper-cased and stripped of anything that isn't a letter,
+  so "ice cream;60" is stored as ICECREAM with score 60.
+ */
+
+#define DICT_MAGIC "PUZDAWG1"
+#define DICT_BYTE_ORDER 0x01020304
+#define DICT_MAX_WORD 255   /* the longest slot a .puz can hold */
+#define DICT_DEFAULT_SCORE 50
+#define DICT_MAX_NODES (1 << 24) /* node ids share an edge word with the letter */
+
+#define EDGE_TARGET(e) ((e) >> 8)
+#define EDGE_LETTER(e) ((e) & 0xFF)
+
+struct dict_word_t {
+  unsigned char *word;
+  int score;
+};
+
+/* A node still being built: only those on the path of the last word
+   added can still gain edges. */
+struct dict_open_t {
+  int final;
+  int n;
+  unsigned char letter[26];
+  uint32_t target[26];
+};
+
+struct dict_build_t {
+  struct puz_dict_node_t *nodes;
+  int n_nodes, max_nodes;
+
+  uint32_t *edges;
+  int n_edges, max_edges;
+
+  uint32_t *reg;   /* open-addressed register of frozen nodes, id+1 */
+  uint32_t reg_mask;
+
+  struct dict_open_t path[DICT_MAX_WORD + 1];
+};
+
+static int dict_word_cmp(const void *a, const void *b);
+static int dict_normalize(char *line, unsigned char *word, int *score);
+static uint32_t dict_hash(struct dict_open_t *o);
+static int dict_freeze(struct dict_build_t *b, struct dict_open_t *o);
+static int dict_walk(struct puz_dict_t *d, unsigned char *word, int len,
+                     uint32_t *node, uint32_t *rank);
+static int dict_check(struct puz_dict_head_t *h);
+
+/**
+ * dict_word_cmp - qsort comparator for words, in byte order
+ *
+ * This is an internal function.
+ */
+static int dict_word_cmp(const void *a, const void *b) {
+  const struct dict_word_t *wa = (const struct dict_word_t *)a;
+  const struct dict_word_t *wb = (const struct dict_word_t *)b;
+
+  return strcmp((char *)wa->word, (char *)wb->word);
+}
+
+/**
+ * dict_normalize - turn a line of a word list into a word and score
+ *
+ * @line: the line, "WORD" or "WORD;SCORE"
+ * @word: buffer of DICT_MAX_WORD+1 bytes for the word
+ * @score: receives the score, clamped to 0..255
+ *
+ * This is an internal function.
+ *
+ * Return Value: the length of the word; 0 if there is none.
+ */
+static int dict_normalize(char *line, unsigned char *word, int *score) {
+  char *semi = strchr(line, ';');
+  int len = 0;
+
+  *score = DICT_DEFAULT_SCORE;
+  if(semi) {
+    *score = atoi(semi + 1);
+    *semi = 0;
+  }
+  if(*score < 0)
+    *score = 0;
+  if(*score > 255)
+    *score = 255;
+
+  for(; *line; line++) {
+    if(!isalpha((unsigned char)*line))
+      continue;
+    if(len == DICT_MAX_WORD)
+      return 0;
+    word[len++] = toupper((unsigned char)*line);
+  }
+  word[len] = 0;
+
+  return len;
+}
+
+/**
+ * dict_hash - hash a node by its finality and edges
+ *
+ * This is an internal function.
+ */
+static uint32_t dict_hash(struct dict_open_t *o) {
+  uint32_t h = 2166136261u ^ o->final;
+  int i;
+
+  for(i = 0; i < o->n; i++) {
+    h = (h ^ o->letter[i]) * 16777619u;
+    h = (h ^ o->target[i]) * 16777619u;
+  }
+
+  return h;
+}
+
+/**
+ * dict_freeze - find or create the frozen node equal to an open node
+ *
+ * @b: the builder
+ * @o: the open node, all of whose targets are frozen
+ *
+ * This is an internal function.
+ *
+ * Return Value: the node's id, or -1 on allocation failure.
+ */
+static int dict_freeze(struct dict_build_t *b, struct dict_open_t *o) {
+  struct puz_dict_node_t *nd;
+  uint32_t h, id;
+  int i;
+
+  for(h = dict_hash(o) & b->reg_mask; b->reg[h]; h = (h + 1) & b->reg_mask) {
+    nd = &b->nodes[b->reg[h] - 1];
+    if(nd->final != o->final || nd->n_edges != o->n)
+      continue;
+    for(i = 0; i < o->n; i++) {
+      if(b->edges[nd->first + i] != (o->target[i] << 8 | o->letter[i]))
+        break;
+    }
+    if(i == o->n)
+      return b->reg[h] - 1;
+  }
+
+  if(b->n_nodes == DICT_MAX_NODES) {
+    fprintf(stderr, "dictionary too large\n");
+    return -1;
+  }
+  if(b->n_nodes == b->max_nodes) {
+    b->max_nodes *= 2;
+    nd = (struct puz_dict_node_t *)realloc(b->nodes, b->max_nodes * sizeof(*nd));
+    if(NULL == nd) {
+      perror("realloc");
+      return -1;
+    }
+    b->nodes = nd;
+  }
+  if(b->n_edges + o->n > b->max_edges) {
+    uint32_t *e;
+
+    b->max_edges *= 2;
+    e = (uint32_t *)realloc(b->edges, b->max_edges * sizeof(uint32_t));
+    if(NULL == e) {
+      perror("realloc");
+      return -1;
+    }
+    b->edges = e;
+  }
+
+  id = b->n_nodes++;
+  nd = &b->nodes[id];
+  nd->first = b->n_edges;
+  nd->n_edges = o->n;
+  nd->final = o->final;
+  nd->pad = 0;
+  nd->count = o->final;
+  for(i = 0; i < o->n; i++) {
+    b->edges[b->n_edges++] = o->target[i] << 8 | o->letter[i];
+    nd->count += b->nodes[o->target[i]].count;
+  }
+
+  b->reg[h] = id + 1;
+
+  return id;
+}
+
+/**
+ * puz_dict_compile - compile a word list into a dictionary file
+ *
+ * @in_path: the word list, one "WORD" or "WORD;SCORE" per line (required)
+ * @out_path: where to write the dictionary (required)
+ *
+ * Scores are 0 to 255, higher being better; words without one get 50.
+ * If a word appears more than once, its best score is kept.
+ *
+ * Return Value: the number of words written, or -1 on error.
+ */
+int puz_dict_compile(const char *in_path, const char *out_path) {
+  struct dict_build_t b;
+  struct dict_word_t *words = NULL, *tmp;
+  struct puz_dict_head_t head;
+  unsigned char word[DICT_MAX_WORD + 1];
+  unsigned char *scores = NULL;
+  char line[1024];
+  FILE *in, *out = NULL;
+  int n = 0, max = 0, total = 0, len, score, i, j, d, p, prev_len;
+  int rv = -1;
+  uint32_t cap;
+
+  if(NULL == in_path || NULL == out_path)
+    return -1;
+
+  memset(&b, 0, sizeof(b));
+
+  in = fopen(in_path, "r");
+  if(NULL == in) {
+    perror("fopen");
+    return -1;
+  }
+
+  while(fgets(line, sizeof(line), in)) {
+    line[strcspn(line, "\r\n")] = 0;
+    len = dict_normalize(line, word, &score);
+    if(0 == len)
+      continue;
+
+    if(n == max) {
+      max = max ? 2 * max : 4096;
+      tmp = (struct dict_word_t *)realloc(words, max * sizeof(*words));
+      if(NULL == tmp) {
+        perror("realloc");
+        goto out;
+      }
+      words = tmp;
+    }
+    words[n].word = Sstrdup(word);
+    if(NULL == words[n].word) {
+      perror("strdup");
+      goto out;
+    }
+    words[n++].score = score;
+    total += len;
+  }
+
+  qsort(words, n, sizeof(*words), dict_word_cmp);
+
+  /* drop duplicates, keeping the best score */
+  for(i = j = 0; i < n; i++) {
+    if(j && 0 == strcmp((char *)words[j-1].word, (char *)words[i].word)) {
+      if(words[i].score > words[j-1].score)
+        words[j-1].score = words[i].score;
+      free(words[i].word);
+      continue;
+    }
+    words[j++] = words[i];
+  }
+  n = j;
+
+  b.max_nodes = b.max_edges = 1024;
+  for(cap = 1024; cap < 2 * (uint32_t)(total + 1); cap *= 2)
+    ;
+  b.reg_mask = cap - 1;
+  b.nodes = (struct puz_dict_node_t *)malloc(b.max_nodes * sizeof(*b.nodes));
+  b.edges = (uint32_t *)malloc(b.max_edges * sizeof(uint32_t));
+  b.reg = (uint32_t *)calloc(cap, sizeof(uint32_t));
+  scores = (unsigned char *)malloc(n ? n : 1);
+  if(NULL == b.nodes || NULL == b.edges || NULL == b.reg || NULL == scores) {
+    perror("malloc");
+    goto out;
+  }
+
+  /*
+    Words arrive sorted, so once a word diverges from the one before
+    it, nothing more can be added below the point of divergence: those
+    nodes are frozen, deepest first, merging each with an equal node
+    if there is one.
+   */
+  prev_len = 0;
+  memset(&b.path[0], 0, sizeof(b.path[0]));
+  for(i = 0; i < n; i++) {
+    unsigned char *w = words[i].word;
+
+    len = Sstrlen(w);
+    for(p = 0; p < len && p < prev_len && w[p] == words[i-1].word[p]; p++)
+      ;
+
+    for(d = prev_len; d > p; d--) {
+      int id = dict_freeze(&b, &b.path[d]);
+      if(id < 0)
+        goto out;
+      b.path[d-1].target[b.path[d-1].n - 1] = id;
+    }
+
+    for(d = p + 1; d <= len; d++) {
+      struct dict_open_t *parent = &b.path[d-1];
+
+      parent->letter[parent->n] = w[d-1];
+      parent->target[parent->n++] = 0;
+      memset(&b.path[d], 0, sizeof(b.path[d]));
+    }
+    b.path[len].final = 1;
+
+    scores[i] = words[i].score;
+    prev_len = len;
+  }
+
+  for(d = prev_len; d > 0; d--) {
+    int id = dict_freeze(&b, &b.path[d]);
+    if(id < 0)
+      goto out;
+    b.path[d-1].target[b.path[d-1].n - 1] = id;
+  }
+  i = dict_freeze(&b, &b.path[0]);
+  if(i < 0)
+    goto out;
+
+  memset(&head, 0, sizeof(head));
+  memcpy(head.magic, DICT_MAGIC, 8);
+  head.byte_order = DICT_BYTE_ORDER;
+  head.n_nodes = b.n_nodes;
+  head.n_edges = b.n_edges;
+  head.n_words = n;
+  head.root = i;
+
+  out = fopen(out_path, "wb");
+  if(NULL == out) {
+    perror("fopen");
+    goto out;
+  }
+  if(1 != fwrite(&head, sizeof(head), 1, out) ||
+     (size_t)b.n_nodes != fwrite(b.nodes, sizeof(*b.nodes), b.n_nodes, out) ||
+     (size_t)b.n_edges != fwrite(b.edges, sizeof(uint32_t), b.n_edges, out) ||
+     (size_t)n != fwrite(scores, 1, n, out)) {
+    perror("fwrite");
+    goto out;
+  }
+  if(0 != fclose(out)) {
+    out = NULL;
+    perror("fclose");
+    goto out;
+  }
+  out = NULL;
+
+  rv = n;
+
+ out:
+  if(out)
+    fclose(out);
+  fclose(in);
+  for(i = 0; i < n; i++)
+    free(words[i].word);
+  free(words);
+  free(scores);
+  free(b.nodes);
+  free(b.edges);
+  free(b.reg);
+
+  return rv;
+}
+
+/**
+ * dict_check - check a mapped dictionary's nodes and edges
+ *
+ * @h: the header, followed by the arrays it sizes
+ *
+ * Every edge range must lie inside the edge array and every edge must
+ * point at a real node.  Each node's word count must also equal its
+ * own finality plus its targets' counts, with the root's equal to the
+ * number of words, so that no rank can index past the score table.
+ *
+ * Return Value: 1 if the arrays are consistent, else 0.
+ */
+static int dict_check(struct puz_dict_head_t *h) {
+  struct puz_dict_node_t *nodes = (struct puz_dict_node_t *)(h + 1);
+  uint32_t *edges = (uint32_t *)(nodes + h->n_nodes);
+  uint64_t count;
+  uint32_t i, j;
+
+  for(i = 0; i < h->n_nodes; i++) {
+    if(nodes[i].final > 1 || nodes[i].first > h->n_edges ||
+       nodes[i].n_edges > h->n_edges - nodes[i].first)
+      return 0;
+    count = nodes[i].final;
+    for(j = 0; j < nodes[i].n_edges; j++) {
+      if(EDGE_TARGET(edges[nodes[i].first + j]) >= h->n_nodes)
+        return 0;
+      count += nodes[EDGE_TARGET(edges[nodes[i].first + j])].count;
+    }
+    if(count != nodes[i].count)
+      return 0;
+  }
+
+  return nodes[h->root].count == h->n_words;
+}
+
+/**
+ * puz_dict_open - map a compiled dictionary into memory
+ *
+ * @path: a file written by puz_dict_compile() (required)
+ *
+ * Nothing is parsed or copied; the file is checked for size and
+ * consistency and then used in place.
+ *
+ * Return Value: the dictionary, to be released with puz_dict_close(),
+ * or NULL on error.
+ */
+struct puz_dict_t *puz_dict_open(const char *path) {
+  struct puz_dict_t *d;
+  struct puz_dict_head_t *h;
+  struct stat st;
+  void *map;
+  size_t need;
+  int fd;
+
+  if(NULL == path)
+    return NULL;
+
+  fd = open(path, O_RDONLY);
+  if(fd < 0) {
+    perror("open");
+    return NULL;
+  }
+  if(0 != fstat(fd, &st) || st.st_size < (off_t)sizeof(struct puz_dict_head_t)) {
+    close(fd);
+    return NULL;
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(MAP_FAILED == map) {
+    perror("mmap");
+    return NULL;
+  }
+
+  h = (struct puz_dict_head_t *)map;
+  need = sizeof(*h) + (size_t)h->n_nodes * sizeof(struct puz_dict_node_t) +
+    (size_t)h->n_edges * sizeof(uint32_t) + h->n_words;
+  if(memcmp(h->magic, DICT_MAGIC, 8) || h->byte_order != DICT_BYTE_ORDER ||
+     need != (size_t)st.st_size || h->root >= h->n_nodes || !dict_check(h)) {
+    fprintf(stderr, "%s: not a dictionary for this machine\n", path);
+    munmap(map, st.st_size);
+    return NULL;
+  }
+
+  d = (struct puz_dict_t *)malloc(sizeof(struct puz_dict_t));
+  if(NULL == d) {
+    perror("malloc");
+    munmap(map, st.st_size);
+    return NULL;
+  }
+
+  d->map = map;
+  d->map_sz = st.st_size;
+  d->head = h;
+  d->nodes = (struct puz_dict_node_t *)(h + 1);
+  d->edges = (uint32_t *)(d->nodes + h->n_nodes);
+  d->scores = (unsigned char *)(d->edges + h->n_edges);
+
+  return d;
+}
+
+/**
+ * puz_dict_close - unmap a dictionary
+ *
+ * @d: the dictionary, or NULL
+ */
+void puz_dict_close(struct puz_dict_t *d) {
+  if(NULL == d)
+    return;
+
+  munmap(d->map, d->map_sz);
+  free(d);
+}
+
+/**
+ * puz_dict_word_count - get the number of words in a dictionary
+ *
+ * @d: the dictionary (required)
+ *
+ * Returns -1 on error; else a non-negative value
+ */
+int puz_dict_word_count(struct puz_dict_t *d) {
+  if(NULL == d)
+    return -1;
+
+  return d->head->n_words;
+}
+
+/**
+ * dict_walk - follow a string down from the root
+ *
+ * @d: the dictionary
+ * @word: the string; letters are upper-cased as we go
+ * @len: its length
+ * @node: receives the node reached
+ * @rank: if not NULL, receives the number of words sorting before
+ *   everything under that node
+ *
+ * This is an internal function.
+ *
+ * Return Value: 1 if the whole string was followed, 0 if not.
+ */
+static int dict_walk(struct puz_dict_t *d, unsigned char *word, int len,
+                     uint32_t *node, uint32_t *rank) {
+  struct puz_dict_node_t *nd;
+  uint32_t n = d->head->root, r = 0, e, c;
+  int i, k;
+
+  for(i = 0; i < len; i++) {
+    nd = &d->nodes[n];
+    c = toupper(word[i]);
+    r += nd->final;
+
+    for(k = 0; k < nd->n_edges; k++) {
+      e = d->edges[nd->first + k];
+      if(EDGE_LETTER(e) == c)
+        break;
+      r += d->nodes[EDGE_TARGET(e)].count;
+    }
+    if(k == nd->n_edges)
+      return 0;
+
+    n = EDGE_TARGET(e);
+  }
+
+  *node = n;
+  if(rank)
+    *rank = r;
+
+  return 1;
+}
+
+/**
+ * puz_dict_lookup - look up a word
+ *
+ * @d: the dictionary (required)
+ * @word: the word, in either case; need not be NUL-terminated (required)
+ * @len: the length of the word
+ *
+ * Return Value: the word's score, or -1 if it isn't in the dictionary.
+ */
+int puz_dict_lookup(struct puz_dict_t *d, unsigned char *word, int len) {
+  uint32_t n, r;
+
+  if(NULL == d || NULL == word || len <= 0)
+    return -1;
+
+  if(!dict_walk(d, word, len, &n, &r) || !d->nodes[n].final)
+    return -1;
+
+  return d->scores[r];
+}
+
+/**
+ * puz_dict_prefix - count the words starting with a prefix
+ *
+ * @d: the dictionary (required)
+ * @prefix: the prefix, in either case (required)
+ * @len: the length of the prefix; 0 counts every word
+ *
+ * Return Value: the number of words, which includes the prefix itself
+ * if it is a word, or -1 on error.
+ */
+int puz_dict_prefix(struct puz_dict_t *d, unsigned char *prefix, int len) {
+  uint32_t n;
+
+  if(NULL == d || (NULL == prefix && len > 0) || len < 0)
+    return -1;
+
+  if(!dict_walk(d, prefix, len, &n, NULL))
+    return 0;
+
+  return d->nodes[n].count;
+}
+
+/**
+ * puz_dict_match - find the words matching a pattern
+ *
+ * @d: the dictionary (required)
+ * @pattern: letters, and '?' or '-' for any letter (required)
+ * @len: the length of the pattern; only words of exactly this length match
+ * @cb: called with each match, its length, its score and @arg, in
+ *   sorted order; returning non-zero stops the search.  May be NULL.
+ * @arg: passed to @cb
+ *
+ * The word passed to @cb is only valid during the call.
+ *
+ * Return Value: the number of matches reported, or -1 on error.
+ */
+int puz_dict_match(struct puz_dict_t *d, unsigned char *pattern, int len,
+                   int (*cb)(unsigned char *word, int len, int score, void *arg),
+                   void *arg) {
+  uint32_t node[DICT_MAX_WORD + 1], rank[DICT_MAX_WORD + 1];
+  int edge[DICT_MAX_WORD + 1];
+  unsigned char word[DICT_MAX_WORD + 1];
+  struct puz_dict_node_t *nd;
+  uint32_t e;
+  int depth = 0, found = 0, c;
+
+  if(NULL == d || NULL == pattern || len <= 0 || len > DICT_MAX_WORD)
+    return -1;
+
+  /*
+    Depth-first, with an explicit stack: edge[i] is the next edge to
+    try out of node[i], and rank[i] the rank of the first word under
+    that edge.
+   */
+  node[0] = d->head->root;
+  edge[0] = 0;
+  rank[0] = d->nodes[node[0]].final;
+
+  while(depth >= 0) {
+    nd = &d->nodes[node[depth]];
+
+    if(depth == len || edge[depth] == nd->n_edges) {
+      depth--;
+      continue;
+    }
+
+    e = d->edges[nd->first + edge[depth]++];
+    c = pattern[depth] == '?' || pattern[depth] == '-' ? 0 : toupper(pattern[depth]);
+    if(c && c != (int)EDGE_LETTER(e)) {
+      rank[depth] += d->nodes[EDGE_TARGET(e)].count;
+      continue;
+    }
+
+    word[depth] = EDGE_LETTER(e);
+    node[depth+1] = EDGE_TARGET(e);
+    rank[depth+1] = rank[depth] + d->nodes[node[depth+1]].final;
+    edge[depth+1] = 0;
+    rank[depth] += d->nodes[node[depth+1]].count;
+
+    if(depth + 1 == len) {
+      if(d->nodes[node[depth+1]].final) {
+        found++;
+        word[len] = 0;
+        if(cb && cb(word, len, d->scores[rank[depth+1] - 1], arg))
+          return found;
+      }
+      continue;
+    }
+
+    depth++;
+  }
+
+  return found;
+}
+
+/**
+ * puz_dict_check_puzzle - validate and score every answer in a puzzle
+ *
+ * @d: the dictionary (required)
+ * @puz: the puzzle; its solution and bitboard must be set (required)
+ * @report: receives the totals (required)
+ * @scores: if not NULL, an array of at least one int per slot, which
+ *   receives each answer's score, or -1 if it isn't a word.  Slots
+ *   are in clue order: by starting square, across before down.
+ *
+ * Rebus squares are checked by their single solution letter.
+ *
+ * Return Value: -1 on error, else the number of answers not in the
+ * dictionary.
+ */
+int puz_dict_check_puzzle(struct puz_dict_t *d, struct puzzle_t *puz,
+                          struct puz_dict_report_t *report, int *scores) {
+  struct puz_bitboard_t *bb;
+  uint64_t (*down)[PUZ_BB_WORDS];
+  uint64_t across[PUZ_BB_WORDS];
+  unsigned char word[DICT_MAX_WORD];
+  int w, h, r, c, k, len, dir, slot = 0, score;
+
+  if(NULL == d || NULL == puz || NULL == report || NULL == puz->solution)
+    return -1;
+
+  bb = puz_bitboard_get(puz);
+  if(NULL == bb)
+    return -1;
+
+  w = bb->width;
+  h = bb->height;
+
+  down = (uint64_t (*)[PUZ_BB_WORDS])malloc((w ? w : 1) * sizeof(*down));
+  if(NULL == down) {
+    perror("malloc");
+    return -1;
+  }
+  for(c = 0; c < w; c++)
+    puz_bitboard_down_starts(bb, c, down[c], NULL);
+
+  memset(report, 0, sizeof(*report));
+  report->score_min = -1;
+
+  for(r = 0; r < h; r++) {
+    puz_bitboard_across_starts(bb, r, across, NULL);
+
+    for(c = 0; c < w; c++) {
+      for(dir = 0; dir < 2; dir++) {
+        if(0 == dir && !((across[c/64] >> (c%64)) & 1))
+          continue;
+        if(1 == dir && !((down[c][r/64] >> (r%64)) & 1))
+          continue;
+
+        len = 0;
+        if(0 == dir) {
+          for(k = c; k < w && !puz_bitboard_black_get(bb, r, k); k++)
+            word[len++] = puz->solution[r*w + k];
+        } else {
+          for(k = r; k < h && !puz_bitboard_black_get(bb, k, c); k++)
+            word[len++] = puz->solution[k*w + c];
+        }
+
+        score = puz_dict_lookup(d, word, len);
+        if(scores)
+          scores[slot] = score;
+        slot++;
+
+        if(score < 0) {
+          report->unknown++;
+          continue;
+        }
+        report->score_sum += score;
+        if(report->score_min < 0 || score < report->score_min)
+          report->score_min = score;
+      }
+    }
+  }
+
+  report->slots = slot;
+  free(down);
+
+  return report->unknown;
+}
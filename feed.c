@@ -0,0 +1,227 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * feed.c -- Load a puzzle from bytes as they arrive
+ */
+
+#include <puz.h>
+
+/*
+  For callers that get a file in pieces: off a socket, a pipe, or an
+  asynchronous read.  Bytes are appended with puz_feed_write() as they
+  come, and puz_feed_finish() at the end of input returns the puzzle.
+
+  Neither format says how long the whole file is: a binary puzzle's
+  extra sections run to the end of the file, and a text one's clues
+  do.  So the end of input is always the caller's to say.  What the
+  feed does do as bytes arrive is follow the binary framing (the
+  header, the boards, the counted strings, then each section's
+  length) so that a file that isn't a puzzle is turned away after
+  its first few bytes rather than at the end, and a truncated one is
+  caught at puz_feed_finish().  The fields themselves are decoded by
+  puz_load() at the end, straight from the feed's buffer.
+ */
+
+#define FEED_HEAD     0
+#define FEED_STRINGS  1
+#define FEED_SECTIONS 2
+#define FEED_TEXT     3
+
+static int feed_scan(struct puz_feed_t *feed);
+
+/**
+ * puz_feed_init - start feeding a puzzle
+ *
+ * @feed: the feed to set up (required)
+ * @type: as for puz_load(), with any load flags
+ *
+ * Return Value: -1 on error, else 0.
+ */
+int puz_feed_init(struct puz_feed_t *feed, int type) {
+  if(NULL == feed)
+    return -1;
+
+  memset(feed, 0, sizeof(struct puz_feed_t));
+  feed->type = type;
+  feed->state = (type & PUZ_FILE_TYPE_MASK) == PUZ_FILE_TEXT ?
+    FEED_TEXT : FEED_HEAD;
+
+  return 0;
+}
+
+/**
+ * feed_scan - follow the binary framing through the bytes so far
+ *
+ * @feed: the feed
+ *
+ * This is an internal function.  feed->scan is how far it has got;
+ * feed->state and feed->left say what it is in the middle of.
+ *
+ * Return Value: PUZ_FEED_ERROR if the bytes can't be a puzzle, else
+ * PUZ_FEED_MORE.
+ */
+static int feed_scan(struct puz_feed_t *feed) {
+  unsigned char magic[] = FILE_MAGIC;
+  unsigned char tmagic[] = TEXT_FILE_MAGIC;
+  unsigned char *b = feed->buf, *p;
+  int n;
+
+  for(;;) {
+    switch(feed->state) {
+    case FEED_HEAD:
+      if(feed->len < 0x0e)
+        return PUZ_FEED_MORE;
+
+      /* the same guess puz_load() makes */
+      if(b[0] == TEXT_SUBMAGIC && b[0x0d] != 0 &&
+         (feed->type & PUZ_FILE_TYPE_MASK) != PUZ_FILE_BINARY) {
+        feed->state = FEED_TEXT;
+        break;
+      }
+
+      if(feed->len < 0x34)
+        return PUZ_FEED_MORE;
+      if(memcmp(b + 2, magic, sizeof(magic)) || 0 == b[0x2c] ||
+         0 == b[0x2d])
+        return PUZ_FEED_ERROR;
+
+      /* the boards, then title, author, copyright, clues, notes */
+      feed->scan = 0x34 + 2 * b[0x2c] * b[0x2d];
+      feed->left = 4 + le_16(b + 0x2e);
+      feed->state = FEED_STRINGS;
+      break;
+
+    case FEED_STRINGS:
+      while(feed->left > 0 && feed->scan < feed->len) {
+        p = memchr(b + feed->scan, 0, feed->len - feed->scan);
+        if(NULL == p) {
+          feed->scan = feed->len;
+          return PUZ_FEED_MORE;
+        }
+        feed->scan = p - b + 1;
+        feed->left--;
+      }
+      if(feed->left > 0)
+        return PUZ_FEED_MORE;
+      feed->state = FEED_SECTIONS;
+      break;
+
+    case FEED_SECTIONS:
+      /* each is a name, a length and a checksum, the data and a NUL */
+      while(feed->scan + 8 <= feed->len) {
+        n = le_16(b + feed->scan + 4);
+        feed->scan += 8 + n + 1;
+      }
+      return PUZ_FEED_MORE;
+
+    case FEED_TEXT:
+      n = feed->len < (int)sizeof(tmagic) - 1 ?
+        feed->len : (int)sizeof(tmagic) - 1;
+      if(memcmp(b, tmagic, n))
+        return PUZ_FEED_ERROR;
+      feed->scan = feed->len;
+      return PUZ_FEED_MORE;
+    }
+  }
+}
+
+/**
+ * puz_feed_write - add the next bytes of the file
+ *
+ * @feed: the feed (required)
+ * @data: the bytes; copied, so they needn't outlive the call
+ * @len: how many
+ *
+ * Return Value: PUZ_FEED_ERROR if the input can't be a puzzle (or out
+ * of memory, or over PUZ_FEED_MAX bytes); the feed should then just be
+ * freed.  Else PUZ_FEED_MORE.
+ */
+int puz_feed_write(struct puz_feed_t *feed, const unsigned char *data,
+                   int len) {
+  unsigned char *nb;
+  int cap;
+
+  if(NULL == feed || (NULL == data && len > 0) || len < 0)
+    return PUZ_FEED_ERROR;
+  if(feed->failed)
+    return PUZ_FEED_ERROR;
+
+  if(len > PUZ_FEED_MAX - feed->len) {
+    feed->failed = 1;
+    return PUZ_FEED_ERROR;
+  }
+
+  if(feed->len + len + 1 > feed->cap) {
+    cap = feed->cap ? feed->cap : 4096;
+    while(cap < feed->len + len + 1)
+      cap *= 2;
+    nb = (unsigned char *)realloc(feed->buf, cap);
+    if(NULL == nb) {
+      perror("realloc");
+      feed->failed = 1;
+      return PUZ_FEED_ERROR;
+    }
+    feed->buf = nb;
+    feed->cap = cap;
+  }
+
+  memcpy(feed->buf + feed->len, data, len);
+  feed->len += len;
+  feed->buf[feed->len] = 0; /* so a text puzzle is always terminated */
+
+  if(feed_scan(feed) == PUZ_FEED_ERROR) {
+    feed->failed = 1;
+    return PUZ_FEED_ERROR;
+  }
+
+  return PUZ_FEED_MORE;
+}
+
+/**
+ * puz_feed_finish - load the puzzle at the end of input
+ *
+ * @feed: the feed (required).  It is freed either way.
+ *
+ * Return Value: NULL if the input wasn't a whole puzzle, else the
+ * newly-allocated puzzle, as from puz_load().
+ */
+struct puzzle_t *puz_feed_finish(struct puz_feed_t *feed) {
+  struct puzzle_t *puz = NULL;
+
+  if(NULL == feed)
+    return NULL;
+
+  /* a binary file must end on a section boundary */
+  if(!feed->failed && feed->len > 0 &&
+     (feed->state == FEED_TEXT ||
+      (feed->state == FEED_SECTIONS && feed->scan == feed->len)))
+    puz = puz_load(NULL, feed->type, feed->buf, feed->len);
+
+  /* everything puz_load() keeps is copied out of the buffer */
+  if(puz)
+    puz->base = NULL;
+
+  puz_feed_free(feed);
+
+  return puz;
+}
+
+/**
+ * puz_feed_free - give up on a feed
+ *
+ * @feed: the feed to free the insides of
+ */
+void puz_feed_free(struct puz_feed_t *feed) {
+  if(NULL == feed)
+    return;
+
+  free(feed->buf);
+  memset(feed, 0, sizeof(struct puz_feed_t));
+}
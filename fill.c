@@ -0,0 +1,980 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * fill.c -- Fill a pattern of black squares with words
+ */
+
+#include <puz.h>
+
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+
+/*
+  How the fill works:
+
+  The slots (across and down words of two or more squares) are taken
+  from the solution.  Black squares are '.', letters A-Z are kept as
+  fixed entries, and anything else is an open square.
+
+  The word list is split by length.  For each length L we build, for
+  every position p and letter c, a bitset over the words of length L
+  that have c at position p.  The candidates for a slot are then just
+  the AND of the bitsets for the letters already in it, a word at a
+  time.
+
+  The search is plain backtracking: pick the open slot with the
+  fewest candidates left, try its candidates in turn, and after each
+  one narrow the candidate sets of the crossing slots (forward
+  checking), backing out as soon as any of them goes empty.  Every
+  narrowed set is saved on a trail first, so undoing a choice is
+  just copying the saved sets back.
+
+  Candidates are tried best first: each length's words are sorted so
+  the ones made of common letters, which leave the crossings the most
+  room, come first.
+
+  Searches like this have long tails, so each search restarts with a
+  fresh random tie-breaking whenever it runs over a node budget,
+  and the budget grows each time.  Several tasks on the thread pool
+  run the same search with different seeds (a portfolio) and the
+  first to finish wins, cancelling the rest.  A search that finishes
+  within its budget without a fill proves there isn't one, which
+  also stops everyone.
+ */
+
+#define FILL_FIRST_BUDGET 2000
+
+/* The words of one length */
+struct fill_lex_t {
+  int len;
+  int n;             /* number of words */
+  int nw;            /* words per bitset */
+  unsigned char *words; /* n * len letters, each 0..25 */
+  uint64_t *index;   /* [len][26][nw] */
+  int used_off;      /* offset of this length's used-word set */
+};
+
+struct fill_slot_t {
+  int len;
+  int dir;           /* 0 across, 1 down */
+  int *cells;        /* len square indices */
+  struct fill_lex_t *lex;
+  int dom_off;       /* offset of this slot's candidate set */
+};
+
+/* Read-only after setup, shared by all the threads */
+struct fill_ctx_t {
+  int bd_sz;
+  unsigned char *fixed;   /* per square: 0 open, 1..26 a letter, 27 black */
+
+  int nslots;
+  struct fill_slot_t *slots;
+  int *slot_cells;        /* backing store for the slots' cells */
+  int *cell_slot;         /* [bd_sz][2]: across, down slot or -1 */
+  int *cell_pos;          /* [bd_sz][2]: position within that slot */
+
+  struct fill_lex_t *lex[256];
+  int dom_words;          /* total candidate set size, in words */
+  int used_words;         /* total used-word set size, in words */
+
+  /* results */
+  pthread_mutex_t lock;
+  struct puz_group_t group;
+  int done;               /* 1 filled, 2 proven impossible */
+  unsigned char *result;  /* per square letter 0..25 */
+};
+
+struct fill_thread_t {
+  struct fill_ctx_t *ctx;
+  uint64_t rng;
+
+  uint64_t *dom;        /* candidate sets, laid out by slot dom_off */
+  int *count;           /* candidates left per slot */
+  unsigned char *assigned;
+  unsigned char *letter;   /* per square: 0 open, else 1..26 */
+
+  /* slots waiting for propagation, as a ring of nslots */
+  int *queue; int q_head, q_len;
+  unsigned char *queued;
+  uint64_t *used;          /* words already placed, by lex used_off */
+
+  /* trail */
+  int *cells; int cells_top, cells_max;
+  int *saves; int saves_top, saves_max;          /* slot, count, arena pos */
+  uint64_t *arena; int arena_top, arena_max;
+
+  long nodes;
+  long budget;
+};
+
+static int fill_lex_add(struct fill_ctx_t *ctx, unsigned char *word);
+static int fill_score_cmp(const void *a, const void *b);
+static int fill_lex_index(struct fill_lex_t *lex, const double *weight);
+static int fill_slots(struct fill_ctx_t *ctx, struct puzzle_t *puz);
+static void fill_ctx_free(struct fill_ctx_t *ctx);
+static uint64_t fill_rand(struct fill_thread_t *t);
+static int fill_reset(struct fill_thread_t *t);
+static int fill_save(struct fill_thread_t *t, int s);
+static void fill_undo(struct fill_thread_t *t, int cells_mark, int saves_mark);
+static unsigned int fill_letters(struct fill_thread_t *t, int s, int p);
+static int fill_restrict(struct fill_thread_t *t, int s, int p,
+                         unsigned int letters);
+static void fill_push(struct fill_thread_t *t, int s);
+static int fill_propagate(struct fill_thread_t *t);
+static int fill_place(struct fill_thread_t *t, int s, int w);
+static int fill_search(struct fill_thread_t *t);
+static void fill_worker(void *arg);
+
+/**
+ * fill_lex_add - add a word to the lexicon for its length
+ *
+ * This is an internal function.  Words with anything other than
+ * letters in them are skipped, as are lengths no slot needs.
+ *
+ * Returns -1 on allocation failure, else 0.
+ */
+static int fill_lex_add(struct fill_ctx_t *ctx, unsigned char *word) {
+  struct fill_lex_t *lex;
+  int i, len = Sstrlen(word);
+
+  if(len < 2 || len > 255 || NULL == (lex = ctx->lex[len]))
+    return 0;
+
+  for(i = 0; i < len; i++) {
+    if(!isalpha(word[i]))
+      return 0;
+  }
+
+  if((lex->n & (lex->n - 1)) == 0) {
+    unsigned char *w = realloc(lex->words, (lex->n ? 2 * lex->n : 1) * len);
+    if(NULL == w) {
+      perror("realloc");
+      return -1;
+    }
+    lex->words = w;
+  }
+
+  for(i = 0; i < len; i++)
+    lex->words[lex->n * len + i] = toupper(word[i]) - 'A';
+  lex->n++;
+
+  return 0;
+}
+
+struct fill_score_t {
+  double score;
+  int word;
+};
+
+/**
+ * fill_score_cmp - qsort comparator, best score first
+ *
+ * This is an internal function.
+ */
+static int fill_score_cmp(const void *a, const void *b) {
+  const struct fill_score_t *x = a, *y = b;
+
+  if(x->score != y->score)
+    return x->score < y->score ? 1 : -1;
+  return x->word - y->word;
+}
+
+/**
+ * fill_lex_index - build the per-position, per-letter bitsets
+ *
+ * @lex: the lexicon to index
+ * @weight: per-letter weight, the log of how common the letter is
+ *
+ * This is an internal function.
+ *
+ * Duplicates are dropped, and the words are sorted so that those made
+ * of common letters come first.  Such words leave the crossings the
+ * most candidates, and since candidates are tried in index order the
+ * sort is the search's value ordering.
+ *
+ * Returns -1 on allocation failure, else 0.
+ */
+static int fill_lex_index(struct fill_lex_t *lex, const double *weight) {
+  int w, p, n, h, mask;
+  int *table;
+  struct fill_score_t *order;
+  unsigned char *sorted;
+
+  /* drop duplicates, so no word can be placed twice under two indices */
+  for(mask = 1; mask < 2 * lex->n; mask <<= 1)
+    ;
+  table = malloc(mask * sizeof(int));
+  if(NULL == table) {
+    perror("malloc");
+    return -1;
+  }
+  memset(table, -1, mask * sizeof(int));
+  mask--;
+
+  for(w = n = 0; w < lex->n; w++) {
+    unsigned char *word = lex->words + w * lex->len;
+    unsigned int hash = 2166136261u;
+
+    for(p = 0; p < lex->len; p++)
+      hash = (hash ^ word[p]) * 16777619u;
+
+    for(h = hash & mask; table[h] >= 0; h = (h + 1) & mask) {
+      if(0 == memcmp(lex->words + table[h] * lex->len, word, lex->len))
+        break;
+    }
+    if(table[h] >= 0)
+      continue;
+
+    table[h] = n;
+    memmove(lex->words + n * lex->len, word, lex->len);
+    n++;
+  }
+  free(table);
+  lex->n = n;
+
+  order = malloc((n ? n : 1) * sizeof(struct fill_score_t));
+  sorted = malloc((n ? n : 1) * lex->len);
+  if(NULL == order || NULL == sorted) {
+    perror("malloc");
+    free(order);
+    free(sorted);
+    return -1;
+  }
+  for(w = 0; w < n; w++) {
+    order[w].word = w;
+    order[w].score = 0;
+    for(p = 0; p < lex->len; p++)
+      order[w].score += weight[lex->words[w * lex->len + p]];
+  }
+  qsort(order, n, sizeof(struct fill_score_t), fill_score_cmp);
+  for(w = 0; w < n; w++)
+    memcpy(sorted + w * lex->len, lex->words + order[w].word * lex->len,
+           lex->len);
+  free(order);
+  free(lex->words);
+  lex->words = sorted;
+
+  lex->nw = (lex->n + 63) / 64;
+  lex->index = calloc((size_t)lex->len * 26 * (lex->nw ? lex->nw : 1),
+                      sizeof(uint64_t));
+  if(NULL == lex->index) {
+    perror("calloc");
+    return -1;
+  }
+
+  for(w = 0; w < lex->n; w++) {
+    for(p = 0; p < lex->len; p++) {
+      int c = lex->words[w * lex->len + p];
+      lex->index[(p * 26 + c) * lex->nw + w / 64] |= 1ULL << (w % 64);
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * fill_slots - find the slots and the squares' crossings
+ *
+ * This is an internal function.
+ *
+ * Returns -1 on error, else 0.
+ */
+static int fill_slots(struct fill_ctx_t *ctx, struct puzzle_t *puz) {
+  int w = puz_width_get(puz), h = puz_height_get(puz);
+  int r, c, i, dir, n = 0;
+  int *cells;
+
+  ctx->bd_sz = w * h;
+  ctx->fixed = calloc(ctx->bd_sz, 1);
+  ctx->cell_slot = malloc(2 * ctx->bd_sz * sizeof(int));
+  ctx->cell_pos = malloc(2 * ctx->bd_sz * sizeof(int));
+  /* there can't be more slots than squares in each direction */
+  ctx->slots = calloc(2 * ctx->bd_sz, sizeof(struct fill_slot_t));
+  ctx->slot_cells = cells = malloc(2 * ctx->bd_sz * sizeof(int));
+  if(!ctx->fixed || !ctx->cell_slot || !ctx->cell_pos || !ctx->slots || !cells) {
+    perror("malloc");
+    return -1;
+  }
+
+  for(i = 0; i < ctx->bd_sz; i++) {
+    unsigned char ch = puz->solution[i];
+    ctx->fixed[i] = ch == '.' ? 27 : isalpha(ch) ? toupper(ch) - 'A' + 1 : 0;
+    ctx->cell_slot[2*i] = ctx->cell_slot[2*i+1] = -1;
+  }
+
+#define BLACK(rr, cc) ((rr) < 0 || (cc) < 0 || (rr) >= h || (cc) >= w || \
+                       ctx->fixed[(rr)*w + (cc)] == 27)
+
+  for(r = 0; r < h; r++) {
+    for(c = 0; c < w; c++) {
+      for(dir = 0; dir < 2; dir++) {
+        int dr = dir, dc = !dir, len;
+        struct fill_slot_t *s;
+
+        if(BLACK(r, c) || !BLACK(r - dr, c - dc) || BLACK(r + dr, c + dc))
+          continue;
+
+        s = &ctx->slots[n];
+        s->cells = cells;
+        for(len = 0; !BLACK(r + len*dr, c + len*dc); len++) {
+          int sq = (r + len*dr) * w + (c + len*dc);
+          s->cells[len] = sq;
+          ctx->cell_slot[2*sq + dir] = n;
+          ctx->cell_pos[2*sq + dir] = len;
+        }
+        s->len = len;
+        s->dir = dir;
+        cells += len;
+
+        if(NULL == ctx->lex[len]) {
+          ctx->lex[len] = calloc(1, sizeof(struct fill_lex_t));
+          if(NULL == ctx->lex[len]) {
+            perror("calloc");
+            return -1;
+          }
+          ctx->lex[len]->len = len;
+        }
+        s->lex = ctx->lex[len];
+        n++;
+      }
+    }
+  }
+#undef BLACK
+
+  ctx->nslots = n;
+  return 0;
+}
+
+/**
+ * fill_ctx_free - free everything hanging off a fill context
+ *
+ * This is an internal function.
+ */
+static void fill_ctx_free(struct fill_ctx_t *ctx) {
+  int i;
+
+  for(i = 0; i < 256; i++) {
+    if(ctx->lex[i]) {
+      free(ctx->lex[i]->words);
+      free(ctx->lex[i]->index);
+      free(ctx->lex[i]);
+    }
+  }
+
+  free(ctx->slots);
+  free(ctx->slot_cells);
+  free(ctx->fixed);
+  free(ctx->cell_slot);
+  free(ctx->cell_pos);
+  free(ctx->result);
+}
+
+/**
+ * fill_rand - xorshift64*, so threads don't share rand()'s state
+ *
+ * This is an internal function.
+ */
+static uint64_t fill_rand(struct fill_thread_t *t) {
+  t->rng ^= t->rng >> 12;
+  t->rng ^= t->rng << 25;
+  t->rng ^= t->rng >> 27;
+  return t->rng * 2685821657736338717ULL;
+}
+
+/**
+ * fill_reset - put a thread's state back to the starting position
+ *
+ * This is an internal function.  The fixed letters are applied to
+ * every slot's candidate set.
+ *
+ * Returns 0 if some slot has no candidates at all, else 1.
+ */
+static int fill_reset(struct fill_thread_t *t) {
+  struct fill_ctx_t *ctx = t->ctx;
+  int s, p, i, ok = 1;
+
+  memset(t->used, 0, ctx->used_words * sizeof(uint64_t));
+  memset(t->assigned, 0, ctx->nslots);
+  t->cells_top = t->saves_top = t->arena_top = 0;
+
+  for(i = 0; i < ctx->bd_sz; i++)
+    t->letter[i] = ctx->fixed[i] == 27 ? 0 : ctx->fixed[i];
+
+  for(s = 0; s < ctx->nslots; s++) {
+    struct fill_slot_t *sl = &ctx->slots[s];
+    struct fill_lex_t *lex = sl->lex;
+    uint64_t *d = t->dom + sl->dom_off;
+
+    for(i = 0; i < lex->nw; i++)
+      d[i] = ~0ULL;
+    if(lex->n % 64)
+      d[lex->nw - 1] = (1ULL << (lex->n % 64)) - 1;
+
+    for(p = 0; p < sl->len; p++) {
+      int l = t->letter[sl->cells[p]];
+      if(l) {
+        uint64_t *b = lex->index + (p * 26 + l - 1) * lex->nw;
+        for(i = 0; i < lex->nw; i++)
+          d[i] &= b[i];
+      }
+    }
+
+    t->count[s] = 0;
+    for(i = 0; i < lex->nw; i++)
+      t->count[s] += __builtin_popcountll(d[i]);
+    if(t->count[s] == 0)
+      ok = 0;
+    fill_push(t, s);
+  }
+
+  if(ok && fill_propagate(t) != 1)
+    ok = 0;
+
+  return ok;
+}
+
+/**
+ * fill_save - push a slot's candidate set onto the trail
+ *
+ * This is an internal function.
+ *
+ * Returns -1 on allocation failure, else 0.
+ */
+static int fill_save(struct fill_thread_t *t, int s) {
+  struct fill_slot_t *sl = &t->ctx->slots[s];
+  int nw = sl->lex->nw;
+
+  if(t->arena_top + nw > t->arena_max) {
+    int m = 2 * (t->arena_max + nw);
+    uint64_t *a = realloc(t->arena, m * sizeof(uint64_t));
+    if(NULL == a)
+      return -1;
+    t->arena = a;
+    t->arena_max = m;
+  }
+  if(t->saves_top + 3 > t->saves_max) {
+    int m = 2 * (t->saves_max + 3);
+    int *a = realloc(t->saves, m * sizeof(int));
+    if(NULL == a)
+      return -1;
+    t->saves = a;
+    t->saves_max = m;
+  }
+
+  memcpy(t->arena + t->arena_top, t->dom + sl->dom_off, nw * sizeof(uint64_t));
+  t->saves[t->saves_top++] = s;
+  t->saves[t->saves_top++] = t->count[s];
+  t->saves[t->saves_top++] = t->arena_top;
+  t->arena_top += nw;
+
+  return 0;
+}
+
+/**
+ * fill_undo - pop the trail back to a mark
+ *
+ * This is an internal function.
+ */
+static void fill_undo(struct fill_thread_t *t, int cells_mark, int saves_mark) {
+  while(t->saves_top > saves_mark) {
+    int pos = t->saves[--t->saves_top];
+    int cnt = t->saves[--t->saves_top];
+    int s = t->saves[--t->saves_top];
+    struct fill_slot_t *sl = &t->ctx->slots[s];
+
+    memcpy(t->dom + sl->dom_off, t->arena + pos, sl->lex->nw * sizeof(uint64_t));
+    t->count[s] = cnt;
+    t->arena_top = pos;
+  }
+
+  while(t->cells_top > cells_mark)
+    t->letter[t->cells[--t->cells_top]] = 0;
+}
+
+/**
+ * fill_letters - find which letters a slot's candidates allow at a position
+ *
+ * This is an internal function.
+ *
+ * Returns a bitmask, bit c set for letter 'A'+c.
+ */
+static unsigned int fill_letters(struct fill_thread_t *t, int s, int p) {
+  struct fill_slot_t *sl = &t->ctx->slots[s];
+  struct fill_lex_t *lex = sl->lex;
+  uint64_t *d = t->dom + sl->dom_off;
+  unsigned int letters = 0;
+  int c, i;
+
+  for(c = 0; c < 26; c++) {
+    uint64_t *b = lex->index + (p * 26 + c) * lex->nw;
+    for(i = 0; i < lex->nw; i++) {
+      if(d[i] & b[i]) {
+        letters |= 1U << c;
+        break;
+      }
+    }
+  }
+
+  return letters;
+}
+
+/**
+ * fill_restrict - drop a slot's candidates that don't fit a set of letters
+ *
+ * @letters: the letters allowed at position p, as from fill_letters()
+ *
+ * This is an internal function.  The old candidate set goes on the
+ * trail if anything changes.
+ *
+ * Returns the number of candidates left, or -1 on allocation failure.
+ */
+static int fill_restrict(struct fill_thread_t *t, int s, int p,
+                         unsigned int letters) {
+  struct fill_slot_t *sl = &t->ctx->slots[s];
+  struct fill_lex_t *lex = sl->lex;
+  uint64_t *d = t->dom + sl->dom_off;
+  int c, i, saved = 0, n = 0;
+
+  for(i = 0; i < lex->nw; i++) {
+    uint64_t ok = 0;
+
+    if(0 == d[i])
+      continue;
+    for(c = 0; c < 26; c++) {
+      if(letters >> c & 1)
+        ok |= lex->index[(p * 26 + c) * lex->nw + i];
+    }
+    if(d[i] & ~ok) {
+      if(!saved) {
+        if(fill_save(t, s) < 0)
+          return -1;
+        saved = 1;
+      }
+      d[i] &= ok;
+    }
+    n += __builtin_popcountll(d[i]);
+  }
+
+  t->count[s] = n;
+  return n;
+}
+
+/**
+ * fill_push - queue a slot whose candidates changed
+ *
+ * This is an internal function.
+ */
+static void fill_push(struct fill_thread_t *t, int s) {
+  int n = t->ctx->nslots;
+
+  if(t->queued[s])
+    return;
+  t->queued[s] = 1;
+  t->queue[(t->q_head + t->q_len++) % n] = s;
+}
+
+/**
+ * fill_propagate - make every queued slot agree with its crossings
+ *
+ * This is an internal function.
+ *
+ * Forward checking alone lets a slot keep candidates whose letters
+ * its crossings can't supply, which is what makes stacked long
+ * answers so slow.  So for each queued slot we work out, square by
+ * square, the letters its candidates allow and the letters the
+ * crossing's candidates allow, and cut both down to the common
+ * letters.  Any slot that shrinks is queued in turn, until nothing
+ * changes.  All the changes go on the trail.
+ *
+ * Returns 1 if every slot still has candidates, 0 if one went empty,
+ * -1 on allocation failure.
+ */
+static int fill_propagate(struct fill_thread_t *t) {
+  struct fill_ctx_t *ctx = t->ctx;
+  int rv = 1;
+
+  while(t->q_len && rv == 1) {
+    int x = t->queue[t->q_head], q;
+    struct fill_slot_t *xs = &ctx->slots[x];
+
+    t->q_head = (t->q_head + 1) % ctx->nslots;
+    t->q_len--;
+    t->queued[x] = 0;
+
+    if(t->assigned[x])
+      continue;
+
+    for(q = 0; q < xs->len && rv == 1; q++) {
+      int sq = xs->cells[q], y, yq, n;
+      unsigned int lx, ly, both;
+
+      y = ctx->cell_slot[2*sq + !xs->dir];
+      if(t->letter[sq] || y < 0 || t->assigned[y])
+        continue;
+      yq = ctx->cell_pos[2*sq + !xs->dir];
+
+      lx = fill_letters(t, x, q);
+      ly = fill_letters(t, y, yq);
+      both = lx & ly;
+
+      if(0 == both) {
+        rv = 0;
+        break;
+      }
+      if(ly & ~both) {
+        n = fill_restrict(t, y, yq, both);
+        if(n <= 0)
+          rv = n;
+        fill_push(t, y);
+      }
+      if(lx & ~both) {
+        n = fill_restrict(t, x, q, both);
+        if(n <= 0)
+          rv = n;
+        fill_push(t, x);
+      }
+    }
+  }
+
+  /* on failure, empty the queue for next time */
+  while(t->q_len) {
+    t->queued[t->queue[t->q_head]] = 0;
+    t->q_head = (t->q_head + 1) % ctx->nslots;
+    t->q_len--;
+  }
+
+  return rv;
+}
+
+/**
+ * fill_place - write word w into slot s and narrow the crossings
+ *
+ * This is an internal function.  Everything it changes goes on the
+ * trail, so the caller can undo it whatever the outcome.
+ *
+ * Returns 1 if every crossing still has candidates, 0 if one went
+ * empty, -1 on allocation failure.
+ */
+static int fill_place(struct fill_thread_t *t, int s, int w) {
+  struct fill_ctx_t *ctx = t->ctx;
+  struct fill_slot_t *sl = &ctx->slots[s];
+  unsigned char *word = sl->lex->words + w * sl->len;
+  int p, i, dir = -1;
+
+  for(p = 0; p < sl->len; p++) {
+    int sq = sl->cells[p];
+    int x, xp;
+    struct fill_lex_t *xl;
+    uint64_t *d, *b;
+
+    if(t->letter[sq])
+      continue;
+
+    if(t->cells_top == t->cells_max) {
+      int m = 2 * t->cells_max + 16;
+      int *a = realloc(t->cells, m * sizeof(int));
+      if(NULL == a)
+        return -1;
+      t->cells = a;
+      t->cells_max = m;
+    }
+    t->letter[sq] = word[p] + 1;
+    t->cells[t->cells_top++] = sq;
+
+    /* the crossing is whichever of the square's two slots isn't us */
+    if(dir < 0)
+      dir = ctx->cell_slot[2*sq] == s ? 0 : 1;
+    x = ctx->cell_slot[2*sq + !dir];
+    if(x < 0 || t->assigned[x])
+      continue;
+
+    if(fill_save(t, x) < 0)
+      return -1;
+
+    xp = ctx->cell_pos[2*sq + !dir];
+    xl = ctx->slots[x].lex;
+    d = t->dom + ctx->slots[x].dom_off;
+    b = xl->index + (xp * 26 + word[p]) * xl->nw;
+
+    t->count[x] = 0;
+    for(i = 0; i < xl->nw; i++) {
+      d[i] &= b[i];
+      t->count[x] += __builtin_popcountll(d[i]);
+    }
+    if(t->count[x] == 0)
+      return 0;
+    fill_push(t, x);
+  }
+
+  return fill_propagate(t);
+}
+
+/**
+ * fill_search - the backtracking search
+ *
+ * This is an internal function.
+ *
+ * Returns 1 if filled, 0 if there's no fill from here, -1 if the
+ * node budget ran out or another thread finished, -2 on allocation
+ * failure.
+ */
+static int fill_search(struct fill_thread_t *t) {
+  struct fill_ctx_t *ctx = t->ctx;
+  struct fill_slot_t *sl;
+  uint64_t *d, *used;
+  int s, best = -1, k, start, rv;
+
+  if(++t->nodes > t->budget || __atomic_load_n(&ctx->done, __ATOMIC_RELAXED))
+    return -1;
+
+  /* most constrained open slot; longer slots, then chance, break ties */
+  for(s = 0; s < ctx->nslots; s++) {
+    if(t->assigned[s])
+      continue;
+    if(best < 0 || t->count[s] < t->count[best])
+      best = s;
+    else if(t->count[s] == t->count[best]) {
+      if(ctx->slots[s].len > ctx->slots[best].len ||
+         (ctx->slots[s].len == ctx->slots[best].len && (fill_rand(t) & 1)))
+        best = s;
+    }
+  }
+
+  if(best < 0)
+    return 1;
+  if(t->count[best] == 0)
+    return 0;
+
+  sl = &ctx->slots[best];
+  d = t->dom + sl->dom_off;
+  used = t->used + sl->lex->used_off;
+
+  /* jitter where we start among the best few candidates, so restarts
+     and the other threads in the portfolio don't repeat each other */
+  start = fill_rand(t) % (sl->lex->nw < 4 ? sl->lex->nw : 4);
+
+  for(k = 0; k < sl->lex->nw; k++) {
+    int wi = (start + k) % sl->lex->nw;
+    uint64_t bits = d[wi] & ~used[wi];
+
+    while(bits) {
+      int w = wi * 64 + __builtin_ctzll(bits);
+      int cells_mark = t->cells_top, saves_mark = t->saves_top;
+
+      bits &= bits - 1;
+
+      rv = fill_place(t, best, w);
+      if(rv < 0)
+        return -2;
+
+      if(rv > 0) {
+        t->assigned[best] = 1;
+        used[wi] |= 1ULL << (w % 64);
+
+        rv = fill_search(t);
+
+        used[wi] &= ~(1ULL << (w % 64));
+        t->assigned[best] = 0;
+
+        if(rv != 0) {
+          if(rv < 0)
+            fill_undo(t, cells_mark, saves_mark);
+          return rv;
+        }
+      }
+
+      fill_undo(t, cells_mark, saves_mark);
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * fill_worker - pool task: restart the search until something finishes
+ *
+ * This is an internal function.
+ */
+static void fill_worker(void *arg) {
+  struct fill_thread_t *t = (struct fill_thread_t *)arg;
+  struct fill_ctx_t *ctx = t->ctx;
+  int rv;
+
+  for(t->budget = FILL_FIRST_BUDGET; ; t->budget += t->budget / 2) {
+    if(__atomic_load_n(&ctx->done, __ATOMIC_RELAXED))
+      break;
+
+    t->nodes = 0;
+    if(!fill_reset(t))
+      rv = 0;
+    else
+      rv = fill_search(t);
+
+    if(rv == -1)
+      continue;
+
+    pthread_mutex_lock(&ctx->lock);
+    if(!ctx->done) {
+      if(rv == 1)
+        memcpy(ctx->result, t->letter, ctx->bd_sz);
+      __atomic_store_n(&ctx->done, rv == 1 ? 1 : rv == 0 ? 2 : 3,
+                       __ATOMIC_RELAXED);
+      puz_group_cancel(&ctx->group); /* searches yet to start needn't */
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    break;
+  }
+}
+
+/**
+ * puz_fill - fill a pattern of black squares with words
+ *
+ * @puz: the puzzle to fill (required).  Its solution gives the
+ *   pattern: '.' is black, A-Z are letters that must be kept, and
+ *   anything else is an open square.
+ * @words: the word list (required).  Words are matched
+ *   case-insensitively; words containing anything but letters are
+ *   ignored.
+ * @n_words: the number of words
+ * @nthreads: how many searches to run, as tasks on the library's
+ *   thread pool; 0 means one per pool thread, plus this one
+ * @seed: seed for the candidate ordering.  The same seed and thread
+ *   count can still give different fills, since the first thread to
+ *   finish wins.
+ *
+ * No word is used twice.  On success, the completed fill is written
+ * with puz_solution_set().
+ *
+ * Return Value: 0 if the puzzle was filled, 1 if no fill exists with
+ * this word list, -1 on error.
+ */
+int puz_fill(struct puzzle_t *puz, unsigned char **words, int n_words,
+             int nthreads, unsigned int seed) {
+  struct fill_ctx_t ctx;
+  struct fill_thread_t *th = NULL;
+  double weight[26];
+  uint32_t letters[26];
+  int i, s, rv = -1;
+
+  if(NULL == puz || NULL == puz->solution || NULL == words || n_words < 0)
+    return -1;
+
+  memset(&ctx, 0, sizeof(ctx));
+  pthread_mutex_init(&ctx.lock, NULL);
+  puz_group_init(&ctx.group);
+
+  if(fill_slots(&ctx, puz) < 0)
+    goto out;
+
+  for(i = 0; i < n_words; i++) {
+    if(words[i] && fill_lex_add(&ctx, words[i]) < 0)
+      goto out;
+  }
+
+  memset(letters, 0, sizeof(letters));
+  for(i = 0; i < 256; i++) {
+    if(ctx.lex[i])
+      puz_kernels.letters(ctx.lex[i]->words, ctx.lex[i]->n * i, letters);
+  }
+  for(i = 0; i < 26; i++)
+    weight[i] = log(1.0 + letters[i]);
+
+  for(i = 0; i < 256; i++) {
+    if(ctx.lex[i] && fill_lex_index(ctx.lex[i], weight) < 0)
+      goto out;
+  }
+
+  for(s = 0; s < ctx.nslots; s++) {
+    ctx.slots[s].dom_off = ctx.dom_words;
+    ctx.dom_words += ctx.slots[s].lex->nw;
+  }
+  for(i = 0; i < 256; i++) {
+    if(ctx.lex[i]) {
+      ctx.lex[i]->used_off = ctx.used_words;
+      ctx.used_words += ctx.lex[i]->nw;
+    }
+  }
+
+  ctx.result = calloc(ctx.bd_sz + 1, 1);
+  if(NULL == ctx.result)
+    goto out;
+
+  if(nthreads <= 0)
+    nthreads = puz_pool_threads_get() + 1;
+
+  th = calloc(nthreads, sizeof(struct fill_thread_t));
+  if(!th)
+    goto out;
+
+  for(i = 0; i < nthreads; i++) {
+    th[i].ctx = &ctx;
+    th[i].rng = (seed + 1) * 0x9E3779B97F4A7C15ULL + i * 0xD1B54A32D192ED03ULL;
+    if(th[i].rng == 0)
+      th[i].rng = 1;
+    th[i].dom = malloc((ctx.dom_words + 1) * sizeof(uint64_t));
+    th[i].used = malloc((ctx.used_words + 1) * sizeof(uint64_t));
+    th[i].count = malloc((ctx.nslots + 1) * sizeof(int));
+    th[i].assigned = malloc(ctx.nslots + 1);
+    th[i].letter = malloc(ctx.bd_sz + 1);
+    th[i].queue = malloc((ctx.nslots + 1) * sizeof(int));
+    th[i].queued = calloc(ctx.nslots + 1, 1);
+    if(!th[i].dom || !th[i].used || !th[i].count || !th[i].assigned ||
+       !th[i].letter || !th[i].queue || !th[i].queued) {
+      perror("malloc");
+      goto out;
+    }
+  }
+
+  for(i = 1; i < nthreads; i++)
+    puz_group_spawn(&ctx.group, fill_worker, &th[i]);
+  fill_worker(&th[0]);
+  puz_group_wait(&ctx.group);
+
+  if(ctx.done == 1) {
+    unsigned char *sol = malloc(ctx.bd_sz + 1);
+    if(NULL == sol)
+      goto out;
+    for(i = 0; i < ctx.bd_sz; i++) {
+      if(ctx.fixed[i] == 27)
+        sol[i] = '.';
+      else if(ctx.result[i])
+        sol[i] = 'A' + ctx.result[i] - 1;
+      else
+        sol[i] = puz->solution[i]; /* unchecked square outside any slot */
+    }
+    sol[ctx.bd_sz] = 0;
+    rv = puz_solution_set(puz, sol) ? 0 : -1;
+    free(sol);
+  } else if(ctx.done == 2) {
+    rv = 1;
+  }
+
+ out:
+  if(th) {
+    for(i = 0; i < nthreads; i++) {
+      free(th[i].dom);
+      free(th[i].used);
+      free(th[i].count);
+      free(th[i].assigned);
+      free(th[i].letter);
+      free(th[i].queue);
+      free(th[i].queued);
+      free(th[i].cells);
+      free(th[i].saves);
+      free(th[i].arena);
+    }
+  }
+  free(th);
+  fill_ctx_free(&ctx);
+  pthread_mutex_destroy(&ctx.lock);
+
+  return rv;
+}
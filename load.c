@@ -16,20 +16,22 @@
 
 #include <ctype.h>
 #include <string.h>
+#include <unistd.h>
 
 #ifndef isspace
 int isspace(int C);
 #endif
 
-static struct puz_head_t *read_puz_head(struct puz_head_t *h, unsigned char *base);
+static struct puzzle_t *read_puz_head(struct puzzle_t *puz, unsigned char *base);
 static struct puzzle_t *puz_load_bin(struct puzzle_t *puz, unsigned char *base, int sz);
-static unsigned char *strnchr(unsigned char *buf, int n, unsigned char c);
+static struct puzzle_t *load_fail(struct puzzle_t *puz, int didmalloc);
 static int delim_memcmp(unsigned char *input, unsigned char *buf);
 
 /* A structure for linked-lists of input text */
 struct line_list {
   unsigned char *line;
   struct line_list *next;
+  struct line_list *last; /* root only: the empty node at the end */
 };
 
 static struct line_list *line_append(struct line_list *list, unsigned char *line);
@@ -38,83 +40,82 @@ static unsigned char *line_concat(struct line_list *list);
 static int line_count(struct line_list *root);
 static void line_clear(struct line_list *root);
 
+static struct puzzle_t *puz_load_text(struct puzzle_t *puz, unsigned char *base,
+                                      int sz, int *err);
+static void text_worker(void *arg);
+
+/* Set to 1 to trace the text loader's state machine on stdout */
+#define TEXT_DEBUG 0
 
 static unsigned char *mkgrid(unsigned char *soln);
 
 /**
- * read_puz_head - Read in puz_head_t values from a buffer
+ * read_puz_head - Read in the header from a buffer
  * 
- * @h: pointer to the struct puz_head_t to fill in.  If NULL, is malloc'd for you.
+ * @puz: pointer to the struct puzzle_t whose header and cold header
+ *   fields to fill in (required)
  * @base: pointer to the buffer containing the header to read in (required)
  *
  * This is an internal function
  *
- * Return value: Returns a pointer to the filled-in puz_head_t.  If h
- * was NULL initially, returns the allocated pointer.
+ * Return value: Returns @puz.
  */
-static struct puz_head_t *read_puz_head(struct puz_head_t *h, unsigned char *base) {
+static struct puzzle_t *read_puz_head(struct puzzle_t *puz, unsigned char *base) {
+  struct puz_cold_t *c = &puz->cold;
   int i;
 
-  if(NULL == h) {
-    h = malloc(sizeof(struct puz_head_t));
-    if(NULL == h) {
-      perror("malloc");
-      return NULL;
-    }
-  }
-
   i = 0;
 
-  h->cksum_puz = le_16(base+i);
+  c->cksum_puz = le_16(base+i);
   i += 2;
 
-  memcpy(h->magic, base+i, 12);
+  memcpy(c->magic, base+i, 12);
   i += 12;
 
-  h->cksum_cib = le_16(base+i);
+  c->cksum_cib = le_16(base+i);
   i += 2;
 
-  memcpy(h->magic_10, base+i, 4);
+  memcpy(c->magic_10, base+i, 4);
   i += 4;
 
-  memcpy(h->magic_14, base+i, 4);
+  memcpy(c->magic_14, base+i, 4);
   i += 4;
 
-  memcpy(h->magic_18, base+i, 4);
+  memcpy(c->magic_18, base+i, 4);
   i += 4;
 
-  h->noise_1c = le_16(base+i);
+  c->noise_1c = le_16(base+i);
   i += 2;
 
-  h->scrambled_cksum = le_16(base+i);
+  c->scrambled_cksum = le_16(base+i);
   i += 2;
 
-  h->noise_20 = le_16(base+i);
+  c->noise_20 = le_16(base+i);
   i += 2;
-  h->noise_22 = le_16(base+i);
+  c->noise_22 = le_16(base+i);
   i += 2;
-  h->noise_24 = le_16(base+i);
+  c->noise_24 = le_16(base+i);
   i += 2;
-  h->noise_26 = le_16(base+i);
+  c->noise_26 = le_16(base+i);
   i += 2;
-  h->noise_28 = le_16(base+i);
+  c->noise_28 = le_16(base+i);
   i += 2;
-  h->noise_2a = le_16(base+i);
+  c->noise_2a = le_16(base+i);
   i += 2;
 
-  h->width = le_8(base+i);
+  puz->header.width = le_8(base+i);
   i++;
-  h->height = le_8(base+i);
+  puz->header.height = le_8(base+i);
   i++;
-  h->clue_count = le_16(base+i);
+  puz->header.clue_count = le_16(base+i);
   i += 2;
   
-  h->x_unk_30 = le_16(base+i);
+  puz->header.x_unk_30 = le_16(base+i);
   i += 2;
-  h->scrambled_tag = le_16(base+i);
+  puz->header.scrambled_tag = le_16(base+i);
   i += 2;
 
-  return h;
+  return puz;
 }
 
 // Each of these special section readers return the actual number
@@ -140,7 +141,7 @@ unsigned int load_grbs_bin(struct puzzle_t *puz, unsigned char *base,
   int i = 0;
   int bd_sz = puz->header.width*puz->header.height;
 
-  puz->grbs_cksum = le_16(base+i);
+  puz->cold.grbs_cksum = le_16(base+i);
   i += 2;
 
   // rebus grid
@@ -169,6 +170,7 @@ unsigned int load_grbs_bin(struct puzzle_t *puz, unsigned char *base,
     if (rbssum != 0) {
       printf("Rebus grid is missing a rebus table: sz: %d, i: %d\n", sz, i);
       free(puz->grbs);
+      puz->grbs = NULL;
       return 0;
     }
   } else {
@@ -180,7 +182,7 @@ unsigned int load_grbs_bin(struct puzzle_t *puz, unsigned char *base,
     i += 2;
 
     if (rbssum != 0) {
-      puz->rtbl_cksum = le_16(base+i);
+      puz->cold.rtbl_cksum = le_16(base+i);
     }
     i += 2;
 
@@ -216,7 +218,7 @@ unsigned int load_ltim_bin(struct puzzle_t *puz, unsigned char *base,
 
   int i = 0;
 
-  puz->ltim_cksum = le_16(base+i);
+  puz->cold.ltim_cksum = le_16(base+i);
   i += 2;
 
   puz->ltim = calloc(sizeof(unsigned char), ltim_sz+1);
@@ -250,7 +252,7 @@ unsigned int load_gext_bin(struct puzzle_t *puz, unsigned char *base) {
   int i = 0;
   int bd_sz = puz->header.width*puz->header.height;
 
-  puz->gext_cksum = le_16(base+i);
+  puz->cold.gext_cksum = le_16(base+i);
   i += 2;
 
   // extras grid
@@ -282,7 +284,7 @@ unsigned int load_rusr_bin(struct puzzle_t *puz, unsigned char *base) {
   int i = 0;
   int bd_sz = puz->header.width*puz->header.height;
 
-  puz->rusr_cksum = le_16(base+i);
+  puz->cold.rusr_cksum = le_16(base+i);
   i += 2;
 
   // rusr grid
@@ -334,9 +336,10 @@ static struct puzzle_t *puz_load_bin(struct puzzle_t *puz, unsigned char *base,
   }
 
   if(NULL == puz) {
-    puz = (struct puzzle_t *)malloc(sizeof(struct puzzle_t));
+    /* on a cache line of its own; see struct puzzle_t */
+    puz = (struct puzzle_t *)aligned_alloc(64, PUZ_PUZZLE_ALLOC_SZ);
     if(NULL == puz) {
-      perror("malloc");
+      perror("aligned_alloc");
       return NULL;
     }
     didmalloc = 1;
@@ -347,18 +350,12 @@ static struct puzzle_t *puz_load_bin(struct puzzle_t *puz, unsigned char *base,
   puz->base = base;
   puz->sz = sz;
 	
-  if(NULL == read_puz_head(&(puz->header), base)) {
+  if(NULL == read_puz_head(puz, base)) {
     printf("Error reading header!\n");
-
-    if(didmalloc) {
-      free(puz);
-      puz = NULL;
-    }
-
-    return NULL;
+    return load_fail(puz, didmalloc);
   }
 
-  memcpy(puz->cib, base+0x2c, 8);
+  memcpy(puz->cold.cib, base+0x2c, 8);
 
   i = 0x34;
   int bd_sz = puz->header.width*puz->header.height;
@@ -388,10 +385,11 @@ strncpy(dest,src,bd_sz);
   puz->copyright = Sstrdup(base+i);
   i += Sstrlen(puz->copyright) + 1;
 
-  puz->clues = (unsigned char **)malloc(puz->header.clue_count * sizeof(unsigned char *));
+  /* calloc, so load_fail() can free a partly-read table */
+  puz->clues = (unsigned char **)calloc(puz->header.clue_count, sizeof(unsigned char *));
   if(NULL == puz->clues) {
-    perror("malloc");
-    return NULL; /* XXX cleanup */
+    perror("calloc");
+    return load_fail(puz, didmalloc);
   }
 
   for(j = 0; i < sz && j < puz->header.clue_count; j++) {
@@ -399,7 +397,7 @@ strncpy(dest,src,bd_sz);
 
     if(NULL == puz->clues[j]) {
       perror("Sstrdup");
-      return NULL; /* XXX cleanup */
+      return load_fail(puz, didmalloc);
     }
 
     i += Sstrlen(puz->clues[j]) + 1;
@@ -408,13 +406,8 @@ strncpy(dest,src,bd_sz);
   if(j != puz->header.clue_count) {
     printf("Appear to have run out of clues: sz: %d, i: %d, clues: %d, j: %d\n",
 	   sz, i, puz->header.clue_count, j);
-
-    if(didmalloc) {
-      free(puz);
-      puz = NULL;
-    }
-
-    return NULL; /* XXX cleanup */
+    printf("puz_load_salvage() may be able to recover the rest\n");
+    return load_fail(puz, didmalloc);
   }
 
   puz->notes = NULL;
@@ -470,40 +463,502 @@ strncpy(dest,src,bd_sz);
       continue;
     }
     if (advance == 0) {
-      printf("Error reading %.4s section", base+i);
-      if(didmalloc) {
-        free(puz);
-        puz = NULL;
-        break;
-      }
+      printf("Error reading %.4s section\n", base+i);
+      return load_fail(puz, didmalloc);
     }
     i += 6 + advance;
   }
 
+  puz_bitboard_calc(puz);
+  puz_progress_calc(puz);
+
   return puz;
 }
 
 
 /**
- * strnchr - find a unsigned character within the first n bytes of a buffer
+ * load_fail - Free a partly-loaded puzzle
+ *
+ * @puz: the puzzle being loaded
+ * @didmalloc: whether the loader allocated @puz itself
  *
- * @buf: buffer to search through
- * @n: maximum search length (look in buf[0]..buf[n-1]
- * @c: unsigned character value to look for.
+ * This is an internal function.  It frees whatever has been read
+ * into @puz so far, and @puz itself if the loader allocated it;
+ * otherwise @puz is left zeroed.
  *
- * Returns a pointer to the unsigned character if found, else points to buf[n]
- * (which might not actually be in buf!)
+ * Return value: NULL, for the loader to return.
  */
+static struct puzzle_t *load_fail(struct puzzle_t *puz, int didmalloc) {
+  if(NULL == puz)
+    return NULL;
+
+  if(didmalloc) {
+    puz_deep_free(puz);
+    return NULL;
+  }
+
+  /* the tables first: clearing them recounts progress, which reads
+     the boards */
+  if(puz->rtbl)
+    puz_clear_rtbl(puz);
+  if(puz->rusr)
+    puz_clear_rusr(puz);
+
+  puz_utf8_clear(puz);
+  free(puz->solution);
+  free(puz->grid);
+  free(puz->title);
+  free(puz->author);
+  free(puz->copyright);
+  if(puz->clues)
+    puz_clear_clues(puz);
+  free(puz->notes);
+  free(puz->grbs);
+  free(puz->ltim);
+  free(puz->gext);
+  free(puz->bitboard);
+
+  memset(puz, 0, sizeof(struct puzzle_t));
+
+  return NULL;
+}
+
+/*
+  Salvage loading.  A .puz file records each region's checksum
+  independently: the CIB sum twice (at 0x0e, and split across the
+  magic bytes at 0x10/0x14), the solution, grid and string sums once
+  each in the magic bytes, and every extra section carries its own.
+  So damage can be pinned to a region, and everything else kept.
+ */
+
+/* The extra sections, and the report bits they map to */
+static const struct {
+  const char *name;
+  int region;
+} salvage_sections[] = {
+  { "GRBS", PUZ_REGION_GRBS },
+  { "RTBL", PUZ_REGION_RTBL },
+  { "LTIM", PUZ_REGION_LTIM },
+  { "GEXT", PUZ_REGION_GEXT },
+  { "RUSR", PUZ_REGION_RUSR },
+};
+
+#define SALVAGE_N_SECTIONS \
+  (int)(sizeof(salvage_sections) / sizeof(salvage_sections[0]))
 
-static unsigned char *strnchr(unsigned char *buf, int n, unsigned char c) {
+/**
+ * salvage_region - look up the report bit for a section name
+ *
+ * This is an internal function.  Returns 0 for an unknown name.
+ */
+static int salvage_region(unsigned char *name) {
   int i;
-  for(i = 0; i < n; i++) {
-    if(*(buf+i) == c)
-      return (buf+i);
+
+  for(i = 0; i < SALVAGE_N_SECTIONS; i++) {
+    if(0 == memcmp(name, salvage_sections[i].name, 4))
+      return salvage_sections[i].region;
+  }
+
+  return 0;
+}
+
+/**
+ * salvage_stored - the stored checksum of one header region
+ *
+ * @c: the cold fields, with the header as read
+ * @n: 0 for the CIB, 1 the solution, 2 the grid, 3 the strings
+ *
+ * This is an internal function, the reverse of magic_gen_10() and
+ * magic_gen_14().
+ */
+static unsigned short salvage_stored(struct puz_cold_t *c, int n) {
+  unsigned char m10[4] = MAGIC_10_MASK;
+  unsigned char m14[4] = MAGIC_14_MASK;
+
+  return (c->magic_10[n] ^ m10[n]) | ((c->magic_14[n] ^ m14[n]) << 8);
+}
+
+/**
+ * salvage_str - read a string that may run off the end of the file
+ *
+ * @base: the file
+ * @sz: its size
+ * @i: offset of the string; advanced past it
+ * @cut: set to 1 if the string was missing or unterminated
+ *
+ * This is an internal function.  A missing string comes back empty,
+ * an unterminated one as far as it goes.
+ *
+ * Return value: a malloc'd string, or NULL if out of memory.
+ */
+static unsigned char *salvage_str(unsigned char *base, int sz, int *i,
+                                  int *cut) {
+  unsigned char *end, *s;
+  int n;
+
+  if(*i >= sz) {
+    *cut = 1;
+    return (unsigned char *)calloc(1, 1);
+  }
+
+  end = memchr(base + *i, 0, sz - *i);
+  if(NULL == end) {
+    *cut = 1;
+    n = sz - *i;
+  } else {
+    n = end - (base + *i);
+  }
+
+  s = (unsigned char *)malloc(n + 1);
+  if(NULL == s)
+    return NULL;
+  memcpy(s, base + *i, n);
+  s[n] = 0;
+
+  *i += n + 1;
+
+  return s;
+}
+
+/**
+ * salvage_resync - find the next extra section after damage
+ *
+ * @base: the file
+ * @sz: its size
+ * @i: where to start looking
+ *
+ * This is an internal function.  It returns the offset of the next
+ * known section name with room for its header, or @sz.
+ */
+static int salvage_resync(unsigned char *base, int sz, int i) {
+  for(; i + 8 <= sz; i++) {
+    if(salvage_region(base + i))
+      return i;
+  }
+
+  return sz;
+}
+
+/**
+ * salvage_section - check one extra section's framing and checksum
+ *
+ * @base: the file
+ * @sz: its size
+ * @i: offset of the section's name
+ * @len: set to the length of the section's data
+ *
+ * This is an internal function.
+ *
+ * Return value: 1 if the section fits in the file, is terminated and
+ * matches its checksum; else 0.
+ */
+static int salvage_section(unsigned char *base, int sz, int i, int *len) {
+  unsigned char *data = base + i + 8;
+
+  if(i + 8 > sz)
+    return 0;
+
+  *len = le_16(base + i + 4);
+  if(i + 8 + *len + 1 > sz || data[*len] != 0)
+    return 0;
+
+  return puz_cksum_region(data, *len, 0x0000) == le_16(base + i + 6);
+}
+
+/**
+ * salvage_rusr_ok - check that RUSR data holds one string per square
+ *
+ * This is an internal function.
+ */
+static int salvage_rusr_ok(unsigned char *data, int len, int bd_sz) {
+  unsigned char *end;
+  int j, k = 0;
+
+  for(j = 0; j < bd_sz && k < len; j++) {
+    end = memchr(data + k, 0, len - k);
+    if(NULL == end)
+      return 0;
+    k = end - data + 1;
+  }
+
+  return j == bd_sz && k == len;
+}
+
+/**
+ * puz_load_salvage - Load what can be recovered of a damaged binary puzzle
+ *
+ * @puz: pointer to the struct puzzle_t to fill in.  If NULL, will be allocated for you.
+ * @base: pointer to the buffer containing the puzzle to load from (required)
+ * @sz: size of the puzzle file in the buffer (required)
+ * @flags: PUZ_LOAD_UTF8 and PUZ_SALVAGE_CKSUMS, or'd together
+ * @report: filled in with what was damaged and what was recovered
+ *   (required)
+ *
+ * Where puz_load() gives up on the first problem, this keeps every
+ * region whose checksum holds and reports the rest as PUZ_REGION_*
+ * bits.  Strings past the end of a truncated file come back empty;
+ * an extra section that fails its checksum, or doesn't fit, is
+ * dropped and the loader skips ahead to the next one it recognises.
+ * A missing grid is rebuilt blank from the solution.  The solution,
+ * grid and strings are kept even when damaged, since there is
+ * nothing better to put there, but a damaged grid has its black
+ * squares made to agree with the solution's.
+ *
+ * With PUZ_SALVAGE_CKSUMS, the checksums are rebuilt to match what
+ * was recovered, so puz_cksums_check() passes and puz_save() writes
+ * a consistent file.  Otherwise the file's own checksums are kept.
+ *
+ * Return value: NULL if not even the header and solution could be
+ * recovered, else a pointer to the filled-in struct puzzle_t.  If
+ * puz was NULL, this pointer is the newly-allocated puzzle_t.
+ */
+struct puzzle_t *puz_load_salvage(struct puzzle_t *puz, unsigned char *base,
+                                  int sz, int flags,
+                                  struct puz_salvage_report_t *report) {
+  unsigned char *data;
+  unsigned short ck;
+  int i, j, len, rlen, region, bd_sz, cut = 0;
+  int didmalloc = 0;
+
+  if(NULL == report)
+    return NULL;
+
+  memset(report, 0, sizeof(struct puz_salvage_report_t));
+
+  if(NULL == base || sz < 0x34) {
+    report->missing = PUZ_REGION_CIB;
+    return NULL;
+  }
+
+  if(NULL == puz) {
+    /* on a cache line of its own; see struct puzzle_t */
+    puz = (struct puzzle_t *)aligned_alloc(64, PUZ_PUZZLE_ALLOC_SZ);
+    if(NULL == puz) {
+      perror("aligned_alloc");
+      return NULL;
+    }
+    didmalloc = 1;
+  }
+
+  memset(puz, 0, sizeof(struct puzzle_t));
+
+  puz->base = base;
+  puz->sz = sz;
+
+  read_puz_head(puz, base);
+  memcpy(puz->cold.cib, base+0x2c, 8);
+
+  /* the CIB sum is stored twice, so a mismatch with just one of them
+     means the stored copy is what's damaged */
+  ck = puz_cksum_region(puz->cold.cib, 8, 0x0000);
+  if(ck != puz->cold.cksum_cib && ck != salvage_stored(&puz->cold, 0))
+    report->damaged |= PUZ_REGION_CIB;
+
+  bd_sz = puz->header.width * puz->header.height;
+  if(0 == bd_sz || 0x34 + bd_sz > sz) {
+    report->missing |= PUZ_REGION_SOLUTION | PUZ_REGION_GRID;
+    return load_fail(puz, didmalloc);
+  }
+
+  i = 0x34;
+  puz->solution = (unsigned char *)calloc(bd_sz + 1, 1);
+  puz->grid = (unsigned char *)calloc(bd_sz + 1, 1);
+  if(NULL == puz->solution || NULL == puz->grid) {
+    perror("calloc");
+    return load_fail(puz, didmalloc);
+  }
+
+  memcpy(puz->solution, base+i, bd_sz);
+  i += bd_sz;
+  report->recovered |= PUZ_REGION_CIB | PUZ_REGION_SOLUTION;
+
+  if(i + bd_sz > sz) {
+    report->missing |= PUZ_REGION_GRID;
+    for(j = 0; j < bd_sz; j++)
+      puz->grid[j] = puz->solution[j] == '.' ? '.' : '-';
+    i = sz;
+  } else {
+    memcpy(puz->grid, base+i, bd_sz);
+    i += bd_sz;
+    report->recovered |= PUZ_REGION_GRID;
+  }
+
+  puz->title = salvage_str(base, sz, &i, &cut);
+  puz->author = salvage_str(base, sz, &i, &cut);
+  puz->copyright = salvage_str(base, sz, &i, &cut);
+  if(NULL == puz->title || NULL == puz->author || NULL == puz->copyright) {
+    perror("malloc");
+    return load_fail(puz, didmalloc);
   }
-  return(buf+n);
+
+  puz->clues = (unsigned char **)calloc(puz->header.clue_count,
+                                        sizeof(unsigned char *));
+  if(NULL == puz->clues && puz->header.clue_count) {
+    perror("calloc");
+    return load_fail(puz, didmalloc);
+  }
+
+  for(j = 0; j < puz->header.clue_count; j++) {
+    int was = cut;
+
+    cut = 0;
+    puz->clues[j] = salvage_str(base, sz, &i, &cut);
+    if(NULL == puz->clues[j]) {
+      perror("malloc");
+      return load_fail(puz, didmalloc);
+    }
+    if(cut)
+      report->clues_lost++;
+    cut |= was;
+  }
+
+  /* the notes may be left off entirely, as puz_load_bin() allows */
+  if(i < sz)
+    puz->notes = salvage_str(base, sz, &i, &cut);
+  else
+    puz->notes = (unsigned char *)calloc(1, 1);
+  if(NULL == puz->notes) {
+    perror("malloc");
+    return load_fail(puz, didmalloc);
+  }
+  puz->notes_sz = Sstrlen(puz->notes);
+
+  if(cut)
+    report->missing |= PUZ_REGION_STRINGS;
+  else
+    report->recovered |= PUZ_REGION_STRINGS;
+
+  /* the extra sections, skipping any that don't check out */
+  while(i + 8 <= sz) {
+    region = salvage_region(base+i);
+
+    if(0 == region) {
+      j = salvage_resync(base, sz, i + 1);
+      for(; i < j; i++) {
+        if(base[i])
+          report->damaged |= PUZ_REGION_UNKNOWN;
+      }
+      continue;
+    }
+
+    data = base + i + 6; /* what the load_*_bin() functions expect */
+
+    if(!salvage_section(base, sz, i, &len)
+       || (report->recovered & region)
+       || ((region == PUZ_REGION_GRBS || region == PUZ_REGION_GEXT)
+           && len != bd_sz)
+       || (region == PUZ_REGION_RUSR
+           && !salvage_rusr_ok(base + i + 8, len, bd_sz))) {
+      j = salvage_resync(base, sz, i + 4);
+      /* running off the end with nothing after it is truncation */
+      if(j == sz && i + 8 + len + 1 > sz)
+        report->missing |= region;
+      else
+        report->damaged |= region;
+      report->sections_dropped++;
+      i = j;
+      continue;
+    }
+
+    switch(region) {
+    case PUZ_REGION_GRBS:
+      /* the rebus grid means nothing without the table after it */
+      j = i + 8 + len + 1;
+      if(j + 4 > sz || 0 != memcmp(base+j, "RTBL", 4)) {
+        for(rlen = 0; rlen < len && 0 == base[i + 8 + rlen]; rlen++)
+          ;
+        if(rlen == len) {
+          /* an empty rebus grid needs no table */
+          report->recovered |= PUZ_REGION_GRBS;
+          i = j;
+          continue;
+        }
+        report->missing |= PUZ_REGION_RTBL;
+        report->sections_dropped++;
+        i = j;
+        continue;
+      }
+      if(!salvage_section(base, sz, j, &rlen)) {
+        report->damaged |= PUZ_REGION_RTBL;
+        report->sections_dropped++;
+        i = salvage_resync(base, sz, j + 4);
+        continue;
+      }
+      if(0 == load_grbs_bin(puz, data, len))
+        return load_fail(puz, didmalloc);
+      report->recovered |= PUZ_REGION_GRBS | PUZ_REGION_RTBL;
+      i = j + 8 + rlen + 1;
+      continue;
+    case PUZ_REGION_RTBL:
+      /* a table whose grid was dropped goes with it */
+      if(!(report->damaged & PUZ_REGION_GRBS))
+        report->damaged |= PUZ_REGION_RTBL;
+      report->sections_dropped++;
+      break;
+    case PUZ_REGION_LTIM:
+      if(0 == load_ltim_bin(puz, data, len))
+        return load_fail(puz, didmalloc);
+      report->recovered |= region;
+      break;
+    case PUZ_REGION_GEXT:
+      if(0 == load_gext_bin(puz, data))
+        return load_fail(puz, didmalloc);
+      report->recovered |= region;
+      break;
+    case PUZ_REGION_RUSR:
+      if(0 == load_rusr_bin(puz, data))
+        return load_fail(puz, didmalloc);
+      report->recovered |= region;
+      break;
+    }
+
+    i += 8 + len + 1;
+  }
+
+  /* a few stray bytes at the end: the start of a section, cut off */
+  for(; i < sz; i++) {
+    if(base[i])
+      report->missing |= PUZ_REGION_UNKNOWN;
+  }
+
+  puz_cksums_calc(puz);
+
+  if(puz->cold.calc_cksums[1] != salvage_stored(&puz->cold, 1))
+    report->damaged |= PUZ_REGION_SOLUTION;
+  if(puz->cold.calc_cksums[2] != salvage_stored(&puz->cold, 2)
+     && !(report->missing & PUZ_REGION_GRID))
+    report->damaged |= PUZ_REGION_GRID;
+  if(puz->cold.calc_cksums[3] != salvage_stored(&puz->cold, 3))
+    report->damaged |= PUZ_REGION_STRINGS;
+  if(puz->cold.calc_cksum_puzcib != puz->cold.cksum_puz)
+    report->damaged |= PUZ_REGION_FILE;
+
+  report->recovered &= ~report->damaged;
+
+  if(report->damaged & PUZ_REGION_GRID) {
+    for(j = 0; j < bd_sz; j++) {
+      if(puz->solution[j] == '.')
+        puz->grid[j] = '.';
+      else if(puz->grid[j] == '.' || puz->grid[j] == 0)
+        puz->grid[j] = '-';
+    }
+  }
+
+  puz_bitboard_calc(puz);
+  puz_progress_calc(puz);
+
+  if(flags & PUZ_SALVAGE_CKSUMS) {
+    puz_cksums_commit(puz);
+    report->repaired = 1;
+  }
+
+  if(flags & PUZ_LOAD_UTF8)
+    puz_utf8_calc(puz);
+
+  return puz;
 }
 
+
 /**
  * get_one_line - get one [\r\n]{1,2}-delimited line
  *
@@ -520,54 +975,34 @@ static unsigned char *strnchr(unsigned char *buf, int n, unsigned char c) {
  * may be an mmap'd file which is read-only.
  */
 unsigned char *get_one_line(unsigned char **buf, int *n) {
-  unsigned char *b, *c, *d, *end;
+  unsigned char *b, *d, *end, *stop, *c;
   int extra = 0;
+
   b = *buf;
+  stop = *buf + *n;
 
-  while(isspace(*b) && *b != '\r' && *b != '\n' )
+  while(b < stop && isspace(*b) && *b != '\r' && *b != '\n')
     b++;
 
-  c = strnchr(b, *n, '\r');
-  d = strnchr(b, *n, '\n');
-
-  if(c == NULL) // if no \r found, use the \n (unix)
-    end = d;
-  else if(d == NULL) // if no \n found, use the \r (macos)
-    end = c;
-  else {
-    if(d == (c+1)) {// if find \r\n, use \r, skip \n (DOS)
-      end = c;
-      extra = 1;
-    } else if(c == (d+1)) { // if \n\r, use \n, skip \r (??!)
-      end = c;
-      extra = 1;
-    } else {
-      if(d == c) { // we must be at end of the buffer
-	extra = -1; // since we're not consuming a \r or \n
-	end = d;
-      } else
-	end = (d > c ? d : c); // if find both, but not together, use
-      // earliest (??!!!)
-    }
-  }
+  /* one pass to whichever terminator comes first */
+  end = puz_kernels.eol(b, stop);
+
+  if(end + 1 < stop && ((end[0] == '\r' && end[1] == '\n') ||
+                        (end[0] == '\n' && end[1] == '\r')))
+    extra = 1; // \r\n (DOS), or \n\r (??!): skip both
+  else if(end == stop)
+    extra = -1; // at the end of the buffer, with no \r or \n to consume
 
   d = end;
-  while(d > b && isspace(*d))
+  while(d > b && isspace(*(d-1)))
     d--;
-  /* d now points to the last unsigned character of the string */
-
-  /* Diagram of what our pointers look like:
-     0123456
-     __XYZ_\n
-     __b d
-     
-     So, d = 4, b = 2, but our string is 3 bytes long (it includes d).
-     We thus have (d+1)-b bytes of string, so we need d+1-b+1 bytes to
-     hold the string along with its terminating NUL */
-  c = (unsigned char *)malloc(d+1-b+1);
-  memset(c, 'X', d+1-b+1);
-  memcpy(c, b, d+1-b);
-  c[d+1-b] = '\0';
+  /* the line is b up to, but not including, d */
+
+  c = (unsigned char *)malloc(d-b+1);
+  if(NULL == c)
+    return NULL;
+  memcpy(c, b, d-b);
+  c[d-b] = '\0';
 
   /* update the remaining bytes count, and advance the cursor */
   *n = (*n - (end+1+extra - *buf));
@@ -603,18 +1038,20 @@ static int delim_memcmp(unsigned char *input, unsigned char *buf) {
 static struct line_list *line_append(struct line_list *list, unsigned char *line) {
   struct line_list *cur;
 
-  for(cur = list; cur->next != NULL; cur = cur->next) 
-    {}; // Do nothing
-
-  cur->line = line;
+  /* the root keeps the end of the list, so this isn't a walk */
+  cur = list->last ? list->last : list;
 
   cur->next = (struct line_list *)malloc(sizeof(struct line_list));
+  if(NULL == cur->next)
+    return NULL;
+
+  cur->line = line;
   cur = cur->next;
 
   memset(cur, 0, sizeof(struct line_list));
+  list->last = cur;
 
-  cur->next = NULL;
-  return cur->next;
+  return cur;
 }
 
 static int line_length(struct line_list *list) {
@@ -632,11 +1069,15 @@ static unsigned char *line_concat(struct line_list *list) {
   unsigned char *retval;
   int i, len;
 
+#if TEXT_DEBUG
   printf("   ** LC: %p\n ", list);
+#endif
 
   len = line_length(list);
 
-  retval = (unsigned char *)malloc(len);
+  retval = (unsigned char *)malloc(len + 1);
+  if(NULL == retval)
+    return NULL;
   i = 0;
   for(cur = list; cur != NULL && cur->line != NULL; cur = cur->next) {
     memcpy(retval+i, cur->line, Sstrlen(cur->line));
@@ -651,7 +1092,9 @@ static int line_count(struct line_list *root) {
   struct line_list *cur;
   int i;
 
+#if TEXT_DEBUG
   printf("   ** Ln: %p\n ", root);
+#endif
 
   for(i = 0, cur = root; cur->line != NULL; cur = cur->next)
     i++;
@@ -663,7 +1106,9 @@ static void line_clear(struct line_list *root) {
   /* doesn't free root! */
   struct line_list *cur = NULL, *next = NULL;
 
+#if TEXT_DEBUG
   printf("   ** LW: %p\n ", root);
+#endif
 
   if(NULL == root)
     return;
@@ -674,6 +1119,7 @@ static void line_clear(struct line_list *root) {
 
   free(root->line);
   root->line = NULL;
+  root->last = NULL;
 
   if(NULL == root->next) {
     return;
@@ -706,13 +1152,14 @@ static void line_clear(struct line_list *root) {
  * Return Value: NULL on error, pointer to new grid string on success.
  */
 static unsigned char *mkgrid(unsigned char *soln) {
-  unsigned int i;
+  unsigned int i, len;
   unsigned char *grid = Sstrdup(soln);
 
   if(NULL == grid)
     return NULL;
 
-  for(i = 0; i < Sstrlen(grid); i++) {
+  len = Sstrlen(grid);
+  for(i = 0; i < len; i++) {
     if(grid[i] != '.')
       grid[i] = '-';
   }
@@ -725,6 +1172,8 @@ static unsigned char *mkgrid(unsigned char *soln) {
  * @puz: pointer to the struct puzzle_t to fill in.  If NULL, will be allocated for you.
  * @base: pointer to the buffer containing the puzzle to load from (required)
  * @sz: size of the puzzle file in the buffer (required)
+ * @err: if not NULL, set to a PUZ_TEXT_ERR_* value on error, and
+ *   the error isn't printed
  * 
  * This is an internal function
  *
@@ -739,7 +1188,7 @@ static unsigned char *mkgrid(unsigned char *soln) {
  *
  * After all this processing, the line_list is cleared (unless the
  * state handler set do_clear to 0, which is used in grabbing clues),
- * and the state advanced.
+ * and the state advanced.  Blank lines are skipped.
  *
  * This proceeds until the final state is reached, then the puzzle is
  * checksummed and returned.
@@ -748,13 +1197,16 @@ static unsigned char *mkgrid(unsigned char *soln) {
  * puzzle_t.  If puz was NULL, this pointer is the newly-allocated
  * puzzle_t.
  */
-static struct puzzle_t *puz_load_text(struct puzzle_t *puz, unsigned char *base, int sz) {
+static struct puzzle_t *puz_load_text(struct puzzle_t *puz, unsigned char *base,
+                                      int sz, int *err) {
   /* And this, boys and girls, is why Josh Hates Delimited Formats */
 
   unsigned char *cursor;
   unsigned char *line;
 
   int remaining = sz;
+  int error = 0;
+  int didmalloc = (NULL == puz);
 
   unsigned char magics[9][17] = { {}, /* no initial magic */
                          TEXT_FILE_MAGIC,
@@ -784,11 +1236,19 @@ static struct puzzle_t *puz_load_text(struct puzzle_t *puz, unsigned char *base,
   struct line_list linelist;
 
   /* A quick sanity check */
-  if(*(base) != TEXT_SUBMAGIC)
+  if(sz < 1 || *(base) != TEXT_SUBMAGIC) {
+    if(err)
+      *err = PUZ_TEXT_ERR_MAGIC;
     return NULL;
+  }
 
   /* initialize our structure */
   puz = puz_init(puz);
+  if(NULL == puz) {
+    if(err)
+      *err = PUZ_TEXT_ERR_NOMEM;
+    return NULL;
+  }
 
   /* Set up our state machine */
   memset(&linelist, 0, sizeof(struct line_list));
@@ -796,33 +1256,55 @@ static struct puzzle_t *puz_load_text(struct puzzle_t *puz, unsigned char *base,
 
   /* Run the state machine */
   while(state != STATE_FINAL) {
+    if(remaining <= 0 && state != STATE_CLUE1) {
+      if(NULL == err)
+        printf("Text puzzle ended in state %d\n", state);
+      error = PUZ_TEXT_ERR_TRUNCATED;
+      goto fail;
+    }
+
     line = get_one_line(&cursor, &remaining);
+    if(NULL == line) {
+      error = PUZ_TEXT_ERR_NOMEM;
+      goto fail;
+    }
 
+#if TEXT_DEBUG
     printf("Got Line: %s\n", line);
+#endif
 
     state_d = 0;
 
-    if(remaining <= 0) {
-      line_append(&linelist, line);
-      state_d = 1;
-    }
-
     if(line[0] == TEXT_SUBMAGIC) {
-      if(0 != delim_memcmp(line, magics[state+1])) {
-	printf("Didn't get the right magic line at state %d (%s not %s)!\n", 
-	       state, line, magics[state+1]);
-	return NULL;
+      if(state >= STATE_CLUE1 || 0 != delim_memcmp(line, magics[state+1])) {
+        if(NULL == err)
+          printf("Didn't get the right magic line at state %d (%s)!\n",
+                 state, line);
+        free(line);
+        error = PUZ_TEXT_ERR_MAGIC;
+        goto fail;
       }
+      free(line);
       state_d = 1;
+    } else if(line[0] == 0) {
+      free(line);
+    } else if(NULL == line_append(&linelist, line)) {
+      free(line);
+      error = PUZ_TEXT_ERR_NOMEM;
+      goto fail;
     }
 
-    if(0 == state_d) {
-      line_append(&linelist, line);
-    } else {
+    if(remaining <= 0)
+      state_d = 1;
+
+    if(state_d) {
+      unsigned char *buf = NULL;
+
       do_clear = 1;
 
+#if TEXT_DEBUG
       printf("Exiting state %d\n", state);
-      printf("Values: %s\n\n", line_concat(&linelist));
+#endif
 
       switch(state) {
       case STATE_INIT:
@@ -830,64 +1312,95 @@ static struct puzzle_t *puz_load_text(struct puzzle_t *puz, unsigned char *base,
       case STATE_FILE:
 	break;
       case STATE_TITLE:
-	puz_title_set(puz, line_concat(&linelist));
-	break;
       case STATE_AUTHOR:
-	puz_author_set(puz, line_concat(&linelist));
-	break;
       case STATE_COPYRIGHT:
-	puz_copyright_set(puz, line_concat(&linelist));
+	buf = line_concat(&linelist);
+	if(NULL == buf) {
+	  error = PUZ_TEXT_ERR_NOMEM;
+	  goto fail;
+	}
+	if(state == STATE_TITLE)
+	  puz_title_set(puz, buf);
+	else if(state == STATE_AUTHOR)
+	  puz_author_set(puz, buf);
+	else
+	  puz_copyright_set(puz, buf);
 	break;
       case STATE_SIZE: {
-	unsigned char *buf, *a, *b, *c;
+	unsigned char *b;
 	int w,h;
 	buf = line_concat(&linelist);
+	if(NULL == buf) {
+	  error = PUZ_TEXT_ERR_NOMEM;
+	  goto fail;
+	}
 
-	printf("size line: %s\n", buf);
-	fflush(stdout);
-	a = buf;
 	b = Sstrchr(buf, 'x');
-	c = b+1;
-
-	if(NULL == a || NULL == b /* || NULL == c is meaningless */) {
-	  printf("Got bad size values or something: '%s'\n", buf);
+	w = Satoi(buf);
+	h = b ? Satoi(b+1) : 0;
+
+	if(w < 1 || w > 255 || h < 1 || h > 255) {
+	  if(NULL == err)
+	    printf("Got bad size values or something: '%s'\n", buf);
+	  free(buf);
+	  error = PUZ_TEXT_ERR_SIZE;
+	  goto fail;
 	}
 
-	*b = 0x00;
-	w = Satoi(a);
-	h = Satoi(c);
-	*b = 'x';
-
 	puz_width_set(puz, w);
 	puz_height_set(puz, h);
 
 	break;
       }
       case STATE_GRID: {
-	unsigned char *soln = line_concat(&linelist);
-	unsigned char *grid = mkgrid(soln);
-	puz_solution_set(puz, soln);
+	unsigned char *grid;
+	buf = line_concat(&linelist);
+	if(NULL == buf) {
+	  error = PUZ_TEXT_ERR_NOMEM;
+	  goto fail;
+	}
+	if((int)Sstrlen(buf) != puz_width_get(puz) * puz_height_get(puz)) {
+	  if(NULL == err)
+	    printf("Grid doesn't match its size: '%s'\n", buf);
+	  free(buf);
+	  error = PUZ_TEXT_ERR_SIZE;
+	  goto fail;
+	}
+	grid = mkgrid(buf);
+	if(NULL == grid) {
+	  free(buf);
+	  error = PUZ_TEXT_ERR_NOMEM;
+	  goto fail;
+	}
+	puz_solution_set(puz, buf);
 	puz_grid_set(puz, grid);
+	free(grid);
 	break;
       }
       case STATE_CLUE0: do_clear = 0;
       case STATE_CLUE1: {
 	int j, n_clues = line_count(&linelist);
 	struct line_list *cur;
-	puz_clear_clues(puz);
+	if(puz->clues)
+	  puz_clear_clues(puz);
 	puz_clue_count_set(puz, n_clues);
 	
 	for(j = 0, cur = &linelist;  j < n_clues && cur != NULL; j++, cur = cur->next) {
 	  puz_clue_set(puz, j, cur->line);
+#if TEXT_DEBUG
 	  printf("Clue %d -> %s\n", j, cur->line);
+#endif
 	}
 	break;
       }
       default:
 	printf("Reached Unknown state: %d\n", state);
-	return NULL;
+	error = PUZ_TEXT_ERR_MAGIC;
+	goto fail;
       }
 
+      free(buf);
+
       if(do_clear) {
 	line_clear(&linelist);
       }
@@ -896,10 +1409,15 @@ static struct puzzle_t *puz_load_text(struct puzzle_t *puz, unsigned char *base,
     if(state_d) state++;
   }
 
-  puz_cksums_calc(puz);
-  puz_cksums_commit(puz);
+  puz_cksums_commit(puz); /* calculates them first */
 
   return puz;
+
+ fail:
+  line_clear(&linelist);
+  if(err)
+    *err = error;
+  return load_fail(puz, didmalloc);
 }
 
 /**
@@ -919,6 +1437,9 @@ static struct puzzle_t *puz_load_text(struct puzzle_t *puz, unsigned char *base,
  */
 struct puzzle_t *puz_load(struct puzzle_t *puz, int type, unsigned char *base, int sz) {
   int typeguess;
+  int flags = type & ~PUZ_FILE_TYPE_MASK;
+
+  type &= PUZ_FILE_TYPE_MASK;
 
   if(base[0] != TEXT_SUBMAGIC || base[0xd] == 0x00) 
     typeguess = PUZ_FILE_BINARY;
@@ -935,9 +1456,150 @@ struct puzzle_t *puz_load(struct puzzle_t *puz, int type, unsigned char *base, i
     puz = puz_load_bin(puz, base, sz);
     break;
   case PUZ_FILE_TEXT:
-    puz = puz_load_text(puz, base, sz);
+    puz = puz_load_text(puz, base, sz, NULL);
     break;
   }
+
+  if(puz && (flags & PUZ_LOAD_UTF8))
+    puz_utf8_calc(puz);
   
   return puz;
 }
+
+/*
+  Multi-document text dumps.  Each document starts with a
+  <ACROSS PUZZLE> line, so the buffer is split there with one memchr
+  pass, and the documents are parsed independently by a few tasks on
+  the library's pool.  They only share the buffer, which is never
+  written.
+ */
+
+struct text_job_t {
+  unsigned char *base;
+  struct puz_text_doc_t *docs;
+  int n;
+  int next; /* the next document to take */
+};
+
+/**
+ * text_worker - parse documents until there are none left
+ *
+ * This is an internal function, the pool task for
+ * puz_load_text_many().
+ */
+static void text_worker(void *arg) {
+  struct text_job_t *job = (struct text_job_t *)arg;
+  struct puz_text_doc_t *d;
+  int i;
+
+  while((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->n) {
+    d = &job->docs[i];
+    d->puz = puz_load_text(NULL, job->base + d->offset, d->sz, &d->error);
+  }
+}
+
+/**
+ * puz_load_text_many - Load every puzzle in a concatenated text dump
+ *
+ * @base: pointer to the buffer holding the documents (required)
+ * @sz: size of the buffer
+ * @nthreads: tasks to parse with, on the library's thread pool; 0 or
+ *   less means one per pool thread, plus this one
+ * @docs: set to a malloc'd array with one entry per document, in
+ *   buffer order, or NULL if there are none (required)
+ *
+ * A document starts at each <ACROSS PUZZLE> line at the start of a
+ * line, and runs to the next one.  Anything before the first is
+ * ignored.  Each is loaded as puz_load() loads a text puzzle, but a
+ * document that fails just gets its entry's puz left NULL and error
+ * set to a PUZ_TEXT_ERR_* value; the others still load.  Free the
+ * result with puz_text_docs_free().
+ *
+ * Return value: -1 on error, else the number of documents found.
+ */
+int puz_load_text_many(unsigned char *base, int sz, int nthreads,
+                       struct puz_text_doc_t **docs) {
+  unsigned char magic[] = TEXT_FILE_MAGIC;
+  int mlen = Sstrlen(magic);
+  struct puz_text_doc_t *d = NULL, *nd;
+  struct text_job_t job;
+  struct puz_group_t g;
+  unsigned char *p;
+  int i, n = 0, cap = 0;
+
+  if(NULL == base || NULL == docs || sz < 0)
+    return -1;
+
+  *docs = NULL;
+
+  /* find the documents: a '<' at a line start, then the magic */
+  for(i = 0; i + mlen <= sz; i = p - base + 1) {
+    p = memchr(base + i, TEXT_SUBMAGIC, sz - mlen + 1 - i);
+    if(NULL == p)
+      break;
+    if(p > base && p[-1] != '\n' && p[-1] != '\r')
+      continue;
+    if(0 != memcmp(p, magic, mlen))
+      continue;
+
+    if(n == cap) {
+      cap = cap ? cap * 2 : 64;
+      nd = (struct puz_text_doc_t *)realloc(d, cap * sizeof(struct puz_text_doc_t));
+      if(NULL == nd) {
+        perror("realloc");
+        free(d);
+        return -1;
+      }
+      d = nd;
+    }
+
+    memset(&d[n], 0, sizeof(struct puz_text_doc_t));
+    d[n].offset = p - base;
+    if(n > 0)
+      d[n-1].sz = d[n].offset - d[n-1].offset;
+    n++;
+  }
+
+  if(0 == n)
+    return 0;
+  d[n-1].sz = sz - d[n-1].offset;
+
+  if(nthreads <= 0)
+    nthreads = puz_pool_threads_get() + 1;
+  if(nthreads > n)
+    nthreads = n;
+
+  job.base = base;
+  job.docs = d;
+  job.n = n;
+  job.next = 0;
+
+  /* the calling thread works too */
+  puz_group_init(&g);
+  for(i = 1; i < nthreads; i++)
+    puz_group_spawn(&g, text_worker, &job);
+  text_worker(&job);
+  puz_group_wait(&g);
+
+  *docs = d;
+
+  return n;
+}
+
+/**
+ * puz_text_docs_free - free the result of puz_load_text_many()
+ *
+ * @docs: the array
+ * @n: the number of entries
+ */
+void puz_text_docs_free(struct puz_text_doc_t *docs, int n) {
+  int i;
+
+  if(NULL == docs)
+    return;
+
+  for(i = 0; i < n; i++)
+    puz_deep_free(docs[i].puz);
+
+  free(docs);
+}
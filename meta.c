@@ -0,0 +1,546 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * meta.c -- A column-wise table of puzzle metadata, for fast filtering
+ */
+
+#include <puz.h>
+
+/*
+  A question like "every 21x21 unlocked puzzle with a rebus and more
+  than 140 clues" over a big collection shouldn't have to walk a
+  struct puzzle_t, or even a row of an index, per puzzle.  So the
+  table keeps each field in its own array, one entry per puzzle:
+  width, height, clue count, scrambled tag, which extra sections there
+  are (as PUZ_REGION_* bits) and the file checksum; and the title,
+  author and copyright as offsets into one block of strings.
+
+  puz_meta_select() takes a struct puz_meta_query_t and gives back a
+  bitmap with one bit per row.  Each field the query constrains is one
+  pass down its column with a puz_kernels predicate, 64 rows to a
+  word of the bitmap, and the passes AND together; fields it doesn't
+  constrain cost nothing.  Big tables are cut into runs of
+  META_TASK_ROWS rows, each a task on the thread pool, small enough
+  that a run's bitmap stays in cache across the passes.
+
+  Rows come from puz_meta_probe(), which reads just the header and
+  walks the framing of a binary file without loading it, or from
+  puz_meta_add() for a puzzle that's already loaded.
+ */
+
+#define META_TASK_ROWS (1 << 16)
+
+struct meta_job_t {
+  struct puz_meta_t *meta;
+  struct puz_meta_query_t *q;
+  uint64_t *sel;
+  int first, n;
+  int *count;
+};
+
+static int meta_grow(struct puz_meta_t *meta);
+static int meta_string(struct puz_meta_t *meta, unsigned char *s, int len,
+                       uint32_t *off);
+static int meta_row(struct puz_meta_t *meta, int width, int height,
+                    int clue_count, int scrambled_tag, int sections,
+                    int cksum_puz, unsigned char **strs, int *lens);
+static void meta_select_rows(void *arg);
+
+/**
+ * puz_meta_init - start an empty metadata table
+ *
+ * @meta: pointer to the struct puz_meta_t to init.  If NULL, one will
+ *   be malloc'd for you.
+ *
+ * Return Value: NULL on error, else a pointer to the initialized
+ * struct puz_meta_t.  If meta was NULL, this is a pointer to the
+ * newly-allocated structure.
+ */
+struct puz_meta_t *puz_meta_init(struct puz_meta_t *meta) {
+  if(NULL == meta) {
+    meta = (struct puz_meta_t *)malloc(sizeof(struct puz_meta_t));
+    if(NULL == meta) {
+      perror("malloc");
+      return NULL;
+    }
+  }
+
+  memset(meta, 0, sizeof(struct puz_meta_t));
+
+  return meta;
+}
+
+/**
+ * puz_meta_free - free a table's columns and strings
+ *
+ * @meta: the table
+ *
+ * This does not free @meta itself, since it may live on the stack or
+ * inside another structure.
+ */
+void puz_meta_free(struct puz_meta_t *meta) {
+  if(NULL == meta)
+    return;
+
+  free(meta->width);
+  free(meta->height);
+  free(meta->clue_count);
+  free(meta->scrambled_tag);
+  free(meta->sections);
+  free(meta->cksum_puz);
+  free(meta->title);
+  free(meta->author);
+  free(meta->copyright);
+  free(meta->strings);
+  memset(meta, 0, sizeof(struct puz_meta_t));
+}
+
+/**
+ * meta_grow - make room for at least one more row
+ *
+ * @meta: the table
+ *
+ * This is an internal function.
+ *
+ * Return Value: 0 on success, -1 if out of memory.
+ */
+static int meta_grow(struct puz_meta_t *meta) {
+  void *p;
+  int cap;
+
+  if(meta->n < meta->cap)
+    return 0;
+
+  cap = meta->cap ? meta->cap * 2 : 1024;
+
+#define META_GROW_COLUMN(col)                                           \
+  p = realloc(meta->col, cap * sizeof(*meta->col));                     \
+  if(NULL == p) {                                                       \
+    perror("realloc");                                                  \
+    return -1;                                                          \
+  }                                                                     \
+  meta->col = p;
+
+  META_GROW_COLUMN(width);
+  META_GROW_COLUMN(height);
+  META_GROW_COLUMN(clue_count);
+  META_GROW_COLUMN(scrambled_tag);
+  META_GROW_COLUMN(sections);
+  META_GROW_COLUMN(cksum_puz);
+  META_GROW_COLUMN(title);
+  META_GROW_COLUMN(author);
+  META_GROW_COLUMN(copyright);
+
+#undef META_GROW_COLUMN
+
+  meta->cap = cap;
+
+  return 0;
+}
+
+/**
+ * meta_string - copy a string into the table's strings
+ *
+ * @meta: the table
+ * @s: the string; NULL is stored as ""
+ * @len: its length
+ * @off: receives its offset
+ *
+ * This is an internal function.
+ *
+ * Return Value: 0 on success, -1 if out of memory or past 4GB.
+ */
+static int meta_string(struct puz_meta_t *meta, unsigned char *s, int len,
+                       uint32_t *off) {
+  unsigned char *p;
+  size_t cap;
+
+  if(NULL == s)
+    len = 0;
+
+  if(meta->strings_sz + len + 1 > meta->strings_cap) {
+    cap = meta->strings_cap ? meta->strings_cap : 4096;
+    while(cap < meta->strings_sz + len + 1)
+      cap *= 2;
+    if(cap > 0xFFFFFFFFUL) {
+      if(meta->strings_sz + len + 1 > 0xFFFFFFFFUL)
+        return -1;
+      cap = 0xFFFFFFFFUL;
+    }
+    p = (unsigned char *)realloc(meta->strings, cap);
+    if(NULL == p) {
+      perror("realloc");
+      return -1;
+    }
+    meta->strings = p;
+    meta->strings_cap = cap;
+  }
+
+  *off = meta->strings_sz;
+  if(len)
+    memcpy(meta->strings + meta->strings_sz, s, len);
+  meta->strings[meta->strings_sz + len] = 0;
+  meta->strings_sz += len + 1;
+
+  return 0;
+}
+
+/**
+ * meta_row - append one row
+ *
+ * @meta: the table
+ * @strs: the title, author and copyright
+ * @lens: and their lengths
+ *
+ * This is an internal function; the rest are the columns' values.
+ *
+ * Return Value: the new row's index, or -1 if out of memory.
+ */
+static int meta_row(struct puz_meta_t *meta, int width, int height,
+                    int clue_count, int scrambled_tag, int sections,
+                    int cksum_puz, unsigned char **strs, int *lens) {
+  size_t strings_sz = meta->strings_sz;
+  int i = meta->n;
+
+  if(meta_grow(meta) < 0)
+    return -1;
+
+  if(meta_string(meta, strs[0], lens[0], &meta->title[i]) < 0 ||
+     meta_string(meta, strs[1], lens[1], &meta->author[i]) < 0 ||
+     meta_string(meta, strs[2], lens[2], &meta->copyright[i]) < 0) {
+    meta->strings_sz = strings_sz;
+    return -1;
+  }
+
+  meta->width[i] = width;
+  meta->height[i] = height;
+  meta->clue_count[i] = clue_count;
+  meta->scrambled_tag[i] = scrambled_tag;
+  meta->sections[i] = sections;
+  meta->cksum_puz[i] = cksum_puz;
+  meta->n++;
+
+  return i;
+}
+
+/**
+ * puz_meta_probe - add a row for a binary puzzle file, without loading it
+ *
+ * @meta: the table (required)
+ * @base: the file's bytes (required)
+ * @sz: how many
+ *
+ * Only the header, the title, author and copyright, and the names and
+ * lengths of the extra sections are read; nothing is checked against
+ * its checksum.  A section cut off by the end of the file isn't
+ * counted.  Text puzzles have to be loaded and given to
+ * puz_meta_add().
+ *
+ * Return Value: the new row's index, or -1 if @base isn't a binary
+ * puzzle (or out of memory).
+ */
+int puz_meta_probe(struct puz_meta_t *meta, unsigned char *base, int sz) {
+  unsigned char magic[] = FILE_MAGIC;
+  unsigned char *strs[3], *p;
+  int lens[3], n_strs, scan, len, sections = 0, i;
+
+  if(NULL == meta || NULL == base || sz < 0x34)
+    return -1;
+  if(memcmp(base + 2, magic, sizeof(magic)) || 0 == base[0x2c] ||
+     0 == base[0x2d])
+    return -1;
+
+  /* title, author, copyright, the clues, then the notes */
+  scan = 0x34 + 2 * base[0x2c] * base[0x2d];
+  n_strs = 4 + le_16(base + 0x2e);
+  for(i = 0; i < n_strs; i++) {
+    if(scan >= sz)
+      return -1;
+    p = memchr(base + scan, 0, sz - scan);
+    if(NULL == p)
+      return -1;
+    if(i < 3) {
+      strs[i] = base + scan;
+      lens[i] = p - (base + scan);
+    }
+    scan = p - base + 1;
+  }
+
+  /* each is a name, a length and a checksum, the data and a NUL */
+  while(scan + 8 <= sz) {
+    len = le_16(base + scan + 4);
+    if(scan + 8 + len + 1 > sz)
+      break;
+    if(!memcmp(base + scan, "GRBS", 4))
+      sections |= PUZ_REGION_GRBS;
+    else if(!memcmp(base + scan, "RTBL", 4))
+      sections |= PUZ_REGION_RTBL;
+    else if(!memcmp(base + scan, "LTIM", 4))
+      sections |= PUZ_REGION_LTIM;
+    else if(!memcmp(base + scan, "GEXT", 4))
+      sections |= PUZ_REGION_GEXT;
+    else if(!memcmp(base + scan, "RUSR", 4))
+      sections |= PUZ_REGION_RUSR;
+    scan += 8 + len + 1;
+  }
+
+  return meta_row(meta, base[0x2c], base[0x2d], le_16(base + 0x2e),
+                  le_16(base + 0x32), sections, le_16(base), strs, lens);
+}
+
+/**
+ * puz_meta_add - add a row for a loaded puzzle
+ *
+ * @meta: the table (required)
+ * @puz: the puzzle (required)
+ *
+ * The checksum is the header's, as loaded or last committed.
+ *
+ * Return Value: the new row's index, or -1 on error.
+ */
+int puz_meta_add(struct puz_meta_t *meta, struct puzzle_t *puz) {
+  unsigned char *strs[3];
+  int lens[3], sections = 0, i;
+
+  if(NULL == meta || NULL == puz)
+    return -1;
+
+  strs[0] = puz->title;
+  strs[1] = puz->author;
+  strs[2] = puz->copyright;
+  for(i = 0; i < 3; i++)
+    lens[i] = strs[i] ? Sstrlen(strs[i]) : 0;
+
+  if(puz->grbs)
+    sections |= PUZ_REGION_GRBS;
+  if(puz->rtbl)
+    sections |= PUZ_REGION_RTBL;
+  if(puz->ltim)
+    sections |= PUZ_REGION_LTIM;
+  if(puz->gext)
+    sections |= PUZ_REGION_GEXT;
+  if(puz->rusr)
+    sections |= PUZ_REGION_RUSR;
+
+  return meta_row(meta, puz->header.width, puz->header.height,
+                  puz->header.clue_count, puz->header.scrambled_tag,
+                  sections, puz->cold.cksum_puz, strs, lens);
+}
+
+/**
+ * puz_meta_count - how many rows a table has
+ *
+ * @meta: the table (required)
+ *
+ * A selection bitmap for the table takes (count + 63) / 64 words.
+ *
+ * Return Value: the number of rows, or -1 on error.
+ */
+int puz_meta_count(struct puz_meta_t *meta) {
+  if(NULL == meta)
+    return -1;
+
+  return meta->n;
+}
+
+/**
+ * puz_meta_title_get - a row's title
+ *
+ * @meta: the table (required)
+ * @row: the row
+ *
+ * The string is as it was in the file, and lives as long as the table
+ * (or until a row is next added).  So do the author and copyright.
+ *
+ * Returns NULL on error.
+ */
+unsigned char * puz_meta_title_get(struct puz_meta_t *meta, int row) {
+  if(NULL == meta || row < 0 || row >= meta->n)
+    return NULL;
+
+  return meta->strings + meta->title[row];
+}
+
+/**
+ * puz_meta_author_get - a row's author
+ *
+ * @meta: the table (required)
+ * @row: the row
+ *
+ * Returns NULL on error.
+ */
+unsigned char * puz_meta_author_get(struct puz_meta_t *meta, int row) {
+  if(NULL == meta || row < 0 || row >= meta->n)
+    return NULL;
+
+  return meta->strings + meta->author[row];
+}
+
+/**
+ * puz_meta_copyright_get - a row's copyright
+ *
+ * @meta: the table (required)
+ * @row: the row
+ *
+ * Returns NULL on error.
+ */
+unsigned char * puz_meta_copyright_get(struct puz_meta_t *meta, int row) {
+  if(NULL == meta || row < 0 || row >= meta->n)
+    return NULL;
+
+  return meta->strings + meta->copyright[row];
+}
+
+/**
+ * puz_meta_query_init - a query that selects every row
+ *
+ * @q: the query to set (required)
+ *
+ * Narrow it by setting the fields of interest.
+ */
+void puz_meta_query_init(struct puz_meta_query_t *q) {
+  if(NULL == q)
+    return;
+
+  q->width_min = 0;
+  q->width_max = 255;
+  q->height_min = 0;
+  q->height_max = 255;
+  q->clues_min = 0;
+  q->clues_max = 0xFFFF;
+  q->locked = -1;
+  q->cksum = -1;
+  q->sections_all = 0;
+  q->sections_none = 0;
+}
+
+/**
+ * meta_select_rows - evaluate a query over one run of rows
+ *
+ * This is an internal function, a pool task for puz_meta_select().
+ * job->first is a multiple of 64, so the run has its own words of the
+ * bitmap.
+ */
+static void meta_select_rows(void *arg) {
+  struct meta_job_t *job = (struct meta_job_t *)arg;
+  struct puz_meta_t *meta = job->meta;
+  struct puz_meta_query_t *q = job->q;
+  uint64_t *sel = job->sel + job->first / 64;
+  int i = job->first, n = job->n, w, count = 0;
+  unsigned mask;
+
+  for(w = 0; w < n / 64; w++)
+    sel[w] = ~0ULL;
+  if(n % 64)
+    sel[w] = (1ULL << (n % 64)) - 1;
+
+  if(q->width_min > 0 || q->width_max < 255)
+    puz_kernels.range8(meta->width + i, n, q->width_min, q->width_max, sel);
+  if(q->height_min > 0 || q->height_max < 255)
+    puz_kernels.range8(meta->height + i, n, q->height_min, q->height_max, sel);
+  if(q->clues_min > 0 || q->clues_max < 0xFFFF)
+    puz_kernels.range16(meta->clue_count + i, n, q->clues_min, q->clues_max,
+                        sel);
+  if(q->locked == 0)
+    puz_kernels.range16(meta->scrambled_tag + i, n, 0, 0, sel);
+  else if(q->locked > 0)
+    puz_kernels.range16(meta->scrambled_tag + i, n, 1, 0xFFFF, sel);
+  if(q->cksum >= 0)
+    puz_kernels.range16(meta->cksum_puz + i, n, q->cksum, q->cksum, sel);
+
+  mask = (q->sections_all | q->sections_none) & 0xFFFF;
+  if(mask)
+    puz_kernels.match16(meta->sections + i, n, mask, q->sections_all & mask,
+                        sel);
+
+  for(w = 0; w < (n + 63) / 64; w++)
+    count += __builtin_popcountll(sel[w]);
+  __atomic_add_fetch(job->count, count, __ATOMIC_RELAXED);
+}
+
+/**
+ * puz_meta_select - find the rows that match a query
+ *
+ * @meta: the table (required)
+ * @q: the query, from puz_meta_query_init() and narrowed (required)
+ * @sel: receives bit i%64 of word i/64 set if row i matches, and the
+ *   bits past the last row clear.  (puz_meta_count() + 63) / 64 words
+ *   (required)
+ *
+ * A row matches if every field is within its range (inclusive),
+ * locked is -1 or agrees with the scrambled tag, cksum is -1 or equal,
+ * and the row has every section in sections_all and none in
+ * sections_none.  Runs on the library's thread pool when the table
+ * is big enough to be worth it.
+ *
+ * Return Value: the number of rows that match, or -1 on error.
+ */
+int puz_meta_select(struct puz_meta_t *meta, struct puz_meta_query_t *q,
+                    uint64_t *sel) {
+  struct puz_meta_query_t c;
+  struct meta_job_t *jobs, one;
+  struct puz_group_t g;
+  int i, njobs, count = 0;
+
+  if(NULL == meta || NULL == q || NULL == sel)
+    return -1;
+
+  /* clamp to what each column can hold; an empty range selects none */
+  c = *q;
+  if(c.width_min < 0) c.width_min = 0;
+  if(c.width_max > 255) c.width_max = 255;
+  if(c.height_min < 0) c.height_min = 0;
+  if(c.height_max > 255) c.height_max = 255;
+  if(c.clues_min < 0) c.clues_min = 0;
+  if(c.clues_max > 0xFFFF) c.clues_max = 0xFFFF;
+  if(c.width_min > c.width_max || c.height_min > c.height_max ||
+     c.clues_min > c.clues_max || c.cksum > 0xFFFF ||
+     (c.sections_all & c.sections_none)) {
+    memset(sel, 0, (meta->n + 63) / 64 * sizeof(uint64_t));
+    return 0;
+  }
+
+  njobs = (meta->n + META_TASK_ROWS - 1) / META_TASK_ROWS;
+  if(njobs <= 1) {
+    one.meta = meta;
+    one.q = &c;
+    one.sel = sel;
+    one.first = 0;
+    one.n = meta->n;
+    one.count = &count;
+    if(meta->n > 0)
+      meta_select_rows(&one);
+    return count;
+  }
+
+  jobs = (struct meta_job_t *)calloc(njobs, sizeof(struct meta_job_t));
+  if(NULL == jobs) {
+    perror("calloc");
+    return -1;
+  }
+
+  puz_group_init(&g);
+  for(i = 0; i < njobs; i++) {
+    jobs[i].meta = meta;
+    jobs[i].q = &c;
+    jobs[i].sel = sel;
+    jobs[i].first = i * META_TASK_ROWS;
+    jobs[i].n = i == njobs - 1 ? meta->n - jobs[i].first : META_TASK_ROWS;
+    jobs[i].count = &count;
+    if(i > 0)
+      puz_group_spawn(&g, meta_select_rows, &jobs[i]);
+  }
+  meta_select_rows(&jobs[0]);
+  puz_group_wait(&g);
+
+  free(jobs);
+
+  return count;
+}
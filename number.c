@@ -0,0 +1,303 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * number.c -- Clue numbering and black-square edits
+ */
+
+#include <puz.h>
+
+/*
+  Toggling one square can only change which words start on a handful
+  of squares: the square itself, the squares after it across and
+  down, and the first squares of the runs it sits in.  Every other
+  word keeps its first square, and so its clue.  So a toggle works
+  out which of those (square, direction) keys stop or start being
+  words, removes and inserts exactly those entries in clues[], and
+  leaves every other clue pointer where it was, just shifted.
+ */
+
+#define NUMBER_MAX_KEYS 6
+
+struct number_key_t {
+  int row, col, dir;
+  int was, is;
+};
+
+static int run_start(const uint64_t *line, int pos);
+static int number_keys(struct puz_bitboard_t *bb, int row, int col,
+                       struct number_key_t *keys);
+
+/**
+ * run_start - find the first square of the run through a square
+ *
+ * @line: a bitboard row or column
+ * @pos: the square, taken as white
+ *
+ * This is an internal function.  It returns the square after the
+ * nearest black square before @pos, or 0 if there is none.
+ */
+static int run_start(const uint64_t *line, int pos) {
+  uint64_t m;
+  int i;
+
+  for(i = pos / 64; i >= 0; i--) {
+    m = line[i];
+    if(i == pos / 64)
+      m &= (1ULL << (pos % 64)) - 1;
+    if(m)
+      return i * 64 + 64 - __builtin_clzll(m);
+  }
+
+  return 0;
+}
+
+/**
+ * number_keys - list the words a toggle of (row,col) can create or destroy
+ *
+ * @bb: the bitboard, before the toggle
+ * @row: row of the square
+ * @col: column of the square
+ * @keys: NUMBER_MAX_KEYS entries to fill in, in clue order
+ *
+ * This is an internal function.
+ *
+ * Return Value: the number of keys.
+ */
+static int number_keys(struct puz_bitboard_t *bb, int row, int col,
+                       struct number_key_t *keys) {
+  struct number_key_t k;
+  int n = 0, i, j, s;
+
+  /* first square of the across run through (row,col), if it were white */
+  s = run_start(bb->rows[row], col);
+  keys[n].row = row; keys[n].col = s; keys[n++].dir = 0;
+  if(s != col) {
+    keys[n].row = row; keys[n].col = col; keys[n++].dir = 0;
+  }
+  if(col + 1 < bb->width) {
+    keys[n].row = row; keys[n].col = col + 1; keys[n++].dir = 0;
+  }
+
+  s = run_start(bb->cols[col], row);
+  keys[n].row = s; keys[n].col = col; keys[n++].dir = 1;
+  if(s != row) {
+    keys[n].row = row; keys[n].col = col; keys[n++].dir = 1;
+  }
+  if(row + 1 < bb->height) {
+    keys[n].row = row + 1; keys[n].col = col; keys[n++].dir = 1;
+  }
+
+  /* insertion sort into clue order */
+  for(i = 1; i < n; i++) {
+    k = keys[i];
+    for(j = i; j > 0; j--) {
+      struct number_key_t *p = &keys[j-1];
+      if(p->row < k.row || (p->row == k.row && (p->col < k.col ||
+         (p->col == k.col && p->dir < k.dir))))
+        break;
+      keys[j] = *p;
+    }
+    keys[j] = k;
+  }
+
+  for(i = 0; i < n; i++)
+    keys[i].was = puz_bitboard_is_start(bb, keys[i].row, keys[i].col,
+                                        keys[i].dir);
+
+  return n;
+}
+
+/**
+ * puz_square_toggle - make a white square black, or a black one white
+ *
+ * @puz: the puzzle to edit; its solution must be set (required)
+ * @row: row of the square
+ * @col: column of the square
+ * @letter: the solution letter for a square turning white; ignored
+ *   for a square turning black
+ *
+ * The solution, grid and bitboard are updated, and the clues are
+ * renumbered: words that still start on the same square keep their
+ * clue strings (the pointers are moved, the text is never copied),
+ * clues of words that no longer exist are freed, and new words get
+ * empty clues.  clues[] stays in the order the binary format needs.
+ *
+ * The clues must match the grid beforehand, as they do for any
+ * well-formed puzzle; puz_validate() checks this.  This is not
+ * rechecked here, since it would mean counting the whole board.  Rebus, circle and
+ * solver state on a square turning black are cleared.
+ *
+ * Return Value: -1 on error, else the new clue count.
+ */
+int puz_square_toggle(struct puzzle_t *puz, int row, int col,
+                      unsigned char letter) {
+  struct puz_bitboard_t *bb;
+  struct number_key_t keys[NUMBER_MAX_KEYS];
+  unsigned char *fresh[NUMBER_MAX_KEYS];
+  int idx[NUMBER_MAX_KEYS];
+  unsigned char **clues;
+  int n, i, black, sq, count, r0, base, add = 0, del = 0;
+
+  if(NULL == puz || NULL == puz->solution || NULL == puz->grid)
+    return -1;
+
+  bb = puz_bitboard_get(puz);
+  black = puz_bitboard_black_get(bb, row, col);
+  if(black < 0)
+    return -1;
+  if(black && (letter == '.' || letter == 0))
+    return -1;
+
+  count = puz->header.clue_count;
+  n = number_keys(bb, row, col, keys);
+
+  /*
+    Only words starting in the rows either side of the square can
+    appear or disappear, and the words above those rows are the same
+    before and after, so they are counted once and only the rows from
+    r0 on are counted per key.
+   */
+  r0 = row > 0 ? row - 1 : 0;
+  base = puz_bitboard_slot_range(bb, 0, r0, 0, 0);
+
+  /* see which keys change, so only those need positions */
+  puz_bitboard_black_set(bb, row, col, !black);
+  for(i = 0; i < n; i++)
+    keys[i].is = puz_bitboard_is_start(bb, keys[i].row, keys[i].col,
+                                       keys[i].dir);
+  puz_bitboard_black_set(bb, row, col, black);
+
+  /* old positions of the words going away, while the board is old */
+  for(i = 0; i < n; i++) {
+    fresh[i] = NULL;
+    if(keys[i].was && !keys[i].is) {
+      idx[i] = base + puz_bitboard_slot_range(bb, r0, keys[i].row, keys[i].col,
+                                              keys[i].dir);
+      if(idx[i] >= count)
+        return -1;
+      del++;
+    }
+  }
+
+  puz_bitboard_black_set(bb, row, col, !black);
+
+  for(i = 0; i < n; i++) {
+    if(keys[i].is && !keys[i].was) {
+      idx[i] = base + puz_bitboard_slot_range(bb, r0, keys[i].row, keys[i].col,
+                                              keys[i].dir);
+      fresh[i] = (unsigned char *)calloc(1, 1);
+      if(NULL == fresh[i]) {
+        perror("calloc");
+        goto fail;
+      }
+      add++;
+    }
+  }
+
+  /* a clue count that doesn't match the grid would take us out of bounds */
+  for(i = 0; i < n; i++) {
+    if(fresh[i] && idx[i] > count - del + add - 1)
+      goto fail;
+  }
+
+  if(add > del) {
+    clues = (unsigned char **)realloc(puz->clues, (count - del + add) *
+                                      sizeof(unsigned char *));
+    if(NULL == clues) {
+      perror("realloc");
+      goto fail;
+    }
+    puz->clues = clues;
+  }
+
+  /* nothing can fail from here on */
+  puz_utf8_clear(puz);
+  sq = row * bb->width + col;
+  if(!black) {
+    /* blank the square first, so the progress counts stay right */
+    if(puz->rusr && puz->rusr[sq])
+      puz_rusr_cell_set(puz, sq, NULL);
+    puz_cell_set(puz, sq, '-');
+    if(puz->grbs)
+      puz->grbs[sq] = 0;
+    if(puz->gext)
+      puz->gext[sq] = 0;
+    puz->solution[sq] = puz->grid[sq] = '.';
+    puz->cells_total--;
+  } else {
+    puz->solution[sq] = letter;
+    puz->grid[sq] = '-';
+    puz->cells_total++;
+  }
+
+  /* remove last to first, so the earlier old positions hold */
+  for(i = n - 1; i >= 0; i--) {
+    if(keys[i].was && !keys[i].is) {
+      free(puz->clues[idx[i]]);
+      memmove(puz->clues + idx[i], puz->clues + idx[i] + 1,
+              (count - idx[i] - 1) * sizeof(unsigned char *));
+      count--;
+    }
+  }
+
+  /* insert first to last at their new positions */
+  for(i = 0; i < n; i++) {
+    if(fresh[i]) {
+      memmove(puz->clues + idx[i] + 1, puz->clues + idx[i],
+              (count - idx[i]) * sizeof(unsigned char *));
+      puz->clues[idx[i]] = fresh[i];
+      count++;
+    }
+  }
+
+  puz->header.clue_count = count;
+
+  return count;
+
+ fail:
+  for(i = 0; i < n; i++)
+    free(fresh[i]);
+  puz_bitboard_black_set(bb, row, col, black);
+
+  return -1;
+}
+
+/**
+ * puz_clue_index_get - find the clue for a word
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ * @row: row of the word's first square
+ * @col: column of the word's first square
+ * @dir: 0 for across, 1 for down
+ *
+ * Returns -1 on error or if no word starts there in that direction;
+ * else the index of the word's clue, for puz_clue_get().
+ */
+int puz_clue_index_get(struct puzzle_t *puz, int row, int col, int dir) {
+  struct puz_bitboard_t *bb = puz_bitboard_get(puz);
+
+  if(NULL == bb || !puz_bitboard_is_start(bb, row, col, dir))
+    return -1;
+
+  return puz_bitboard_slot_index(bb, row, col, dir);
+}
+
+/**
+ * puz_square_number_get - get the clue number printed in a square
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ * @row: row of the square
+ * @col: column of the square
+ *
+ * Returns -1 on error, 0 if the square isn't numbered, else its number.
+ */
+int puz_square_number_get(struct puzzle_t *puz, int row, int col) {
+  return puz_bitboard_square_number(puz_bitboard_get(puz), row, col);
+}
@@ -0,0 +1,371 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * pack.c -- Boards packed 5 bits a square, for big resident caches
+ */
+
+#include <puz.h>
+
+/*
+  A solution or grid is almost all letters, '.' and '-', which is 28
+  values, so 5 bits a square holds a board in 5/8 the bytes.  A packed
+  board is:
+
+    byte 0      width
+    byte 1      height
+    bytes 2-3   how many squares are escaped, little-endian
+    then        the squares, 5 bits each, least significant first
+                ((5 * width * height + 7) / 8 bytes)
+    then        3 bytes per escaped square, in square order: its
+                index, little-endian, and the byte itself
+
+  A square that isn't a capital letter, '.' or '-' (a lowercase
+  pencil mark, a digit or symbol in a rebus-style grid, a stray byte
+  from a damaged file) gets the code PUZ_PACK_ESCAPE and its byte goes
+  in the list at the end, so any board packs and unpacks exactly.
+  Normal boards have no escapes, and a 15x15 one is 145 bytes to the
+  225 of the plain board.
+
+  Whole boards go through puz_kernels.pack5 and unpack5, 32 squares a
+  step.  Single squares, rows and columns are read straight from the
+  packed form without unpacking the rest.
+ */
+
+#define PACK_ESC_SZ 3
+
+/* what each code unpacks to; escapes are patched in afterwards */
+static const unsigned char pack_chars[33] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ.-????";
+
+static int pack_bits_sz(int width, int height);
+static int pack_esc_find(const unsigned char *pk, int idx);
+static unsigned int pack_code_get(const unsigned char *bits, int idx);
+
+/**
+ * pack_bits_sz - how many bytes the squares of a board take
+ *
+ * @width: its width
+ * @height: its height
+ *
+ * This is an internal function.
+ *
+ * Return Value: the size in bytes.
+ */
+static int pack_bits_sz(int width, int height) {
+  return (5 * width * height + 7) / 8;
+}
+
+/**
+ * pack_code_get - the 5-bit code of one square
+ *
+ * @bits: the packed squares
+ * @idx: which square
+ *
+ * This is an internal function.  It never reads past the byte that
+ * holds the last bit of the square.
+ *
+ * Return Value: the code.
+ */
+static unsigned int pack_code_get(const unsigned char *bits, int idx) {
+  int bit = 5 * idx;
+  unsigned int v = bits[bit >> 3];
+
+  if((bit & 7) > 3)
+    v |= bits[(bit >> 3) + 1] << 8;
+
+  return (v >> (bit & 7)) & 31;
+}
+
+/**
+ * pack_esc_find - find the first escape at or after a square
+ *
+ * @pk: the packed board
+ * @idx: the square
+ *
+ * This is an internal function.
+ *
+ * Return Value: the position of that escape in the list, or the
+ * number of escapes if there's none.
+ */
+static int pack_esc_find(const unsigned char *pk, int idx) {
+  const unsigned char *esc = pk + PUZ_PACK_HEAD +
+    pack_bits_sz(pk[0], pk[1]);
+  int lo = 0, hi = pk[2] | pk[3] << 8, mid;
+
+  while(lo < hi) {
+    mid = (lo + hi) / 2;
+    if((esc[mid * PACK_ESC_SZ] | esc[mid * PACK_ESC_SZ + 1] << 8) < idx)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+/**
+ * puz_pack_size - how big a board will be when packed
+ *
+ * @board: the board, width * height squares (a solution or grid)
+ * @width: its width
+ * @height: its height
+ *
+ * Return Value: the number of bytes puz_pack() needs, or -1 if the
+ * board is too big to pack.
+ */
+int puz_pack_size(const unsigned char *board, int width, int height) {
+  int i, n, esc = 0;
+
+  if(NULL == board || width < 0 || width > 255 || height < 0 || height > 255)
+    return -1;
+
+  n = width * height;
+  for(i = 0; i < n; i++)
+    esc += !((unsigned char)(board[i] - 'A') < 26 ||
+             board[i] == '.' || board[i] == '-');
+
+  return PUZ_PACK_HEAD + pack_bits_sz(width, height) + PACK_ESC_SZ * esc;
+}
+
+/**
+ * puz_pack - pack a board 5 bits a square
+ *
+ * @board: the board, width * height squares (a solution or grid)
+ * @width: its width
+ * @height: its height
+ * @out: where to write the packed board
+ * @sz: how big out is; puz_pack_size() says how big it must be
+ *
+ * Return Value: the number of bytes written, or -1 if out is too
+ * small (in which case what's in it is garbage) or the board too big.
+ */
+int puz_pack(const unsigned char *board, int width, int height,
+             unsigned char *out, int sz) {
+  unsigned char *esc;
+  int i, n, bits_sz, nesc;
+
+  if(NULL == board || NULL == out || width < 0 || width > 255 ||
+     height < 0 || height > 255)
+    return -1;
+
+  n = width * height;
+  bits_sz = pack_bits_sz(width, height);
+  if(sz < PUZ_PACK_HEAD + bits_sz)
+    return -1;
+
+  nesc = puz_kernels.pack5(board, n, out + PUZ_PACK_HEAD);
+  if(sz < PUZ_PACK_HEAD + bits_sz + PACK_ESC_SZ * nesc)
+    return -1;
+
+  out[0] = width;
+  out[1] = height;
+  out[2] = nesc & 0xFF;
+  out[3] = nesc >> 8;
+
+  esc = out + PUZ_PACK_HEAD + bits_sz;
+  for(i = 0; nesc && i < n; i++) {
+    if(pack_code_get(out + PUZ_PACK_HEAD, i) != PUZ_PACK_ESCAPE)
+      continue;
+    esc[0] = i & 0xFF;
+    esc[1] = i >> 8;
+    esc[2] = board[i];
+    esc += PACK_ESC_SZ;
+  }
+
+  return esc - out;
+}
+
+/**
+ * puz_pack_length - how many bytes a packed board takes up
+ *
+ * @pk: the packed board
+ * @sz: how many bytes are there to look at
+ *
+ * For stepping over a packed board in a larger buffer.
+ *
+ * Return Value: its length, or -1 if sz is too short to hold it.
+ */
+int puz_pack_length(const unsigned char *pk, int sz) {
+  int len;
+
+  if(NULL == pk || sz < PUZ_PACK_HEAD)
+    return -1;
+
+  len = PUZ_PACK_HEAD + pack_bits_sz(pk[0], pk[1]) +
+    PACK_ESC_SZ * (pk[2] | pk[3] << 8);
+
+  return len > sz ? -1 : len;
+}
+
+/**
+ * puz_unpack - unpack a whole board
+ *
+ * @pk: the packed board
+ * @sz: how many bytes of it there are
+ * @board: receives width * height squares (no NUL is added)
+ *
+ * The packed board is checked for consistency first, so it's safe to
+ * hand this one that came off the disk or the network.
+ *
+ * Return Value: the number of squares, or -1 if pk isn't a packed
+ * board.
+ */
+int puz_unpack(const unsigned char *pk, int sz, unsigned char *board) {
+  const unsigned char *esc;
+  int i, n, nesc, idx, last = -1;
+
+  if(NULL == pk || NULL == board || sz < PUZ_PACK_HEAD)
+    return -1;
+
+  n = pk[0] * pk[1];
+  nesc = pk[2] | pk[3] << 8;
+  if(sz < PUZ_PACK_HEAD + pack_bits_sz(pk[0], pk[1]) + PACK_ESC_SZ * nesc)
+    return -1;
+
+  esc = pk + PUZ_PACK_HEAD + pack_bits_sz(pk[0], pk[1]);
+  for(i = 0; i < nesc; i++) {
+    idx = esc[i * PACK_ESC_SZ] | esc[i * PACK_ESC_SZ + 1] << 8;
+    if(idx <= last || idx >= n ||
+       pack_code_get(pk + PUZ_PACK_HEAD, idx) != PUZ_PACK_ESCAPE)
+      return -1;
+    last = idx;
+  }
+
+  puz_kernels.unpack5(pk + PUZ_PACK_HEAD, n, board);
+  for(i = 0; i < nesc; i++)
+    board[esc[i * PACK_ESC_SZ] | esc[i * PACK_ESC_SZ + 1] << 8] =
+      esc[i * PACK_ESC_SZ + 2];
+
+  return n;
+}
+
+/**
+ * puz_pack_width - the width of a packed board
+ *
+ * @pk: the packed board
+ *
+ * Return Value: the width.
+ */
+int puz_pack_width(const unsigned char *pk) {
+  return pk[0];
+}
+
+/**
+ * puz_pack_height - the height of a packed board
+ *
+ * @pk: the packed board
+ *
+ * Return Value: the height.
+ */
+int puz_pack_height(const unsigned char *pk) {
+  return pk[1];
+}
+
+/**
+ * puz_pack_cell_get - read one square of a packed board
+ *
+ * @pk: the packed board, from puz_pack() or checked by puz_unpack()
+ * @row: its row
+ * @col: its column
+ *
+ * Return Value: the byte in the square, or -1 if it's off the board.
+ */
+int puz_pack_cell_get(const unsigned char *pk, int row, int col) {
+  unsigned int code;
+  int idx, e;
+
+  if(row < 0 || row >= pk[1] || col < 0 || col >= pk[0])
+    return -1;
+
+  idx = row * pk[0] + col;
+  code = pack_code_get(pk + PUZ_PACK_HEAD, idx);
+  if(code != PUZ_PACK_ESCAPE)
+    return pack_chars[code];
+
+  e = pack_esc_find(pk, idx);
+  return pk[PUZ_PACK_HEAD + pack_bits_sz(pk[0], pk[1]) +
+            e * PACK_ESC_SZ + 2];
+}
+
+/**
+ * puz_pack_is_black - is a square of a packed board black?
+ *
+ * @pk: the packed board, from puz_pack() or checked by puz_unpack()
+ * @row: its row
+ * @col: its column
+ *
+ * Return Value: 1 if black, 0 if not, -1 if it's off the board.
+ */
+int puz_pack_is_black(const unsigned char *pk, int row, int col) {
+  if(row < 0 || row >= pk[1] || col < 0 || col >= pk[0])
+    return -1;
+
+  return pack_code_get(pk + PUZ_PACK_HEAD, row * pk[0] + col) ==
+    PUZ_PACK_BLACK;
+}
+
+/**
+ * puz_pack_row_get - read one row of a packed board
+ *
+ * @pk: the packed board, from puz_pack() or checked by puz_unpack()
+ * @row: which row
+ * @out: receives width squares (no NUL is added)
+ *
+ * Return Value: the number of squares, or -1 if there's no such row.
+ */
+int puz_pack_row_get(const unsigned char *pk, int row, unsigned char *out) {
+  const unsigned char *esc;
+  int i, e, nesc, idx, first;
+
+  if(NULL == out || row < 0 || row >= pk[1])
+    return -1;
+
+  /* rows of 8k squares start on a byte, and unpack whole */
+  first = row * pk[0];
+  if(!(first & 7)) {
+    puz_kernels.unpack5(pk + PUZ_PACK_HEAD + first / 8 * 5, pk[0], out);
+  } else {
+    for(i = 0; i < pk[0]; i++)
+      out[i] = pack_chars[pack_code_get(pk + PUZ_PACK_HEAD, first + i)];
+  }
+
+  esc = pk + PUZ_PACK_HEAD + pack_bits_sz(pk[0], pk[1]);
+  nesc = pk[2] | pk[3] << 8;
+  for(e = pack_esc_find(pk, first); e < nesc; e++) {
+    idx = esc[e * PACK_ESC_SZ] | esc[e * PACK_ESC_SZ + 1] << 8;
+    if(idx >= first + pk[0])
+      break;
+    out[idx - first] = esc[e * PACK_ESC_SZ + 2];
+  }
+
+  return pk[0];
+}
+
+/**
+ * puz_pack_col_get - read one column of a packed board
+ *
+ * @pk: the packed board, from puz_pack() or checked by puz_unpack()
+ * @col: which column
+ * @out: receives height squares (no NUL is added)
+ *
+ * Return Value: the number of squares, or -1 if there's no such
+ * column.
+ */
+int puz_pack_col_get(const unsigned char *pk, int col, unsigned char *out) {
+  int i;
+
+  if(NULL == out || col < 0 || col >= pk[0])
+    return -1;
+
+  for(i = 0; i < pk[1]; i++)
+    out[i] = puz_pack_cell_get(pk, i, col);
+
+  return pk[1];
+}
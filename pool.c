@@ -0,0 +1,589 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * pool.c -- One work-stealing thread pool for every bulk operation
+ */
+
+#include <puz.h>
+
+#include <pthread.h>
+#include <sched.h>
+
+/*
+  Checking, filling, loading text dumps, repairing files and
+  brute-force unlocking all want every core.  If each started its own
+  threads, two of them at once (or one inside another's callback)
+  would oversubscribe the machine; so they all spawn tasks here
+  instead, onto one set of workers started on first use.
+
+  Each worker has its own deque of tasks.  It pushes and pops at the
+  back, so what it spawned last runs first, while it's still in
+  cache; an idle worker steals from the front of a random victim's
+  deque, which takes the oldest, and usually largest, piece of work.
+  Tasks spawned from a thread that isn't a worker go on a shared
+  injection queue.  A worker that finds nothing anywhere parks on a
+  condition variable until something is spawned.
+
+  Tasks belong to a struct puz_group_t.  puz_group_wait() doesn't
+  just block: the waiting thread runs tasks too (its own group's or
+  anyone's) until the group is done.  That is what lets the calling
+  thread work alongside the pool, as the bulk functions always had it
+  do, and what keeps a bulk function called from inside a task from
+  deadlocking a pool whose workers are all waiting.  A cancelled
+  group's tasks that haven't started are dropped; those already
+  running can watch puz_group_cancelled() and stop early.
+
+  The pool has one fewer worker than there are CPUs, since the thread
+  that waits works too.  PUZ_THREADS in the environment, or
+  puz_pool_threads_set(), changes that.
+ */
+
+struct pool_task_t {
+  void (*fn)(void *arg);
+  void *arg;
+  struct puz_group_t *group;
+};
+
+/* a ring of tasks; the owner works the back, thieves the front */
+struct pool_deque_t {
+  pthread_mutex_t lock;
+  struct pool_task_t *ring;
+  int cap;
+  int head;
+  int n;
+};
+
+struct pool_worker_t {
+  struct puz_pool_t *pool;
+  struct pool_deque_t dq;
+  pthread_t tid;
+  uint32_t rng;
+};
+
+struct puz_pool_t {
+  int nworkers;
+  struct pool_worker_t *workers;
+  struct pool_deque_t inject;
+
+  /* parking: epoch changes whenever there may be something to do */
+  pthread_mutex_t park_lock;
+  pthread_cond_t park;
+  unsigned int epoch;
+  int sleepers;
+  int quit;
+};
+
+static pthread_mutex_t pool_start_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct puz_pool_t *pool_cur;
+static int pool_want = -1;
+
+static __thread struct pool_worker_t *pool_self;
+
+static int pool_default_threads(void);
+static struct puz_pool_t *pool_get(void);
+static int deque_init(struct pool_deque_t *dq);
+static void deque_free(struct pool_deque_t *dq);
+static int deque_push(struct pool_deque_t *dq, struct pool_task_t *t);
+static int deque_pop(struct pool_deque_t *dq, struct pool_task_t *t);
+static int deque_steal(struct pool_deque_t *dq, struct pool_task_t *t);
+static int pool_find(struct puz_pool_t *pool, struct pool_task_t *t);
+static void pool_run(struct puz_pool_t *pool, struct pool_task_t *t);
+static void pool_wake(struct puz_pool_t *pool, int all);
+static void pool_park(struct puz_pool_t *pool, unsigned int epoch);
+static void *pool_worker(void *arg);
+
+/**
+ * deque_init - set up an empty deque
+ *
+ * This is an internal function.  Returns 0, or -1 if out of memory.
+ */
+static int deque_init(struct pool_deque_t *dq) {
+  memset(dq, 0, sizeof(struct pool_deque_t));
+  dq->cap = 64;
+  dq->ring = (struct pool_task_t *)malloc(dq->cap * sizeof(struct pool_task_t));
+  if(NULL == dq->ring) {
+    perror("malloc");
+    return -1;
+  }
+  pthread_mutex_init(&dq->lock, NULL);
+
+  return 0;
+}
+
+/**
+ * deque_free - free a deque's ring
+ *
+ * This is an internal function.
+ */
+static void deque_free(struct pool_deque_t *dq) {
+  if(NULL == dq->ring)
+    return;
+  pthread_mutex_destroy(&dq->lock);
+  free(dq->ring);
+  dq->ring = NULL;
+}
+
+/**
+ * deque_push - add a task at the back
+ *
+ * This is an internal function.  Returns 0, or -1 if the ring was
+ * full and couldn't grow.
+ */
+static int deque_push(struct pool_deque_t *dq, struct pool_task_t *t) {
+  struct pool_task_t *ring;
+  int i, cap;
+
+  pthread_mutex_lock(&dq->lock);
+
+  if(dq->n == dq->cap) {
+    cap = dq->cap * 2;
+    ring = (struct pool_task_t *)malloc(cap * sizeof(struct pool_task_t));
+    if(NULL == ring) {
+      pthread_mutex_unlock(&dq->lock);
+      perror("malloc");
+      return -1;
+    }
+    for(i = 0; i < dq->n; i++)
+      ring[i] = dq->ring[(dq->head + i) % dq->cap];
+    free(dq->ring);
+    dq->ring = ring;
+    dq->cap = cap;
+    dq->head = 0;
+  }
+
+  dq->ring[(dq->head + dq->n) % dq->cap] = *t;
+  __atomic_store_n(&dq->n, dq->n + 1, __ATOMIC_RELAXED);
+
+  pthread_mutex_unlock(&dq->lock);
+
+  return 0;
+}
+
+/**
+ * deque_pop - take the newest task, from the back
+ *
+ * This is an internal function.  Returns 1 if there was one.
+ */
+static int deque_pop(struct pool_deque_t *dq, struct pool_task_t *t) {
+  int found = 0;
+
+  if(0 == __atomic_load_n(&dq->n, __ATOMIC_RELAXED))
+    return 0;
+
+  pthread_mutex_lock(&dq->lock);
+  if(dq->n > 0) {
+    __atomic_store_n(&dq->n, dq->n - 1, __ATOMIC_RELAXED);
+    *t = dq->ring[(dq->head + dq->n) % dq->cap];
+    found = 1;
+  }
+  pthread_mutex_unlock(&dq->lock);
+
+  return found;
+}
+
+/**
+ * deque_steal - take the oldest task, from the front
+ *
+ * This is an internal function.  Returns 1 if there was one.
+ */
+static int deque_steal(struct pool_deque_t *dq, struct pool_task_t *t) {
+  int found = 0;
+
+  /* a peek without the lock, so empty victims cost nothing */
+  if(0 == __atomic_load_n(&dq->n, __ATOMIC_RELAXED))
+    return 0;
+
+  pthread_mutex_lock(&dq->lock);
+  if(dq->n > 0) {
+    *t = dq->ring[dq->head];
+    dq->head = (dq->head + 1) % dq->cap;
+    __atomic_store_n(&dq->n, dq->n - 1, __ATOMIC_RELAXED);
+    found = 1;
+  }
+  pthread_mutex_unlock(&dq->lock);
+
+  return found;
+}
+
+/**
+ * pool_find - find something to run
+ *
+ * @pool: the pool
+ * @t: receives the task
+ *
+ * This is an internal function.  A worker looks in its own deque
+ * first; then everyone tries the injection queue, then the other
+ * workers' deques, starting from a random one.
+ *
+ * Return Value: 1 if a task was found, else 0.
+ */
+static int pool_find(struct puz_pool_t *pool, struct pool_task_t *t) {
+  struct pool_worker_t *self = pool_self;
+  static __thread uint32_t seed = 0x9E3779B9;
+  uint32_t *rng = self ? &self->rng : &seed;
+  int i, v, n = __atomic_load_n(&pool->nworkers, __ATOMIC_ACQUIRE);
+
+  if(self && deque_pop(&self->dq, t))
+    return 1;
+  if(deque_steal(&pool->inject, t))
+    return 1;
+  if(0 == n)
+    return 0;
+
+  *rng ^= *rng << 13;
+  *rng ^= *rng >> 17;
+  *rng ^= *rng << 5;
+  v = *rng % n;
+  for(i = 0; i < n; i++, v = (v + 1) % n) {
+    if(&pool->workers[v] != self && deque_steal(&pool->workers[v].dq, t))
+      return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * pool_wake - tell parked threads there may be something to do
+ *
+ * @pool: the pool
+ * @all: wake everyone (a group finished) rather than one (a task came)
+ *
+ * This is an internal function.  The epoch is bumped before sleepers
+ * is read, and a thread parks only after bumping sleepers and seeing
+ * the epoch it started looking at; so either we see it parked and
+ * wake it, or it sees the new epoch and doesn't park.
+ */
+static void pool_wake(struct puz_pool_t *pool, int all) {
+  __atomic_add_fetch(&pool->epoch, 1, __ATOMIC_SEQ_CST);
+  if(0 == __atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST))
+    return;
+
+  pthread_mutex_lock(&pool->park_lock);
+  if(all)
+    pthread_cond_broadcast(&pool->park);
+  else
+    pthread_cond_signal(&pool->park);
+  pthread_mutex_unlock(&pool->park_lock);
+}
+
+/**
+ * pool_park - sleep until the epoch moves on from @epoch
+ *
+ * This is an internal function.  @epoch is what the caller read
+ * before it last looked for work.
+ */
+static void pool_park(struct puz_pool_t *pool, unsigned int epoch) {
+  pthread_mutex_lock(&pool->park_lock);
+  __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+  if(__atomic_load_n(&pool->epoch, __ATOMIC_SEQ_CST) == epoch && !pool->quit)
+    pthread_cond_wait(&pool->park, &pool->park_lock);
+  __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&pool->park_lock);
+}
+
+/**
+ * pool_run - run one task and account for it
+ *
+ * This is an internal function.
+ */
+static void pool_run(struct puz_pool_t *pool, struct pool_task_t *t) {
+  struct puz_group_t *g = t->group;
+
+  if(!__atomic_load_n(&g->cancelled, __ATOMIC_RELAXED))
+    t->fn(t->arg);
+
+  if(0 == __atomic_sub_fetch(&g->pending, 1, __ATOMIC_ACQ_REL))
+    pool_wake(pool, 1);
+}
+
+/**
+ * pool_worker - thread body: run tasks, park when there are none
+ *
+ * This is an internal function.
+ */
+static void *pool_worker(void *arg) {
+  struct pool_worker_t *self = (struct pool_worker_t *)arg;
+  struct puz_pool_t *pool = self->pool;
+  struct pool_task_t t;
+  unsigned int epoch;
+  int spin = 0;
+
+  pool_self = self;
+
+  while(!__atomic_load_n(&pool->quit, __ATOMIC_RELAXED)) {
+    epoch = __atomic_load_n(&pool->epoch, __ATOMIC_SEQ_CST);
+    if(pool_find(pool, &t)) {
+      pool_run(pool, &t);
+      spin = 0;
+      continue;
+    }
+
+    /* tasks often come in bursts; look again a few times first */
+    if(++spin < 16) {
+      sched_yield();
+      continue;
+    }
+    spin = 0;
+    pool_park(pool, epoch);
+  }
+
+  return NULL;
+}
+
+/**
+ * pool_default_threads - how many workers to have if not told
+ *
+ * This is an internal function.
+ */
+static int pool_default_threads(void) {
+  char *env = getenv("PUZ_THREADS");
+  long n;
+
+  if(env && *env)
+    return atoi(env) < 0 ? 0 : atoi(env);
+
+  n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 1 ? n - 1 : 0;
+}
+
+/**
+ * pool_get - the pool, started if it isn't yet
+ *
+ * This is an internal function.
+ *
+ * Return Value: the pool, or NULL if it couldn't be set up at all.
+ */
+static struct puz_pool_t *pool_get(void) {
+  struct puz_pool_t *pool;
+  int i, n;
+
+  pool = __atomic_load_n(&pool_cur, __ATOMIC_ACQUIRE);
+  if(pool)
+    return pool;
+
+  pthread_mutex_lock(&pool_start_lock);
+  pool = pool_cur;
+  if(pool) {
+    pthread_mutex_unlock(&pool_start_lock);
+    return pool;
+  }
+
+  n = pool_want >= 0 ? pool_want : pool_default_threads();
+
+  pool = (struct puz_pool_t *)calloc(1, sizeof(struct puz_pool_t));
+  if(NULL == pool || deque_init(&pool->inject) < 0) {
+    perror("calloc");
+    free(pool);
+    pthread_mutex_unlock(&pool_start_lock);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->park_lock, NULL);
+  pthread_cond_init(&pool->park, NULL);
+
+  pool->workers = (struct pool_worker_t *)calloc(n ? n : 1,
+                                                 sizeof(struct pool_worker_t));
+  if(NULL == pool->workers) {
+    perror("calloc");
+    n = 0;
+  }
+
+  /* workers only ever look at the first nworkers, so start in order */
+  for(i = 0; i < n; i++) {
+    struct pool_worker_t *w = &pool->workers[i];
+    w->pool = pool;
+    w->rng = 0x9E3779B9u * (i + 1);
+    if(deque_init(&w->dq) < 0)
+      break;
+    if(0 != pthread_create(&w->tid, NULL, pool_worker, w)) {
+      perror("pthread_create");
+      deque_free(&w->dq);
+      break;
+    }
+    __atomic_store_n(&pool->nworkers, i + 1, __ATOMIC_RELEASE);
+  }
+
+  __atomic_store_n(&pool_cur, pool, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&pool_start_lock);
+
+  return pool;
+}
+
+/**
+ * puz_pool_threads_set - set how many worker threads the pool has
+ *
+ * @n: the number of workers; 0 means none, so that everything runs
+ *   on the threads that wait for it, and less than 0 means the
+ *   default (PUZ_THREADS, else one fewer than the online CPUs)
+ *
+ * If the pool is running it is shut down first, and restarted at the
+ * new size on next use; see puz_pool_shutdown().
+ *
+ * Return Value: the number of workers the pool will have.
+ */
+int puz_pool_threads_set(int n) {
+  puz_pool_shutdown();
+
+  pthread_mutex_lock(&pool_start_lock);
+  pool_want = n;
+  if(n < 0)
+    n = pool_default_threads();
+  pthread_mutex_unlock(&pool_start_lock);
+
+  return n;
+}
+
+/**
+ * puz_pool_threads_get - how many worker threads the pool has
+ *
+ * The thread waiting on a group works as well, so a bulk operation
+ * with nthreads 0 runs this many plus one tasks side by side.
+ *
+ * Return Value: the number of workers, starting the pool if needed.
+ */
+int puz_pool_threads_get(void) {
+  struct puz_pool_t *pool = pool_get();
+
+  return pool ? __atomic_load_n(&pool->nworkers, __ATOMIC_ACQUIRE) : 0;
+}
+
+/**
+ * puz_pool_shutdown - stop the pool's threads
+ *
+ * Nothing may be running on the pool, or waiting on it.  The pool
+ * starts again on next use.
+ */
+void puz_pool_shutdown(void) {
+  struct puz_pool_t *pool;
+  int i;
+
+  pthread_mutex_lock(&pool_start_lock);
+  pool = pool_cur;
+  __atomic_store_n(&pool_cur, NULL, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&pool_start_lock);
+
+  if(NULL == pool)
+    return;
+
+  pthread_mutex_lock(&pool->park_lock);
+  __atomic_store_n(&pool->quit, 1, __ATOMIC_SEQ_CST);
+  pthread_cond_broadcast(&pool->park);
+  pthread_mutex_unlock(&pool->park_lock);
+
+  for(i = 0; i < pool->nworkers; i++) {
+    pthread_join(pool->workers[i].tid, NULL);
+    deque_free(&pool->workers[i].dq);
+  }
+
+  free(pool->workers);
+  deque_free(&pool->inject);
+  pthread_cond_destroy(&pool->park);
+  pthread_mutex_destroy(&pool->park_lock);
+  free(pool);
+}
+
+/**
+ * puz_group_init - start an empty task group
+ *
+ * @g: the group (required)
+ */
+void puz_group_init(struct puz_group_t *g) {
+  memset(g, 0, sizeof(struct puz_group_t));
+}
+
+/**
+ * puz_group_spawn - run a task on the pool
+ *
+ * @g: the group it belongs to (required)
+ * @fn: the task
+ * @arg: passed to @fn
+ *
+ * The task may run on any thread, including the one that later calls
+ * puz_group_wait(), and may itself spawn and wait.  If the pool can't
+ * take it, it runs now, on this thread.
+ */
+void puz_group_spawn(struct puz_group_t *g, void (*fn)(void *arg), void *arg) {
+  struct puz_pool_t *pool = pool_get();
+  struct pool_task_t t;
+
+  if(__atomic_load_n(&g->cancelled, __ATOMIC_RELAXED))
+    return;
+
+  t.fn = fn;
+  t.arg = arg;
+  t.group = g;
+
+  __atomic_add_fetch(&g->pending, 1, __ATOMIC_RELAXED);
+  if(NULL == pool) {
+    __atomic_sub_fetch(&g->pending, 1, __ATOMIC_RELAXED);
+    fn(arg);
+    return;
+  }
+
+  if(deque_push(pool_self && pool_self->pool == pool ?
+                &pool_self->dq : &pool->inject, &t) < 0) {
+    pool_run(pool, &t);
+    return;
+  }
+
+  pool_wake(pool, 0);
+}
+
+/**
+ * puz_group_wait - run tasks until a group has finished
+ *
+ * @g: the group (required)
+ *
+ * Every task spawned in the group has run (or been dropped, if the
+ * group was cancelled) by the time this returns.
+ */
+void puz_group_wait(struct puz_group_t *g) {
+  struct puz_pool_t *pool = pool_get();
+  struct pool_task_t t;
+  unsigned int epoch;
+
+  if(NULL == pool)
+    return;
+
+  while(__atomic_load_n(&g->pending, __ATOMIC_ACQUIRE) > 0) {
+    epoch = __atomic_load_n(&pool->epoch, __ATOMIC_SEQ_CST);
+    if(pool_find(pool, &t)) {
+      pool_run(pool, &t);
+      continue;
+    }
+
+    /* the rest are running elsewhere; sleep until they're done or
+       something turns up to help with */
+    if(__atomic_load_n(&g->pending, __ATOMIC_SEQ_CST) > 0)
+      pool_park(pool, epoch);
+  }
+}
+
+/**
+ * puz_group_cancel - stop a group's tasks from starting
+ *
+ * @g: the group (required)
+ *
+ * Tasks already running carry on unless they check
+ * puz_group_cancelled().  Still wait for the group afterwards.
+ */
+void puz_group_cancel(struct puz_group_t *g) {
+  __atomic_store_n(&g->cancelled, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * puz_group_cancelled - has a group been cancelled?
+ *
+ * @g: the group (required)
+ *
+ * Return Value: 1 if so, else 0.
+ */
+int puz_group_cancelled(struct puz_group_t *g) {
+  return __atomic_load_n(&g->cancelled, __ATOMIC_RELAXED);
+}
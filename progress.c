@@ -0,0 +1,286 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * progress.c -- Completion state and cell-level editing
+ */
+
+#include <puz.h>
+
+static unsigned char *rtbl_answer(struct puzzle_t *puz, int key);
+static int cell_filled(struct puzzle_t *puz, int i);
+static int cell_correct(struct puzzle_t *puz, int i);
+
+/**
+ * rtbl_answer - find the rebus table entry for a GRBS key
+ *
+ * @puz: the puzzle to look in (required)
+ * @key: the key, ie: the GRBS byte minus one
+ *
+ * This is an internal function.
+ *
+ * RTBL entries are stored as "NN:ANSWER", with the key padded to
+ * two characters.
+ *
+ * Return Value: pointer to the answer part of the entry, or NULL if
+ * there is no entry for this key.
+ */
+static unsigned char *rtbl_answer(struct puzzle_t *puz, int key) {
+  int i;
+  unsigned char *colon;
+
+  for(i = 0; i < puz->rtbl_sz; i++) {
+    if(NULL == puz->rtbl[i])
+      continue;
+    colon = Sstrchr(puz->rtbl[i], ':');
+    if(NULL != colon && Satoi(puz->rtbl[i]) == key)
+      return colon + 1;
+  }
+
+  return NULL;
+}
+
+/**
+ * cell_filled - check whether the solver has entered something in a square
+ *
+ * This is an internal function.
+ */
+static int cell_filled(struct puzzle_t *puz, int i) {
+  if(puz->rusr && puz->rusr[i])
+    return 1;
+
+  return puz->grid[i] != '-' && puz->grid[i] != '.' && puz->grid[i] != 0;
+}
+
+/**
+ * cell_correct - check whether a square's entry matches the solution
+ *
+ * This is an internal function.
+ *
+ * Rebus squares are checked by comparing their RUSR entry with the
+ * RTBL answer for their GRBS key.  If the key has no table entry, we
+ * fall back to comparing the single letters in grid and solution.
+ */
+static int cell_correct(struct puzzle_t *puz, int i) {
+  unsigned char *answer;
+
+  if(puz->grbs && puz->grbs[i] && puz->rtbl) {
+    answer = rtbl_answer(puz, puz->grbs[i] - 1);
+    if(NULL != answer) {
+      if(NULL == puz->rusr || NULL == puz->rusr[i])
+        return 0;
+      return 0 == strcmp((char *)puz->rusr[i], (char *)answer);
+    }
+  }
+
+  return puz->grid[i] == puz->solution[i];
+}
+
+/**
+ * puz_progress_calc - recompute a puzzle's completion state from scratch
+ *
+ * @puz: the puzzle to recompute (required)
+ *
+ * This scans the whole board once.  It is called on load and whenever
+ * the grid, solution or rebus state is replaced wholesale; the cell
+ * editing functions keep the counts current from then on, so the
+ * progress queries are O(1).
+ *
+ * Return Value: -1 on error, 0 on success.
+ */
+int puz_progress_calc(struct puzzle_t *puz) {
+  int i, bd_sz;
+
+  if(NULL == puz)
+    return -1;
+
+  puz->cells_total = 0;
+  puz->cells_filled = 0;
+  puz->cells_correct = 0;
+
+  if(NULL == puz->solution || NULL == puz->grid)
+    return 0;
+
+  bd_sz = puz->header.width * puz->header.height;
+
+  for(i = 0; i < bd_sz; i++) {
+    if(puz->solution[i] == '.')
+      continue;
+
+    puz->cells_total++;
+    puz->cells_filled += cell_filled(puz, i);
+    puz->cells_correct += cell_correct(puz, i);
+  }
+
+  return 0;
+}
+
+/**
+ * puz_cell_set - enter a letter into one square of the grid
+ *
+ * @puz: a pointer to the struct puzzle_t to write to (required)
+ * @idx: the row-major index of the square (required)
+ * @val: the letter to enter; '-' clears the square
+ *
+ * Black squares can't be written to.
+ *
+ * Return Value: -1 on error, 0 on success.
+ */
+int puz_cell_set(struct puzzle_t *puz, int idx, unsigned char val) {
+  if(NULL == puz || NULL == puz->grid || NULL == puz->solution)
+    return -1;
+
+  if(idx < 0 || idx >= puz->header.width * puz->header.height)
+    return -1;
+
+  if(puz->solution[idx] == '.' || val == '.' || val == 0)
+    return -1;
+
+  puz->cells_filled -= cell_filled(puz, idx);
+  puz->cells_correct -= cell_correct(puz, idx);
+
+  puz->grid[idx] = val;
+
+  puz->cells_filled += cell_filled(puz, idx);
+  puz->cells_correct += cell_correct(puz, idx);
+
+  return 0;
+}
+
+/**
+ * puz_rusr_cell_set - enter a rebus string into one square
+ *
+ * @puz: a pointer to the struct puzzle_t to write to (required)
+ * @idx: the row-major index of the square (required)
+ * @val: the string to enter, or NULL to clear the square's entry
+ *
+ * The rusr board is created if the puzzle doesn't have one yet.
+ *
+ * Return Value: -1 on error, 0 on success.
+ */
+int puz_rusr_cell_set(struct puzzle_t *puz, int idx, unsigned char *val) {
+  int bd_sz;
+  unsigned char *copy = NULL;
+
+  if(NULL == puz || NULL == puz->grid || NULL == puz->solution)
+    return -1;
+
+  bd_sz = puz->header.width * puz->header.height;
+  if(idx < 0 || idx >= bd_sz || puz->solution[idx] == '.')
+    return -1;
+
+  if(NULL != val) {
+    copy = Sstrndup(val, MAX_REBUS_SIZE);
+    if(NULL == copy) {
+      perror("strndup");
+      return -1;
+    }
+  }
+
+  if(NULL == puz->rusr) {
+    if(NULL == copy)
+      return 0;
+
+    puz->rusr = (unsigned char **)calloc(bd_sz, sizeof(unsigned char *));
+    if(NULL == puz->rusr) {
+      perror("calloc");
+      free(copy);
+      return -1;
+    }
+    puz->rusr_sz = bd_sz;
+  }
+
+  puz->cells_filled -= cell_filled(puz, idx);
+  puz->cells_correct -= cell_correct(puz, idx);
+
+  if(puz->rusr[idx])
+    puz->rusr_sz -= Sstrlen(puz->rusr[idx]);
+  free(puz->rusr[idx]);
+
+  puz->rusr[idx] = copy;
+  if(copy)
+    puz->rusr_sz += Sstrlen(copy);
+
+  puz->cells_filled += cell_filled(puz, idx);
+  puz->cells_correct += cell_correct(puz, idx);
+
+  return 0;
+}
+
+/**
+ * puz_cell_count_get - get the number of white squares
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ *
+ * Returns -1 on error; else a non-negative value
+ */
+int puz_cell_count_get(struct puzzle_t *puz) {
+  if(NULL == puz)
+    return -1;
+
+  return puz->cells_total;
+}
+
+/**
+ * puz_filled_count_get - get the number of squares the solver has filled
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ *
+ * Returns -1 on error; else a non-negative value
+ */
+int puz_filled_count_get(struct puzzle_t *puz) {
+  if(NULL == puz)
+    return -1;
+
+  return puz->cells_filled;
+}
+
+/**
+ * puz_correct_count_get - get the number of correctly filled squares
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ *
+ * Returns -1 on error; else a non-negative value
+ */
+int puz_correct_count_get(struct puzzle_t *puz) {
+  if(NULL == puz)
+    return -1;
+
+  return puz->cells_correct;
+}
+
+/**
+ * puz_is_complete - check if every white square has been filled in
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ *
+ * Returns 1 if complete, 0 if not, if the puzzle has no white squares
+ * or if it is NULL
+ */
+int puz_is_complete(struct puzzle_t *puz) {
+  if(NULL == puz)
+    return 0;
+
+  return puz->cells_total && puz->cells_filled == puz->cells_total;
+}
+
+/**
+ * puz_is_solved - check if every white square is filled in correctly
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ *
+ * Returns 1 if solved, 0 if not, if the puzzle has no white squares
+ * or if it is NULL
+ */
+int puz_is_solved(struct puzzle_t *puz) {
+  if(NULL == puz)
+    return 0;
+
+  return puz->cells_total && puz->cells_correct == puz->cells_total;
+}
@@ -21,6 +21,11 @@
 #include <stdlib.h>
 
 #include <string.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 // little-endian access routines
 
@@ -33,8 +38,29 @@
 #define w_le_8(a, x) ( *(a) = (x))
 #define w_le_16(a, x) *(a) = ((x) & 0xFF); *((a)+1) = (((x) & 0xFF00) >> 8)
 
-// A puzzle header
+// The CIB: the 8 bytes of the header, shorts in LE, that say what the
+// rest of the file holds.  The rest of the header is in struct
+// puz_cold_t.
 struct puz_head_t {
+  unsigned char width;
+  unsigned char height;
+  unsigned short clue_count;
+  unsigned short x_unk_30;  // a bitmask of some sort
+  unsigned short scrambled_tag;
+};
+
+/* The parts of a puzzle that are only wanted when loading, saving or
+   checking it: the rest of the header, and every checksum, stored and
+   calculated.  Kept at the end of struct puzzle_t, out of the way of
+   the fields that are used all the time.
+
+   These fields used to be elsewhere, and code that touches them
+   directly must now go through puz->cold: puz->header.cksum_puz,
+   .magic, .cksum_cib, .magic_10, .magic_14, .magic_18, .noise_* and
+   .scrambled_cksum; and puz->calc_cksum_puzcib, calc_cksums,
+   calc_magic10, calc_magic14, cib, and each section's *_cksum and
+   calc_*_cksum.  The accessor functions are unchanged. */
+struct puz_cold_t {
   unsigned short cksum_puz;   // IV: cksum_cib
 
   unsigned char magic[12];
@@ -59,20 +85,6 @@ struct puz_head_t {
   unsigned short noise_28;
   unsigned short noise_2a;
 
-  /* These 8 bytes, with shorts in LE,  are the CIB */
-  unsigned char width;
-  unsigned char height;
-  unsigned short clue_count;
-  unsigned short x_unk_30;  // a bitmask of some sort
-  unsigned short scrambled_tag;
-};
-
-// A whole, parsed puzzle file
-struct puzzle_t {
-  int sz;
-
-  struct puz_head_t header;
-
   unsigned short calc_cksum_puzcib;
   unsigned short calc_cksums[4];
   unsigned char calc_magic10[4];
@@ -80,38 +92,79 @@ struct puzzle_t {
 
   unsigned char cib[8];
 
-  unsigned char *base;
+  // The extra sections' checksums
+  unsigned short grbs_cksum;
+  unsigned short calc_grbs_cksum;
+  unsigned short rtbl_cksum;
+  unsigned short calc_rtbl_cksum;
+  unsigned short ltim_cksum;
+  unsigned short calc_ltim_cksum;
+  unsigned short gext_cksum;
+  unsigned short calc_gext_cksum;
+  unsigned short rusr_cksum;
+  unsigned short calc_rusr_cksum;
+};
+
+/* Black squares as bitsets, one PUZ_BB_WORDS-word line per row and
+   per column.  See bitboard.c. */
+#define PUZ_BB_WORDS 4 /* 4 x 64 bits covers the format's 255 max */
+
+struct puz_bitboard_t {
+  int width;
+  int height;
+
+  uint64_t (*rows)[PUZ_BB_WORDS]; /* bit c of rows[r]: (r,c) is black */
+  uint64_t (*cols)[PUZ_BB_WORDS]; /* bit r of cols[c]: (r,c) is black */
+
+  uint64_t lines[][PUZ_BB_WORDS]; /* height rows, then width columns */
+};
+
+// A whole, parsed puzzle file.  The first 64 bytes are what a scan
+// over many puzzles reads (the board's shape, its lock, the boards
+// and clues, and the completion counts); the checksum bookkeeping is
+// in cold, at the end.  The struct needs no more than the usual
+// alignment, so puz_init() can be given any memory, but the puzzles
+// the library allocates itself start on a cache line, which makes
+// those 64 bytes exactly one.
+struct puzzle_t {
+  struct puz_head_t header;
+
+  int sz;
+
+  /* Completion state.  Recomputed in bulk by puz_progress_calc(), and
+     kept current by the cell editing functions in progress.c */
+  int cells_total;   /* non-black squares */
+  int cells_filled;
+  int cells_correct;
 
   unsigned char *solution;
   unsigned char *grid;
+  unsigned char **clues;
+
+  /* Derived from solution on load and by puz_solution_set() */
+  struct puz_bitboard_t *bitboard;
 
   unsigned char *title;
+
+  /* end of the first cache line */
+
   unsigned char *author;
   unsigned char *copyright;
 
-  unsigned char **clues;
   unsigned char *notes;
   int notes_sz;
 
+  unsigned char *base;
+
   // The extra sections
-  unsigned short grbs_cksum;
-  unsigned short calc_grbs_cksum;
   unsigned char *grbs;  /* rebus squares */
   int rtbl_sz; // this is the # of entries, not the length of all table entries
-  unsigned short rtbl_cksum;
-  unsigned short calc_rtbl_cksum;
   unsigned char **rtbl; /* rebus table, indexed by entry, not a raw string! */
 
-  unsigned short ltim_cksum;
-  unsigned short calc_ltim_cksum;
   unsigned char *ltim;
   
-  unsigned short gext_cksum;
-  unsigned short calc_gext_cksum;
   unsigned char *gext;  /* circled squares */
 
-  unsigned short rusr_cksum;
-  unsigned short calc_rusr_cksum;
   unsigned char **rusr; /* rusr table - one (possibly null) entry per square */ 
   unsigned int   rusr_sz;
   /* The rusr board is an array of strings.  The squares without rusr
@@ -120,11 +173,316 @@ struct puzzle_t {
      we have to calculate it several times.  This does not include
      the size of the null terminator for the whole rusr data section */
 
+  /* UTF-8 views of the strings, made on load with PUZ_LOAD_UTF8 or on
+     first use.  A pure ASCII string's view is the string itself.
+     See utf8.c */
+  unsigned char *title_utf8;
+  unsigned char *author_utf8;
+  unsigned char *copyright_utf8;
+  unsigned char *notes_utf8;
+  unsigned char **clues_utf8;
+  int clues_utf8_sz;
+
+  struct puz_cold_t cold;
 };
 
+/* What the library allocates for a puzzle: whole cache lines, as
+   aligned_alloc() wants */
+#define PUZ_PUZZLE_ALLOC_SZ ((sizeof(struct puzzle_t) + 63) & ~(size_t)63)
+
+/* An immutable copy of the mutable board state, published by the
+   writer of a puzzle and pinned by readers.  See snapshot.c. */
+struct puz_snapshot_t {
+  int width;
+  int height;
+
+  unsigned char *grid;
+  unsigned char *gext;
+  unsigned char **rusr; /* one (possibly null) entry per square */
+  unsigned char *ltim;
+
+  /* writer-private: the epoch this snapshot was retired in, and the
+     retired list link */
+  unsigned long epoch;
+  struct puz_snapshot_t *next;
+};
+
+#define PUZ_RCU_MAX_READERS 64
+
+/* One reader's slot.  epoch is 0 while the reader is outside a
+   read-side section.  Padded so readers don't share cache lines. */
+struct puz_rcu_reader_t {
+  unsigned long epoch;
+  int in_use;
+} __attribute__((aligned(64)));
+
+struct puz_rcu_t {
+  struct puz_snapshot_t *current;
+  unsigned long epoch;
+  struct puz_snapshot_t *retired;
+  int didmalloc;  /* puz_rcu_free() frees the struct too */
+
+  struct puz_rcu_reader_t readers[PUZ_RCU_MAX_READERS];
+};
+
+/* Per-user result of puz_check_grids() */
+struct puz_check_result_t {
+  int correct;
+  int incorrect;
+};
+
+/* A compiled, mmap'able word list.  See dict.c for the layout. */
+struct puz_dict_head_t {
+  char magic[8];
+  uint32_t byte_order;
+  uint32_t n_nodes;
+  uint32_t n_edges;
+  uint32_t n_words;
+  uint32_t root;
+  uint32_t reserved;
+};
+
+struct puz_dict_node_t {
+  uint32_t first;   /* index of the first edge */
+  uint8_t n_edges;
+  uint8_t final;    /* a word ends here */
+  uint16_t pad;
+  uint32_t count;   /* words at or below this node */
+};
+
+struct puz_dict_t {
+  void *map;
+  size_t map_sz;
+
+  struct puz_dict_head_t *head;
+  struct puz_dict_node_t *nodes;
+  uint32_t *edges;
+  unsigned char *scores;
+};
+
+/* Result of puz_dict_check_puzzle() */
+struct puz_dict_report_t {
+  int slots;
+  int unknown;    /* answers not in the dictionary */
+  int score_sum;  /* over the known answers */
+  int score_min;  /* -1 if there are none */
+};
+
+/* Result of puz_validate() */
+struct puz_validate_report_t {
+  int flags;        /* PUZ_INVALID_* for each failed check */
+  int slots;        /* across + down, derived from the solution */
+  int across;
+  int down;
+  int clue_count;   /* as given in the header */
+  int short_words;  /* words shorter than the minimum length */
+  int unchecked;    /* white squares in fewer than two words */
+  int bad_rebus;    /* grbs squares without an rtbl entry */
+};
+
+#define PUZ_INVALID_CLUE_COUNT   1
+#define PUZ_INVALID_DISCONNECTED 2
+#define PUZ_INVALID_SHORT_WORD   4
+#define PUZ_INVALID_UNCHECKED    8
+#define PUZ_INVALID_ASYMMETRIC   16
+#define PUZ_INVALID_REBUS        32
+
+/* Result of puz_load_salvage(), as PUZ_REGION_* bits */
+struct puz_salvage_report_t {
+  int damaged;          /* failed their checksums */
+  int missing;          /* cut off by the end of the file */
+  int recovered;        /* loaded and intact */
+  int clues_lost;       /* missing or cut-off clues, left empty */
+  int sections_dropped; /* extra sections not loaded */
+  int repaired;         /* the checksums were rebuilt */
+};
+
+#define PUZ_REGION_CIB      1
+#define PUZ_REGION_SOLUTION 2
+#define PUZ_REGION_GRID     4
+#define PUZ_REGION_STRINGS  8    /* title through notes */
+#define PUZ_REGION_FILE     16   /* the whole-file checksum at 0x00 */
+#define PUZ_REGION_GRBS     32
+#define PUZ_REGION_RTBL     64
+#define PUZ_REGION_LTIM     128
+#define PUZ_REGION_GEXT     256
+#define PUZ_REGION_RUSR     512
+#define PUZ_REGION_UNKNOWN  1024 /* bytes that aren't any section */
+#define PUZ_REGIONS         11
+
+/* Totals from puz_cksums_repair_files() */
+struct puz_repair_report_t {
+  int files;
+  int clean;                /* every checksum already right */
+  int repaired;             /* some were wrong; fixed unless a dry run */
+  int failed;               /* couldn't be opened or parsed */
+  int fields[PUZ_REGIONS];  /* files with a wrong checksum, by region bit */
+};
+
+#define PUZ_REPAIR_DRY_RUN 1
+
+/* One document of a text dump, from puz_load_text_many() */
+struct puz_text_doc_t {
+  struct puzzle_t *puz; /* NULL if the document didn't load */
+  int offset;           /* of its <ACROSS PUZZLE> line in the buffer */
+  int sz;
+  int error;            /* PUZ_TEXT_ERR_*, or 0 */
+};
+
+#define PUZ_TEXT_ERR_MAGIC     1 /* a section line missing or out of order */
+#define PUZ_TEXT_ERR_TRUNCATED 2 /* ended before the <DOWN> clues */
+#define PUZ_TEXT_ERR_SIZE      3 /* a bad <SIZE>, or a grid that doesn't fit it */
+#define PUZ_TEXT_ERR_NOMEM     4
+
+/* A puzzle being loaded a piece at a time; see feed.c */
+struct puz_feed_t {
+  int type;           /* as passed to puz_feed_init() */
+  unsigned char *buf; /* everything so far */
+  int len;
+  int cap;
+
+  int state;          /* where the framing is up to */
+  int scan;           /* bytes of buf it has followed */
+  int left;           /* strings still to come */
+  int failed;
+};
+
+#define PUZ_FEED_MORE   0
+#define PUZ_FEED_ERROR -1
+#define PUZ_FEED_MAX   (16 << 20) /* far past any real puzzle */
+
+/* Puzzle metadata a column per field, for filtering; see meta.c */
+struct puz_meta_t {
+  int n;
+  int cap;
+
+  uint8_t *width;
+  uint8_t *height;
+  uint16_t *clue_count;
+  uint16_t *scrambled_tag;
+  uint16_t *sections;      /* PUZ_REGION_GRBS .. PUZ_REGION_RUSR bits */
+  uint16_t *cksum_puz;
+  uint32_t *title;         /* offsets into strings */
+  uint32_t *author;
+  uint32_t *copyright;
+
+  unsigned char *strings;
+  size_t strings_sz;
+  size_t strings_cap;
+};
+
+/* What puz_meta_select() looks for; ranges are inclusive */
+struct puz_meta_query_t {
+  int width_min, width_max;
+  int height_min, height_max;
+  int clues_min, clues_max;
+  int locked;         /* -1 either, 0 unlocked only, 1 locked only */
+  int cksum;          /* -1 any, else the file checksum */
+  int sections_all;   /* sections that must be there */
+  int sections_none;  /* and that mustn't */
+};
+
+/* Boards packed 5 bits a square; see pack.c */
+#define PUZ_PACK_HEAD   4  /* width, height, escape count */
+#define PUZ_PACK_BLACK  26 /* '.' */
+#define PUZ_PACK_BLANK  27 /* '-' */
+#define PUZ_PACK_ESCAPE 31 /* anything else; the byte is kept aside */
+
+/* The compact transfer format; see wire.c */
+#define PUZ_WIRE_VERSION 1
+
+/* Clues compressed against a trained dictionary; see clue.c */
+#define PUZ_CLUE_TOKENS    (112 + 15 * 256) /* dictionary entries */
+#define PUZ_CLUE_TOKEN_MAX 15               /* longest entry */
+#define PUZ_CLUE_PAD       16 /* decompress is fastest with this to spare */
+#define PUZ_CLUE_CODES     (128 + PUZ_CLUE_TOKENS + 256)
+
+struct puz_clue_dict_t {
+  /* what each code decodes to, its length in the last byte: the bytes
+     0-127, the entries, then the bytes 0-255 for escapes.  First, so
+     the slots are aligned. */
+  unsigned char code[PUZ_CLUE_CODES][PUZ_CLUE_TOKEN_MAX + 1];
+  int n;  /* entries */
+
+  /* for compressing: entry + 1 by hash, and which lengths there are */
+  uint16_t *hash;
+  uint32_t hash_mask;
+  uint32_t lens;
+};
+
+struct puz_clue_store_t {
+  struct puz_clue_dict_t *dict;
+  int n;
+  int cap;
+  uint32_t *off;           /* clue i is data[off[i]] to data[off[i + 1]] */
+  unsigned char *data;
+  size_t data_sz;
+  size_t data_cap;
+};
+
+/* A puzzle shared read-only by many sessions; see session.c */
+struct puz_base_t {
+  struct puzzle_t *puz;
+  int refs;
+};
+
+/* One solver's board state over a shared base.  Each board pointer
+   is the base's own until the session first changes that board. */
+struct puz_session_t {
+  struct puz_base_t *base;
+
+  unsigned char *grid;
+  unsigned char *gext;
+  unsigned char **rusr;
+  unsigned int rusr_sz;
+  unsigned char *ltim;
+
+  int cells_filled;
+  int cells_correct;
+
+  int owned;  /* which of the boards are the session's own */
+};
+
+/* A set of tasks on the library's thread pool; see pool.c */
+struct puz_group_t {
+  int pending;   /* spawned and not yet finished */
+  int cancelled;
+};
+
+/* The per-CPU versions of the hot loops; see cpu.c */
+#define PUZ_CPU_SCALAR 0
+#define PUZ_CPU_SSE2   1
+#define PUZ_CPU_AVX2   2
+#define PUZ_CPU_AVX512 3 /* AVX-512BW */
+
+struct puz_kernels_t {
+  unsigned short (*cksum)(unsigned char *base, int len, unsigned short cksum);
+  void (*check)(unsigned char *sol, unsigned char *grid, int off, int len,
+                int bd_sz, struct puz_check_result_t *res,
+                unsigned char *mismatch);
+  unsigned char *(*eol)(unsigned char *b, unsigned char *stop);
+  int (*ascii)(unsigned char *s, size_t *len);
+  void (*letters)(const unsigned char *p, int n, uint32_t *counts);
+  void (*range8)(const uint8_t *col, int n, unsigned lo, unsigned hi,
+                 uint64_t *sel);
+  void (*range16)(const uint16_t *col, int n, unsigned lo, unsigned hi,
+                  uint64_t *sel);
+  void (*match16)(const uint16_t *col, int n, unsigned mask, unsigned val,
+                  uint64_t *sel);
+  int (*pack5)(const unsigned char *board, int n, unsigned char *bits);
+  void (*unpack5)(const unsigned char *bits, int n, unsigned char *board);
+};
+
+extern struct puz_kernels_t puz_kernels;
+
 #define PUZ_FILE_BINARY 1
 #define PUZ_FILE_TEXT   2
 #define PUZ_FILE_UNKNOWN 4
+#define PUZ_FILE_TYPE_MASK 0xFF
+
+/* Load flags, or'd into the type passed to puz_load() */
+#define PUZ_LOAD_UTF8 0x100 /* make the UTF-8 views up front */
+#define PUZ_SALVAGE_CKSUMS 0x200 /* puz_load_salvage(): rebuild checksums */
 
 /* Magic Numbers.  These are the numbers required for interoperability
    in various places within the files.  They are arrays of 8-bit
@@ -134,6 +492,9 @@ struct puzzle_t {
 #define FILE_MAGIC { 65, 67, 82, 79, 83, 83, 38, 68, 79, 87, 78, 0 }
 #define VER_MAGIC { 49, 46, 50, 0 }
 
+/* The first version whose strings are UTF-8 ("2.0"), times ten */
+#define PUZ_VERSION_UNICODE 20
+
 #define MAGIC_10_MASK { 73, 67, 72, 69 }
 #define MAGIC_14_MASK { 65, 84, 69, 68 }
 
@@ -167,6 +528,18 @@ struct puzzle_t {
 struct puzzle_t *puz_init(struct puzzle_t *puz);
 
 struct puzzle_t *puz_load(struct puzzle_t *retval, int type, unsigned char *base, int sz);
+struct puzzle_t *puz_load_salvage(struct puzzle_t *puz, unsigned char *base,
+                                  int sz, int flags,
+                                  struct puz_salvage_report_t *report);
+int puz_load_text_many(unsigned char *base, int sz, int nthreads,
+                       struct puz_text_doc_t **docs);
+void puz_text_docs_free(struct puz_text_doc_t *docs, int n);
+
+int puz_feed_init(struct puz_feed_t *feed, int type);
+int puz_feed_write(struct puz_feed_t *feed, const unsigned char *data,
+                   int len);
+struct puzzle_t *puz_feed_finish(struct puz_feed_t *feed);
+void puz_feed_free(struct puz_feed_t *feed);
 
 void puz_deep_free(struct puzzle_t *puz);
 
@@ -180,6 +553,10 @@ int puz_size(struct puzzle_t *puz);
 int puz_cksums_commit(struct puzzle_t *puz);
 int puz_save(struct puzzle_t *puz, int type, unsigned char *base, int sz);
 
+int puz_version_get(struct puzzle_t *puz);
+int puz_version_set(struct puzzle_t *puz, int version);
+int puz_is_unicode(struct puzzle_t *puz);
+
 int puz_width_set(struct puzzle_t *puz, unsigned char val);
 int puz_width_get(struct puzzle_t *puz);
 
@@ -259,4 +636,226 @@ unsigned short puz_lock_set(struct puzzle_t *puz, unsigned short cksum);
 int puz_unlock_solution(struct puzzle_t* puz, unsigned short code);
 int puz_brute_force_unlock(struct puzzle_t* puz);
 
+/* Batch answer checking; see check.c */
+int puz_check_grids(struct puzzle_t *ref, unsigned char **grids, int n,
+                    struct puz_check_result_t *results,
+                    unsigned char **mismatch, int nthreads);
+int puz_check_puzzles(struct puzzle_t *ref, struct puzzle_t **puzzles, int n,
+                      struct puz_check_result_t *results,
+                      unsigned char **mismatch, int nthreads);
+
+/* Completion state and cell-level editing; see progress.c */
+int puz_progress_calc(struct puzzle_t *puz);
+int puz_cell_set(struct puzzle_t *puz, int idx, unsigned char val);
+int puz_rusr_cell_set(struct puzzle_t *puz, int idx, unsigned char *val);
+int puz_cell_count_get(struct puzzle_t *puz);
+int puz_filled_count_get(struct puzzle_t *puz);
+int puz_correct_count_get(struct puzzle_t *puz);
+int puz_is_complete(struct puzzle_t *puz);
+int puz_is_solved(struct puzzle_t *puz);
+
+/* Bitboard view of the black squares; see bitboard.c */
+struct puz_bitboard_t *puz_bitboard_calc(struct puzzle_t *puz);
+struct puz_bitboard_t *puz_bitboard_get(struct puzzle_t *puz);
+int puz_bitboard_black_get(struct puz_bitboard_t *bb, int row, int col);
+int puz_bitboard_black_set(struct puz_bitboard_t *bb, int row, int col,
+                           int black);
+int puz_bitboard_across_starts(struct puz_bitboard_t *bb, int row,
+                               uint64_t *starts, uint64_t *ends);
+int puz_bitboard_down_starts(struct puz_bitboard_t *bb, int col,
+                             uint64_t *starts, uint64_t *ends);
+int puz_bitboard_word_count(struct puz_bitboard_t *bb, int *across, int *down);
+int puz_bitboard_is_symmetric(struct puz_bitboard_t *bb);
+int puz_bitboard_is_connected(struct puz_bitboard_t *bb);
+int puz_bitboard_unchecked_count(struct puz_bitboard_t *bb);
+int puz_bitboard_is_start(struct puz_bitboard_t *bb, int row, int col, int dir);
+int puz_bitboard_slot_range(struct puz_bitboard_t *bb, int row0, int row,
+                            int col, int dir);
+int puz_bitboard_slot_index(struct puz_bitboard_t *bb, int row, int col, int dir);
+int puz_bitboard_square_number(struct puz_bitboard_t *bb, int row, int col);
+
+/* Grid auto-fill for constructors; see fill.c */
+int puz_fill(struct puzzle_t *puz, unsigned char **words, int n_words,
+             int nthreads, unsigned int seed);
+
+/* Compiled word-list dictionaries; see dict.c */
+int puz_dict_compile(const char *in_path, const char *out_path);
+struct puz_dict_t *puz_dict_open(const char *path);
+void puz_dict_close(struct puz_dict_t *d);
+int puz_dict_word_count(struct puz_dict_t *d);
+int puz_dict_lookup(struct puz_dict_t *d, unsigned char *word, int len);
+int puz_dict_prefix(struct puz_dict_t *d, unsigned char *prefix, int len);
+int puz_dict_match(struct puz_dict_t *d, unsigned char *pattern, int len,
+                   int (*cb)(unsigned char *word, int len, int score, void *arg),
+                   void *arg);
+int puz_dict_check_puzzle(struct puz_dict_t *d, struct puzzle_t *puz,
+                          struct puz_dict_report_t *report, int *scores);
+
+/* Structural checks for incoming puzzles; see validate.c */
+int puz_validate(struct puzzle_t *puz, int min_len,
+                 struct puz_validate_report_t *report);
+
+/* Clue numbering and black-square edits; see number.c */
+int puz_square_toggle(struct puzzle_t *puz, int row, int col,
+                      unsigned char letter);
+int puz_clue_index_get(struct puzzle_t *puz, int row, int col, int dir);
+int puz_square_number_get(struct puzzle_t *puz, int row, int col);
+
+/* UTF-8 views of the strings; see utf8.c */
+int puz_utf8_calc(struct puzzle_t *puz);
+void puz_utf8_clear(struct puzzle_t *puz);
+unsigned char * puz_title_utf8_get(struct puzzle_t *puz);
+unsigned char * puz_author_utf8_get(struct puzzle_t *puz);
+unsigned char * puz_copyright_utf8_get(struct puzzle_t *puz);
+unsigned char * puz_notes_utf8_get(struct puzzle_t *puz);
+unsigned char * puz_clue_utf8_get(struct puzzle_t *puz, int n);
+unsigned char * puz_title_utf8_set(struct puzzle_t *puz, unsigned char *val);
+unsigned char * puz_author_utf8_set(struct puzzle_t *puz, unsigned char *val);
+unsigned char * puz_copyright_utf8_set(struct puzzle_t *puz, unsigned char *val);
+unsigned char * puz_notes_utf8_set(struct puzzle_t *puz, unsigned char *val);
+unsigned char * puz_clue_utf8_set(struct puzzle_t *puz, int n, unsigned char *val);
+
+/* In-place checksum repair for many files; see repair.c */
+int puz_cksums_repair(unsigned char *base, int sz, int flags);
+int puz_cksums_repair_file(const char *path, int flags);
+int puz_cksums_repair_files(char **paths, int n, int nthreads, int flags,
+                            struct puz_repair_report_t *report,
+                            void (*cb)(const char *path, int fixed, void *arg),
+                            void *arg);
+
+/* Loading puzzles straight out of tar archives; see tar.c */
+int puz_tar_walk(unsigned char *base, size_t sz, int type,
+                 int (*cb)(const char *name, struct puzzle_t *puz,
+                           unsigned char *data, int sz, void *arg),
+                 void *arg);
+int puz_tar_walk_fd(int fd, int type,
+                    int (*cb)(const char *name, struct puzzle_t *puz,
+                              unsigned char *data, int sz, void *arg),
+                    void *arg);
+int puz_tar_walk_file(const char *path, int type,
+                      int (*cb)(const char *name, struct puzzle_t *puz,
+                                unsigned char *data, int sz, void *arg),
+                      void *arg);
+
+/* Column-wise metadata tables; see meta.c */
+struct puz_meta_t *puz_meta_init(struct puz_meta_t *meta);
+void puz_meta_free(struct puz_meta_t *meta);
+int puz_meta_probe(struct puz_meta_t *meta, unsigned char *base, int sz);
+int puz_meta_add(struct puz_meta_t *meta, struct puzzle_t *puz);
+int puz_meta_count(struct puz_meta_t *meta);
+unsigned char * puz_meta_title_get(struct puz_meta_t *meta, int row);
+unsigned char * puz_meta_author_get(struct puz_meta_t *meta, int row);
+unsigned char * puz_meta_copyright_get(struct puz_meta_t *meta, int row);
+void puz_meta_query_init(struct puz_meta_query_t *q);
+int puz_meta_select(struct puz_meta_t *meta, struct puz_meta_query_t *q,
+                    uint64_t *sel);
+
+/* Boards packed 5 bits a square; see pack.c */
+int puz_pack_size(const unsigned char *board, int width, int height);
+int puz_pack(const unsigned char *board, int width, int height,
+             unsigned char *out, int sz);
+int puz_unpack(const unsigned char *pk, int sz, unsigned char *board);
+int puz_pack_length(const unsigned char *pk, int sz);
+int puz_pack_width(const unsigned char *pk);
+int puz_pack_height(const unsigned char *pk);
+int puz_pack_cell_get(const unsigned char *pk, int row, int col);
+int puz_pack_is_black(const unsigned char *pk, int row, int col);
+int puz_pack_row_get(const unsigned char *pk, int row, unsigned char *out);
+int puz_pack_col_get(const unsigned char *pk, int col, unsigned char *out);
+
+/* The compact transfer format; see wire.c */
+int puz_wire_size(struct puzzle_t *puz);
+int puz_wire_encode(struct puzzle_t *puz, unsigned char *base, int sz);
+struct puzzle_t *puz_wire_decode(struct puzzle_t *puz, unsigned char *base,
+                                 int sz);
+
+/* Clues compressed against a trained dictionary; see clue.c */
+struct puz_clue_dict_t *puz_clue_dict_init(struct puz_clue_dict_t *d);
+void puz_clue_dict_free(struct puz_clue_dict_t *d);
+int puz_clue_dict_train(struct puz_clue_dict_t *d, unsigned char **clues,
+                        int n);
+int puz_clue_dict_size(struct puz_clue_dict_t *d);
+int puz_clue_dict_write(struct puz_clue_dict_t *d, unsigned char *base,
+                        int sz);
+int puz_clue_dict_read(struct puz_clue_dict_t *d, unsigned char *base,
+                       int sz);
+int puz_clue_compress(struct puz_clue_dict_t *d, const unsigned char *clue,
+                      unsigned char *out, int sz);
+int puz_clue_decompress(struct puz_clue_dict_t *d, const unsigned char *in,
+                        int len, unsigned char *out, int sz);
+struct puz_clue_store_t *puz_clue_store_init(struct puz_clue_store_t *store,
+                                             struct puz_clue_dict_t *d);
+void puz_clue_store_free(struct puz_clue_store_t *store);
+int puz_clue_store_add(struct puz_clue_store_t *store, unsigned char *clue);
+int puz_clue_store_add_puzzle(struct puz_clue_store_t *store,
+                              struct puzzle_t *puz);
+int puz_clue_store_count(struct puz_clue_store_t *store);
+int puz_clue_store_get(struct puz_clue_store_t *store, int n,
+                       unsigned char *out, int sz);
+
+/* Many solvers' board states over one shared puzzle; see session.c */
+struct puz_base_t *puz_base_new(struct puzzle_t *puz);
+struct puz_base_t *puz_base_ref(struct puz_base_t *base);
+void puz_base_unref(struct puz_base_t *base);
+struct puzzle_t *puz_base_puzzle_get(struct puz_base_t *base);
+struct puz_session_t *puz_session_init(struct puz_session_t *sess,
+                                       struct puz_base_t *base);
+void puz_session_free(struct puz_session_t *sess);
+struct puzzle_t *puz_session_view(struct puz_session_t *sess,
+                                  struct puzzle_t *view);
+int puz_session_cell_set(struct puz_session_t *sess, int idx,
+                         unsigned char val);
+int puz_session_rusr_cell_set(struct puz_session_t *sess, int idx,
+                              unsigned char *val);
+unsigned char * puz_session_grid_set(struct puz_session_t *sess,
+                                     unsigned char *val);
+unsigned char * puz_session_extras_set(struct puz_session_t *sess,
+                                       unsigned char *val);
+unsigned char * puz_session_timer_set(struct puz_session_t *sess,
+                                      int elapsed, int stopped);
+unsigned char * puz_session_grid_get(struct puz_session_t *sess);
+unsigned char * puz_session_extras_get(struct puz_session_t *sess);
+unsigned char ** puz_session_rusr_get(struct puz_session_t *sess);
+unsigned char * puz_session_timer_get(struct puz_session_t *sess);
+int puz_session_size(struct puz_session_t *sess);
+int puz_session_save(struct puz_session_t *sess, int type,
+                     unsigned char *out, int sz);
+
+/* The shared work-stealing thread pool; see pool.c */
+int puz_pool_threads_set(int n);
+int puz_pool_threads_get(void);
+void puz_pool_shutdown(void);
+void puz_group_init(struct puz_group_t *g);
+void puz_group_spawn(struct puz_group_t *g, void (*fn)(void *arg), void *arg);
+void puz_group_wait(struct puz_group_t *g);
+void puz_group_cancel(struct puz_group_t *g);
+int puz_group_cancelled(struct puz_group_t *g);
+
+/* CPU feature dispatch; see cpu.c */
+int puz_cpu_level_detect(void);
+int puz_cpu_level_get(void);
+int puz_cpu_level_set(int level);
+const char *puz_cpu_level_name(int level);
+int puz_cpu_selftest(void);
+
+/* Lock-free snapshots for concurrent readers; see snapshot.c */
+struct puz_rcu_t *puz_rcu_init(struct puz_rcu_t *rcu, struct puzzle_t *puz);
+int puz_rcu_publish(struct puz_rcu_t *rcu, struct puzzle_t *puz);
+void puz_rcu_free(struct puz_rcu_t *rcu);
+
+int puz_rcu_reader_register(struct puz_rcu_t *rcu);
+int puz_rcu_reader_unregister(struct puz_rcu_t *rcu, int slot);
+
+struct puz_snapshot_t *puz_rcu_read_lock(struct puz_rcu_t *rcu, int slot);
+void puz_rcu_read_unlock(struct puz_rcu_t *rcu, int slot);
+
+unsigned char * puz_snapshot_grid_get(struct puz_snapshot_t *snap);
+unsigned char * puz_snapshot_extras_get(struct puz_snapshot_t *snap);
+unsigned char ** puz_snapshot_rusr_get(struct puz_snapshot_t *snap);
+unsigned char * puz_snapshot_timer_get(struct puz_snapshot_t *snap);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* ndef __LIBPUZ_H__ */
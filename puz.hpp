@@ -0,0 +1,352 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * puz.hpp -- C++17 wrapper around struct puzzle_t
+ */
+
+#ifndef __LIBPUZ_HPP__
+#define __LIBPUZ_HPP__
+
+#include <puz.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+#if __cplusplus > 202002L && __has_include(<expected>)
+#include <expected>
+#endif
+
+/*
+  Header-only: there is nothing here the C library doesn't already
+  do, it only says who owns what.  A puz::Puzzle owns its struct
+  puzzle_t and frees it with puz_deep_free(); it can be moved but not
+  copied.  Strings come back as std::string_view and boards as spans,
+  pointing into the puzzle, so they are good until the puzzle is
+  changed or goes away.  The const members only read, so a Puzzle
+  nobody is changing can be read from many threads at once.
+ */
+
+namespace puz {
+
+#if defined(__cpp_lib_span)
+template <class T> using span = std::span<T>;
+#else
+/* just enough of std::span for boards */
+template <class T> class span {
+ public:
+  constexpr span() noexcept : data_(nullptr), size_(0) {}
+  constexpr span(T *data, std::size_t size) noexcept
+    : data_(data), size_(size) {}
+
+  constexpr T *data() const noexcept { return data_; }
+  constexpr std::size_t size() const noexcept { return size_; }
+  constexpr bool empty() const noexcept { return 0 == size_; }
+  constexpr T &operator[](std::size_t i) const noexcept { return data_[i]; }
+  constexpr T *begin() const noexcept { return data_; }
+  constexpr T *end() const noexcept { return data_ + size_; }
+
+ private:
+  T *data_;
+  std::size_t size_;
+};
+#endif
+
+enum class Error {
+  invalid_argument = 1,
+  io,          /* the file couldn't be read */
+  format,      /* the loader turned it down */
+  nomem,
+};
+
+#if defined(__cpp_lib_expected)
+template <class T> using Result = std::expected<T, Error>;
+namespace detail {
+template <class T> Result<T> fail(Error e) { return std::unexpected(e); }
+}
+#else
+/* the parts of std::expected<T, Error> that the loaders need */
+template <class T> class Result {
+ public:
+  Result(T &&value) : value_(std::move(value)), error_(), ok_(true) {}
+
+  bool has_value() const noexcept { return ok_; }
+  explicit operator bool() const noexcept { return ok_; }
+
+  T &value() & { return value_; }
+  const T &value() const & { return value_; }
+  T &&value() && { return std::move(value_); }
+  T &operator*() & { return value_; }
+  T &&operator*() && { return std::move(value_); }
+  T *operator->() { return &value_; }
+  const T *operator->() const { return &value_; }
+
+  Error error() const noexcept { return error_; }
+
+  static Result failure(Error e) { return Result(e); }
+
+ private:
+  explicit Result(Error e) : value_(), error_(e), ok_(false) {}
+
+  T value_;
+  Error error_;
+  bool ok_;
+};
+namespace detail {
+template <class T> Result<T> fail(Error e) { return Result<T>::failure(e); }
+}
+#endif
+
+namespace detail {
+inline std::string_view view(const unsigned char *s, std::size_t len) {
+  return std::string_view(reinterpret_cast<const char *>(s), len);
+}
+}
+
+class Puzzle;
+
+/* An extra section that's present: its name, and its bytes where the
+   puzzle keeps them flat (GRBS, GEXT: one per square; LTIM: the
+   string).  RTBL and RUSR are kept as tables, so their data is empty;
+   use Puzzle::rebus_entry() and Puzzle::user_rebus() for those. */
+struct Section {
+  std::string_view name;
+  span<const unsigned char> data;
+};
+
+class Puzzle {
+ public:
+  Puzzle() noexcept = default;
+  /* take ownership of a puzzle from the C API */
+  explicit Puzzle(struct puzzle_t *puz) noexcept : puz_(puz) {}
+
+  Puzzle(const Puzzle &) = delete;
+  Puzzle &operator=(const Puzzle &) = delete;
+
+  Puzzle(Puzzle &&other) noexcept
+    : puz_(std::exchange(other.puz_, nullptr)) {}
+
+  Puzzle &operator=(Puzzle &&other) noexcept {
+    if(this != &other) {
+      reset(std::exchange(other.puz_, nullptr));
+    }
+    return *this;
+  }
+
+  ~Puzzle() { reset(); }
+
+  /* Load from a buffer.  The puzzle copies what it keeps, so the
+     buffer can go away afterwards.  @type is as for puz_load(). */
+  static Result<Puzzle> load(const unsigned char *base, std::size_t sz,
+                             int type = PUZ_FILE_UNKNOWN) {
+    if(nullptr == base || sz < 1 || sz > INT32_MAX)
+      return detail::fail<Puzzle>(Error::invalid_argument);
+
+    struct puzzle_t *p = puz_load(nullptr, type,
+                                  const_cast<unsigned char *>(base),
+                                  static_cast<int>(sz));
+    if(nullptr == p)
+      return detail::fail<Puzzle>(Error::format);
+
+    return Puzzle(p);
+  }
+
+  static Result<Puzzle> load_file(const std::string &path,
+                                  int type = PUZ_FILE_UNKNOWN) {
+    std::ifstream in(path, std::ios::binary);
+    if(!in)
+      return detail::fail<Puzzle>(Error::io);
+
+    std::vector<unsigned char> buf((std::istreambuf_iterator<char>(in)),
+                                   std::istreambuf_iterator<char>());
+    if(in.bad())
+      return detail::fail<Puzzle>(Error::io);
+
+    return load(buf.data(), buf.size(), type);
+  }
+
+  /* Write out in the binary format; see puz_save() */
+  Result<std::vector<unsigned char>> save() const {
+    if(nullptr == puz_)
+      return detail::fail<std::vector<unsigned char>>(Error::invalid_argument);
+
+    int sz = puz_size(puz_);
+    if(sz < 0)
+      return detail::fail<std::vector<unsigned char>>(Error::format);
+
+    std::vector<unsigned char> out(sz);
+    sz = puz_save(puz_, PUZ_FILE_BINARY, out.data(), sz);
+    if(sz < 0)
+      return detail::fail<std::vector<unsigned char>>(Error::format);
+    out.resize(sz);
+
+    return out;
+  }
+
+  struct puzzle_t *get() const noexcept { return puz_; }
+  explicit operator bool() const noexcept { return nullptr != puz_; }
+
+  /* hand the puzzle back to C; the caller frees it */
+  struct puzzle_t *release() noexcept {
+    return std::exchange(puz_, nullptr);
+  }
+
+  void reset(struct puzzle_t *puz = nullptr) noexcept {
+    if(puz_ && puz_ != puz)
+      puz_deep_free(puz_);
+    puz_ = puz;
+  }
+
+  int width() const noexcept { return puz_ ? puz_->header.width : 0; }
+  int height() const noexcept { return puz_ ? puz_->header.height : 0; }
+  int clue_count() const noexcept {
+    return puz_ ? puz_->header.clue_count : 0;
+  }
+
+  std::string_view title() const noexcept { return str(puz_ ? puz_->title : nullptr); }
+  std::string_view author() const noexcept { return str(puz_ ? puz_->author : nullptr); }
+  std::string_view copyright() const noexcept {
+    return str(puz_ ? puz_->copyright : nullptr);
+  }
+  std::string_view notes() const noexcept {
+    /* the C library keeps this one's length itself */
+    if(nullptr == puz_ || nullptr == puz_->notes)
+      return std::string_view();
+    return detail::view(puz_->notes, puz_->notes_sz);
+  }
+
+  std::string_view clue(int n) const noexcept {
+    /* range-checked here, as puz_clue_get() lets n == clue_count() by */
+    if(nullptr == puz_ || n < 0 || n >= clue_count() || nullptr == puz_->clues)
+      return std::string_view();
+    return str(puz_->clues[n]);
+  }
+
+  span<const unsigned char> solution() const noexcept { return board(puz_ ? puz_->solution : nullptr); }
+  span<const unsigned char> grid() const noexcept { return board(puz_ ? puz_->grid : nullptr); }
+  span<const unsigned char> rebus() const noexcept { return board(puz_ ? puz_->grbs : nullptr); }
+  span<const unsigned char> extras() const noexcept { return board(puz_ ? puz_->gext : nullptr); }
+
+  std::string_view rebus_entry(int n) const {
+    const unsigned char *s = puz_ ? puz_rtbl_get(puz_, n) : nullptr;
+    return s ? std::string_view(reinterpret_cast<const char *>(s)) : std::string_view();
+  }
+
+  std::string_view user_rebus(int square) const {
+    if(nullptr == puz_ || nullptr == puz_->rusr || square < 0 ||
+       square >= width() * height() || nullptr == puz_->rusr[square])
+      return std::string_view();
+    return std::string_view(reinterpret_cast<const char *>(puz_->rusr[square]));
+  }
+
+  /* Setters copy the text, as the C ones do.  They return false on error. */
+  bool set_title(std::string_view s) { return set(s, puz_title_set); }
+  bool set_author(std::string_view s) { return set(s, puz_author_set); }
+  bool set_copyright(std::string_view s) { return set(s, puz_copyright_set); }
+  bool set_notes(std::string_view s) {
+    std::string tmp(s);
+    return puz_ && puz_notes_set(puz_, reinterpret_cast<unsigned char *>(tmp.data()));
+  }
+  bool set_clue(int n, std::string_view s) {
+    /* as for clue(): puz_clue_set() would write one past the end */
+    if(nullptr == puz_ || n < 0 || n >= clue_count())
+      return false;
+    std::string tmp(s);
+    return nullptr != puz_clue_set(puz_, n, reinterpret_cast<unsigned char *>(tmp.data()));
+  }
+
+  bool commit_cksums() { return puz_ && 0 == puz_cksums_commit(puz_); }
+
+  /* for(std::string_view clue : puzzle.clues()) ... */
+  class ClueIterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = std::string_view;
+
+    ClueIterator(const Puzzle *puz, int n) noexcept : puz_(puz), n_(n) {}
+
+    std::string_view operator*() const { return puz_->clue(n_); }
+    ClueIterator &operator++() noexcept { ++n_; return *this; }
+    ClueIterator operator++(int) noexcept { ClueIterator t = *this; ++n_; return t; }
+    bool operator==(const ClueIterator &o) const noexcept { return n_ == o.n_; }
+    bool operator!=(const ClueIterator &o) const noexcept { return n_ != o.n_; }
+
+   private:
+    const Puzzle *puz_;
+    int n_;
+  };
+
+  struct ClueRange {
+    const Puzzle *puz;
+    ClueIterator begin() const noexcept { return ClueIterator(puz, 0); }
+    ClueIterator end() const noexcept { return ClueIterator(puz, puz->clue_count()); }
+    std::size_t size() const noexcept { return puz->clue_count(); }
+  };
+
+  ClueRange clues() const noexcept { return ClueRange{this}; }
+
+  /* the extra sections present, in the order puz_save() writes them */
+  std::vector<Section> sections() const {
+    std::vector<Section> out;
+
+    if(nullptr == puz_)
+      return out;
+    if(puz_has_rebus(puz_)) {
+      out.push_back(Section{"GRBS", rebus()});
+      out.push_back(Section{"RTBL", span<const unsigned char>()});
+    }
+    if(puz_has_timer(puz_))
+      out.push_back(Section{"LTIM", span<const unsigned char>(
+            puz_->ltim, std::strlen(reinterpret_cast<const char *>(puz_->ltim)))});
+    if(puz_has_extras(puz_))
+      out.push_back(Section{"GEXT", extras()});
+    if(puz_has_rusr(puz_))
+      out.push_back(Section{"RUSR", span<const unsigned char>()});
+
+    return out;
+  }
+
+ private:
+  static std::string_view str(const unsigned char *s) noexcept {
+    if(nullptr == s)
+      return std::string_view();
+    return std::string_view(reinterpret_cast<const char *>(s));
+  }
+
+  span<const unsigned char> board(const unsigned char *b) const noexcept {
+    if(nullptr == b)
+      return span<const unsigned char>();
+    return span<const unsigned char>(b, static_cast<std::size_t>(width()) * height());
+  }
+
+  bool set(std::string_view s,
+           unsigned char *(*fn)(struct puzzle_t *, unsigned char *)) {
+    std::string tmp(s);
+    return puz_ && nullptr != fn(puz_, reinterpret_cast<unsigned char *>(tmp.data()));
+  }
+
+  struct puzzle_t *puz_ = nullptr;
+};
+
+} /* namespace puz */
+
+#endif /* ndef __LIBPUZ_HPP__ */
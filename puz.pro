@@ -1,6 +1,7 @@
 TEMPLATE = app
 TARGET = puz
 
-SOURCES += cksum.c load.c puzzle.c readpuz.c
-HEADERS += puz.h
+SOURCES += cksum.c load.c puzzle.c readpuz.c snapshot.c progress.c check.c bitboard.c fill.c dict.c validate.c number.c utf8.c save.c repair.c tar.c feed.c cpu.c pool.c meta.c pack.c wire.c clue.c session.c
+HEADERS += puz.h puz.hpp puz_async.hpp
 
+LIBS += -lpthread
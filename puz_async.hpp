@@ -0,0 +1,777 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * puz_async.hpp -- C++20 coroutine loading and saving
+ */
+
+#ifndef __LIBPUZ_ASYNC_HPP__
+#define __LIBPUZ_ASYNC_HPP__
+
+#include <puz.hpp>
+
+#if __cplusplus < 202002L
+#error "puz_async.hpp needs C++20"
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cerrno>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define PUZ_HAVE_URING 1
+#ifndef IORING_FEAT_RW_CUR_POS
+#define IORING_FEAT_RW_CUR_POS (1U << 3)  /* 5.6; older headers lack it */
+#endif
+#endif
+
+/*
+  Loading a puzzle is a loop of reads into a puz_feed_t (see feed.c)
+  and one puz_feed_finish() at the end; here that loop is a coroutine,
+  so a server can have thousands of them waiting on the network or
+  the disk at once:
+
+    puz::Task<void> handle(puz::Executor &ex, int sock) {
+      auto p = co_await puz::async_load(ex, sock);
+      if(p) ...
+    }
+
+    auto ex = puz::make_executor();
+    puz::spawn(handle(*ex, sock));
+    ex->run();
+
+  The executor does the waiting.  EpollExecutor waits on sockets and
+  pipes with epoll; regular files can't be waited on that way, so
+  their reads go to a few worker threads.  UringExecutor hands all of
+  it to io_uring, talking to the kernel directly (no liburing needed).
+  make_executor() picks io_uring if the kernel will give us one that
+  can read and write at the current position (5.6 on), as sockets and
+  pipes need.
+  Either way every coroutine is resumed on the thread calling run(),
+  so handlers need no locking among themselves.
+
+  Only one read or write may be outstanding per descriptor.  Sockets
+  and pipes should be non-blocking.
+ */
+
+namespace puz {
+
+/* A lazily-started coroutine returning T.  co_await it from another
+   coroutine, or hand it to spawn(). */
+template <class T> class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+  std::coroutine_handle<> next;
+
+  struct Final {
+    bool await_ready() const noexcept { return false; }
+    template <class P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+      std::coroutine_handle<> n = h.promise().next;
+      return n ? n : std::noop_coroutine();
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  Final final_suspend() const noexcept { return {}; }
+  void unhandled_exception() const noexcept { std::terminate(); }
+};
+
+template <class T> struct TaskPromise : TaskPromiseBase {
+  std::optional<T> value;
+
+  Task<T> get_return_object() noexcept;
+  template <class U> void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+  T take() { return std::move(*value); }
+};
+
+template <> struct TaskPromise<void> : TaskPromiseBase {
+  Task<void> get_return_object() noexcept;
+  void return_void() const noexcept {}
+  void take() const noexcept {}
+};
+
+} /* namespace detail */
+
+template <class T> class Task {
+ public:
+  using promise_type = detail::TaskPromise<T>;
+  using handle_type = std::coroutine_handle<promise_type>;
+
+  explicit Task(handle_type h) noexcept : h_(h) {}
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+  Task(Task &&other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+  Task &operator=(Task &&other) noexcept {
+    if(this != &other) {
+      if(h_)
+        h_.destroy();
+      h_ = std::exchange(other.h_, nullptr);
+    }
+    return *this;
+  }
+  ~Task() {
+    if(h_)
+      h_.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+    h_.promise().next = caller;
+    return h_;
+  }
+  T await_resume() { return h_.promise().take(); }
+
+ private:
+  handle_type h_;
+};
+
+namespace detail {
+
+template <class T> Task<T> TaskPromise<T>::get_return_object() noexcept {
+  return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+  return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/* runs straight away and frees itself at the end */
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() const noexcept { return {}; }
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept { std::terminate(); }
+  };
+};
+
+inline Detached run_detached(Task<void> t) { co_await std::move(t); }
+
+template <class T, class F> Detached run_detached(Task<T> t, F done) {
+  done(co_await std::move(t));
+}
+
+} /* namespace detail */
+
+/* Start a task without waiting for it; it runs up to its first wait
+   now, and the rest on the executor.  @done, if given, gets the result. */
+inline void spawn(Task<void> t) { detail::run_detached(std::move(t)); }
+
+template <class T, class F> void spawn(Task<T> t, F done) {
+  detail::run_detached(std::move(t), std::move(done));
+}
+
+/* Where coroutines wait for I/O.  The read and write awaitables give
+   the byte count, or -errno. */
+class Executor {
+ public:
+  /* one outstanding read or write */
+  struct Op {
+    std::coroutine_handle<> handle;
+    long res = 0;
+  };
+
+  struct IoAwaitable {
+    Executor *ex;
+    bool write;
+    int fd;
+    void *buf;
+    std::size_t len;
+    std::int64_t off;
+    Op op;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+      op.handle = h;
+      if(write)
+        ex->submit_write(fd, buf, len, off, &op);
+      else
+        ex->submit_read(fd, buf, len, off, &op);
+    }
+    long await_resume() const noexcept { return op.res; }
+  };
+
+  struct PostAwaitable {
+    Executor *ex;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { ex->post(h); }
+    void await_resume() const noexcept {}
+  };
+
+  virtual ~Executor() = default;
+
+  /* @off is the file offset, or -1 for the descriptor's own position
+     (which is all a socket or pipe has) */
+  IoAwaitable read(int fd, void *buf, std::size_t len, std::int64_t off = -1) {
+    return IoAwaitable{this, false, fd, buf, len, off, {}};
+  }
+  IoAwaitable write(int fd, const void *buf, std::size_t len,
+                    std::int64_t off = -1) {
+    return IoAwaitable{this, true, fd, const_cast<void *>(buf), len, off, {}};
+  }
+  /* let everything else ready run first */
+  PostAwaitable yield() { return PostAwaitable{this}; }
+
+  /* Resume @h from run(); safe from any thread. */
+  virtual void post(std::coroutine_handle<> h) = 0;
+  /* Run until nothing is waiting, or until stop(). */
+  virtual void run() = 0;
+  /* Make run() return soon; safe from any thread. */
+  virtual void stop() = 0;
+
+  virtual void submit_read(int fd, void *buf, std::size_t len,
+                           std::int64_t off, Op *op) = 0;
+  virtual void submit_write(int fd, void *buf, std::size_t len,
+                            std::int64_t off, Op *op) = 0;
+};
+
+namespace detail {
+
+/* the handles post() has queued, and the eventfd that wakes run() */
+class PostQueue {
+ public:
+  PostQueue() : efd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+  ~PostQueue() {
+    if(efd_ >= 0)
+      ::close(efd_);
+  }
+
+  int fd() const noexcept { return efd_; }
+
+  void push(std::coroutine_handle<> h) {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      q_.push_back(h);
+    }
+    wake();
+  }
+
+  void wake() const noexcept {
+    std::uint64_t one = 1;
+    if(::write(efd_, &one, sizeof(one)) < 0) {
+      /* the counter is already non-zero, so run() will wake anyway */
+    }
+  }
+
+  std::deque<std::coroutine_handle<>> take() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return std::exchange(q_, {});
+  }
+
+ private:
+  int efd_;
+  std::mutex mu_;
+  std::deque<std::coroutine_handle<>> q_;
+};
+
+inline long do_io(bool write, int fd, void *buf, std::size_t len,
+                  std::int64_t off) {
+  ssize_t n;
+  if(off >= 0)
+    n = write ? ::pwrite(fd, buf, len, off) : ::pread(fd, buf, len, off);
+  else
+    n = write ? ::write(fd, buf, len) : ::read(fd, buf, len);
+  return n < 0 ? -errno : static_cast<long>(n);
+}
+
+} /* namespace detail */
+
+/* epoll for whatever it can wait on, a few threads for the rest */
+class EpollExecutor : public Executor {
+ public:
+  explicit EpollExecutor(int threads = 4)
+    : epfd_(::epoll_create1(EPOLL_CLOEXEC)) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    ::epoll_ctl(epfd_, EPOLL_CTL_ADD, posted_.fd(), &ev);
+
+    if(threads <= 0)
+      threads = 1;
+    for(int i = 0; i < threads; i++)
+      workers_.emplace_back([this] { work(); });
+  }
+
+  ~EpollExecutor() override {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      quit_ = true;
+    }
+    cv_.notify_all();
+    for(std::thread &t : workers_)
+      t.join();
+    ::close(epfd_);
+  }
+
+  bool ok() const noexcept { return epfd_ >= 0 && posted_.fd() >= 0; }
+
+  void post(std::coroutine_handle<> h) override {
+    pending_++;
+    posted_.push(h);
+  }
+
+  void stop() override {
+    stopped_ = true;
+    posted_.wake();
+  }
+
+  void submit_read(int fd, void *buf, std::size_t len, std::int64_t off,
+                   Op *op) override {
+    submit(false, fd, buf, len, off, op);
+  }
+  void submit_write(int fd, void *buf, std::size_t len, std::int64_t off,
+                    Op *op) override {
+    submit(true, fd, buf, len, off, op);
+  }
+
+  void run() override {
+    struct epoll_event evs[64];
+    int i, n;
+
+    stopped_ = false;
+    while(!stopped_ && pending_ > 0) {
+      n = ::epoll_wait(epfd_, evs, 64, -1);
+      if(n < 0 && errno != EINTR)
+        break;
+      for(i = 0; i < n; i++) {
+        if(nullptr == evs[i].data.ptr)
+          drain();
+        else
+          ready(static_cast<Waiting *>(evs[i].data.ptr));
+      }
+    }
+  }
+
+ private:
+  /* an op on a descriptor epoll is watching, or one a worker owns */
+  struct Waiting {
+    bool write;
+    int fd;
+    void *buf;
+    std::size_t len;
+    std::int64_t off;
+    Op *op;
+  };
+
+  void submit(bool write, int fd, void *buf, std::size_t len,
+              std::int64_t off, Op *op) {
+    Waiting *w = new Waiting{write, fd, buf, len, off, op};
+    struct epoll_event ev;
+
+    pending_++;
+    ev.events = (write ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+    ev.data.ptr = w;
+    if(0 == ::epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev) ||
+       0 == ::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev))
+      return;
+
+    /* EPERM: a regular file, which is always "ready" and still blocks */
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      jobs_.push_back(w);
+    }
+    cv_.notify_one();
+  }
+
+  void ready(Waiting *w) {
+    long res = detail::do_io(w->write, w->fd, w->buf, w->len, w->off);
+    struct epoll_event ev;
+
+    if(-EAGAIN == res || -EINTR == res) {
+      ev.events = (w->write ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+      ev.data.ptr = w;
+      if(0 == ::epoll_ctl(epfd_, EPOLL_CTL_MOD, w->fd, &ev))
+        return;
+      res = -errno;
+    }
+    finish(w, res);
+  }
+
+  void finish(Waiting *w, long res) {
+    Op *op = w->op;
+    delete w;
+    op->res = res;
+    pending_--;
+    op->handle.resume();
+  }
+
+  /* posted handles, and reads the workers have done */
+  void drain() {
+    std::uint64_t count;
+    std::deque<Waiting *> done;
+
+    if(::read(posted_.fd(), &count, sizeof(count)) < 0) {
+      /* nothing to clear */
+    }
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      done.swap(done_);
+    }
+    for(Waiting *w : done) {
+      Op *op = w->op;
+      delete w;
+      pending_--;
+      op->handle.resume();
+    }
+    for(std::coroutine_handle<> h : posted_.take()) {
+      pending_--;
+      h.resume();
+    }
+  }
+
+  void work() {
+    Waiting *w;
+    for(;;) {
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [this] { return quit_ || !jobs_.empty(); });
+        if(quit_)
+          return;
+        w = jobs_.front();
+        jobs_.pop_front();
+      }
+      w->op->res = detail::do_io(w->write, w->fd, w->buf, w->len, w->off);
+      {
+        std::lock_guard<std::mutex> lock(mu_);
+        done_.push_back(w);
+      }
+      posted_.wake();
+    }
+  }
+
+  int epfd_;
+  detail::PostQueue posted_;
+  std::atomic<long> pending_{0};
+  std::atomic<bool> stopped_{false};
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<Waiting *> jobs_, done_;
+  bool quit_ = false;
+  std::vector<std::thread> workers_;
+};
+
+#ifdef PUZ_HAVE_URING
+/* io_uring, set up by hand: one ring, reaped by run() */
+class UringExecutor : public Executor {
+ public:
+  /* nullptr if the kernel won't give us a ring, or one that's too old */
+  static std::unique_ptr<UringExecutor> create(unsigned entries = 256) {
+    std::unique_ptr<UringExecutor> ex(new UringExecutor());
+    if(!ex->setup(entries))
+      return nullptr;
+    return ex;
+  }
+
+  ~UringExecutor() override {
+    if(sqes_ != MAP_FAILED)
+      ::munmap(sqes_, sqes_sz_);
+    if(cq_ != MAP_FAILED && cq_ != sq_)
+      ::munmap(cq_, cq_sz_);
+    if(sq_ != MAP_FAILED)
+      ::munmap(sq_, sq_sz_);
+    if(ring_ >= 0)
+      ::close(ring_);
+  }
+
+  void post(std::coroutine_handle<> h) override {
+    pending_++;
+    posted_.push(h);
+  }
+
+  void stop() override {
+    stopped_ = true;
+    posted_.wake();
+  }
+
+  void submit_read(int fd, void *buf, std::size_t len, std::int64_t off,
+                   Op *op) override {
+    pending_++;
+    queue(IORING_OP_READ, fd, buf, len, off, reinterpret_cast<std::uint64_t>(op));
+  }
+  void submit_write(int fd, void *buf, std::size_t len, std::int64_t off,
+                    Op *op) override {
+    pending_++;
+    queue(IORING_OP_WRITE, fd, buf, len, off, reinterpret_cast<std::uint64_t>(op));
+  }
+
+  void run() override {
+    unsigned head, tail;
+    struct io_uring_cqe *cqe;
+    std::uint64_t ud;
+    long n;
+
+    stopped_ = false;
+    while(!stopped_ && pending_ > 0) {
+      n = enter(to_submit_, 1, IORING_ENTER_GETEVENTS);
+      if(n < 0 && errno != EINTR && errno != EBUSY)
+        break;
+      if(n > 0)
+        to_submit_ -= static_cast<unsigned>(n);
+
+      head = *cq_head_;
+      tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      while(head != tail) {
+        cqe = &cqes_[head & *cq_mask_];
+        ud = cqe->user_data;
+        n = cqe->res;
+        head++;
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+        if(WAKE == ud) {
+          for(std::coroutine_handle<> h : posted_.take()) {
+            pending_--;
+            h.resume();
+          }
+          arm_wake();
+        } else {
+          Op *op = reinterpret_cast<Op *>(ud);
+          op->res = n;
+          pending_--;
+          op->handle.resume();
+        }
+      }
+    }
+  }
+
+ private:
+  static constexpr std::uint64_t WAKE = 1;
+
+  UringExecutor() = default;
+
+  static long enter(int fd, unsigned to_submit, unsigned min, unsigned flags) {
+    return ::syscall(__NR_io_uring_enter, fd, to_submit, min, flags, nullptr, 0);
+  }
+  long enter(unsigned to_submit, unsigned min, unsigned flags) {
+    return enter(ring_, to_submit, min, flags);
+  }
+
+  bool setup(unsigned entries) {
+    struct io_uring_params p;
+    unsigned char *sq;
+
+    std::memset(&p, 0, sizeof(p));
+    ring_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+    if(ring_ < 0 || posted_.fd() < 0)
+      return false;
+
+    /* reads and writes go at offset -1; before 5.6 that's -EINVAL on
+       every one, so leave the ring to the destructor and use epoll */
+    if(!(p.features & IORING_FEAT_RW_CUR_POS))
+      return false;
+
+    sq_sz_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_sz_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if(p.features & IORING_FEAT_SINGLE_MMAP)
+      sq_sz_ = cq_sz_ = sq_sz_ > cq_sz_ ? sq_sz_ : cq_sz_;
+
+    sq_ = ::mmap(nullptr, sq_sz_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQ_RING);
+    if(sq_ == MAP_FAILED)
+      return false;
+    if(p.features & IORING_FEAT_SINGLE_MMAP)
+      cq_ = sq_;
+    else
+      cq_ = ::mmap(nullptr, cq_sz_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_CQ_RING);
+    if(cq_ == MAP_FAILED)
+      return false;
+    sqes_sz_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = ::mmap(nullptr, sqes_sz_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQES);
+    if(sqes_ == MAP_FAILED)
+      return false;
+
+    sq = static_cast<unsigned char *>(sq_);
+    sq_head_ = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+    sq_entries_ = p.sq_entries;
+
+    sq = static_cast<unsigned char *>(cq_);
+    cq_head_ = reinterpret_cast<unsigned *>(sq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(sq + p.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned *>(sq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe *>(sq + p.cq_off.cqes);
+
+    arm_wake();
+    return true;
+  }
+
+  /* post() and stop() write the eventfd; keep a read of it in the ring */
+  void arm_wake() {
+    queue(IORING_OP_READ, posted_.fd(), &wake_buf_, sizeof(wake_buf_), 0, WAKE);
+  }
+
+  void queue(int opcode, int fd, void *buf, std::size_t len,
+             std::int64_t off, std::uint64_t ud) {
+    unsigned tail = *sq_tail_, idx;
+    struct io_uring_sqe *sqe;
+
+    /* full: hand what we have to the kernel, which empties the ring */
+    while(tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == sq_entries_) {
+      long n = enter(to_submit_, 0, 0);
+      if(n > 0)
+        to_submit_ -= static_cast<unsigned>(n);
+    }
+
+    idx = tail & *sq_mask_;
+    sqe = &static_cast<struct io_uring_sqe *>(sqes_)[idx];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = static_cast<std::uint8_t>(opcode);
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<std::uint64_t>(buf);
+    sqe->len = static_cast<std::uint32_t>(len);
+    sqe->off = static_cast<std::uint64_t>(off);
+    sqe->user_data = ud;
+    sq_array_[idx] = idx;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    to_submit_++;
+  }
+
+  int ring_ = -1;
+  void *sq_ = MAP_FAILED, *cq_ = MAP_FAILED, *sqes_ = MAP_FAILED;
+  std::size_t sq_sz_ = 0, cq_sz_ = 0, sqes_sz_ = 0;
+  unsigned *sq_head_, *sq_tail_, *sq_mask_, *sq_array_, sq_entries_ = 0;
+  unsigned *cq_head_, *cq_tail_, *cq_mask_;
+  struct io_uring_cqe *cqes_;
+  unsigned to_submit_ = 0;
+  std::uint64_t wake_buf_ = 0;
+
+  detail::PostQueue posted_;
+  std::atomic<long> pending_{0};
+  std::atomic<bool> stopped_{false};
+};
+#endif /* PUZ_HAVE_URING */
+
+/* io_uring if we can have it, else epoll with @threads file workers */
+inline std::unique_ptr<Executor> make_executor(int threads = 4) {
+#ifdef PUZ_HAVE_URING
+  if(std::unique_ptr<UringExecutor> u = UringExecutor::create())
+    return u;
+#endif
+  return std::unique_ptr<Executor>(new EpollExecutor(threads));
+}
+
+/* Read @fd to the end and load what's there; @type is as for
+   puz_load().  Doesn't close @fd. */
+inline Task<Result<Puzzle>> async_load(Executor &ex, int fd,
+                                       int type = PUZ_FILE_UNKNOWN) {
+  struct puz_feed_t feed;
+  std::vector<unsigned char> buf(16384);
+  std::int64_t off;
+  struct puzzle_t *p;
+  long n;
+
+  if(fd < 0 || puz_feed_init(&feed, type) < 0)
+    co_return detail::fail<Puzzle>(Error::invalid_argument);
+
+  /* files by offset, so the workers can pread(); pipes as they come */
+  off = ::lseek(fd, 0, SEEK_CUR);
+
+  for(;;) {
+    n = co_await ex.read(fd, buf.data(), buf.size(), off);
+    if(-EINTR == n || -EAGAIN == n)
+      continue;
+    if(n < 0) {
+      puz_feed_free(&feed);
+      co_return detail::fail<Puzzle>(Error::io);
+    }
+    if(0 == n)
+      break;
+    if(PUZ_FEED_ERROR == puz_feed_write(&feed, buf.data(), static_cast<int>(n))) {
+      puz_feed_free(&feed);
+      co_return detail::fail<Puzzle>(Error::format);
+    }
+    if(off >= 0)
+      off += n;
+  }
+
+  p = puz_feed_finish(&feed);
+  if(nullptr == p)
+    co_return detail::fail<Puzzle>(Error::format);
+  co_return Puzzle(p);
+}
+
+inline Task<Result<Puzzle>> async_load(Executor &ex, std::string path,
+                                       int type = PUZ_FILE_UNKNOWN) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+  if(fd < 0)
+    co_return detail::fail<Puzzle>(Error::io);
+
+  Result<Puzzle> r = co_await async_load(ex, fd, type);
+  ::close(fd);
+  co_return std::move(r);
+}
+
+/* Write @puz out in the binary format; gives the byte count.  @puz is
+   read when the task starts, so it must be alive until then. */
+inline Task<Result<std::size_t>> async_save(Executor &ex, const Puzzle &puz,
+                                            int fd) {
+  Result<std::vector<unsigned char>> out = puz.save();
+  std::int64_t off;
+  std::size_t done = 0;
+  long n;
+
+  if(!out)
+    co_return detail::fail<std::size_t>(out.error());
+  if(fd < 0)
+    co_return detail::fail<std::size_t>(Error::invalid_argument);
+
+  off = ::lseek(fd, 0, SEEK_CUR);
+  while(done < out->size()) {
+    n = co_await ex.write(fd, out->data() + done, out->size() - done, off);
+    if(-EINTR == n || -EAGAIN == n)
+      continue;
+    if(n <= 0)
+      co_return detail::fail<std::size_t>(Error::io);
+    done += static_cast<std::size_t>(n);
+    if(off >= 0)
+      off += n;
+  }
+
+  co_return std::move(done);
+}
+
+inline Task<Result<std::size_t>> async_save(Executor &ex, const Puzzle &puz,
+                                            std::string path) {
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if(fd < 0)
+    co_return detail::fail<std::size_t>(Error::io);
+
+  Result<std::size_t> r = co_await async_save(ex, puz, fd);
+  if(::close(fd) < 0 && r)
+    co_return detail::fail<std::size_t>(Error::io);
+  co_return std::move(r);
+}
+
+} /* namespace puz */
+
+#endif /* ndef __LIBPUZ_ASYNC_HPP__ */
@@ -20,6 +20,7 @@
  * puz_init - initialize a puzzle
  *
  * @puz: pointer to the struct puzzle_t to init.  If NULL, one will be malloc'd for you.
+ *   Memory of your own needs only the usual alignment.
  *
  * This function is used to initialize a new struct puzzle_t to sane defaults.
  *
@@ -34,9 +35,10 @@ struct puzzle_t *puz_init(struct puzzle_t *puz) {
   unsigned char magic_18[4] = VER_MAGIC;
 
  if(NULL == puz) {
-    puz = (struct puzzle_t *)malloc(sizeof(struct puzzle_t));
+    /* on a cache line of its own; see struct puzzle_t */
+    puz = (struct puzzle_t *)aligned_alloc(64, PUZ_PUZZLE_ALLOC_SZ);
     if(NULL == puz) {
-      perror("malloc");
+      perror("aligned_alloc");
       return NULL;
     }
     didmalloc = 1;
@@ -44,8 +46,8 @@ struct puzzle_t *puz_init(struct puzzle_t *puz) {
 
   memset(puz, 0, sizeof(struct puzzle_t));
 
-  memcpy(puz->header.magic, file_magic, 12);
-  memcpy(puz->header.magic_18, magic_18, 4);
+  memcpy(puz->cold.magic, file_magic, 12);
+  memcpy(puz->cold.magic_18, magic_18, 4);
   puz->header.x_unk_30 = 0x0001;
 
   return puz;
@@ -68,6 +70,14 @@ void puz_deep_free (struct puzzle_t* puz) {
   if(NULL == puz)
     return;
 
+  /* the tables first: clearing them recounts progress, which reads
+     the boards */
+  if(puz->rtbl)
+    puz_clear_rtbl(puz);
+  if(puz->rusr)
+    puz_clear_rusr(puz);
+
+  puz_utf8_clear(puz);
   free(puz->solution);
   free(puz->grid);
   free(puz->title);
@@ -79,15 +89,9 @@ void puz_deep_free (struct puzzle_t* puz) {
 
   free(puz->notes);
   free(puz->grbs);
-
-  if(puz->rtbl)
-    puz_clear_rtbl(puz);
-
   free(puz->ltim);
   free(puz->gext);
-
-  if(puz->rusr)
-    puz_clear_rusr(puz);
+  free(puz->bitboard);
 
   free(puz);
 
@@ -177,6 +181,43 @@ int puz_size(struct puzzle_t *puz) {
 }
 
 
+/**
+ * puz_version_get - get the file format version of a puzzle
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ *
+ * The version is the "1.2"-style string at 0x18 in the header.
+ * Versions from PUZ_VERSION_UNICODE on keep their strings in UTF-8;
+ * earlier ones use the Windows code page.
+ *
+ * Returns -1 on error or if the version is unreadable; else the
+ * version times ten, eg: 12 for "1.2".
+ */
+int puz_version_get(struct puzzle_t *puz) {
+  unsigned char *v;
+
+  if(NULL == puz)
+    return -1;
+
+  v = puz->cold.magic_18;
+  if(v[0] < '0' || v[0] > '9' || v[1] != '.' || v[2] < '0' || v[2] > '9')
+    return -1;
+
+  return (v[0] - '0') * 10 + (v[2] - '0');
+}
+
+/**
+ * puz_is_unicode - check if a puzzle's strings are in UTF-8
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ *
+ * Returns 1 if the puzzle is version 2.0 or later, 0 if not or if the
+ * puzzle is NULL
+ */
+int puz_is_unicode(struct puzzle_t *puz) {
+  return puz_version_get(puz) >= PUZ_VERSION_UNICODE;
+}
+
 /**
  * puz_width_get - get the puzzle's width
  *
@@ -276,6 +317,8 @@ unsigned char * puz_solution_set(struct puzzle_t *puz, unsigned char *val) {
   free(puz->solution);
 
   puz->solution = Sstrdup(val);
+  puz_bitboard_calc(puz);
+  puz_progress_calc(puz);
 
   return puz->solution;
 }
@@ -310,6 +353,7 @@ unsigned char * puz_grid_set(struct puzzle_t *puz, unsigned char *val) {
   free(puz->grid);
 
   puz->grid = Sstrdup(val);
+  puz_progress_calc(puz);
 
   return puz->grid;
 }
@@ -341,6 +385,7 @@ unsigned char * puz_title_set(struct puzzle_t *puz, unsigned char *val) {
   if(NULL == puz || NULL == val)
     return NULL;
 
+  puz_utf8_clear(puz);
   free(puz->title);
 
   puz->title = Sstrdup(val);
@@ -375,6 +420,7 @@ unsigned char * puz_author_set(struct puzzle_t *puz, unsigned char *val) {
   if(NULL == puz || NULL == val)
     return NULL;
 
+  puz_utf8_clear(puz);
   free(puz->author);
 
   puz->author = Sstrdup(val);
@@ -409,6 +455,7 @@ unsigned char * puz_copyright_set(struct puzzle_t *puz, unsigned char *val) {
   if(NULL == puz || NULL == val)
     return NULL;
 
+  puz_utf8_clear(puz);
   free(puz->copyright);
 
   puz->copyright = Sstrdup(val);
@@ -443,6 +490,7 @@ unsigned char * puz_notes_set(struct puzzle_t *puz, unsigned char *val) {
   if(NULL == puz || NULL == val)
     return NULL;
 
+  puz_utf8_clear(puz);
   free(puz->notes);
 
   puz->notes = Sstrdup(val);
@@ -515,6 +563,7 @@ int puz_clear_clues(struct puzzle_t *puz) {
   if(NULL == puz || NULL == puz->clues)
     return -1;
 
+  puz_utf8_clear(puz);
   for(i = 0; i < puz->header.clue_count; i++)
     free(puz->clues[i]);
   
@@ -555,6 +604,7 @@ unsigned char * puz_clue_set(struct puzzle_t *puz, int n, unsigned char * val) {
   if(NULL == puz || n < 0 || n > puz->header.clue_count || NULL == val)
     return NULL;
 
+  puz_utf8_clear(puz);
   free(puz->clues[n]);
   puz->clues[n] = Sstrdup(val);
 
@@ -607,6 +657,7 @@ unsigned char * puz_rebus_set(struct puzzle_t *puz, unsigned char *val) {
   puz->grbs = calloc(size+1, sizeof (unsigned char));
   memcpy(puz->grbs, val, size);
   puz->grbs[size] = 0;
+  puz_progress_calc(puz);
 
   return puz->grbs;
 }
@@ -683,6 +734,7 @@ unsigned char * puz_rtbl_set(struct puzzle_t *puz, int n, unsigned char * val) {
 
   free(puz->rtbl[n]);
   puz->rtbl[n] = Sstrdup(val);
+  puz_progress_calc(puz);
 
   return puz->rtbl[n];
 }
@@ -773,6 +825,7 @@ char*v = (char*)val;
     (puz->rtbl[i])[end-start] = 0;
     start = end+1;
   }
+  puz_progress_calc(puz);
 
   return puz->rtbl;
 }
@@ -803,8 +856,9 @@ int puz_clear_rtbl(struct puzzle_t *puz) {
 
   puz->rtbl = NULL;
   puz->rtbl_sz = 0;
-  puz->rtbl_cksum = 0;
-  puz->calc_rtbl_cksum = 0;
+  puz->cold.rtbl_cksum = 0;
+  puz->cold.calc_rtbl_cksum = 0;
+  puz_progress_calc(puz);
 
   return 0;
 }
@@ -1021,6 +1075,7 @@ unsigned char ** puz_rusr_set(struct puzzle_t *puz, unsigned char ** val) {
 
   puz->rusr = rusr;
   puz->rusr_sz = rusr_sz;
+  puz_progress_calc(puz);
   return puz->rusr;
 }
 
@@ -1087,8 +1142,9 @@ int puz_clear_rusr(struct puzzle_t *puz) {
 
   puz->rusr = NULL;
   puz->rusr_sz = 0;
-  puz->rusr_cksum = 0;
-  puz->calc_rusr_cksum = 0;
+  puz->cold.rusr_cksum = 0;
+  puz->cold.calc_rusr_cksum = 0;
+  puz_progress_calc(puz);
 
   return 0;
 }
@@ -1127,7 +1183,7 @@ unsigned short puz_locked_cksum_get(struct puzzle_t *puz) {
   if(NULL == puz)
     return 0;
   
-  return puz->header.scrambled_cksum;
+  return puz->cold.scrambled_cksum;
 }
 
 /**
@@ -1150,143 +1206,203 @@ unsigned short puz_lock_set (struct puzzle_t *puz, unsigned short cksum) {
 
   if(cksum) {
     puz->header.scrambled_tag = 4;
-    puz->header.scrambled_cksum = cksum;
+    puz->cold.scrambled_cksum = cksum;
   } else {
     puz->header.scrambled_tag = 0;
-    puz->header.scrambled_cksum = 0x0000;
+    puz->cold.scrambled_cksum = 0x0000;
   }
 
   return cksum;
 }
 
 
+/*
+  Unlocking.  A locked solution is scrambled as one string: the
+  letters of the white squares in column-major order.  Each of the
+  four rounds of unscrambling, for key digit d, does three things:
+
+    unscramble: the string is [s[len/2], s[0], s[1+len/2], s[1], ...]
+                with its halves interleaved; put them back
+    unshift:    the string had its first d letters moved to the end;
+                move them back
+    unkey:      letter j had key digit j%4 added to it, mod 26
+
+  The first two only move letters, and where each letter goes depends
+  on nothing but len and d.  So they are done as one gather through a
+  table, one table per digit, made once per puzzle: trying a key is
+  then four passes over the letters with no allocation, which is what
+  makes puz_brute_force_unlock() fast.
+ */
+
+struct unlock_t {
+  int len;                 /* white squares */
+  int *order;              /* board index of each, column-major */
+  int *perm[10];           /* perm[d][k]: where letter k goes, digit d */
+  unsigned char *letters;  /* the scrambled string */
+  unsigned char *work[2];
+};
+
+static int unlock_prepare(struct puzzle_t *puz, struct unlock_t *u);
+static void unlock_free(struct unlock_t *u);
+static unsigned char *unlock_try(struct unlock_t *u, int *digits);
+static int code_digits(int code, int *digits);
+
 /**
- * unscramble_string - an internal function used by puz_unscramble.
- * 
- * Let s be a string and len be its length.  A "scrambled" version
- * of s looks like:
- *
- * [ s[len/2], s[0], s[1 + (len/2)], s[1], s[2 + (len/2)], s[2],  ...]
+ * unlock_order - list a board's white squares in column-major order
  *
- * This function takes such a scrambled string (inp) and unscrambles
- * it into another string (out).  inp and out had better have the same
- * length.
- * 
- * return -1 on error and 0 otherwise.
- * 
+ * This is an internal function.  It is always inlined, so the calls
+ * with the common board sizes get fixed-stride copies.  Returns the
+ * number of white squares.
  */
-unsigned short unscramble_string (unsigned char* inp, unsigned char* out) {
-  if(NULL == inp || NULL == out)
-    return -1;
-
-  int len = Sstrlen(inp);
-  int strbreak = len/2;
-  
-  int i;
-  for(i = 0; i < len; i++) {
-    int index;
-    if (0 == i%2) {
-      index = strbreak + i/2;
-    } else {
-      index = i/2;
+static inline __attribute__((always_inline))
+int unlock_order(unsigned char *sol, int w, int h, int *order) {
+  int r, c, n = 0;
+
+  for(c = 0; c < w; c++) {
+    for(r = 0; r < h; r++) {
+      if(sol[r*w + c] != '.')
+        order[n++] = r*w + c;
     }
-    
-    out[index] = inp[i];
   }
-  out[len] = 0;
 
-  return 0;
+  return n;
 }
 
 /**
- * unshift_string - an internal function used by puz_unscramble.
- * 
- * Given a string s and an int k, the "shifted" verison of s is created
- * by moving everything before index k to the end of the string.
- * 
- * This takes such a shifted string (inp) and undoes the shifting into
- * (out).
+ * unlock_prepare - work out everything about a key that doesn't depend on it
+ *
+ * @puz: the locked puzzle
+ * @u: filled in; free it with unlock_free()
  *
- * return -1 on error and 0 otherwise.
+ * This is an internal function.
+ *
+ * Return Value: 0 on success, -1 if out of memory.
  */
-unsigned short unshift_string(unsigned char* inp, unsigned int shift,
-                              unsigned char* out) {
-  if(NULL == inp || NULL == out)
-    return -1;
+static int unlock_prepare(struct puzzle_t *puz, struct unlock_t *u) {
+  int w = puz_width_get(puz), h = puz_height_get(puz);
+  int *unmix;
+  int d, k, len, half;
 
-  int len = Sstrlen(inp);
+  memset(u, 0, sizeof(*u));
 
-  if (len < (int)shift)
+  u->order = (int *)malloc((w * h + 1) * sizeof(int));
+  if(NULL == u->order)
     return -1;
 
-char*dest=(char*)out+shift;
-char*src=(char*)inp;
-  strncpy(dest,src, len - shift);
-dest=(char*)out;
-src=(char*)inp+(len-shift);
-  strncpy(dest,src, shift);
+  if(15 == w && 15 == h)
+    len = unlock_order(puz->solution, 15, 15, u->order);
+  else if(21 == w && 21 == h)
+    len = unlock_order(puz->solution, 21, 21, u->order);
+  else
+    len = unlock_order(puz->solution, w, h, u->order);
+  u->len = len;
+
+  u->letters = (unsigned char *)malloc(len + 1);
+  u->work[0] = (unsigned char *)malloc(len + 1);
+  u->work[1] = (unsigned char *)malloc(len + 1);
+  unmix = (int *)malloc((len + 1) * sizeof(int));
+  if(NULL == u->letters || NULL == u->work[0] || NULL == u->work[1] ||
+     NULL == unmix) {
+    free(unmix);
+    unlock_free(u);
+    return -1;
+  }
 
-  out[len] = 0;
+  for(k = 0; k < len; k++)
+    u->letters[k] = puz->solution[u->order[k]];
+
+  /* even positions came from the back half, odd from the front */
+  half = len / 2;
+  for(k = 0; k < len; k++)
+    unmix[k] = (k % 2) ? k / 2 : half + k / 2;
+
+  /* a digit longer than the string can't have been used to lock it */
+  for(d = 1; d <= 9 && d <= len; d++) {
+    u->perm[d] = (int *)malloc((len + 1) * sizeof(int));
+    if(NULL == u->perm[d]) {
+      free(unmix);
+      unlock_free(u);
+      return -1;
+    }
+    for(k = 0; k < len; k++)
+      u->perm[d][k] = (unmix[k] + d) % len;
+  }
+
+  free(unmix);
 
   return 0;
 }
 
-/* the scrambling functions use this impossibly unfortunate
-   representation for the board.  We calculate it here.
+/**
+ * unlock_free - free what unlock_prepare() made
+ *
+ * This is an internal function.
+ */
+static void unlock_free(struct unlock_t *u) {
+  int d;
+
+  free(u->order);
+  free(u->letters);
+  free(u->work[0]);
+  free(u->work[1]);
+  for(d = 0; d < 10; d++)
+    free(u->perm[d]);
+  memset(u, 0, sizeof(*u));
+}
 
-   NULL on error
+/**
+ * unlock_try - unscramble with one key
+ *
+ * @u: from unlock_prepare()
+ * @digits: the key's four digits, each 1 to 9
+ *
+ * This is an internal function.
+ *
+ * Return Value: NULL if the key can't have been used (a digit longer
+ * than the string), else the unscrambled string, in u->work.
  */
-unsigned char* formatted_solution(struct puzzle_t* puz) {
-  if (puz == NULL)
-    return NULL;
+static unsigned char *unlock_try(struct unlock_t *u, int *digits) {
+  unsigned char *in = u->letters, *out = u->work[0];
+  int i, k, *perm;
 
-  int w = puz_width_get(puz);
-  int h = puz_height_get(puz);
-  int board_sz = w*h;
-  
-  unsigned char* sol = puz_solution_get(puz);
+  for(i = 3; i >= 0; i--) {
+    perm = u->perm[digits[i]];
+    if(NULL == perm)
+      return NULL;
 
-  int i,size = 0;
-  for(i=0; i < board_sz; i++) {
-    if(sol[i] != '.')
-      size++;
-  }
+    for(k = 0; k < u->len; k++)
+      out[perm[k]] = in[k];
 
-  unsigned char* out = calloc(size+1, sizeof(unsigned char));
-  int j,index = 0;
-  for(i=0; i < w; i++) {
-    for(j=0; j < h; j++) {
-      if (sol[j*h + i] != '.') {
-        out[index] = sol[j*h + i];
-        index++;
-      }
+    for(k = 0; k < u->len; k++) {
+      out[k] -= digits[k % 4];
+      if(out[k] < 65)
+        out[k] += 26;
     }
+
+    in = out;
+    out = (out == u->work[0]) ? u->work[1] : u->work[0];
   }
 
-  out[size] = 0;
-  return out;
+  return in;
 }
 
-int unformat_unlocked_sol(struct puzzle_t* puz, unsigned char* formatted) {
-  if (puz == NULL || formatted == NULL)
-    return -1;
-
-  int w = puz_width_get(puz);
-  int h = puz_height_get(puz);
-
-  unsigned char* sol = puz_solution_get(puz);
+/**
+ * code_digits - split a key into its digits
+ *
+ * This is an internal function.  Returns 0 if the key is valid (four
+ * digits, none of them 0), else -1.
+ */
+static int code_digits(int code, int *digits) {
+  int i;
 
-  int i,j;
-  int index = 0;
+  digits[0] = (code/1000) % 10;
+  digits[1] = (code/100)  % 10;
+  digits[2] = (code/10)   % 10;
+  digits[3] = code        % 10;
 
-  // XXX this could fail if we calculated something poorly (but shouldn't)
-  for(i=0; i < w; i++) {
-    for(j=0; j < h; j++) {
-      if (sol[j*h + i] != '.') {
-        sol[j*h + i] = formatted[index];
-        index++;
-      }
-    }
+  for(i = 0; i < 4; i++) {
+    if(digits[i] == 0)
+      return -1;
   }
 
   return 0;
@@ -1305,116 +1421,156 @@ int unformat_unlocked_sol(struct puzzle_t* puz, unsigned char* formatted) {
  *   2 means the code didn't work
  */
 int puz_unlock_solution(struct puzzle_t* puz, unsigned short code) {
+  struct unlock_t u;
+  unsigned char *out;
+  int digits[4], k;
 
-  if(NULL == puz)
+  if(NULL == puz || NULL == puz->solution)
     return -1;
 
-
   // make sure the puzzle is actually scrambled
   if(!(puz->header.scrambled_tag)) {
     return 1;
   }
 
-  int digits[4];
-  digits[0] = (code/1000) % 10;
-  digits[1] = (code/100)  % 10;
-  digits[2] = (code/10)   % 10;
-  digits[3] = code        % 10;
-
   // make sure the code is valid
-  int i;
-  for (i = 0; i < 4; i++) {
-    if(digits[i] == 0)
-      return -2;
-  }
+  if(code_digits(code, digits))
+    return -2;
 
-  // first we must calculate the unscrambled solution.  It's possible
-  // the key passed will be wrong and we'll have to fail after we
-  // calculate it.
-  unsigned char* inp = formatted_solution(puz);
-  int len = Sstrlen(inp);
-  unsigned char* workspace1 = calloc(len+1, sizeof(unsigned char));
-  unsigned char* workspace2 = calloc(len+1, sizeof(unsigned char));
-  if (NULL == workspace1 || NULL == workspace2)
+  if(unlock_prepare(puz, &u))
     return -3;
 
-char*src=(char*)workspace1;
-char*dst=(char*)inp;
-  strncpy(src,dst, len+1);
-
-  int e1, e2, j;
-  for(i = 3; i >= 0; i--) {
-    e1 = unscramble_string(workspace1, workspace2);
-    e2 = unshift_string(workspace2, digits[i], workspace1);
-    if(e1 || e2)
-      return -4;
-   
-    for (j = 0; j < len; j++) {
-      workspace1[j] -= digits[j % 4];
-      if (workspace1[j] < 65)
-        workspace1[j] += 26;
-    }
-  }
-
-  // Now we have to check - did this unscrambling mess actually
-  // produce something with the right checksum?  The stored
-  // checksum is for the solution _without_ black squares, so 
-  // first we create a copy without them in workspace 2.
-  int index = 0;
-  for(j=0; j<len; j++) {
-    if(workspace1[j] != '.') {
-      workspace2[index] = workspace1[j];
-      index++;
-    }
+  out = unlock_try(&u, digits);
+  if(NULL == out) {
+    unlock_free(&u);
+    return -4;
   }
-  workspace2[j] = 0;
 
-  unsigned short cksum = puz_cksum_region(workspace2, len, 0x0000);
-  if (cksum != puz->header.scrambled_cksum) {
+  // The stored checksum is for the unscrambled string, so a match
+  // means it's almost certainly the correct board.
+  if(puz_cksum_region(out, u.len, 0x0000) != puz->cold.scrambled_cksum) {
+    unlock_free(&u);
     return 2;
   }
 
-  // Awesome, the unscrambled solution has the right checksum, so
-  // it's almost certainly the correct board.  Copy it in as the solution
-  // and fix up all the scrambled markers
-  unformat_unlocked_sol(puz, workspace1);
+  for(k = 0; k < u.len; k++)
+    puz->solution[u.order[k]] = out[k];
   puz_lock_set(puz, 0x0000);
+  puz_progress_calc(puz);
+
+  unlock_free(&u);
 
-  free(workspace1);
-  free(workspace2);
-  
   return 0;
 }
 
 
+/* One first digit's worth of keys for puz_brute_force_unlock() */
+struct unlock_job_t {
+  struct unlock_t u;       /* shares the tables; its own work buffers */
+  unsigned short cksum;
+  int first;               /* the key's first digit */
+  int *found;              /* shared: the lowest key that matched */
+};
+
+/**
+ * unlock_keys - try every key with one first digit
+ *
+ * This is an internal function, the pool task for
+ * puz_brute_force_unlock().  Keys are tried in order, and it stops as
+ * soon as another task has matched a lower key, since only the lowest
+ * match is wanted.
+ */
+static void unlock_keys(void *arg) {
+  struct unlock_job_t *job = (struct unlock_job_t *)arg;
+  unsigned char *out;
+  int digits[4], code, old;
+
+  for(code = job->first * 1000 + 111; code < (job->first + 1) * 1000;
+      code++) {
+    old = __atomic_load_n(job->found, __ATOMIC_RELAXED);
+    if(old && old < code)
+      return;
+
+    if(code_digits(code, digits))
+      continue;
+
+    out = unlock_try(&job->u, digits);
+    if(out && puz_cksum_region(out, job->u.len, 0x0000) == job->cksum) {
+      while((0 == old || code < old) &&
+            !__atomic_compare_exchange_n(job->found, &old, code, 0,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+      return;
+    }
+  }
+}
+
 /**
  * puz_brute_force_unlock - unscramble a locked puzzle without the key
  *
  * @puz: a pointer to the struct puzzle_t to check (required) 
  *
+ * Every key is tried against one set of tables from unlock_prepare(),
+ * so this costs little more than 6561 checksums of the white squares.
+ * The keys are split by first digit into tasks on the library's
+ * thread pool; once one matches, the tasks with higher keys stop.
+ * The checksum is only 16 bits, so more than one key can match: the
+ * lowest always wins, as it would trying them one by one.
+ *
  * On success, returns the correct code.  Otherwise, it returns an
  * integer less than 0.
  */
 int puz_brute_force_unlock(struct puzzle_t* puz) {
+  struct unlock_t u;
+  struct unlock_job_t jobs[9];
+  struct puz_group_t g;
+  unsigned char *out;
+  int digits[4], found = 0, d, k, rv = -3;
+
   // make sure we were given a puzzle that's scrambled
-  if(NULL == puz)
+  if(NULL == puz || NULL == puz->solution)
     return -1;
   if(!(puz->header.scrambled_tag))
     return -2;
 
+  if(unlock_prepare(puz, &u))
+    return -3;
 
-  int code = 1111;
-  int great_success;
-for (; code < 10000; code++) {
-    great_success = puz_unlock_solution(puz,code);
-    if(!great_success) {
-      break;
-    }
+  memset(jobs, 0, sizeof(jobs));
+  for(d = 0; d < 9; d++) {
+    jobs[d].u = u;
+    jobs[d].u.work[0] = (unsigned char *)malloc(u.len + 1);
+    jobs[d].u.work[1] = (unsigned char *)malloc(u.len + 1);
+    if(NULL == jobs[d].u.work[0] || NULL == jobs[d].u.work[1])
+      goto out;
+    jobs[d].cksum = puz->cold.scrambled_cksum;
+    jobs[d].first = d + 1;
+    jobs[d].found = &found;
   }
 
-  if(great_success) {
-    return -3;
-  } else {
-    return code;
+  /* the low keys, which win ties, go first */
+  puz_group_init(&g);
+  for(d = 1; d < 9; d++)
+    puz_group_spawn(&g, unlock_keys, &jobs[d]);
+  unlock_keys(&jobs[0]);
+  puz_group_wait(&g);
+
+  if(found) {
+    code_digits(found, digits);
+    out = unlock_try(&u, digits);
+    for(k = 0; k < u.len; k++)
+      puz->solution[u.order[k]] = out[k];
+    puz_lock_set(puz, 0x0000);
+    puz_progress_calc(puz);
+    rv = found;
   }
+
+ out:
+  for(d = 0; d < 9; d++) {
+    free(jobs[d].u.work[0]);
+    free(jobs[d].u.work[1]);
+  }
+  unlock_free(&u);
+
+  return rv;
 }
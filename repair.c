@@ -0,0 +1,372 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * repair.c -- In-place checksum repair of binary puzzle files
+ */
+
+#include <puz.h>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+  The checksums are worked out straight from the file's bytes, the
+  same way puz_cksums_calc() works them out from a loaded puzzle, so
+  nothing is allocated or parsed into a puzzle_t.  Only the checksum
+  fields that are wrong get written, through a shared mapping, so a
+  repaired file differs from the original in those bytes alone and
+  the kernel writes back only the pages holding them.
+ */
+
+struct repair_job_t {
+  char **paths;
+  int n;
+  int flags;
+  int *next; /* shared: the next path to take */
+
+  void (*cb)(const char *path, int fixed, void *arg);
+  void *arg;
+  pthread_mutex_t *cb_lock;
+
+  struct puz_repair_report_t report;
+};
+
+static int repair_strings(unsigned char *base, int sz, int *i, int clues,
+                          unsigned short *cksum);
+static void repair_put(unsigned char *field, unsigned short ck, int *fixed,
+                       int region, int flags);
+static void repair_worker(void *arg);
+
+/**
+ * repair_strings - checksum the strings, as puz_cksum2() does
+ *
+ * @base: the file
+ * @sz: its size
+ * @i: offset of the title; set to the offset after the notes
+ * @clues: the clue count
+ * @cksum: in, the initial value; out, the checksum
+ *
+ * This is an internal function.
+ *
+ * Return Value: -1 if the strings run off the end of the file, else 0.
+ */
+static int repair_strings(unsigned char *base, int sz, int *i, int clues,
+                          unsigned short *cksum) {
+  unsigned char *end;
+  int j, len, pos = *i;
+
+  /* title, author, copyright, the clues, then the notes */
+  for(j = 0; j < clues + 4; j++) {
+    if(pos >= sz) {
+      /* the notes may be left off entirely */
+      if(j == clues + 3)
+        break;
+      return -1;
+    }
+
+    end = memchr(base + pos, 0, sz - pos);
+    if(NULL == end)
+      return -1;
+    len = end - (base + pos);
+
+    /* the clues go in without their NULs, the others with, if set */
+    if(j >= 3 && j < clues + 3)
+      *cksum = puz_cksum_region(base + pos, len, *cksum);
+    else if(len > 0)
+      *cksum = puz_cksum_region(base + pos, len + 1, *cksum);
+
+    pos += len + 1;
+  }
+
+  *i = pos;
+
+  return 0;
+}
+
+/**
+ * repair_put - write a checksum field if it is wrong
+ *
+ * This is an internal function.  @fixed gets @region if the field
+ * was wrong; it is only written outside a dry run.
+ */
+static void repair_put(unsigned char *field, unsigned short ck, int *fixed,
+                       int region, int flags) {
+  if(le_16(field) == ck)
+    return;
+
+  *fixed |= region;
+  if(!(flags & PUZ_REPAIR_DRY_RUN)) {
+    w_le_16(field, ck);
+  }
+}
+
+/**
+ * puz_cksums_repair - fix the checksums of a binary puzzle in place
+ *
+ * @base: the file, writable unless @flags has PUZ_REPAIR_DRY_RUN (required)
+ * @sz: its size
+ * @flags: PUZ_REPAIR_DRY_RUN to only report
+ *
+ * Finds the checksums puz_cksums_check() would complain about and
+ * rewrites just those fields: the file checksum at 0x00, the CIB
+ * checksum at 0x0e, the magic bytes at 0x10..0x17 for the CIB,
+ * solution, grid and strings, and the checksum of each extra section.
+ * Nothing else in @base is touched.  The extra sections are
+ * checksummed as stored, whatever is in them.
+ *
+ * Files that aren't binary puzzles, or whose strings or sections run
+ * off the end, are left alone; puz_load_salvage() is for those.
+ *
+ * Return Value: -1 if the file couldn't be parsed, else the
+ * PUZ_REGION_* bits of the checksums that were wrong (0 if none).
+ */
+int puz_cksums_repair(unsigned char *base, int sz, int flags) {
+  unsigned char file_magic[12] = FILE_MAGIC;
+  unsigned char m10[4] = MAGIC_10_MASK;
+  unsigned char m14[4] = MAGIC_14_MASK;
+  unsigned short sums[4], ck;
+  int i, j, bd_sz, len, region, fixed = 0;
+
+  if(NULL == base || sz < 0x34 || 0 != memcmp(base + 2, file_magic, 12))
+    return -1;
+
+  bd_sz = base[0x2c] * base[0x2d];
+  i = 0x34 + 2 * bd_sz;
+  if(i > sz)
+    return -1;
+
+  sums[0] = puz_cksum_region(base + 0x2c, 8, 0x0000);
+  sums[1] = puz_cksum_region(base + 0x34, bd_sz, 0x0000);
+  sums[2] = puz_cksum_region(base + 0x34 + bd_sz, bd_sz, 0x0000);
+
+  /* the file checksum carries on from the CIB through the same bytes */
+  ck = puz_cksum_region(base + 0x34, 2 * bd_sz, sums[0]);
+  j = i;
+  sums[3] = 0x0000;
+  if(repair_strings(base, sz, &j, le_16(base + 0x2e), &sums[3]) < 0 ||
+     repair_strings(base, sz, &i, le_16(base + 0x2e), &ck) < 0)
+    return -1;
+
+  /* make sure the sections fit before writing anything */
+  for(j = i; j + 8 <= sz; j += 8 + len + 1) {
+    len = le_16(base + j + 4);
+    if(j + 8 + len + 1 > sz)
+      return -1;
+  }
+
+  repair_put(base + 0x00, ck, &fixed, PUZ_REGION_FILE, flags);
+  repair_put(base + 0x0e, sums[0], &fixed, PUZ_REGION_CIB, flags);
+
+  for(j = 0; j < 4; j++) {
+    unsigned char lo = (sums[j] & 0xFF) ^ m10[j];
+    unsigned char hi = ((sums[j] & 0xFF00) >> 8) ^ m14[j];
+
+    if(base[0x10 + j] == lo && base[0x14 + j] == hi)
+      continue;
+
+    fixed |= j == 0 ? PUZ_REGION_CIB : PUZ_REGION_SOLUTION << (j - 1);
+    if(!(flags & PUZ_REPAIR_DRY_RUN)) {
+      base[0x10 + j] = lo;
+      base[0x14 + j] = hi;
+    }
+  }
+
+  /* the extra sections, each with its own checksum */
+  while(i + 8 <= sz) {
+    len = le_16(base + i + 4);
+
+    if(0 == memcmp(base + i, "GRBS", 4))
+      region = PUZ_REGION_GRBS;
+    else if(0 == memcmp(base + i, "RTBL", 4))
+      region = PUZ_REGION_RTBL;
+    else if(0 == memcmp(base + i, "LTIM", 4))
+      region = PUZ_REGION_LTIM;
+    else if(0 == memcmp(base + i, "GEXT", 4))
+      region = PUZ_REGION_GEXT;
+    else if(0 == memcmp(base + i, "RUSR", 4))
+      region = PUZ_REGION_RUSR;
+    else
+      region = 0;
+
+    if(region) {
+      ck = puz_cksum_region(base + i + 8, len, 0x0000);
+      repair_put(base + i + 6, ck, &fixed, region, flags);
+    }
+
+    i += 8 + len + 1;
+  }
+
+  return fixed;
+}
+
+/**
+ * puz_cksums_repair_file - fix the checksums of a puzzle file in place
+ *
+ * @path: the file (required)
+ * @flags: as for puz_cksums_repair()
+ *
+ * The file is mapped rather than read, so only the pages holding
+ * wrong checksums are ever written back.  A dry run opens it
+ * read-only.
+ *
+ * Return Value: as for puz_cksums_repair(); also -1 if the file
+ * can't be opened or mapped.
+ */
+int puz_cksums_repair_file(const char *path, int flags) {
+  struct stat st;
+  void *base;
+  int fd, rv, dry = flags & PUZ_REPAIR_DRY_RUN;
+
+  if(NULL == path)
+    return -1;
+
+  fd = open(path, dry ? O_RDONLY : O_RDWR);
+  if(fd < 0) {
+    perror(path);
+    return -1;
+  }
+
+  if(fstat(fd, &st) < 0 || st.st_size < 0x34 || st.st_size > INT_MAX) {
+    close(fd);
+    return -1;
+  }
+
+  base = mmap(NULL, st.st_size, dry ? PROT_READ : PROT_READ | PROT_WRITE,
+              MAP_SHARED, fd, 0);
+  close(fd);
+  if(MAP_FAILED == base) {
+    perror("mmap");
+    return -1;
+  }
+
+  rv = puz_cksums_repair((unsigned char *)base, st.st_size, flags);
+
+  munmap(base, st.st_size);
+
+  return rv;
+}
+
+/**
+ * repair_worker - repair files until there are none left
+ *
+ * This is an internal function, the pool task for
+ * puz_cksums_repair_files().
+ */
+static void repair_worker(void *arg) {
+  struct repair_job_t *job = (struct repair_job_t *)arg;
+  struct puz_repair_report_t *r = &job->report;
+  int i, b, fixed;
+
+  while((i = __atomic_fetch_add(job->next, 1, __ATOMIC_RELAXED)) < job->n) {
+    fixed = puz_cksums_repair_file(job->paths[i], job->flags);
+
+    r->files++;
+    if(fixed < 0) {
+      r->failed++;
+    } else if(0 == fixed) {
+      r->clean++;
+    } else {
+      r->repaired++;
+      for(b = 0; b < PUZ_REGIONS; b++) {
+        if(fixed & (1 << b))
+          r->fields[b]++;
+      }
+    }
+
+    if(job->cb) {
+      pthread_mutex_lock(job->cb_lock);
+      job->cb(job->paths[i], fixed, job->arg);
+      pthread_mutex_unlock(job->cb_lock);
+    }
+  }
+}
+
+/**
+ * puz_cksums_repair_files - fix the checksums of many puzzle files
+ *
+ * @paths: the files (required)
+ * @n: how many
+ * @nthreads: tasks to use, on the library's thread pool; 0 or less
+ *   means one per pool thread, plus this one
+ * @flags: as for puz_cksums_repair()
+ * @report: filled in with totals (required)
+ * @cb: if set, called with each path and its puz_cksums_repair_file()
+ *   result; calls are serialized, but come from the pool's threads
+ *   and not in any particular order
+ * @arg: passed to @cb
+ *
+ * With PUZ_REPAIR_DRY_RUN this is the report of what would be fixed.
+ * Several tasks keep several files in flight, which is what it
+ * takes to keep a disk busy with files this small.
+ *
+ * Return Value: -1 on error, else the number of files with wrong
+ * checksums.
+ */
+int puz_cksums_repair_files(char **paths, int n, int nthreads, int flags,
+                            struct puz_repair_report_t *report,
+                            void (*cb)(const char *path, int fixed, void *arg),
+                            void *arg) {
+  struct repair_job_t *jobs;
+  struct puz_group_t g;
+  pthread_mutex_t cb_lock = PTHREAD_MUTEX_INITIALIZER;
+  int i, b, next = 0;
+
+  if(NULL == paths || NULL == report || n < 0)
+    return -1;
+
+  memset(report, 0, sizeof(struct puz_repair_report_t));
+  if(0 == n)
+    return 0;
+
+  if(nthreads <= 0)
+    nthreads = puz_pool_threads_get() + 1;
+  if(nthreads > n)
+    nthreads = n;
+
+  jobs = (struct repair_job_t *)calloc(nthreads, sizeof(struct repair_job_t));
+  if(NULL == jobs) {
+    perror("calloc");
+    return -1;
+  }
+
+  for(i = 0; i < nthreads; i++) {
+    jobs[i].paths = paths;
+    jobs[i].n = n;
+    jobs[i].flags = flags;
+    jobs[i].next = &next;
+    jobs[i].cb = cb;
+    jobs[i].arg = arg;
+    jobs[i].cb_lock = &cb_lock;
+  }
+
+  /* the calling thread works too */
+  puz_group_init(&g);
+  for(i = 1; i < nthreads; i++)
+    puz_group_spawn(&g, repair_worker, &jobs[i]);
+  repair_worker(&jobs[0]);
+  puz_group_wait(&g);
+
+  for(i = 0; i < nthreads; i++) {
+    report->files += jobs[i].report.files;
+    report->clean += jobs[i].report.clean;
+    report->repaired += jobs[i].report.repaired;
+    report->failed += jobs[i].report.failed;
+    for(b = 0; b < PUZ_REGIONS; b++)
+      report->fields[b] += jobs[i].report.fields[b];
+  }
+
+  free(jobs);
+
+  return report->repaired;
+}
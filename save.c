@@ -0,0 +1,177 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * save.c -- Write puzzles out in the binary format
+ */
+
+#include <puz.h>
+
+static unsigned char *put_16(unsigned char *p, unsigned short v);
+static unsigned char *put_str(unsigned char *p, unsigned char *s);
+static unsigned char *put_head(unsigned char *p, struct puzzle_t *puz);
+static unsigned char *put_section(unsigned char *p, const char *name,
+                                  unsigned char *data, int len,
+                                  unsigned short cksum);
+
+/**
+ * put_16 - write a little-endian short
+ *
+ * This is an internal function.  Returns the position after it.
+ */
+static unsigned char *put_16(unsigned char *p, unsigned short v) {
+  w_le_16(p, v);
+  return p + 2;
+}
+
+/**
+ * put_str - write a string with its terminator
+ *
+ * This is an internal function.  A NULL string is written as empty.
+ * Returns the position after it.
+ */
+static unsigned char *put_str(unsigned char *p, unsigned char *s) {
+  int len = s ? Sstrlen(s) : 0;
+
+  if(len)
+    memcpy(p, s, len);
+  p[len] = 0;
+
+  return p + len + 1;
+}
+
+/**
+ * put_head - write the 0x34-byte header
+ *
+ * This is an internal function, the reverse of read_puz_head().
+ * Returns the position after it.
+ */
+static unsigned char *put_head(unsigned char *p, struct puzzle_t *puz) {
+  struct puz_cold_t *c = &puz->cold;
+  struct puz_head_t *h = &puz->header;
+
+  p = put_16(p, c->cksum_puz);
+  memcpy(p, c->magic, 12);
+  p += 12;
+  p = put_16(p, c->cksum_cib);
+  memcpy(p, c->magic_10, 4);
+  p += 4;
+  memcpy(p, c->magic_14, 4);
+  p += 4;
+  memcpy(p, c->magic_18, 4); /* the version, kept as loaded */
+  p += 4;
+  p = put_16(p, c->noise_1c);
+  p = put_16(p, c->scrambled_cksum);
+  p = put_16(p, c->noise_20);
+  p = put_16(p, c->noise_22);
+  p = put_16(p, c->noise_24);
+  p = put_16(p, c->noise_26);
+  p = put_16(p, c->noise_28);
+  p = put_16(p, c->noise_2a);
+  *p++ = h->width;
+  *p++ = h->height;
+  p = put_16(p, h->clue_count);
+  p = put_16(p, h->x_unk_30);
+  p = put_16(p, h->scrambled_tag);
+
+  return p;
+}
+
+/**
+ * put_section - write one extra section: name, size, checksum, data, NUL
+ *
+ * This is an internal function.  Returns the position after it.
+ */
+static unsigned char *put_section(unsigned char *p, const char *name,
+                                  unsigned char *data, int len,
+                                  unsigned short cksum) {
+  memcpy(p, name, 4);
+  p = put_16(p + 4, len);
+  p = put_16(p, cksum);
+  memcpy(p, data, len);
+  p[len] = 0;
+
+  return p + len + 1;
+}
+
+/**
+ * puz_save - write a puzzle out
+ *
+ * @puz: the puzzle to write (required)
+ * @type: PUZ_FILE_BINARY (or PUZ_FILE_UNKNOWN, meaning the same)
+ * @base: buffer to write into (required)
+ * @sz: size of the buffer; puz_size() says how much is needed
+ *
+ * The header is written as it stands, so the file keeps the version
+ * it was loaded with (see puz_version_get()).  The checksums are not
+ * recalculated: call puz_cksums_commit() first if the puzzle has been
+ * changed.  The extra sections are written in the order Across Lite
+ * writes them: GRBS, RTBL, LTIM, GEXT, RUSR.  Writing the text format
+ * isn't supported.
+ *
+ * Return Value: -1 on error, else the number of bytes written.
+ */
+int puz_save(struct puzzle_t *puz, int type, unsigned char *base, int sz) {
+  unsigned char *p, *s;
+  int i, bd_sz, need;
+
+  if(NULL == puz || NULL == base || NULL == puz->solution || NULL == puz->grid)
+    return -1;
+
+  if(type != PUZ_FILE_BINARY && type != PUZ_FILE_UNKNOWN) {
+    printf("Only the binary format can be saved\n");
+    return -1;
+  }
+
+  need = puz_size(puz);
+  if(need < 0 || need > sz)
+    return -1;
+
+  bd_sz = puz->header.width * puz->header.height;
+
+  p = put_head(base, puz);
+
+  memcpy(p, puz->solution, bd_sz);
+  p += bd_sz;
+  memcpy(p, puz->grid, bd_sz);
+  p += bd_sz;
+
+  p = put_str(p, puz->title);
+  p = put_str(p, puz->author);
+  p = put_str(p, puz->copyright);
+  for(i = 0; i < puz->header.clue_count; i++)
+    p = put_str(p, puz->clues[i]);
+  p = put_str(p, puz->notes);
+
+  if(puz_has_rebus(puz)) {
+    p = put_section(p, "GRBS", puz->grbs, bd_sz, puz->cold.grbs_cksum);
+
+    s = puz_rtblstr_get(puz);
+    if(NULL == s)
+      return -1;
+    p = put_section(p, "RTBL", s, Sstrlen(s), puz->cold.rtbl_cksum);
+    free(s);
+  }
+
+  if(puz_has_timer(puz))
+    p = put_section(p, "LTIM", puz->ltim, Sstrlen(puz->ltim), puz->cold.ltim_cksum);
+
+  if(puz_has_extras(puz))
+    p = put_section(p, "GEXT", puz->gext, bd_sz, puz->cold.gext_cksum);
+
+  if(puz_has_rusr(puz)) {
+    s = puz_rusrstr_get(puz);
+    if(NULL == s)
+      return -1;
+    p = put_section(p, "RUSR", s, puz->rusr_sz, puz->cold.rusr_cksum);
+    free(s);
+  }
+
+  return p - base;
+}
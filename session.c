@@ -0,0 +1,556 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * session.c -- Many solvers' board states over one shared puzzle
+ */
+
+#include <puz.h>
+
+/*
+  When thousands of people solve the same puzzle, all that differs
+  between them is the board state: grid, GEXT, RUSR and LTIM, the
+  same fields a struct puz_snapshot_t holds.  The solution, strings,
+  clues and rebus table are the same for all of them.
+
+  So the puzzle is loaded once and handed to puz_base_new(), which
+  makes it a reference-counted struct puz_base_t that nothing writes
+  to again.  Each solver gets a struct puz_session_t over it, which
+  starts out pointing at the base's board state and takes its own
+  copy of one part only when that part is first changed.  A session
+  that has only typed letters costs its struct and a grid.
+
+  puz_session_view() puts the two together as a struct puzzle_t that
+  borrows everything, so all the usual getters, puz_save(),
+  puz_wire_encode() and the checking functions work on a session
+  as-is.  The edits go through the puz_session_* setters, which take
+  the copy first, then do the edit on a view with the usual setter
+  and keep what it changed.
+
+  The base is made ready for sharing up front: its UTF-8 views are
+  made then, not on first use, so reading it from many threads at
+  once writes nothing.  A session belongs to one thread at a time.
+ */
+
+/* which of a session's board pointers are its own */
+#define SESSION_GRID 1
+#define SESSION_GEXT 2
+#define SESSION_RUSR 4
+#define SESSION_LTIM 8
+
+static int session_own(struct puz_session_t *sess, int what);
+static void session_keep(struct puz_session_t *sess, struct puzzle_t *view,
+                         int what);
+
+/**
+ * puz_base_new - share a puzzle among sessions
+ *
+ * @puz: the puzzle, from puz_load(NULL, ...) or puz_init(NULL).  The
+ *   base takes it over, and frees it with the last reference.
+ *
+ * Nothing may change @puz from here on except through a session,
+ * which never writes to it.
+ *
+ * Return Value: NULL on error, else a new base holding one reference,
+ * the caller's.
+ */
+struct puz_base_t *puz_base_new(struct puzzle_t *puz) {
+  struct puz_base_t *base;
+
+  if(NULL == puz)
+    return NULL;
+
+  if(puz_utf8_calc(puz) < 0)
+    return NULL;
+
+  base = (struct puz_base_t *)malloc(sizeof(struct puz_base_t));
+  if(NULL == base) {
+    perror("malloc");
+    return NULL;
+  }
+
+  base->puz = puz;
+  base->refs = 1;
+
+  return base;
+}
+
+/**
+ * puz_base_ref - take another reference to a base
+ *
+ * @base: the base (required)
+ *
+ * Return Value: @base.
+ */
+struct puz_base_t *puz_base_ref(struct puz_base_t *base) {
+  if(NULL == base)
+    return NULL;
+
+  __atomic_add_fetch(&base->refs, 1, __ATOMIC_RELAXED);
+  return base;
+}
+
+/**
+ * puz_base_unref - drop a reference to a base
+ *
+ * @base: the base
+ *
+ * The last reference frees the base and its puzzle.
+ */
+void puz_base_unref(struct puz_base_t *base) {
+  if(NULL == base)
+    return;
+
+  if(0 != __atomic_sub_fetch(&base->refs, 1, __ATOMIC_ACQ_REL))
+    return;
+
+  puz_deep_free(base->puz);
+  free(base);
+}
+
+/**
+ * puz_base_puzzle_get - get the puzzle a base shares
+ *
+ * @base: the base (required)
+ *
+ * The puzzle is for reading only.
+ *
+ * Returns NULL on error.
+ */
+struct puzzle_t *puz_base_puzzle_get(struct puz_base_t *base) {
+  if(NULL == base)
+    return NULL;
+
+  return base->puz;
+}
+
+/**
+ * puz_session_init - start a session on a shared base
+ *
+ * @sess: pointer to the struct puz_session_t to init.  If NULL, one
+ *   will be malloc'd for you.
+ * @base: the base to solve (required); the session takes its own
+ *   reference
+ *
+ * The session starts with the base's board state.
+ *
+ * Return Value: NULL on error, else a pointer to the initialized
+ * struct puz_session_t.  If sess was NULL, this is a pointer to the
+ * newly-allocated structure.
+ */
+struct puz_session_t *puz_session_init(struct puz_session_t *sess,
+                                       struct puz_base_t *base) {
+  struct puzzle_t *puz;
+
+  if(NULL == base)
+    return NULL;
+
+  if(NULL == sess) {
+    sess = (struct puz_session_t *)malloc(sizeof(struct puz_session_t));
+    if(NULL == sess) {
+      perror("malloc");
+      return NULL;
+    }
+  }
+
+  memset(sess, 0, sizeof(struct puz_session_t));
+
+  puz = base->puz;
+  sess->base = puz_base_ref(base);
+  sess->grid = puz->grid;
+  sess->gext = puz->gext;
+  sess->rusr = puz->rusr;
+  sess->rusr_sz = puz->rusr_sz;
+  sess->ltim = puz->ltim;
+  sess->cells_filled = puz->cells_filled;
+  sess->cells_correct = puz->cells_correct;
+
+  return sess;
+}
+
+/**
+ * puz_session_free - free a session's own board state
+ *
+ * @sess: the session
+ *
+ * This drops the session's reference to its base.  It does not free
+ * @sess itself.
+ */
+void puz_session_free(struct puz_session_t *sess) {
+  int i;
+
+  if(NULL == sess || NULL == sess->base)
+    return;
+
+  if(sess->owned & SESSION_GRID)
+    free(sess->grid);
+  if(sess->owned & SESSION_GEXT)
+    free(sess->gext);
+  if(sess->owned & SESSION_LTIM)
+    free(sess->ltim);
+
+  if((sess->owned & SESSION_RUSR) && sess->rusr) {
+    for(i = 0; i < sess->base->puz->header.width *
+          sess->base->puz->header.height; i++)
+      free(sess->rusr[i]);
+    free(sess->rusr);
+  }
+
+  puz_base_unref(sess->base);
+  memset(sess, 0, sizeof(struct puz_session_t));
+}
+
+/**
+ * session_own - give a session its own copy of parts of its board
+ *
+ * @sess: the session (required)
+ * @what: SESSION_* bits for the parts wanted
+ *
+ * This is an internal function.  Parts the session already has, and
+ * parts the base doesn't have, are left alone.
+ *
+ * Return Value: -1 if out of memory, 0 on success.
+ */
+static int session_own(struct puz_session_t *sess, int what) {
+  int i, bd_sz;
+  unsigned char **rusr;
+
+  what &= ~sess->owned;
+  bd_sz = sess->base->puz->header.width * sess->base->puz->header.height;
+
+  if((what & SESSION_GRID) && sess->grid) {
+    sess->grid = Sstrndup(sess->grid, bd_sz);
+    if(NULL == sess->grid) {
+      perror("strndup");
+      sess->grid = sess->base->puz->grid;
+      return -1;
+    }
+  }
+  if(what & SESSION_GRID)
+    sess->owned |= SESSION_GRID;
+
+  if(what & SESSION_RUSR) {
+    if(sess->rusr) {
+      rusr = (unsigned char **)calloc(bd_sz, sizeof(unsigned char *));
+      if(NULL == rusr) {
+        perror("calloc");
+        return -1;
+      }
+      for(i = 0; i < bd_sz; i++) {
+        if(NULL == sess->rusr[i])
+          continue;
+        rusr[i] = Sstrdup(sess->rusr[i]);
+        if(NULL == rusr[i]) {
+          perror("strdup");
+          while(i--)
+            free(rusr[i]);
+          free(rusr);
+          return -1;
+        }
+      }
+      sess->rusr = rusr;
+    }
+    sess->owned |= SESSION_RUSR;
+  }
+
+  return 0;
+}
+
+/**
+ * session_keep - take back what an edit on a view changed
+ *
+ * @sess: the session (required)
+ * @view: the view the edit was done on
+ * @what: SESSION_* bits for the parts the edit may have replaced;
+ *   they are the session's own from now on
+ *
+ * This is an internal function.
+ */
+static void session_keep(struct puz_session_t *sess, struct puzzle_t *view,
+                         int what) {
+  sess->grid = view->grid;
+  sess->gext = view->gext;
+  sess->rusr = view->rusr;
+  sess->rusr_sz = view->rusr_sz;
+  sess->ltim = view->ltim;
+  sess->cells_filled = view->cells_filled;
+  sess->cells_correct = view->cells_correct;
+  sess->owned |= what;
+}
+
+/**
+ * puz_session_view - see a session as a whole puzzle
+ *
+ * @sess: the session (required)
+ * @view: the struct puzzle_t to fill in (required)
+ *
+ * @view borrows everything from the session and its base, and is
+ * good until the session is next changed.  Hand it to any function
+ * that only reads a puzzle; don't edit it, and don't free it with
+ * puz_deep_free().  puz_cksums_calc() and puz_cksums_commit() are
+ * fine, as they only write the view's own fields.
+ *
+ * Return Value: NULL on error, else @view.
+ */
+struct puzzle_t *puz_session_view(struct puz_session_t *sess,
+                                  struct puzzle_t *view) {
+  if(NULL == sess || NULL == sess->base || NULL == view)
+    return NULL;
+
+  memcpy(view, sess->base->puz, sizeof(struct puzzle_t));
+  view->grid = sess->grid;
+  view->gext = sess->gext;
+  view->rusr = sess->rusr;
+  view->rusr_sz = sess->rusr_sz;
+  view->ltim = sess->ltim;
+  view->cells_filled = sess->cells_filled;
+  view->cells_correct = sess->cells_correct;
+
+  return view;
+}
+
+/**
+ * puz_session_cell_set - enter a letter into one square
+ *
+ * @sess: the session to write to (required)
+ * @idx: the row-major index of the square (required)
+ * @val: the letter to enter; '-' clears the square
+ *
+ * Just like puz_cell_set(), for a session.
+ *
+ * Return Value: -1 on error, 0 on success.
+ */
+int puz_session_cell_set(struct puz_session_t *sess, int idx,
+                         unsigned char val) {
+  struct puzzle_t view;
+
+  if(NULL == puz_session_view(sess, &view) || NULL == view.grid)
+    return -1;
+
+  /* fail before copying anything, not after */
+  if(idx < 0 || idx >= view.header.width * view.header.height ||
+     NULL == view.solution || view.solution[idx] == '.' ||
+     val == '.' || val == 0)
+    return -1;
+
+  if(view.grid[idx] == val)
+    return 0;
+
+  if(session_own(sess, SESSION_GRID) < 0)
+    return -1;
+
+  view.grid = sess->grid;
+  if(puz_cell_set(&view, idx, val) < 0)
+    return -1;
+
+  session_keep(sess, &view, 0);
+  return 0;
+}
+
+/**
+ * puz_session_rusr_cell_set - enter a rebus string into one square
+ *
+ * @sess: the session to write to (required)
+ * @idx: the row-major index of the square (required)
+ * @val: the string to enter, or NULL to clear the square's entry
+ *
+ * Just like puz_rusr_cell_set(), for a session.
+ *
+ * Return Value: -1 on error, 0 on success.
+ */
+int puz_session_rusr_cell_set(struct puz_session_t *sess, int idx,
+                              unsigned char *val) {
+  struct puzzle_t view;
+
+  if(NULL == puz_session_view(sess, &view))
+    return -1;
+
+  if(session_own(sess, SESSION_RUSR) < 0)
+    return -1;
+
+  view.rusr = sess->rusr;
+  if(puz_rusr_cell_set(&view, idx, val) < 0)
+    return -1;
+
+  /* it may have made the rusr board, which is the session's too */
+  session_keep(sess, &view, SESSION_RUSR);
+  return 0;
+}
+
+/**
+ * puz_session_grid_set - replace a session's whole grid
+ *
+ * @sess: the session to write to (required)
+ * @val: the new grid (required)
+ *
+ * Return Value: NULL on error, else the session's copy of the grid.
+ */
+unsigned char * puz_session_grid_set(struct puz_session_t *sess,
+                                     unsigned char *val) {
+  struct puzzle_t view;
+
+  if(NULL == puz_session_view(sess, &view) || NULL == val)
+    return NULL;
+
+  /* puz_grid_set() frees the old grid, which may be the base's */
+  if(!(sess->owned & SESSION_GRID))
+    view.grid = NULL;
+
+  /* kept even if it failed, as the old one is gone by then */
+  puz_grid_set(&view, val);
+  session_keep(sess, &view, SESSION_GRID);
+  return sess->grid;
+}
+
+/**
+ * puz_session_extras_set - replace a session's extras (GEXT) grid
+ *
+ * @sess: the session to write to (required)
+ * @val: the new extras grid (required)
+ *
+ * Return Value: NULL on error, else the session's copy of the grid.
+ */
+unsigned char * puz_session_extras_set(struct puz_session_t *sess,
+                                       unsigned char *val) {
+  struct puzzle_t view;
+
+  if(NULL == puz_session_view(sess, &view) || NULL == val)
+    return NULL;
+
+  if(!(sess->owned & SESSION_GEXT))
+    view.gext = NULL;
+
+  /* kept even if it failed, as the old one is gone by then */
+  puz_extras_set(&view, val);
+  session_keep(sess, &view, SESSION_GEXT);
+  return sess->gext;
+}
+
+/**
+ * puz_session_timer_set - set a session's timer
+ *
+ * @sess: the session to write to (required)
+ * @elapsed: the number of seconds elapsed (should be non-negative)
+ * @stopped: 1 if the timer is stopped, 0 if it is running
+ *
+ * Return Value: NULL on error, else the session's copy of the timer
+ * data.
+ */
+unsigned char * puz_session_timer_set(struct puz_session_t *sess,
+                                      int elapsed, int stopped) {
+  struct puzzle_t view;
+
+  if(NULL == puz_session_view(sess, &view))
+    return NULL;
+
+  if(!(sess->owned & SESSION_LTIM))
+    view.ltim = NULL;
+
+  /* kept even if it failed, as the old one is gone by then */
+  puz_timer_set(&view, elapsed, stopped);
+  session_keep(sess, &view, SESSION_LTIM);
+  return sess->ltim;
+}
+
+/**
+ * puz_session_grid_get - get a session's grid
+ *
+ * @sess: the session to read from (required)
+ *
+ * Returns NULL on error or if field is unset.
+ */
+unsigned char * puz_session_grid_get(struct puz_session_t *sess) {
+  if(NULL == sess)
+    return NULL;
+
+  return sess->grid;
+}
+
+/**
+ * puz_session_extras_get - get a session's extras (GEXT) grid
+ *
+ * @sess: the session to read from (required)
+ *
+ * Returns NULL on error or if field is unset.
+ */
+unsigned char * puz_session_extras_get(struct puz_session_t *sess) {
+  if(NULL == sess)
+    return NULL;
+
+  return sess->gext;
+}
+
+/**
+ * puz_session_rusr_get - get a session's rusr board
+ *
+ * @sess: the session to read from (required)
+ *
+ * Returns NULL on error or if field is unset.
+ */
+unsigned char ** puz_session_rusr_get(struct puz_session_t *sess) {
+  if(NULL == sess)
+    return NULL;
+
+  return sess->rusr;
+}
+
+/**
+ * puz_session_timer_get - get a session's raw LTIM string
+ *
+ * @sess: the session to read from (required)
+ *
+ * Returns NULL on error or if field is unset.
+ */
+unsigned char * puz_session_timer_get(struct puz_session_t *sess) {
+  if(NULL == sess)
+    return NULL;
+
+  return sess->ltim;
+}
+
+/**
+ * puz_session_size - calculate the size of a session as a PUZ file
+ *
+ * @sess: the session to size (required)
+ *
+ * Return value: -1 on error, else the size puz_session_save() needs.
+ */
+int puz_session_size(struct puz_session_t *sess) {
+  struct puzzle_t view;
+
+  if(NULL == puz_session_view(sess, &view))
+    return -1;
+
+  return puz_size(&view);
+}
+
+/**
+ * puz_session_save - save a session's puzzle, with its board state
+ *
+ * @sess: the session to save (required)
+ * @type: PUZ_FILE_BINARY or PUZ_FILE_TEXT
+ * @out: where to write it
+ * @sz: how big out is
+ *
+ * The checksums are worked out for the session's board; the base's
+ * are left alone.
+ *
+ * Return Value: as for puz_save().
+ */
+int puz_session_save(struct puz_session_t *sess, int type,
+                     unsigned char *out, int sz) {
+  struct puzzle_t view;
+
+  if(NULL == puz_session_view(sess, &view))
+    return -1;
+
+  puz_cksums_commit(&view);
+
+  return puz_save(&view, type, out, sz);
+}
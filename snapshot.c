@@ -0,0 +1,420 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * snapshot.c -- Read-copy-update snapshots of the mutable board state
+ */
+
+#include <puz.h>
+
+/*
+  How this works: a single writer owns the struct puzzle_t and applies
+  edits to it as usual.  Whenever it wants readers to see its changes,
+  it calls puz_rcu_publish(), which copies the mutable board state
+  (grid, GEXT, RUSR and LTIM) into a fresh, immutable struct
+  puz_snapshot_t and swaps it into rcu->current.
+
+  Readers never look at the struct puzzle_t.  They pin the current
+  snapshot with puz_rcu_read_lock(), which only stores the global
+  epoch into the reader's own slot and loads the current pointer; no
+  locks are taken, and nothing the writer does can make a reader wait.
+
+  An old snapshot is tagged with the epoch it was retired in.  It can
+  be freed once no reader slot holds an epoch at or before that tag,
+  since any reader that pinned later must have loaded the new pointer.
+  Reclamation is done by the writer, at the end of each publish.
+ */
+
+static struct puz_snapshot_t *snapshot_new(struct puzzle_t *puz);
+static void snapshot_free(struct puz_snapshot_t *snap);
+static unsigned long rcu_min_epoch(struct puz_rcu_t *rcu);
+static void rcu_reclaim(struct puz_rcu_t *rcu);
+
+/**
+ * snapshot_new - copy a puzzle's mutable board state into a snapshot
+ *
+ * @puz: the puzzle to copy from (required)
+ *
+ * This is an internal function.
+ *
+ * Return Value: NULL on error, else a newly-allocated snapshot.
+ */
+static struct puz_snapshot_t *snapshot_new(struct puzzle_t *puz) {
+  struct puz_snapshot_t *snap;
+  int i, bd_sz;
+
+  snap = (struct puz_snapshot_t *)calloc(1, sizeof(struct puz_snapshot_t));
+  if(NULL == snap) {
+    perror("calloc");
+    return NULL;
+  }
+
+  snap->width = puz_width_get(puz);
+  snap->height = puz_height_get(puz);
+  bd_sz = snap->width * snap->height;
+
+  if(puz->grid) {
+    snap->grid = calloc(bd_sz+1, sizeof(unsigned char));
+    if(NULL == snap->grid)
+      goto fail;
+    memcpy(snap->grid, puz->grid, bd_sz);
+  }
+
+  if(puz_has_extras(puz)) {
+    snap->gext = calloc(bd_sz+1, sizeof(unsigned char));
+    if(NULL == snap->gext)
+      goto fail;
+    memcpy(snap->gext, puz->gext, bd_sz);
+  }
+
+  if(puz_has_rusr(puz)) {
+    snap->rusr = (unsigned char **)calloc(bd_sz, sizeof(unsigned char *));
+    if(NULL == snap->rusr)
+      goto fail;
+    for(i = 0; i < bd_sz; i++) {
+      if(puz->rusr[i]) {
+        snap->rusr[i] = Sstrdup(puz->rusr[i]);
+        if(NULL == snap->rusr[i])
+          goto fail;
+      }
+    }
+  }
+
+  if(puz_has_timer(puz)) {
+    snap->ltim = Sstrdup(puz->ltim);
+    if(NULL == snap->ltim)
+      goto fail;
+  }
+
+  return snap;
+
+ fail:
+  perror("snapshot_new");
+  snapshot_free(snap);
+  return NULL;
+}
+
+/**
+ * snapshot_free - free a snapshot and everything it points to
+ *
+ * @snap: the snapshot to free
+ *
+ * This is an internal function.
+ */
+static void snapshot_free(struct puz_snapshot_t *snap) {
+  int i;
+
+  if(NULL == snap)
+    return;
+
+  free(snap->grid);
+  free(snap->gext);
+
+  if(snap->rusr) {
+    for(i = 0; i < snap->width * snap->height; i++)
+      free(snap->rusr[i]);
+    free(snap->rusr);
+  }
+
+  free(snap->ltim);
+  free(snap);
+}
+
+/**
+ * rcu_min_epoch - find the oldest epoch pinned by any reader
+ *
+ * @rcu: the rcu to scan
+ *
+ * This is an internal function.
+ *
+ * Return Value: the smallest non-zero epoch in the reader slots, or
+ * ~0UL if no reader is currently inside a read-side section.
+ */
+static unsigned long rcu_min_epoch(struct puz_rcu_t *rcu) {
+  unsigned long e, min = ~0UL;
+  int i;
+
+  for(i = 0; i < PUZ_RCU_MAX_READERS; i++) {
+    e = __atomic_load_n(&rcu->readers[i].epoch, __ATOMIC_SEQ_CST);
+    if(e != 0 && e < min)
+      min = e;
+  }
+
+  return min;
+}
+
+/**
+ * rcu_reclaim - free every retired snapshot no reader can still see
+ *
+ * @rcu: the rcu to reclaim from
+ *
+ * This is an internal function, and must only be called by the writer.
+ */
+static void rcu_reclaim(struct puz_rcu_t *rcu) {
+  struct puz_snapshot_t **prev, *cur;
+  unsigned long min = rcu_min_epoch(rcu);
+
+  prev = &rcu->retired;
+  while(NULL != (cur = *prev)) {
+    if(cur->epoch < min) {
+      *prev = cur->next;
+      snapshot_free(cur);
+    } else {
+      prev = &cur->next;
+    }
+  }
+}
+
+/**
+ * puz_rcu_init - set up snapshot publishing for a puzzle
+ *
+ * @rcu: pointer to the struct puz_rcu_t to init.  If NULL, one will be
+ *   malloc'd for you, and puz_rcu_free() frees it.  Heap memory of
+ *   your own must be 64-byte aligned, eg: from aligned_alloc().
+ * @puz: the puzzle whose board state is published first (required)
+ *
+ * This initializes the reader slots and publishes an initial
+ * snapshot of @puz, so readers always have something to pin.
+ *
+ * Return Value: NULL on error, else a pointer to the initialized
+ * struct puz_rcu_t.  If rcu was NULL, this is a pointer to the
+ * newly-allocated structure.
+ */
+struct puz_rcu_t *puz_rcu_init(struct puz_rcu_t *rcu, struct puzzle_t *puz) {
+  int didmalloc = 0;
+
+  if(NULL == puz)
+    return NULL;
+
+  if(NULL == rcu) {
+    /* the reader slots are cache-line aligned */
+    rcu = (struct puz_rcu_t *)aligned_alloc(64, sizeof(struct puz_rcu_t));
+    if(NULL == rcu) {
+      perror("aligned_alloc");
+      return NULL;
+    }
+    didmalloc = 1;
+  }
+
+  memset(rcu, 0, sizeof(struct puz_rcu_t));
+  rcu->epoch = 1; /* 0 marks an idle reader slot */
+  rcu->didmalloc = didmalloc;
+
+  rcu->current = snapshot_new(puz);
+  if(NULL == rcu->current) {
+    if(didmalloc)
+      free(rcu);
+    return NULL;
+  }
+
+  return rcu;
+}
+
+/**
+ * puz_rcu_publish - make a puzzle's current board state visible to readers
+ *
+ * @rcu: the rcu to publish into (required)
+ * @puz: the puzzle to copy the board state from (required)
+ *
+ * Copies grid, GEXT, RUSR and LTIM out of @puz into a new snapshot
+ * and atomically replaces the current one.  The previous snapshot is
+ * retired and freed as soon as no reader can still hold it.
+ *
+ * Only one thread may publish at a time.
+ *
+ * Return Value: -1 on error, 0 on success.
+ */
+int puz_rcu_publish(struct puz_rcu_t *rcu, struct puzzle_t *puz) {
+  struct puz_snapshot_t *snap, *old;
+
+  if(NULL == rcu || NULL == puz)
+    return -1;
+
+  snap = snapshot_new(puz);
+  if(NULL == snap)
+    return -1;
+
+  old = __atomic_exchange_n(&rcu->current, snap, __ATOMIC_SEQ_CST);
+  old->epoch = __atomic_fetch_add(&rcu->epoch, 1, __ATOMIC_SEQ_CST);
+
+  old->next = rcu->retired;
+  rcu->retired = old;
+
+  rcu_reclaim(rcu);
+
+  return 0;
+}
+
+/**
+ * puz_rcu_reader_register - claim a reader slot
+ *
+ * @rcu: the rcu to read from (required)
+ *
+ * Each reading thread needs its own slot, which it passes to
+ * puz_rcu_read_lock() and puz_rcu_read_unlock().  Slots are claimed
+ * once per thread, not once per read.
+ *
+ * Return Value: -1 on error or if all PUZ_RCU_MAX_READERS slots are
+ * taken, else the slot number.
+ */
+int puz_rcu_reader_register(struct puz_rcu_t *rcu) {
+  int i;
+
+  if(NULL == rcu)
+    return -1;
+
+  for(i = 0; i < PUZ_RCU_MAX_READERS; i++) {
+    int expected = 0;
+    if(__atomic_compare_exchange_n(&rcu->readers[i].in_use, &expected, 1, 0,
+                                   __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+      return i;
+  }
+
+  return -1;
+}
+
+/**
+ * puz_rcu_reader_unregister - release a reader slot
+ *
+ * @rcu: the rcu the slot belongs to (required)
+ * @slot: the slot returned by puz_rcu_reader_register()
+ *
+ * Return Value: -1 on error, 0 on success.
+ */
+int puz_rcu_reader_unregister(struct puz_rcu_t *rcu, int slot) {
+  if(NULL == rcu || slot < 0 || slot >= PUZ_RCU_MAX_READERS)
+    return -1;
+
+  __atomic_store_n(&rcu->readers[slot].epoch, 0, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&rcu->readers[slot].in_use, 0, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+/**
+ * puz_rcu_read_lock - pin the current snapshot
+ *
+ * @rcu: the rcu to read from (required)
+ * @slot: this thread's reader slot (required)
+ *
+ * The returned snapshot stays valid, and unchanged, until the
+ * matching puz_rcu_read_unlock().  This never blocks.
+ *
+ * Return Value: NULL on error, else the pinned snapshot.
+ */
+struct puz_snapshot_t *puz_rcu_read_lock(struct puz_rcu_t *rcu, int slot) {
+  unsigned long e;
+
+  if(NULL == rcu || slot < 0 || slot >= PUZ_RCU_MAX_READERS)
+    return NULL;
+
+  e = __atomic_load_n(&rcu->epoch, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&rcu->readers[slot].epoch, e, __ATOMIC_SEQ_CST);
+
+  return __atomic_load_n(&rcu->current, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * puz_rcu_read_unlock - unpin the snapshot taken by puz_rcu_read_lock()
+ *
+ * @rcu: the rcu being read from (required)
+ * @slot: this thread's reader slot (required)
+ *
+ * Any pointers into the snapshot become invalid after this call.
+ */
+void puz_rcu_read_unlock(struct puz_rcu_t *rcu, int slot) {
+  if(NULL == rcu || slot < 0 || slot >= PUZ_RCU_MAX_READERS)
+    return;
+
+  __atomic_store_n(&rcu->readers[slot].epoch, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * puz_rcu_free - tear down an rcu and all its snapshots
+ *
+ * @rcu: the rcu to tear down
+ *
+ * There must be no readers left inside a read-side section.  @rcu
+ * itself is freed only if puz_rcu_init() allocated it; otherwise it
+ * may live on the stack or inside another structure.
+ */
+void puz_rcu_free(struct puz_rcu_t *rcu) {
+  struct puz_snapshot_t *cur, *next;
+
+  if(NULL == rcu)
+    return;
+
+  for(cur = rcu->retired; cur != NULL; cur = next) {
+    next = cur->next;
+    snapshot_free(cur);
+  }
+  rcu->retired = NULL;
+
+  snapshot_free(rcu->current);
+  rcu->current = NULL;
+
+  if(rcu->didmalloc)
+    free(rcu);
+}
+
+/**
+ * puz_snapshot_grid_get - get a snapshot's grid
+ *
+ * @snap: a pinned snapshot (required)
+ *
+ * Returns NULL on error or if field is unset.
+ */
+unsigned char * puz_snapshot_grid_get(struct puz_snapshot_t *snap) {
+  if(NULL == snap)
+    return NULL;
+
+  return snap->grid;
+}
+
+/**
+ * puz_snapshot_extras_get - get a snapshot's extras (GEXT) grid
+ *
+ * @snap: a pinned snapshot (required)
+ *
+ * Returns NULL on error or if field is unset.
+ */
+unsigned char * puz_snapshot_extras_get(struct puz_snapshot_t *snap) {
+  if(NULL == snap)
+    return NULL;
+
+  return snap->gext;
+}
+
+/**
+ * puz_snapshot_rusr_get - get a snapshot's rusr board
+ *
+ * @snap: a pinned snapshot (required)
+ *
+ * Returns NULL on error or if field is unset.
+ */
+unsigned char ** puz_snapshot_rusr_get(struct puz_snapshot_t *snap) {
+  if(NULL == snap)
+    return NULL;
+
+  return snap->rusr;
+}
+
+/**
+ * puz_snapshot_timer_get - get a snapshot's raw LTIM string
+ *
+ * @snap: a pinned snapshot (required)
+ *
+ * Returns NULL on error or if field is unset.
+ */
+unsigned char * puz_snapshot_timer_get(struct puz_snapshot_t *snap) {
+  if(NULL == snap)
+    return NULL;
+
+  return snap->ltim;
+}
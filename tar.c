@@ -0,0 +1,472 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * tar.c -- Load puzzles straight out of tar archives
+ */
+
+#include <puz.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+  A tar archive is a run of 512-byte headers, each followed by its
+  member's data padded out to 512 bytes, and ends with two zero
+  blocks.  Only regular files ending in .puz or .txt are loaded; the
+  rest are stepped over.  GNU long names ('L') and pax "path" records
+  ('x') are understood, since partner tools write both; everything
+  else in them is ignored.
+
+  A mapped archive is loaded in place: puz_load() is pointed straight
+  at each member's bytes.  A stream is read one member at a time into
+  a buffer that is reused, and members that aren't puzzles are
+  skipped with lseek() where the input allows it.
+ */
+
+#define TAR_BLOCK 512
+#define TAR_NAME_MAX 1024
+
+struct tar_entry_t {
+  char name[TAR_NAME_MAX];
+  unsigned long long size;
+  int type;
+};
+
+static int tar_header(unsigned char *h, struct tar_entry_t *e);
+static unsigned long long tar_number(unsigned char *p, int len);
+static int tar_pax_path(unsigned char *data, unsigned long long sz,
+                        char *name);
+static int tar_wanted(const char *name, int type);
+static int tar_read(int fd, unsigned char *buf, size_t len);
+static int tar_skip(int fd, unsigned long long len);
+
+/**
+ * tar_number - parse a numeric header field
+ *
+ * This is an internal function.  Fields are octal, NUL or space
+ * terminated, or base-256 big-endian if the first byte has its top
+ * bit set (GNU, for sizes of 8GB and up).
+ */
+static unsigned long long tar_number(unsigned char *p, int len) {
+  unsigned long long v = 0;
+  int i;
+
+  if(p[0] & 0x80) {
+    v = p[0] & 0x3f;
+    for(i = 1; i < len; i++)
+      v = (v << 8) | p[i];
+    return v;
+  }
+
+  for(i = 0; i < len && p[i] == ' '; i++)
+    ;
+  for(; i < len && p[i] >= '0' && p[i] <= '7'; i++)
+    v = (v << 3) | (p[i] - '0');
+
+  return v;
+}
+
+/**
+ * tar_header - read one header block
+ *
+ * @h: the block
+ * @e: filled in with the member's name, size and type
+ *
+ * This is an internal function.
+ *
+ * Return Value: 1 for a member, 0 for a zero block (the end), -1 if
+ * the block's checksum is wrong.
+ */
+static int tar_header(unsigned char *h, struct tar_entry_t *e) {
+  unsigned int sum = 0;
+  int i, n;
+
+  for(i = 0; i < TAR_BLOCK && 0 == h[i]; i++)
+    ;
+  if(TAR_BLOCK == i)
+    return 0;
+
+  /* the checksum is taken with its own field as spaces */
+  for(i = 0; i < TAR_BLOCK; i++)
+    sum += (i >= 148 && i < 156) ? ' ' : h[i];
+  if(sum != tar_number(h + 148, 8))
+    return -1;
+
+  e->size = tar_number(h + 124, 12);
+  e->type = h[156] ? h[156] : '0';
+
+  /* ustar splits long names into a prefix and a name */
+  n = 0;
+  if(0 == memcmp(h + 257, "ustar", 5) && h[345]) {
+    for(i = 0; i < 155 && h[345 + i]; i++)
+      e->name[n++] = h[345 + i];
+    e->name[n++] = '/';
+  }
+  for(i = 0; i < 100 && h[i]; i++)
+    e->name[n++] = h[i];
+  e->name[n] = 0;
+
+  return 1;
+}
+
+/**
+ * tar_pax_path - pull the "path" record out of a pax header
+ *
+ * This is an internal function.  Records are "LEN path=VALUE\n".
+ * Returns 1 and fills in @name if there is one, else 0.
+ */
+static int tar_pax_path(unsigned char *data, unsigned long long sz,
+                        char *name) {
+  unsigned long long pos = 0, len;
+  unsigned char *rec, *key;
+  int n;
+
+  while(pos < sz) {
+    rec = data + pos;
+    len = 0;
+    for(key = rec; key < data + sz && isdigit(*key); key++)
+      len = len * 10 + (*key - '0');
+    if(0 == len || pos + len > sz || key >= data + sz || *key != ' ')
+      return 0;
+    key++;
+
+    if(rec + len - key > 5 && 0 == memcmp(key, "path=", 5)) {
+      n = rec + len - 1 - (key + 5); /* less the newline */
+      if(n >= TAR_NAME_MAX)
+        n = TAR_NAME_MAX - 1;
+      memcpy(name, key + 5, n);
+      name[n] = 0;
+      return 1;
+    }
+
+    pos += len;
+  }
+
+  return 0;
+}
+
+/**
+ * tar_wanted - is this member a puzzle?
+ *
+ * @name: the member's name
+ * @type: the type the caller asked for, with any load flags
+ *
+ * This is an internal function.  Matches .puz and .txt, in any case.
+ *
+ * Return Value: 0 if the member isn't wanted, else the type to pass to
+ * puz_load().  PUZ_FILE_UNKNOWN is resolved by the extension, so that
+ * a .txt member that isn't a text puzzle is turned away rather than
+ * read as a binary one.
+ */
+static int tar_wanted(const char *name, int type) {
+  int n = strlen(name), ext;
+
+  if(n < 4 || name[n-4] != '.')
+    return 0;
+
+  if(0 == strcasecmp(name + n - 3, "puz"))
+    ext = PUZ_FILE_BINARY;
+  else if(0 == strcasecmp(name + n - 3, "txt"))
+    ext = PUZ_FILE_TEXT;
+  else
+    return 0;
+
+  if(PUZ_FILE_UNKNOWN == (type & PUZ_FILE_TYPE_MASK))
+    type = (type & ~PUZ_FILE_TYPE_MASK) | ext;
+
+  return type;
+}
+
+/**
+ * puz_tar_walk - load every puzzle in an archive held in memory
+ *
+ * @base: the archive, typically mmap'd (required)
+ * @sz: its size
+ * @type: passed to puz_load() for each member, with any load flags
+ * @cb: called with each puzzle member's name, the loaded puzzle (NULL
+ *   if it didn't load), and the member's bytes.  The puzzle is the
+ *   callback's to keep or puz_deep_free(); its base pointer is into
+ *   @base.  Return nonzero to stop. (required)
+ * @arg: passed to @cb
+ *
+ * Nothing is copied out of @base before puz_load() sees it.
+ *
+ * Return Value: -1 if the archive is malformed before its end, else
+ * the number of members passed to @cb.
+ */
+int puz_tar_walk(unsigned char *base, size_t sz, int type,
+                 int (*cb)(const char *name, struct puzzle_t *puz,
+                           unsigned char *data, int sz, void *arg),
+                 void *arg) {
+  struct tar_entry_t e;
+  char longname[TAR_NAME_MAX];
+  size_t pos = 0;
+  unsigned long long n;
+  int rv, count = 0, have_long = 0, want;
+
+  if(NULL == base || NULL == cb)
+    return -1;
+
+  while(pos + TAR_BLOCK <= sz) {
+    rv = tar_header(base + pos, &e);
+    if(rv <= 0)
+      return rv < 0 ? -1 : count;
+    pos += TAR_BLOCK;
+
+    if(e.size > sz - pos)
+      return -1;
+
+    switch(e.type) {
+    case 'L':
+      n = e.size < TAR_NAME_MAX ? e.size : TAR_NAME_MAX - 1;
+      memcpy(longname, base + pos, n);
+      longname[n] = 0;
+      have_long = 1;
+      break;
+    case 'x':
+      have_long = tar_pax_path(base + pos, e.size, longname);
+      break;
+    case '0':
+    case '7':
+      if(have_long)
+        strcpy(e.name, longname);
+      have_long = 0;
+
+      want = tar_wanted(e.name, type);
+      if(want && e.size <= INT_MAX) {
+        struct puzzle_t *puz = NULL;
+
+        if(e.size > 0)
+          puz = puz_load(NULL, want, base + pos, e.size);
+        count++;
+        if(cb(e.name, puz, base + pos, e.size, arg))
+          return count;
+      }
+      break;
+    default:
+      have_long = 0;
+      break;
+    }
+
+    pos += (e.size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+  }
+
+  return count;
+}
+
+/**
+ * tar_read - read exactly len bytes
+ *
+ * This is an internal function.  Returns 1 on success, 0 at a clean
+ * end of input, -1 on error or a short read.
+ */
+static int tar_read(int fd, unsigned char *buf, size_t len) {
+  size_t got = 0;
+  ssize_t r;
+
+  while(got < len) {
+    r = read(fd, buf + got, len - got);
+    if(r < 0 && EINTR == errno)
+      continue;
+    if(r < 0) {
+      perror("read");
+      return -1;
+    }
+    if(0 == r)
+      return 0 == got ? 0 : -1;
+    got += r;
+  }
+
+  return 1;
+}
+
+/**
+ * tar_skip - step over len bytes of input
+ *
+ * This is an internal function.  Seeks if it can, else reads and
+ * throws away.  Returns 0 on success, -1 on error.
+ */
+static int tar_skip(int fd, unsigned long long len) {
+  unsigned char buf[64 * 1024];
+  size_t n;
+
+  if(0 == len || lseek(fd, len, SEEK_CUR) >= 0)
+    return 0;
+
+  while(len > 0) {
+    n = len < sizeof(buf) ? len : sizeof(buf);
+    if(tar_read(fd, buf, n) <= 0)
+      return -1;
+    len -= n;
+  }
+
+  return 0;
+}
+
+/**
+ * puz_tar_walk_fd - load every puzzle in an archive read from a stream
+ *
+ * @fd: the input, e.g. a pipe from a decompressor
+ * @type, @cb, @arg: as for puz_tar_walk().  The bytes passed to @cb,
+ *   and the puzzle's base pointer, are only good until @cb returns.
+ *
+ * Each puzzle member is read into one buffer, grown as needed and
+ * reused, and loaded from there.
+ *
+ * Return Value: as for puz_tar_walk(); also -1 on a read error.
+ */
+int puz_tar_walk_fd(int fd, int type,
+                    int (*cb)(const char *name, struct puzzle_t *puz,
+                              unsigned char *data, int sz, void *arg),
+                    void *arg) {
+  struct tar_entry_t e;
+  char longname[TAR_NAME_MAX];
+  unsigned char h[TAR_BLOCK];
+  unsigned char *buf = NULL, *nb;
+  unsigned long long pad, cap = 0;
+  int rv, count = 0, have_long = 0, want;
+
+  if(fd < 0 || NULL == cb)
+    return -1;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  for(;;) {
+    rv = tar_read(fd, h, TAR_BLOCK);
+    if(rv <= 0)
+      break;
+    rv = tar_header(h, &e);
+    if(rv <= 0)
+      break;
+
+    pad = (e.size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK - e.size;
+
+    if(('0' == e.type || '7' == e.type) && have_long)
+      strcpy(e.name, longname);
+
+    want = 0;
+    if('L' == e.type || 'x' == e.type)
+      want = 1;
+    else if(('0' == e.type || '7' == e.type) && e.size <= INT_MAX)
+      want = tar_wanted(e.name, type);
+
+    if(!want) {
+      have_long = 0;
+      if(tar_skip(fd, e.size + pad) < 0) {
+        rv = -1;
+        break;
+      }
+      continue;
+    }
+
+    if(e.size + 1 > cap) {
+      nb = (unsigned char *)realloc(buf, e.size + 1);
+      if(NULL == nb) {
+        perror("realloc");
+        rv = -1;
+        break;
+      }
+      buf = nb;
+      cap = e.size + 1;
+    }
+
+    if(e.size > 0 && tar_read(fd, buf, e.size) <= 0) {
+      rv = -1;
+      break;
+    }
+    buf[e.size] = 0;
+    if(tar_skip(fd, pad) < 0) {
+      rv = -1;
+      break;
+    }
+
+    if('L' == e.type) {
+      memcpy(longname, buf, e.size < TAR_NAME_MAX ? e.size + 1 : TAR_NAME_MAX);
+      longname[TAR_NAME_MAX - 1] = 0;
+      have_long = 1;
+    } else if('x' == e.type) {
+      have_long = tar_pax_path(buf, e.size, longname);
+    } else {
+      struct puzzle_t *puz = NULL;
+
+      have_long = 0;
+      if(e.size > 0)
+        puz = puz_load(NULL, want, buf, e.size);
+      count++;
+      if(cb(e.name, puz, buf, e.size, arg))
+        break;
+    }
+  }
+
+  free(buf);
+
+  return rv < 0 ? -1 : count;
+}
+
+/**
+ * puz_tar_walk_file - load every puzzle in a tar file
+ *
+ * @path: the archive; "-" reads standard input (required)
+ * @type, @cb, @arg: as for puz_tar_walk()
+ *
+ * A regular file is mapped and walked in place; anything else (a
+ * pipe, a tape) is streamed with puz_tar_walk_fd().  Either way the
+ * bytes passed to @cb are only good until @cb returns, since the
+ * mapping goes away with the call.
+ *
+ * Return Value: as for puz_tar_walk(); also -1 if @path can't be opened.
+ */
+int puz_tar_walk_file(const char *path, int type,
+                      int (*cb)(const char *name, struct puzzle_t *puz,
+                                unsigned char *data, int sz, void *arg),
+                      void *arg) {
+  struct stat st;
+  void *base;
+  int fd, rv;
+
+  if(NULL == path)
+    return -1;
+
+  if(0 == strcmp(path, "-")) {
+    fd = 0;
+  } else {
+    fd = open(path, O_RDONLY);
+    if(fd < 0) {
+      perror(path);
+      return -1;
+    }
+  }
+
+  if(0 == fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(MAP_FAILED != base) {
+      madvise(base, st.st_size, MADV_SEQUENTIAL);
+      rv = puz_tar_walk((unsigned char *)base, st.st_size, type, cb, arg);
+      munmap(base, st.st_size);
+      if(fd)
+        close(fd);
+      return rv;
+    }
+  }
+
+  rv = puz_tar_walk_fd(fd, type, cb, arg);
+  if(fd)
+    close(fd);
+
+  return rv;
+}
@@ -0,0 +1,536 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * utf8.c -- UTF-8 views of a puzzle's strings
+ */
+
+#include <puz.h>
+
+/*
+  The strings in a .puz are in the Windows code page the Across
+  software ran under, which is Latin-1 plus typographic quotes and
+  dashes in 0x80-0x9F.  The UTF-8 views are made once, either on load
+  (PUZ_LOAD_UTF8) or on first access, and kept until the string is
+  set again.
+
+  Nearly every string is plain ASCII, which is already UTF-8, so the
+  first thing we do is check for that, a vector at a time, with
+  puz_kernels.ascii (see cpu.c); an ASCII string's view is the string
+  itself, with nothing allocated.  Other strings are expanded a byte
+  at a time through utf8_high[].
+
+  Version 2.0 files hold UTF-8 already, so there every view is the
+  string itself and nothing is transcoded either way.
+ */
+
+/* UTF-8 for bytes 0x80-0xFF: length, then up to three bytes */
+static const unsigned char utf8_high[128][4] = {
+  { 3, 0xE2, 0x82, 0xAC }, { 2, 0xC2, 0x81, 0x00 }, { 3, 0xE2, 0x80, 0x9A }, { 2, 0xC6, 0x92, 0x00 },
+  { 3, 0xE2, 0x80, 0x9E }, { 3, 0xE2, 0x80, 0xA6 }, { 3, 0xE2, 0x80, 0xA0 }, { 3, 0xE2, 0x80, 0xA1 },
+  { 2, 0xCB, 0x86, 0x00 }, { 3, 0xE2, 0x80, 0xB0 }, { 2, 0xC5, 0xA0, 0x00 }, { 3, 0xE2, 0x80, 0xB9 },
+  { 2, 0xC5, 0x92, 0x00 }, { 2, 0xC2, 0x8D, 0x00 }, { 2, 0xC5, 0xBD, 0x00 }, { 2, 0xC2, 0x8F, 0x00 },
+  { 2, 0xC2, 0x90, 0x00 }, { 3, 0xE2, 0x80, 0x98 }, { 3, 0xE2, 0x80, 0x99 }, { 3, 0xE2, 0x80, 0x9C },
+  { 3, 0xE2, 0x80, 0x9D }, { 3, 0xE2, 0x80, 0xA2 }, { 3, 0xE2, 0x80, 0x93 }, { 3, 0xE2, 0x80, 0x94 },
+  { 2, 0xCB, 0x9C, 0x00 }, { 3, 0xE2, 0x84, 0xA2 }, { 2, 0xC5, 0xA1, 0x00 }, { 3, 0xE2, 0x80, 0xBA },
+  { 2, 0xC5, 0x93, 0x00 }, { 2, 0xC2, 0x9D, 0x00 }, { 2, 0xC5, 0xBE, 0x00 }, { 2, 0xC5, 0xB8, 0x00 },
+  { 2, 0xC2, 0xA0, 0x00 }, { 2, 0xC2, 0xA1, 0x00 }, { 2, 0xC2, 0xA2, 0x00 }, { 2, 0xC2, 0xA3, 0x00 },
+  { 2, 0xC2, 0xA4, 0x00 }, { 2, 0xC2, 0xA5, 0x00 }, { 2, 0xC2, 0xA6, 0x00 }, { 2, 0xC2, 0xA7, 0x00 },
+  { 2, 0xC2, 0xA8, 0x00 }, { 2, 0xC2, 0xA9, 0x00 }, { 2, 0xC2, 0xAA, 0x00 }, { 2, 0xC2, 0xAB, 0x00 },
+  { 2, 0xC2, 0xAC, 0x00 }, { 2, 0xC2, 0xAD, 0x00 }, { 2, 0xC2, 0xAE, 0x00 }, { 2, 0xC2, 0xAF, 0x00 },
+  { 2, 0xC2, 0xB0, 0x00 }, { 2, 0xC2, 0xB1, 0x00 }, { 2, 0xC2, 0xB2, 0x00 }, { 2, 0xC2, 0xB3, 0x00 },
+  { 2, 0xC2, 0xB4, 0x00 }, { 2, 0xC2, 0xB5, 0x00 }, { 2, 0xC2, 0xB6, 0x00 }, { 2, 0xC2, 0xB7, 0x00 },
+  { 2, 0xC2, 0xB8, 0x00 }, { 2, 0xC2, 0xB9, 0x00 }, { 2, 0xC2, 0xBA, 0x00 }, { 2, 0xC2, 0xBB, 0x00 },
+  { 2, 0xC2, 0xBC, 0x00 }, { 2, 0xC2, 0xBD, 0x00 }, { 2, 0xC2, 0xBE, 0x00 }, { 2, 0xC2, 0xBF, 0x00 },
+  { 2, 0xC3, 0x80, 0x00 }, { 2, 0xC3, 0x81, 0x00 }, { 2, 0xC3, 0x82, 0x00 }, { 2, 0xC3, 0x83, 0x00 },
+  { 2, 0xC3, 0x84, 0x00 }, { 2, 0xC3, 0x85, 0x00 }, { 2, 0xC3, 0x86, 0x00 }, { 2, 0xC3, 0x87, 0x00 },
+  { 2, 0xC3, 0x88, 0x00 }, { 2, 0xC3, 0x89, 0x00 }, { 2, 0xC3, 0x8A, 0x00 }, { 2, 0xC3, 0x8B, 0x00 },
+  { 2, 0xC3, 0x8C, 0x00 }, { 2, 0xC3, 0x8D, 0x00 }, { 2, 0xC3, 0x8E, 0x00 }, { 2, 0xC3, 0x8F, 0x00 },
+  { 2, 0xC3, 0x90, 0x00 }, { 2, 0xC3, 0x91, 0x00 }, { 2, 0xC3, 0x92, 0x00 }, { 2, 0xC3, 0x93, 0x00 },
+  { 2, 0xC3, 0x94, 0x00 }, { 2, 0xC3, 0x95, 0x00 }, { 2, 0xC3, 0x96, 0x00 }, { 2, 0xC3, 0x97, 0x00 },
+  { 2, 0xC3, 0x98, 0x00 }, { 2, 0xC3, 0x99, 0x00 }, { 2, 0xC3, 0x9A, 0x00 }, { 2, 0xC3, 0x9B, 0x00 },
+  { 2, 0xC3, 0x9C, 0x00 }, { 2, 0xC3, 0x9D, 0x00 }, { 2, 0xC3, 0x9E, 0x00 }, { 2, 0xC3, 0x9F, 0x00 },
+  { 2, 0xC3, 0xA0, 0x00 }, { 2, 0xC3, 0xA1, 0x00 }, { 2, 0xC3, 0xA2, 0x00 }, { 2, 0xC3, 0xA3, 0x00 },
+  { 2, 0xC3, 0xA4, 0x00 }, { 2, 0xC3, 0xA5, 0x00 }, { 2, 0xC3, 0xA6, 0x00 }, { 2, 0xC3, 0xA7, 0x00 },
+  { 2, 0xC3, 0xA8, 0x00 }, { 2, 0xC3, 0xA9, 0x00 }, { 2, 0xC3, 0xAA, 0x00 }, { 2, 0xC3, 0xAB, 0x00 },
+  { 2, 0xC3, 0xAC, 0x00 }, { 2, 0xC3, 0xAD, 0x00 }, { 2, 0xC3, 0xAE, 0x00 }, { 2, 0xC3, 0xAF, 0x00 },
+  { 2, 0xC3, 0xB0, 0x00 }, { 2, 0xC3, 0xB1, 0x00 }, { 2, 0xC3, 0xB2, 0x00 }, { 2, 0xC3, 0xB3, 0x00 },
+  { 2, 0xC3, 0xB4, 0x00 }, { 2, 0xC3, 0xB5, 0x00 }, { 2, 0xC3, 0xB6, 0x00 }, { 2, 0xC3, 0xB7, 0x00 },
+  { 2, 0xC3, 0xB8, 0x00 }, { 2, 0xC3, 0xB9, 0x00 }, { 2, 0xC3, 0xBA, 0x00 }, { 2, 0xC3, 0xBB, 0x00 },
+  { 2, 0xC3, 0xBC, 0x00 }, { 2, 0xC3, 0xBD, 0x00 }, { 2, 0xC3, 0xBE, 0x00 }, { 2, 0xC3, 0xBF, 0x00 }
+};
+
+static unsigned char *to_utf8(unsigned char *s);
+static unsigned char *from_utf8(unsigned char *s);
+static void drop(unsigned char *view, unsigned char *orig);
+static unsigned char *view_get(struct puzzle_t *puz, unsigned char **view,
+                               unsigned char *orig);
+static int convert(unsigned char **s, int to_unicode);
+
+/**
+ * to_utf8 - make the UTF-8 view of a string
+ *
+ * @s: the string, or NULL
+ *
+ * This is an internal function.
+ *
+ * Return Value: s itself if it is pure ASCII, a new string otherwise,
+ * or NULL if s is NULL or on allocation failure.
+ */
+static unsigned char *to_utf8(unsigned char *s) {
+  unsigned char *out, *o;
+  size_t len, i, n;
+
+  if(NULL == s)
+    return NULL;
+
+  if(puz_kernels.ascii(s, &len))
+    return s;
+
+  for(i = n = 0; i < len; i++)
+    n += s[i] < 0x80 ? 1 : utf8_high[s[i] - 0x80][0];
+
+  out = (unsigned char *)malloc(n + 1);
+  if(NULL == out) {
+    perror("malloc");
+    return NULL;
+  }
+
+  for(i = 0, o = out; i < len; i++) {
+    if(s[i] < 0x80) {
+      *o++ = s[i];
+    } else {
+      const unsigned char *u = utf8_high[s[i] - 0x80];
+      memcpy(o, u + 1, 3);
+      o += u[0];
+    }
+  }
+  *o = 0;
+
+  return out;
+}
+
+/**
+ * from_utf8 - convert a UTF-8 string back to the file's code page
+ *
+ * @s: the string (required)
+ *
+ * This is an internal function.  Characters the code page doesn't
+ * have, and malformed UTF-8, come out as '?'.
+ *
+ * Return Value: s itself if it is pure ASCII, a new string otherwise,
+ * or NULL on allocation failure.
+ */
+static unsigned char *from_utf8(unsigned char *s) {
+  unsigned char *out, *o;
+  size_t len, i;
+  int n, k, b;
+
+  if(puz_kernels.ascii(s, &len))
+    return s;
+
+  out = (unsigned char *)malloc(len + 1);
+  if(NULL == out) {
+    perror("malloc");
+    return NULL;
+  }
+
+  for(i = 0, o = out; i < len; i += n) {
+    if(s[i] < 0x80) {
+      *o++ = s[i];
+      n = 1;
+      continue;
+    }
+
+    n = s[i] >= 0xF0 ? 4 : s[i] >= 0xE0 ? 3 : s[i] >= 0xC0 ? 2 : 1;
+    for(k = 1; k < n && i + k < len; k++) {
+      if((s[i+k] & 0xC0) != 0x80)
+        break;
+    }
+    if(k < n) {
+      *o++ = '?';
+      n = k;
+      continue;
+    }
+
+    /* the table is short enough to search */
+    for(b = 0; b < 128; b++) {
+      if(utf8_high[b][0] == n && 0 == memcmp(utf8_high[b] + 1, s + i, n))
+        break;
+    }
+    *o++ = b < 128 ? 0x80 + b : '?';
+  }
+  *o = 0;
+
+  return out;
+}
+
+/**
+ * drop - free a view, unless it is the string itself
+ *
+ * This is an internal function.
+ */
+static void drop(unsigned char *view, unsigned char *orig) {
+  if(view != orig)
+    free(view);
+}
+
+/**
+ * view_get - get a view, making it if need be
+ *
+ * This is an internal function.
+ */
+static unsigned char *view_get(struct puzzle_t *puz, unsigned char **view,
+                               unsigned char *orig) {
+  if(NULL == *view)
+    *view = puz_is_unicode(puz) ? orig : to_utf8(orig);
+
+  return *view;
+}
+
+/**
+ * convert - re-encode one stored string for a change of version
+ *
+ * @s: the string, which may be NULL; replaced if it has to change
+ * @to_unicode: 1 to go to UTF-8, 0 to go to the code page
+ *
+ * This is an internal function.
+ *
+ * Return Value: -1 on allocation failure, leaving the string alone;
+ * else 0.
+ */
+static int convert(unsigned char **s, int to_unicode) {
+  unsigned char *out;
+
+  if(NULL == *s)
+    return 0;
+
+  out = to_unicode ? to_utf8(*s) : from_utf8(*s);
+  if(NULL == out)
+    return -1;
+
+  if(out != *s) {
+    free(*s);
+    *s = out;
+  }
+
+  return 0;
+}
+
+/**
+ * puz_utf8_calc - make the UTF-8 views of all of a puzzle's strings
+ *
+ * @puz: the puzzle (required)
+ *
+ * Passing PUZ_LOAD_UTF8 to puz_load() does this on load.  Without it,
+ * each view is made the first time it is asked for.
+ *
+ * Return Value: -1 on error, 0 on success.
+ */
+int puz_utf8_calc(struct puzzle_t *puz) {
+  int i;
+
+  if(NULL == puz)
+    return -1;
+
+  if((puz->title && !view_get(puz, &puz->title_utf8, puz->title)) ||
+     (puz->author && !view_get(puz, &puz->author_utf8, puz->author)) ||
+     (puz->copyright && !view_get(puz, &puz->copyright_utf8, puz->copyright)) ||
+     (puz->notes && !view_get(puz, &puz->notes_utf8, puz->notes)))
+    return -1;
+
+  for(i = 0; puz->clues && i < puz->header.clue_count; i++) {
+    if(puz->clues[i] && NULL == puz_clue_utf8_get(puz, i))
+      return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * puz_utf8_clear - forget a puzzle's UTF-8 views
+ *
+ * @puz: the puzzle (required)
+ *
+ * The string setters call this, so the views never go stale.
+ */
+void puz_utf8_clear(struct puzzle_t *puz) {
+  int i;
+
+  if(NULL == puz)
+    return;
+
+  drop(puz->title_utf8, puz->title);
+  drop(puz->author_utf8, puz->author);
+  drop(puz->copyright_utf8, puz->copyright);
+  drop(puz->notes_utf8, puz->notes);
+  puz->title_utf8 = puz->author_utf8 = NULL;
+  puz->copyright_utf8 = puz->notes_utf8 = NULL;
+
+  if(puz->clues_utf8) {
+    for(i = 0; i < puz->clues_utf8_sz; i++)
+      drop(puz->clues_utf8[i], puz->clues[i]);
+    free(puz->clues_utf8);
+    puz->clues_utf8 = NULL;
+    puz->clues_utf8_sz = 0;
+  }
+}
+
+/**
+ * puz_title_utf8_get - get the puzzle's title as UTF-8
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ *
+ * The string belongs to the puzzle, and lasts until the title (or
+ * any other string) is set.
+ *
+ * Returns NULL on error or if field is unset.
+ */
+unsigned char * puz_title_utf8_get(struct puzzle_t *puz) {
+  if(NULL == puz)
+    return NULL;
+
+  return view_get(puz, &puz->title_utf8, puz->title);
+}
+
+/**
+ * puz_author_utf8_get - get the puzzle's author as UTF-8
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ *
+ * Returns NULL on error or if field is unset.
+ */
+unsigned char * puz_author_utf8_get(struct puzzle_t *puz) {
+  if(NULL == puz)
+    return NULL;
+
+  return view_get(puz, &puz->author_utf8, puz->author);
+}
+
+/**
+ * puz_copyright_utf8_get - get the puzzle's copyright as UTF-8
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ *
+ * Returns NULL on error or if field is unset.
+ */
+unsigned char * puz_copyright_utf8_get(struct puzzle_t *puz) {
+  if(NULL == puz)
+    return NULL;
+
+  return view_get(puz, &puz->copyright_utf8, puz->copyright);
+}
+
+/**
+ * puz_notes_utf8_get - get the puzzle's notes as UTF-8
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ *
+ * Returns NULL on error or if field is unset.
+ */
+unsigned char * puz_notes_utf8_get(struct puzzle_t *puz) {
+  if(NULL == puz)
+    return NULL;
+
+  return view_get(puz, &puz->notes_utf8, puz->notes);
+}
+
+/**
+ * puz_clue_utf8_get - get the nth clue of a puzzle as UTF-8
+ *
+ * @puz: a pointer to the struct puzzle_t to read from (required)
+ * @n: the index (between zero and n_clues) to get
+ *
+ * Returns NULL on error or if the clue is unset.
+ */
+unsigned char * puz_clue_utf8_get(struct puzzle_t *puz, int n) {
+  if(NULL == puz || NULL == puz->clues || n < 0 || n >= puz->header.clue_count)
+    return NULL;
+
+  if(NULL == puz->clues_utf8) {
+    puz->clues_utf8 = (unsigned char **)calloc(puz->header.clue_count,
+                                              sizeof(unsigned char *));
+    if(NULL == puz->clues_utf8) {
+      perror("calloc");
+      return NULL;
+    }
+    puz->clues_utf8_sz = puz->header.clue_count;
+  }
+
+  return view_get(puz, &puz->clues_utf8[n], puz->clues[n]);
+}
+
+/**
+ * puz_title_utf8_set - set the puzzle's title from UTF-8
+ *
+ * @puz: a pointer to the struct puzzle_t to write to (required)
+ * @val: the title, in UTF-8 (required)
+ *
+ * The title is stored in the file's code page; characters it can't
+ * hold become '?'.
+ *
+ * Returns NULL on error, else the puzzle's copy in the code page.
+ */
+unsigned char * puz_title_utf8_set(struct puzzle_t *puz, unsigned char *val) {
+  unsigned char *s, *rv;
+
+  if(NULL == puz || NULL == val)
+    return NULL;
+
+  s = puz_is_unicode(puz) ? val : from_utf8(val);
+  if(NULL == s)
+    return NULL;
+
+  rv = puz_title_set(puz, s);
+  drop(s, val);
+
+  return rv;
+}
+
+/**
+ * puz_author_utf8_set - set the puzzle's author from UTF-8
+ *
+ * @puz: a pointer to the struct puzzle_t to write to (required)
+ * @val: the author, in UTF-8 (required)
+ *
+ * Returns NULL on error, else the puzzle's copy in the code page.
+ */
+unsigned char * puz_author_utf8_set(struct puzzle_t *puz, unsigned char *val) {
+  unsigned char *s, *rv;
+
+  if(NULL == puz || NULL == val)
+    return NULL;
+
+  s = puz_is_unicode(puz) ? val : from_utf8(val);
+  if(NULL == s)
+    return NULL;
+
+  rv = puz_author_set(puz, s);
+  drop(s, val);
+
+  return rv;
+}
+
+/**
+ * puz_copyright_utf8_set - set the puzzle's copyright from UTF-8
+ *
+ * @puz: a pointer to the struct puzzle_t to write to (required)
+ * @val: the copyright, in UTF-8 (required)
+ *
+ * Returns NULL on error, else the puzzle's copy in the code page.
+ */
+unsigned char * puz_copyright_utf8_set(struct puzzle_t *puz, unsigned char *val) {
+  unsigned char *s, *rv;
+
+  if(NULL == puz || NULL == val)
+    return NULL;
+
+  s = puz_is_unicode(puz) ? val : from_utf8(val);
+  if(NULL == s)
+    return NULL;
+
+  rv = puz_copyright_set(puz, s);
+  drop(s, val);
+
+  return rv;
+}
+
+/**
+ * puz_notes_utf8_set - set the puzzle's notes from UTF-8
+ *
+ * @puz: a pointer to the struct puzzle_t to write to (required)
+ * @val: the notes, in UTF-8 (required)
+ *
+ * Returns NULL on error, else the puzzle's copy in the code page.
+ */
+unsigned char * puz_notes_utf8_set(struct puzzle_t *puz, unsigned char *val) {
+  unsigned char *s, *rv;
+
+  if(NULL == puz || NULL == val)
+    return NULL;
+
+  s = puz_is_unicode(puz) ? val : from_utf8(val);
+  if(NULL == s)
+    return NULL;
+
+  rv = puz_notes_set(puz, s);
+  drop(s, val);
+
+  return rv;
+}
+
+/**
+ * puz_clue_utf8_set - set the nth clue of a puzzle from UTF-8
+ *
+ * @puz: a pointer to the struct puzzle_t to write to (required)
+ * @n: the index (between zero and n_clues) to set
+ * @val: the clue, in UTF-8 (required)
+ *
+ * Returns NULL on error, else the puzzle's copy in the code page.
+ */
+unsigned char * puz_clue_utf8_set(struct puzzle_t *puz, int n, unsigned char *val) {
+  unsigned char *s, *rv;
+
+  if(NULL == puz || NULL == val)
+    return NULL;
+
+  s = puz_is_unicode(puz) ? val : from_utf8(val);
+  if(NULL == s)
+    return NULL;
+
+  rv = puz_clue_set(puz, n, s);
+  drop(s, val);
+
+  return rv;
+}
+
+/**
+ * puz_version_set - change the file format version of a puzzle
+ *
+ * @puz: a pointer to the struct puzzle_t to write to (required)
+ * @version: the version times ten, eg: 12 for "1.2" or 20 for "2.0"
+ *
+ * Moving between a version 1.x and a version 2.0 puzzle re-encodes
+ * the title, author, copyright, clues and notes, so they say the same
+ * thing in the new encoding.  Characters the code page can't hold
+ * become '?'.  The checksums must be recommitted afterwards.
+ *
+ * Returns -1 on error, 0 on success.
+ */
+int puz_version_set(struct puzzle_t *puz, int version) {
+  int was, is, i;
+
+  if(NULL == puz || version < 10 || version > 99)
+    return -1;
+
+  was = puz_is_unicode(puz);
+  is = version >= PUZ_VERSION_UNICODE;
+
+  if(was != is) {
+    puz_utf8_clear(puz);
+
+    if(convert(&puz->title, is) || convert(&puz->author, is) ||
+       convert(&puz->copyright, is) || convert(&puz->notes, is))
+      return -1;
+    if(puz->notes)
+      puz->notes_sz = Sstrlen(puz->notes);
+
+    for(i = 0; puz->clues && i < puz->header.clue_count; i++) {
+      if(convert(&puz->clues[i], is))
+        return -1;
+    }
+  }
+
+  puz->cold.magic_18[0] = '0' + version / 10;
+  puz->cold.magic_18[1] = '.';
+  puz->cold.magic_18[2] = '0' + version % 10;
+  puz->cold.magic_18[3] = 0;
+
+  return 0;
+}
@@ -0,0 +1,156 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * validate.c -- Structural checks for incoming puzzles
+ */
+
+#include <puz.h>
+
+static int short_words(uint64_t *starts, uint64_t *ends, int min_len);
+static int bad_rebus(struct puzzle_t *puz);
+
+/**
+ * short_words - count the words in a line shorter than a minimum
+ *
+ * @starts: PUZ_BB_WORDS words, the first squares of the line's words
+ * @ends: PUZ_BB_WORDS words, the last squares of the line's words
+ * @min_len: the minimum length
+ *
+ * This is an internal function.  Words don't nest, so the k-th start
+ * always pairs with the k-th end.
+ */
+static int short_words(uint64_t *starts, uint64_t *ends, int min_len) {
+  uint64_t s = starts[0], e = ends[0];
+  int si = 0, ei = 0, first, last, n = 0;
+
+  for(;;) {
+    while(!s && ++si < PUZ_BB_WORDS)
+      s = starts[si];
+    if(si == PUZ_BB_WORDS)
+      break;
+    while(!e && ++ei < PUZ_BB_WORDS)
+      e = ends[ei];
+    if(ei == PUZ_BB_WORDS)
+      break;
+
+    first = si * 64 + __builtin_ctzll(s);
+    last = ei * 64 + __builtin_ctzll(e);
+    if(last - first + 1 < min_len)
+      n++;
+
+    s &= s - 1;
+    e &= e - 1;
+  }
+
+  return n;
+}
+
+/**
+ * bad_rebus - count rebus squares whose key has no rebus table entry
+ *
+ * This is an internal function.
+ */
+static int bad_rebus(struct puzzle_t *puz) {
+  unsigned char have[256];
+  int i, key, bd_sz, n = 0;
+
+  if(NULL == puz->grbs)
+    return 0;
+
+  memset(have, 0, sizeof(have));
+  for(i = 0; puz->rtbl && i < puz->rtbl_sz; i++) {
+    if(NULL == puz->rtbl[i] || NULL == Sstrchr(puz->rtbl[i], ':'))
+      continue;
+    key = Satoi(puz->rtbl[i]);
+    if(key >= 0 && key < 256)
+      have[key] = 1;
+  }
+
+  bd_sz = puz->header.width * puz->header.height;
+  for(i = 0; i < bd_sz; i++) {
+    if(0 == puz->grbs[i])
+      continue;
+    if(puz->solution[i] == '.' || !have[puz->grbs[i] - 1])
+      n++;
+  }
+
+  return n;
+}
+
+/**
+ * puz_validate - check a puzzle's structure
+ *
+ * @puz: the puzzle to check; its solution must be set (required)
+ * @min_len: the shortest acceptable word; 3 for most published puzzles
+ * @report: receives the details (required)
+ *
+ * The slots are derived from the solution via the puzzle's bitboard,
+ * which is computed on load, so this does no per-square work except
+ * for the rebus check.  The checks are:
+ *
+ *  PUZ_INVALID_CLUE_COUNT   slots != header.clue_count
+ *  PUZ_INVALID_DISCONNECTED the white squares form more than one region
+ *  PUZ_INVALID_SHORT_WORD   a word is shorter than min_len
+ *  PUZ_INVALID_UNCHECKED    a white square is in fewer than two words
+ *  PUZ_INVALID_ASYMMETRIC   the black squares lack 180-degree symmetry
+ *  PUZ_INVALID_REBUS        a grbs square has no rtbl entry, or is black
+ *
+ * Return Value: -1 on error, else the PUZ_INVALID_* flags of the
+ * failed checks (0 if the puzzle passed them all).
+ */
+int puz_validate(struct puzzle_t *puz, int min_len,
+                 struct puz_validate_report_t *report) {
+  struct puz_bitboard_t *bb;
+  uint64_t starts[PUZ_BB_WORDS], ends[PUZ_BB_WORDS];
+  int i;
+
+  if(NULL == puz || NULL == report || NULL == puz->solution)
+    return -1;
+
+  bb = puz_bitboard_get(puz);
+  if(NULL == bb)
+    bb = puz_bitboard_calc(puz);
+  if(NULL == bb)
+    return -1;
+
+  memset(report, 0, sizeof(*report));
+  report->clue_count = puz->header.clue_count;
+
+  for(i = 0; i < bb->height; i++) {
+    report->across += puz_bitboard_across_starts(bb, i, starts, ends);
+    report->short_words += short_words(starts, ends, min_len);
+  }
+  for(i = 0; i < bb->width; i++) {
+    report->down += puz_bitboard_down_starts(bb, i, starts, ends);
+    report->short_words += short_words(starts, ends, min_len);
+  }
+  report->slots = report->across + report->down;
+
+  report->unchecked = puz_bitboard_unchecked_count(bb);
+  if(report->unchecked < 0)
+    return -1;
+
+  report->bad_rebus = bad_rebus(puz);
+
+  if(report->slots != report->clue_count)
+    report->flags |= PUZ_INVALID_CLUE_COUNT;
+  if(!puz_bitboard_is_connected(bb))
+    report->flags |= PUZ_INVALID_DISCONNECTED;
+  if(report->short_words)
+    report->flags |= PUZ_INVALID_SHORT_WORD;
+  if(report->unchecked)
+    report->flags |= PUZ_INVALID_UNCHECKED;
+  if(!puz_bitboard_is_symmetric(bb))
+    report->flags |= PUZ_INVALID_ASYMMETRIC;
+  if(report->bad_rebus)
+    report->flags |= PUZ_INVALID_REBUS;
+
+  return report->flags;
+}
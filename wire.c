@@ -0,0 +1,643 @@
+/******************************************************************
+ * libpuz - A .PUZ crossword library
+ * Copyright(c) 2006 Josh Myer <josh@joshisanerd.com>
+ *
+ * This code is released under the terms of the GNU General Public
+ * License version 2 or later.  You should have receieved a copy as
+ * along with this source as the file COPYING.
+ ******************************************************************/
+
+/*
+ * wire.c -- A compact format for sending puzzles to clients
+ */
+
+#include <puz.h>
+
+/*
+  A .puz file spends a lot of its bytes on things a client can work
+  out for itself: the header's checksums, magic and memory noise, a
+  grid that's usually just the solution with the letters blanked, the
+  NUL after every string, and extra sections that are nearly all
+  zeroes.  The wire format leaves those out:
+
+    "PW", PUZ_WIRE_VERSION
+    flags                   varint, WIRE_* below
+    version                 the 4 bytes at 0x18, "1.3\0" and so on
+    x_unk_30                varint
+    scrambled tag, cksum    varints, if WIRE_SCRAMBLED
+    solution                packed; see pack.c
+    grid                    packed, if WIRE_GRID; else it's blank
+    clue count              varint
+    title, author, copyright, the clues, and the notes if WIRE_NOTES
+                            each a varint length and the bytes
+    rebus, if WIRE_REBUS    GRBS as a sparse board, then the number
+                            of RTBL entries and each entry as a string
+    timer, if WIRE_LTIM     a string
+    extras, if WIRE_GEXT    a sparse board
+    user rebus, if WIRE_RUSR
+                            the number of squares with one, and for
+                            each the gap since the last, and a string
+
+  A varint is 7 bits a byte, low first, the top bit set on all but
+  the last.  A sparse board is the number of nonzero squares, and for
+  each the gap since the last one (a varint) and its byte.
+
+  Decoding gives back a struct puzzle_t like puz_load() would, with
+  everything but the header noise as it went in.  Like a puzzle built
+  up by hand, it has no checksums until puz_cksums_commit(), after
+  which puz_save() turns it into a .puz that checks.  Working them out
+  costs about as much again as decoding, and a client that only shows
+  the puzzle never needs them.
+ */
+
+#define WIRE_GRID      0x01
+#define WIRE_NOTES     0x02
+#define WIRE_SCRAMBLED 0x04
+#define WIRE_REBUS     0x08
+#define WIRE_LTIM      0x10
+#define WIRE_GEXT      0x20
+#define WIRE_RUSR      0x40
+
+/* The writer.  With no buffer (or once it runs out) it only counts. */
+struct wire_out_t {
+  unsigned char *p;
+  unsigned char *end;
+  int n;
+  int full;  /* ran out of buffer */
+};
+
+/* The reader; any read past end marks it bad and gets zeroes */
+struct wire_in_t {
+  unsigned char *p;
+  unsigned char *end;
+  int bad;
+};
+
+static void wire_put(struct wire_out_t *w, const void *data, int len);
+static void wire_put_uint(struct wire_out_t *w, unsigned int v);
+static void wire_put_str(struct wire_out_t *w, unsigned char *s);
+static void wire_put_board(struct wire_out_t *w, unsigned char *board,
+                           int width, int height);
+static void wire_put_sparse(struct wire_out_t *w, unsigned char *board,
+                            int bd_sz);
+static int wire_encode(struct puzzle_t *puz, struct wire_out_t *w);
+static unsigned int wire_get_uint(struct wire_in_t *r);
+static unsigned char *wire_get_str(struct wire_in_t *r);
+static unsigned char *wire_get_board(struct wire_in_t *r, int *width,
+                                     int *height);
+static unsigned char *wire_get_sparse(struct wire_in_t *r, int bd_sz);
+static int wire_decode(struct puzzle_t *puz, struct wire_in_t *r);
+
+/**
+ * wire_put - write some bytes
+ *
+ * This is an internal function.
+ */
+static void wire_put(struct wire_out_t *w, const void *data, int len) {
+  if(NULL != w->p && w->end - w->p >= len) {
+    memcpy(w->p, data, len);
+    w->p += len;
+  } else if(NULL != w->p) {
+    w->p = NULL;
+    w->full = 1;
+  }
+  w->n += len;
+}
+
+/**
+ * wire_put_uint - write a varint
+ *
+ * This is an internal function.
+ */
+static void wire_put_uint(struct wire_out_t *w, unsigned int v) {
+  unsigned char b[5];
+  int n = 0;
+
+  /* nearly every length is one byte */
+  if(v < 0x80 && NULL != w->p && w->p < w->end) {
+    *w->p++ = v;
+    w->n++;
+    return;
+  }
+
+  while(v >= 0x80) {
+    b[n++] = (v & 0x7F) | 0x80;
+    v >>= 7;
+  }
+  b[n++] = v;
+
+  wire_put(w, b, n);
+}
+
+/**
+ * wire_put_str - write a string as its length and bytes
+ *
+ * This is an internal function.  A NULL string goes as empty.
+ */
+static void wire_put_str(struct wire_out_t *w, unsigned char *s) {
+  int len = s ? Sstrlen(s) : 0;
+
+  wire_put_uint(w, len);
+  wire_put(w, s, len);
+}
+
+/**
+ * wire_put_board - write a board packed 5 bits a square
+ *
+ * This is an internal function.
+ */
+static void wire_put_board(struct wire_out_t *w, unsigned char *board,
+                           int width, int height) {
+  int len;
+
+  if(NULL != w->p) {
+    len = puz_pack(board, width, height, w->p, w->end - w->p);
+    if(len >= 0) {
+      w->p += len;
+      w->n += len;
+      return;
+    }
+    w->p = NULL;
+    w->full = 1;
+  }
+
+  w->n += puz_pack_size(board, width, height);
+}
+
+/**
+ * wire_put_sparse - write a mostly-zero board as its nonzero squares
+ *
+ * This is an internal function.
+ */
+static void wire_put_sparse(struct wire_out_t *w, unsigned char *board,
+                            int bd_sz) {
+  int i, n = 0, last = -1;
+
+  for(i = 0; i < bd_sz; i++)
+    n += board[i] != 0;
+
+  wire_put_uint(w, n);
+  for(i = 0; i < bd_sz; i++) {
+    if(!board[i])
+      continue;
+    wire_put_uint(w, i - last - 1);
+    wire_put(w, board + i, 1);
+    last = i;
+  }
+}
+
+/**
+ * wire_encode - write a puzzle in the wire format
+ *
+ * @puz: the puzzle
+ * @w: where to
+ *
+ * This is an internal function, behind puz_wire_size() and
+ * puz_wire_encode().
+ *
+ * Return Value: -1 if the puzzle can't be encoded, else 0.
+ */
+static int wire_encode(struct puzzle_t *puz, struct wire_out_t *w) {
+  static const unsigned char magic[3] = { 'P', 'W', PUZ_WIRE_VERSION };
+  unsigned char *sol, *grid, diff = 0;
+  int i, n, bd_sz, flags = 0, last;
+
+  if(NULL == puz->solution || NULL == puz->grid)
+    return -1;
+
+  /* no early exit, so it vectorizes */
+  bd_sz = puz->header.width * puz->header.height;
+  sol = puz->solution;
+  grid = puz->grid;
+  for(i = 0; i < bd_sz; i++)
+    diff |= grid[i] ^ (sol[i] == '.' ? '.' : '-');
+  if(diff)
+    flags |= WIRE_GRID;
+  if(NULL != puz->notes)
+    flags |= WIRE_NOTES;
+  if(puz->header.scrambled_tag)
+    flags |= WIRE_SCRAMBLED;
+  if(puz_has_rebus(puz))
+    flags |= WIRE_REBUS;
+  if(puz_has_timer(puz))
+    flags |= WIRE_LTIM;
+  if(puz_has_extras(puz))
+    flags |= WIRE_GEXT;
+  if(puz_has_rusr(puz))
+    flags |= WIRE_RUSR;
+
+  wire_put(w, magic, 3);
+  wire_put_uint(w, flags);
+  wire_put(w, puz->cold.magic_18, 4);
+  wire_put_uint(w, puz->header.x_unk_30);
+  if(flags & WIRE_SCRAMBLED) {
+    wire_put_uint(w, puz->header.scrambled_tag);
+    wire_put_uint(w, puz->cold.scrambled_cksum);
+  }
+
+  wire_put_board(w, puz->solution, puz->header.width, puz->header.height);
+  if(flags & WIRE_GRID)
+    wire_put_board(w, puz->grid, puz->header.width, puz->header.height);
+
+  wire_put_uint(w, puz->header.clue_count);
+  wire_put_str(w, puz->title);
+  wire_put_str(w, puz->author);
+  wire_put_str(w, puz->copyright);
+  for(i = 0; i < puz->header.clue_count; i++)
+    wire_put_str(w, puz->clues[i]);
+  if(flags & WIRE_NOTES)
+    wire_put_str(w, puz->notes);
+
+  if(flags & WIRE_REBUS) {
+    wire_put_sparse(w, puz->grbs, bd_sz);
+    wire_put_uint(w, puz->rtbl_sz);
+    for(i = 0; i < puz->rtbl_sz; i++)
+      wire_put_str(w, puz->rtbl[i]);
+  }
+
+  if(flags & WIRE_LTIM)
+    wire_put_str(w, puz->ltim);
+
+  if(flags & WIRE_GEXT)
+    wire_put_sparse(w, puz->gext, bd_sz);
+
+  if(flags & WIRE_RUSR) {
+    for(i = n = 0; i < bd_sz; i++)
+      n += NULL != puz->rusr[i];
+    wire_put_uint(w, n);
+    for(i = 0, last = -1; i < bd_sz; i++) {
+      if(NULL == puz->rusr[i])
+        continue;
+      wire_put_uint(w, i - last - 1);
+      wire_put_str(w, puz->rusr[i]);
+      last = i;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * puz_wire_size - how big a puzzle will be in the wire format
+ *
+ * @puz: the puzzle
+ *
+ * Return Value: the number of bytes puz_wire_encode() needs, or -1
+ * on error.
+ */
+int puz_wire_size(struct puzzle_t *puz) {
+  struct wire_out_t w;
+
+  if(NULL == puz)
+    return -1;
+
+  memset(&w, 0, sizeof(w));
+  if(wire_encode(puz, &w) < 0)
+    return -1;
+
+  return w.n;
+}
+
+/**
+ * puz_wire_encode - write a puzzle in the compact wire format
+ *
+ * @puz: the puzzle (required)
+ * @base: buffer to write into (required)
+ * @sz: size of the buffer; puz_wire_size() says how much is needed
+ *
+ * The stored checksums aren't sent, and puz_wire_decode() doesn't
+ * work them out: whoever decodes calls puz_cksums_commit() before
+ * puz_save().
+ *
+ * Return Value: -1 on error or if the buffer is too small, else the
+ * number of bytes written.
+ */
+int puz_wire_encode(struct puzzle_t *puz, unsigned char *base, int sz) {
+  struct wire_out_t w;
+
+  if(NULL == puz || NULL == base || sz < 0)
+    return -1;
+
+  w.p = base;
+  w.end = base + sz;
+  w.n = 0;
+  w.full = 0;
+  if(wire_encode(puz, &w) < 0 || w.full)
+    return -1;
+
+  return w.n;
+}
+
+/**
+ * wire_get_uint - read a varint
+ *
+ * This is an internal function.
+ */
+static unsigned int wire_get_uint(struct wire_in_t *r) {
+  unsigned int v = 0;
+  int shift;
+
+  for(shift = 0; shift < 32; shift += 7) {
+    if(r->p >= r->end) {
+      r->bad = 1;
+      return 0;
+    }
+    v |= (unsigned int)(*r->p & 0x7F) << shift;
+    if(!(*r->p++ & 0x80))
+      return v;
+  }
+
+  r->bad = 1;
+  return 0;
+}
+
+/**
+ * wire_get_str - read a string
+ *
+ * This is an internal function.
+ *
+ * Return Value: a newly malloc'd copy, or NULL if the input is bad.
+ */
+static unsigned char *wire_get_str(struct wire_in_t *r) {
+  unsigned int len = wire_get_uint(r);
+  unsigned char *s;
+
+  if(r->bad || len > (unsigned int)(r->end - r->p)) {
+    r->bad = 1;
+    return NULL;
+  }
+
+  s = (unsigned char *)malloc(len + 1);
+  if(NULL == s) {
+    perror("malloc");
+    r->bad = 1;
+    return NULL;
+  }
+  memcpy(s, r->p, len);
+  s[len] = 0;
+  r->p += len;
+
+  return s;
+}
+
+/**
+ * wire_get_board - read a packed board
+ *
+ * @r: the reader
+ * @width: receives its width
+ * @height: receives its height
+ *
+ * This is an internal function.
+ *
+ * Return Value: the board, newly malloc'd and NUL-terminated, or NULL
+ * if the input is bad.
+ */
+static unsigned char *wire_get_board(struct wire_in_t *r, int *width,
+                                     int *height) {
+  unsigned char *board;
+  int len = puz_pack_length(r->p, r->end - r->p);
+
+  if(r->bad || len < 0) {
+    r->bad = 1;
+    return NULL;
+  }
+
+  *width = puz_pack_width(r->p);
+  *height = puz_pack_height(r->p);
+  board = (unsigned char *)malloc(*width * *height + 1);
+  if(NULL == board) {
+    perror("malloc");
+    r->bad = 1;
+    return NULL;
+  }
+
+  if(puz_unpack(r->p, len, board) < 0) {
+    free(board);
+    r->bad = 1;
+    return NULL;
+  }
+  board[*width * *height] = 0;
+  r->p += len;
+
+  return board;
+}
+
+/**
+ * wire_get_sparse - read a sparse board
+ *
+ * This is an internal function.
+ *
+ * Return Value: the board, newly malloc'd, or NULL if the input is
+ * bad.
+ */
+static unsigned char *wire_get_sparse(struct wire_in_t *r, int bd_sz) {
+  unsigned char *board;
+  unsigned int i, n = wire_get_uint(r), at = 0;
+
+  if(r->bad || n > (unsigned int)bd_sz) {
+    r->bad = 1;
+    return NULL;
+  }
+
+  board = (unsigned char *)calloc(bd_sz, 1);
+  if(NULL == board) {
+    perror("calloc");
+    r->bad = 1;
+    return NULL;
+  }
+
+  for(i = 0; i < n; i++) {
+    at += wire_get_uint(r);
+    if(r->bad || at >= (unsigned int)bd_sz || r->p >= r->end) {
+      free(board);
+      r->bad = 1;
+      return NULL;
+    }
+    board[at++] = *r->p++;
+  }
+
+  return board;
+}
+
+/**
+ * wire_decode - read a puzzle in the wire format
+ *
+ * @puz: a puzzle fresh from puz_init(), to fill in
+ * @r: the reader
+ *
+ * This is an internal function.  On failure, @puz holds whatever was
+ * read so far, for puz_deep_free().
+ *
+ * Return Value: -1 if the input is bad, else its WIRE_* flags.
+ */
+static int wire_decode(struct puzzle_t *puz, struct wire_in_t *r) {
+  unsigned int i, n, at;
+  int flags, width, height, bd_sz;
+
+  if(r->end - r->p < 7 || r->p[0] != 'P' || r->p[1] != 'W' ||
+     r->p[2] != PUZ_WIRE_VERSION)
+    return -1;
+  r->p += 3;
+
+  flags = wire_get_uint(r) & 0x7F;
+  if(r->end - r->p < 4)
+    return -1;
+  memcpy(puz->cold.magic_18, r->p, 4);
+  r->p += 4;
+  puz->header.x_unk_30 = wire_get_uint(r);
+  if(flags & WIRE_SCRAMBLED) {
+    puz->header.scrambled_tag = wire_get_uint(r);
+    puz->cold.scrambled_cksum = wire_get_uint(r);
+  }
+
+  puz->solution = wire_get_board(r, &width, &height);
+  if(NULL == puz->solution)
+    return -1;
+  puz->header.width = width;
+  puz->header.height = height;
+  bd_sz = width * height;
+
+  if(flags & WIRE_GRID) {
+    puz->grid = wire_get_board(r, &width, &height);
+    if(NULL == puz->grid || width != puz->header.width ||
+       height != puz->header.height)
+      return -1;
+  } else {
+    puz->grid = (unsigned char *)malloc(bd_sz + 1);
+    if(NULL == puz->grid) {
+      perror("malloc");
+      return -1;
+    }
+    for(i = n = at = 0; i < (unsigned int)bd_sz; i++) {
+      puz->grid[i] = puz->solution[i] == '.' ? '.' : '-';
+      n += puz->solution[i] != '.';
+      at += puz->solution[i] == '-';
+    }
+    puz->grid[bd_sz] = 0;
+    puz->cells_total = n;
+    puz->cells_correct = at;
+  }
+
+  /* every clue takes at least its length byte */
+  n = wire_get_uint(r);
+  if(r->bad || n > 0xFFFF || n > (unsigned int)(r->end - r->p))
+    return -1;
+  puz->clues = (unsigned char **)calloc(n, sizeof(unsigned char *));
+  if(NULL == puz->clues && n) {
+    perror("calloc");
+    return -1;
+  }
+  puz->header.clue_count = n;
+
+  puz->title = wire_get_str(r);
+  puz->author = wire_get_str(r);
+  puz->copyright = wire_get_str(r);
+  for(i = 0; i < n && !r->bad; i++)
+    puz->clues[i] = wire_get_str(r);
+  if(flags & WIRE_NOTES) {
+    puz->notes = wire_get_str(r);
+    if(NULL != puz->notes)
+      puz->notes_sz = Sstrlen(puz->notes);
+  }
+  if(r->bad)
+    return -1;
+
+  if(flags & WIRE_REBUS) {
+    puz->grbs = wire_get_sparse(r, bd_sz);
+    n = wire_get_uint(r);
+    if(r->bad || n > (unsigned int)(r->end - r->p))
+      return -1;
+    puz->rtbl = (unsigned char **)calloc(n, sizeof(unsigned char *));
+    if(NULL == puz->rtbl && n) {
+      perror("calloc");
+      return -1;
+    }
+    puz->rtbl_sz = n;
+    for(i = 0; i < n && !r->bad; i++)
+      puz->rtbl[i] = wire_get_str(r);
+  }
+
+  if(flags & WIRE_LTIM)
+    puz->ltim = wire_get_str(r);
+
+  if(flags & WIRE_GEXT)
+    puz->gext = wire_get_sparse(r, bd_sz);
+
+  if(flags & WIRE_RUSR && !r->bad) {
+    puz->rusr = (unsigned char **)calloc(bd_sz, sizeof(unsigned char *));
+    if(NULL == puz->rusr) {
+      perror("calloc");
+      return -1;
+    }
+    puz->rusr_sz = bd_sz;
+    n = wire_get_uint(r);
+    if(n > (unsigned int)bd_sz)
+      return -1;
+    for(i = 0, at = 0; i < n && !r->bad; i++) {
+      at += wire_get_uint(r);
+      if(at >= (unsigned int)bd_sz)
+        return -1;
+      puz->rusr[at] = wire_get_str(r);
+      if(NULL != puz->rusr[at])
+        puz->rusr_sz += Sstrlen(puz->rusr[at]);
+      at++;
+    }
+  }
+
+  return r->bad ? -1 : flags;
+}
+
+/**
+ * puz_wire_decode - read a puzzle in the compact wire format
+ *
+ * @puz: pointer to the struct puzzle_t to fill in.  If NULL, will be
+ *   allocated for you.
+ * @base: the encoded puzzle (required)
+ * @sz: its size
+ *
+ * The input is checked as it's read, so it may come from anywhere.
+ * The bitboard and completion state are calculated, as by puz_load().
+ * The checksums aren't: call puz_cksums_commit() before puz_save().
+ * If the decode fails, a @puz passed in is left untouched.
+ *
+ * Return Value: NULL on error, else a pointer to the filled-in struct
+ * puzzle_t.  If puz was NULL, this pointer is the newly-allocated
+ * puzzle_t.
+ */
+struct puzzle_t *puz_wire_decode(struct puzzle_t *puz, unsigned char *base,
+                                 int sz) {
+  struct puzzle_t *p;
+  struct wire_in_t r;
+  int flags;
+
+  if(NULL == base || sz < 0)
+    return NULL;
+
+  p = puz_init(NULL);
+  if(NULL == p)
+    return NULL;
+
+  r.p = base;
+  r.end = base + sz;
+  r.bad = 0;
+  flags = wire_decode(p, &r);
+  if(flags < 0) {
+    puz_deep_free(p);
+    return NULL;
+  }
+
+  /* a blank grid's completion state came with it, unless the rebus
+     squares complicate it */
+  puz_bitboard_calc(p);
+  if(flags & (WIRE_GRID | WIRE_REBUS | WIRE_RUSR))
+    puz_progress_calc(p);
+
+  if(NULL == puz)
+    return p;
+
+  /* the strings and boards now belong to @puz */
+  memcpy(puz, p, sizeof(struct puzzle_t));
+  free(p);
+
+  return puz;
+}